@@ -0,0 +1,84 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  Appearance
+  ----------
+
+  A small colour histogram per blob, so the BlobTracker can tell blobs 
+  apart that are close together and can pick up a track again after it 
+  was lost for a few frames (e.g. during an occlusion).
+
+  The histograms are made on the GPU (see AppearanceTiles.h) for a grid of
+  tiles of `tile_size` x `tile_size` pixels: every tile counts the colours
+  of its foreground pixels in APPEARANCE_NUM_BINS bins. That table is read
+  back together with the mask, so the BlobTracker gets the histogram of a 
+  blob by adding the tiles that its bounding box covers; it never touches
+  the pixels. Foreground pixels of another blob that shares a tile are 
+  counted too, so keep the tiles small compared to the blobs.
+
+  The first 12 bins are hues, the last 4 are brightness levels for pixels 
+  without much colour (grey, black and white clothes). A descriptor is 
+  normalized and two of them are compared with appearance_distance(), 
+  which is 0 for equal histograms and 1 when they have nothing in common.
+
+  ````c++
+  AppearanceDescriptor desc;
+  if(table.getDescriptor(min_x, min_y, max_x, max_y, desc)) {
+    float d = appearance_distance(desc, blob.appearance);
+  }
+  ````
+
+ */
+#ifndef TRACKER_APPEARANCE_H
+#define TRACKER_APPEARANCE_H
+
+#include <vector>
+#include <tracker/Latency.h>
+
+#define APPEARANCE_NUM_BINS 16                                     /* 12 hues + 4 grey levels */
+
+struct AppearanceDescriptor {
+  AppearanceDescriptor();
+  void mix(const AppearanceDescriptor& other, float amount);       /* Moves `amount` [0, 1] towards other and normalizes */
+  float bins[APPEARANCE_NUM_BINS];                                 /* Normalized histogram; sums to 1 when num_pixels > 0 */
+  float num_pixels;                                                /* Number of foreground pixels we counted; 0 means we don't know the appearance */
+};
+
+/* ---------------------------------------------------*/
+
+class AppearanceTable {
+ public:
+  AppearanceTable();
+  void resize(int w, int h, int tileSize);                         /* Sets the grid for images of w x h and clears the table */
+  bool getDescriptor(int minX, int minY, int maxX, int maxY, AppearanceDescriptor& result); /* Adds the tiles that overlap the box (inclusive, in pixels); returns false when there are no foreground pixels */
+
+ public:
+  int tile_size;
+  int tiles_x;                                                     /* Number of tiles per row */
+  int tiles_y;                                                     /* Number of rows */
+  std::vector<float> values;                                       /* Per tile, row by row, APPEARANCE_NUM_BINS pixel counts */
+  FrameInfo frame;                                                 /* The frame the table was made from; frame.id is 0 while empty */
+};
+
+/* ---------------------------------------------------*/
+
+float appearance_distance(const AppearanceDescriptor& a, const AppearanceDescriptor& b); /* Hellinger distance [0, 1] between two normalized histograms */
+
+#endif
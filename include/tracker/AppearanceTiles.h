@@ -0,0 +1,145 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  AppearanceTiles
+  ---------------
+
+  Makes the AppearanceTable (see Appearance.h) on the GPU: one pass counts
+  the colours of the foreground pixels for every tile of `tile_size` x 
+  `tile_size` pixels, and we read the result into one of two pack buffers,
+  just like the Tracker reads back the mask. update() copies the table of 
+  the previous frame, so it belongs to the same frame as the mask that the
+  Tracker copies at that moment.
+
+  The colours come from an RGB(A) texture of the mask size; pass flipY 
+  when its rows are mirrored compared to the mask (BG_INGEST_FLIP_Y). The 
+  Tracker can't make an appearance from a luma texture that was added with
+  addTexture() without conversion (BG_FORMAT_LUMA and LUMA_CHROMA); it 
+  logs an error and disables the appearance.
+
+  The output texture has 4 RGBA32F texels per tile (4 bins per texel) and 
+  a texel loops over the pixels of its tile, so a pixel is read 4 times. 
+  For 1280 x 960 with tiles of 16 x 16 we read back 300KB per frame. 
+
+  ````c++
+  AppearanceTiles appearance(tracker.w, tracker.h, 16);
+  tracker.appearance = &appearance;
+  tracker.apply();                  // blobs get an `appearance` descriptor
+  ````
+
+  When you don't use the Tracker, add the pass to your own graph with 
+  apply(), call update() when you copy the mask of the previous frame and
+  set `blobs.appearance = &appearance.table`.
+
+ */
+#ifndef TRACKER_APPEARANCE_TILES_H
+#define TRACKER_APPEARANCE_TILES_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+
+#define ROXLU_USE_OPENGL
+#include <tinylib.h>
+#include <tracker/Appearance.h>
+#include <tracker/ProgramCache.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/Timings.h>
+#include <tracker/Latency.h>
+
+/* Keep the bins in sync with APPEARANCE_NUM_BINS and the description in Appearance.h. */
+static const char* APPEARANCE_TILES_FS = ""
+  "#version 330\n"
+  "uniform sampler2D u_color;"
+  "uniform sampler2D u_mask;"
+  "uniform int u_tile_size;"
+  "uniform int u_flip;"
+  "layout( location = 0 ) out vec4 fragcolor;"
+  ""
+  "int appearance_bin(vec3 c) {"
+  "  float hi = max(c.r, max(c.g, c.b));"
+  "  float lo = min(c.r, min(c.g, c.b));"
+  "  float d = hi - lo;"
+  "  if(hi < 0.1 || d < 0.2 * hi) {"
+  "    return 12 + min(int(hi * 4.0), 3);"
+  "  }"
+  "  float hue = 0.0;"
+  "  if(hi == c.r)      { hue = mod((c.g - c.b) / d, 6.0); }"
+  "  else if(hi == c.g) { hue = (c.b - c.r) / d + 2.0;     }"
+  "  else               { hue = (c.r - c.g) / d + 4.0;     }"
+  "  return min(int(hue * 2.0), 11);"
+  "}"
+  ""
+  "void main() {"
+  "  ivec2 p = ivec2(gl_FragCoord.xy);"
+  "  int group = p.x % 4;"
+  "  ivec2 size = textureSize(u_mask, 0);"
+  "  vec2 texel = 1.0 / vec2(size);"
+  "  ivec2 start = ivec2(p.x / 4, p.y) * u_tile_size;"
+  "  ivec2 end = min(start + ivec2(u_tile_size), size);"
+  "  vec4 counts = vec4(0.0);"
+  "  for(int j = start.y; j < end.y; ++j) {"
+  "    for(int i = start.x; i < end.x; ++i) {"
+  "      if(texelFetch(u_mask, ivec2(i, j), 0).r < 0.5) {"
+  "        continue;"
+  "      }"
+  "      vec2 uv = (vec2(i, j) + 0.5) * texel;"
+  "      if(1 == u_flip) {"
+  "        uv.y = 1.0 - uv.y;"
+  "      }"
+  "      int bin = appearance_bin(texture(u_color, uv).rgb);"
+  "      if(bin / 4 == group) {"
+  "        counts[bin % 4] += 1.0;"
+  "      }"
+  "    }"
+  "  }"
+  "  fragcolor = counts;"
+  "}"
+  "";
+
+class AppearanceTiles {
+ public:
+  AppearanceTiles(int w, int h, int tileSize = 16);
+  ~AppearanceTiles();
+  void apply(RenderGraph& graph, GLuint colorTex, GLuint maskTex, const FrameInfo& frame, bool flipY = false); /* Adds the histogram pass and the read back into the current pack buffer; colorTex must be RGB(A), flipY when its rows are mirrored compared to maskTex */
+  bool update();                                                   /* Copies the read back of the previous apply() into `table` and toggles the pack buffers; returns false when there was none */
+  size_t getNumBytes();                                            /* Number of bytes of VRAM we use */
+
+ private:
+  bool setup();                                                    /* Creates the texture, FBO and pack buffers on first use */
+
+ public:
+  int w;                                                           /* Size of the mask */
+  int h;
+  int tile_size;
+  int out_w;                                                       /* Size of the output texture: 4 texels per tile */
+  int out_h;
+  GLuint fullscreen_vao;
+  GLuint prog;
+  GLint u_tile_size;
+  GLint u_flip;
+  GLuint fbo;
+  GLuint tex;                                                      /* RGBA32F, out_w x out_h */
+  GLuint pbos[2];                                                  /* We read into pbos[pbo_toggle] and copy from the other one */
+  int pbo_toggle;
+  FrameInfo pbo_frames[2];                                         /* The frames whose tables are in the pack buffers */
+  AppearanceTable table;                                           /* The last table we copied; pass this to BlobTracker::appearance */
+};
+
+#endif
@@ -41,6 +41,78 @@
   buffer to make it work better with slowly moving objects. E.g. the `num`
   you pass basically represents the history time. Max. value depends on your
   GPU (the number of sampler2D)
+
+  History formats
+  ---------------
+  By default every history slot is a full GL_RGBA8 texture. For long histories,
+  or on embedded GPUs with little memory, you can pass one of the compact
+  formats below as `fmt` to the constructor. The distance metric is adapted
+  to whatever the slots store:
+
+    - BG_FORMAT_RGBA8:         4 bytes per pixel, RGB distance (the default).
+    - BG_FORMAT_RGB565:        2 bytes per pixel, RGB distance. Needs GL_RGB565 
+                               to be color renderable (GL 4.1+, GLES).
+    - BG_FORMAT_LUMA:          1 byte per pixel, luma distance. Cheapest, but 
+                               changes in color with the same brightness are missed.
+    - BG_FORMAT_LUMA_CHROMA:   1.5 bytes per pixel, YUV distance. Full resolution luma
+                               plus half resolution chroma, stored NV12 style in one 
+                               GL_R8 texture of w x (h + h/2) so each history slot 
+                               still uses only one sampler. Needs an even width.
+
+  For the luma formats you still draw your RGB input between beginFrame() and 
+  endFrame(); we render it into one RGBA capture buffer and convert it into the 
+  history slot in endFrame().
+
+  Instead of drawing you can also upload RGBA pixels with uploadFrame(). For
+  BG_FORMAT_RGBA8 and BG_FORMAT_RGB565 they go straight into the history slot
+  (no draw call), for the luma formats into the capture buffer which we convert
+  as usual. Bind a GL_PIXEL_UNPACK_BUFFER and pass an offset to upload
+  asynchronously, see CaptureIngest.h.
+
+  Texture ingest
+  --------------
+  When your frame is already in a texture (e.g. the texture of the capture
+  library) use addTexture() instead of drawing it between beginFrame() and
+  endFrame(). When the texture has the same internal format and size as the
+  history slots (w x h, or w x (h + h/2) NV12 style for BG_FORMAT_LUMA_CHROMA)
+  we don't draw at all:
+
+    - BG_INGEST_COPY:       we copy it into the history slot with glCopyImageSubData()
+                            (GL 4.3+, a framebuffer blit otherwise).
+    - BG_INGEST_REFERENCE:  we don't copy; the history slot uses your texture until
+                            it's overwritten `num` frames later. You must not change
+                            the texture during that time, e.g. use a pool of `num + 1`
+                            capture textures.
+
+  Otherwise we run the conversion shader into the slot; then the texture must be
+  w x h and RGB(A). By default the texture is used like it is stored: the first row
+  (t = 0) is the bottom of the scene, which is what you get when you render into it.
+  When its first row is the top of the scene (e.g. uploaded from a camera buffer),
+  pass BG_INGEST_FLIP_Y; this always needs the conversion shader.
+
+  Long horizon history
+  --------------------
+  With only `num` consecutive frames the background model forgets very quickly, 
+  at 60fps 10 frames is just 1/6th of a second; people who stand still or move 
+  slowly get merged into the background. Call setupLongHistory() to keep an extra 
+  ring of `longNum` frames of which we only store every `interval`-th frame. The
+  long ring is averaged into one 16 bit float texture once every `interval` frames,
+  so per frame we only sample one extra texture. The background model becomes:
+
+        mix(short_average, long_average, weight)
+
+  E.g. `BackgroundBuffer bg(w, h, 8); bg.setupLongHistory(16, 30, 0.5);` keeps 
+  the last 8 frames plus 16 frames sampled every 30th frame; that's a horizon of 
+  8 seconds at 60fps instead of 1/6th of a second.
+
+  Bootstrap and snapshots
+  -----------------------
+  With `bootstrap` set (the default) the first frame is copied into all 
+  history slots (and long history slots), so the background model is 
+  the first frame instead of black and the first masks are clean instead 
+  of all foreground. To continue with the history of an earlier run, save
+  it with saveHistory() and load it with loadHistory() before the first 
+  frame; see Snapshot.h and Tracker::saveSnapshot(). 
   
 
  */
@@ -52,6 +124,12 @@
 
 #define ROXLU_USE_OPENGL
 #include <tinylib.h>
+#include <tracker/ProgramCache.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/Timings.h>
+#include <tracker/Snapshot.h>
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 static const char* BG_BUFFER_VS = ""
@@ -75,6 +153,61 @@ static const char* BG_BUFFER_VS = ""
   "}"
   "";
 
+static const char* BG_BUFFER_CONVERT_FS = ""
+  "uniform sampler2D u_tex;\n"
+  "uniform int u_flip;\n"
+  "layout( location = 0 ) out vec4 fragcolor;\n"
+  "float luma(vec3 c) { return dot(c, vec3(0.299, 0.587, 0.114)); }\n"
+  "vec3 fetch(ivec2 q) {\n"
+  "  q = min(q, ivec2(W - 1, H - 1));\n"
+  "  if(u_flip == 1) { q.y = H - 1 - q.y; }\n"
+  "  return texelFetch(u_tex, q, 0).rgb;\n"
+  "}\n"
+  "void main() {\n"
+  "  ivec2 p = ivec2(gl_FragCoord.xy);\n"
+  "  fragcolor = vec4(0.0, 0.0, 0.0, 1.0);\n"
+  "#if defined(BG_CONVERT_COPY)\n"
+  "  fragcolor.rgb = fetch(p);\n"
+  "  return;\n"
+  "#endif\n"
+  "  if(p.y < H) {\n"
+  "    fragcolor.r = luma(fetch(p));\n"
+  "    return;\n"
+  "  }\n"
+  "  ivec2 c = ivec2(p.x / 2, p.y - H) * 2;\n"
+  "  vec3 rgb = fetch(c)\n"
+  "           + fetch(c + ivec2(1, 0))\n"
+  "           + fetch(c + ivec2(0, 1))\n"
+  "           + fetch(c + ivec2(1, 1));\n"
+  "  rgb *= 0.25;\n"
+  "  float y = luma(rgb);\n"
+  "  fragcolor.r = ((p.x & 1) == 0) ? (rgb.b - y) * 0.564 + 0.5 : (rgb.r - y) * 0.713 + 0.5;\n"
+  "}\n"
+  "";
+
+enum BackgroundBufferFormat {
+  BG_FORMAT_RGBA8,                                                 /* Full RGBA history slots (default) */
+  BG_FORMAT_RGB565,                                                /* 16 bit RGB history slots */
+  BG_FORMAT_LUMA,                                                  /* GL_R8 luma only history slots */
+  BG_FORMAT_LUMA_CHROMA                                            /* GL_R8 full-res luma + half-res chroma (NV12 layout) */
+};
+
+enum BackgroundIngestFlags {
+  BG_INGEST_COPY = 0x00,                                           /* Copy the texture into the history slot */
+  BG_INGEST_REFERENCE = 0x01,                                      /* Use the texture as history slot without copying, when the format allows it */
+  BG_INGEST_FLIP_Y = 0x02                                          /* The first row of the texture is the top of the scene */
+};
+
+static const char* BG_BUFFER_ACCUM_FS = ""
+  "#version 330\n"
+  "uniform sampler2D u_tex;"
+  "uniform float u_weight;"
+  "layout( location = 0 ) out vec4 fragcolor;"
+  "void main() {"
+  "  fragcolor = texelFetch(u_tex, ivec2(gl_FragCoord.xy), 0) * u_weight;"
+  "}"
+  "";
+
 struct BackgroundFBO {
   GLuint fbo;
   GLuint tex;
@@ -82,38 +215,97 @@ struct BackgroundFBO {
 
 class BackgroundBuffer {
  public:
-  BackgroundBuffer(int w, int h, int num);                         /* Create a background buffer/segmentation with the width/height (w/h) and num numbers of frames */
-  BackgroundFBO createBuffer();                                    /* We create `num` fbos with one color attachment */
+  BackgroundBuffer(int w, int h, int num, int fmt = BG_FORMAT_RGBA8); /* Create a background buffer/segmentation with the width/height (w/h) and num numbers of frames, `fmt` is one of the BackgroundBufferFormat values */
+  BackgroundFBO createBuffer(GLenum internalFormat, int texW, int texH); /* We create `num` fbos with one color attachment */
   void beginFrame();                                               /* Begin grabbing a frame. Between beginFrame() and endFrame() you should draw your raw input */
   void endFrame();                                                 /* End grabbing a frame. "" "" "" */
-  void resize(int winW, int winH);                                 /* When your viewport resizes call this. */
+  void uploadFrame(const GLvoid* pixels);                          /* Instead of beginFrame()/endFrame(): uploads w * h RGBA pixels, last row first (like glTexSubImage2D), or an offset into the bound GL_PIXEL_UNPACK_BUFFER */
+  bool addTexture(GLuint tex, int flags = BG_INGEST_COPY);         /* Instead of beginFrame()/endFrame(): adds the frame in `tex` to the history, see "Texture ingest" above. */
+  void resize(int winW, int winH);                                 /* Does nothing; kept for existing callers. We restore the viewport and framebuffer that were bound before beginFrame() */
   GLuint apply();                                                  /* Returns the texture that contains the current background model. We return the texture that contains the one channel (GL_R8) segmented image  */
-  GLuint getLastUpdatedTexture();                                  /* Returns the texture id that contains the latest frame */
+  GLuint apply(RenderGraph& graph);                                /* Adds the background subtraction pass to the graph; returns the texture that will contain the segmented image, a transient target when the graph has a pool */
+  GLuint getLastUpdatedTexture();                                  /* Returns the texture id that contains the latest (RGB) frame */
+  bool getColorTexture(GLuint& tex, bool& flipY);                  /* Sets tex to the latest frame in colour and flipY when its rows are mirrored compared to the mask; false when we only have its luma (a luma texture added without conversion) */
+  size_t getNumBytes();                                            /* Returns the number of bytes of VRAM used by the history, capture and output textures (not the targets of a RenderTargetPool) */
+  bool setupLongHistory(int longNum, int interval, float weight);  /* Keep `longNum` extra frames, sampled every `interval` frames, that make up `weight` (0-1) of the background model. */
+  void getSnapshotInfo(SnapshotHeader& hdr);                       /* Fills the history fields of a snapshot header */
+  bool saveHistory(TrackerSnapshot& snap);                         /* Reads the history slots into a snapshot that was created with the header of getSnapshotInfo() */
+  bool loadHistory(TrackerSnapshot& snap);                         /* Uploads the history of a snapshot; the size, format and number of slots must match */
+
+ private:
+  bool setupShader();                                              /* (Re)generates the background subtraction shader. */
+  bool setupConvertShader();                                       /* Creates convert_prog; converts (luma formats) or copies (RGB formats) a texture into a slot */
+  void copyTexture(GLuint src, size_t slot);                       /* Copies a texture with the same format and size into the history slot */
+  bool setupOutput();                                              /* Creates fbo/out_tex; only used when we don't draw into a RenderTargetPool target */
+  void saveCallerState();                                          /* Stores the viewport and framebuffers that we restore in finishFrame() */
+  void finishFrame();                                              /* Updates the long history and moves to the next slot; the end of endFrame(), uploadFrame() and addTexture() */
+  void updateLongHistory();                                        /* Copies the current frame into the long history and recalculates the long term average. */
+  void copyToLongHistory();                                        /* Copies the current frame into the next long history slot */
+  void updateLongAverage();                                        /* Recalculates the long term average from the long history slots */
+  void bootstrapHistory();                                         /* Copies the current frame into all history slots */
+  void getPixelFormat(GLenum& format, GLenum& type, size_t& bytesPerPixel); /* The format and type we use to read and upload history slots */
+  bool needsConversion();                                          /* Returns true when the history slots can't be drawn into directly and we convert from the capture buffer */
+  std::string getSampleFunction();                                 /* Returns the GLSL function which fetches a history value for the current format */
  public:
   size_t index;                                                    /* Current index for the texture that we fill between beginFrame()/endFrame() */
   int w;                                                           /* The width of the textures */
   int h;                                                           /* The height of the textures */
-  int win_w;                                                       /* The window width (we reset the viewport after endFrame()). */
-  int win_h;                                                       /* The window height */
+  GLint caller_viewport[4];                                        /* The viewport before beginFrame(), uploadFrame() or addTexture(); restored when the frame is added */
+  GLint caller_draw_fbo;                                           /* The draw framebuffer "" "" */
+  GLint caller_read_fbo;                                           /* The read framebuffer "" "" */
   int num;                                                         /* Number of frames in our buffer */
+  int fmt;                                                         /* The BackgroundBufferFormat of the history slots */
+  GLenum slot_format;                                              /* The GL internal format of the history slots */
+  int slot_h;                                                      /* The height of the history slots; h * 1.5 for BG_FORMAT_LUMA_CHROMA */
   std::vector<BackgroundFBO> buffers;                              /* The FBOs + Textures (on GL_COLOR_ATTACHMENT0) */
+  std::vector<GLuint> slot_tex;                                    /* The texture we sample for each history slot; buffers[i].tex or a texture added with BG_INGEST_REFERENCE */
+  GLuint ingest_tex;                                               /* The last texture passed into addTexture(), 0 when the last frame was drawn or uploaded */
+  int ingest_flags;                                                /* The BackgroundIngestFlags of the last addTexture() */
+  bool ingest_is_luma;                                             /* True when ingest_tex has the (luma) format of the slots, so it has no colours */
+  GLuint read_fbo;                                                 /* Used to blit from external textures when we can't use glCopyImageSubData() */
+  BackgroundFBO capture;                                           /* When we need to convert the input, this is where you draw into between beginFrame()/endFrame() */
  
-  GLuint fbo;                                                      /* FBO used to store the result (in out_tex) */
-  GLuint vert;                                                     /* Vertex shader to grab a frame */
-  GLuint frag;                                                     /* The fragment shader that does the background distance calc. generated in the c'tor */
-  GLuint prog;                                                     /* Shader program that performs the bg subtraction */
+  GLuint fbo;                                                      /* FBO used to store the result (in out_tex); created on first use without a RenderTargetPool */
+  GLuint prog;                                                     /* Shader program that performs the bg subtraction; the fragment shader is generated in setupShader() */
+  GLuint convert_prog;                                             /* Program that converts the capture buffer or an added texture into a history slot */
+  GLint u_convert_flip;                                            /* Location of the u_flip uniform of convert_prog */
+  GLuint accum_prog;                                               /* Program used to average the long history */
+  GLint u_accum_weight;                                            /* Location of the u_weight uniform of accum_prog */
+  GLint u_long_weight;                                             /* Location of the u_long_weight uniform of prog */
+  std::vector<BackgroundFBO> long_buffers;                         /* The decimated long history, see setupLongHistory() */
+  BackgroundFBO long_avg;                                          /* The averaged long history (16 bit float) */
+  int long_interval;                                               /* We copy every `long_interval`-th frame into the long history */
+  float long_weight;                                               /* How much the long term average contributes to the background model */
+  size_t long_index;                                               /* Index into long_buffers that we write into next */
+  size_t long_count;                                               /* Number of long_buffers that contain a frame */
+  uint64_t frame_count;                                            /* Number of frames grabbed so far */
+  bool bootstrap;                                                  /* When true we copy the first frame into all history slots, see "Bootstrap and snapshots" */
   GLuint vao;                                                      /* VAO to back our attribute less rendering */
   GLuint out_tex;                                                  /* The result texture with foreground pixels being 1 */
   int last_index;                                                  /* Internally used; last index that we wrote frame data into */
 };
 
 inline GLuint BackgroundBuffer::getLastUpdatedTexture() {
+  if(ingest_tex) {
+    return ingest_tex;
+  }
+  if(capture.tex) {
+    return capture.tex;
+  }
   return buffers[last_index].tex;
 }
 
-inline void BackgroundBuffer::resize(int ww, int wh) {
-  win_w = ww;
-  win_h = wh;
+inline bool BackgroundBuffer::getColorTexture(GLuint& tex, bool& flipY) {
+  tex = getLastUpdatedTexture();
+  flipY = ingest_tex && (ingest_flags & BG_INGEST_FLIP_Y);
+  return !(ingest_tex && ingest_is_luma);
+}
+
+inline bool BackgroundBuffer::needsConversion() {
+  return fmt == BG_FORMAT_LUMA || fmt == BG_FORMAT_LUMA_CHROMA;
+}
+
+inline void BackgroundBuffer::resize(int, int) {
 }
 
 #endif
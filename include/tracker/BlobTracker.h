@@ -31,6 +31,35 @@
   function `getInputImagePtr()` that we fill directly with the pixels
   that we download from the GPU (See Tracker::apply()).
 
+  track() is label() followed by match(). label() finds the blobs in the
+  input image (`new_blobs`), match() matches them with the blobs we're 
+  tracking (`blobs`). They're public so a TrackerPipeline can use them as
+  separate stages, see TrackerPipeline.h.
+
+  To make the tracking cheaper when there are many blobs (see Governor.h)
+  you can find the contours at a lower resolution (`label_scale`), track
+  every n-th frame only (`track_interval`) and keep only the largest blobs
+  (`max_blobs`). label() also measures `coverage`, the part of the input 
+  image that is foreground, on every frame; also on the frames we skip.
+
+  Set `zones` to count the blobs that cross lines and enter or leave
+  zones, see ZoneCounter.h.
+
+  When you set `appearance` every blob gets a colour histogram. The
+  difference between two histograms is added to the similarity value, 
+  and a new blob that doesn't match by position takes over a lost track
+  (one that is still in `blobs` but wasn't matched) when it's within 
+  `relink_radius` and looks the same, so people keep their id after an
+  occlusion. See Appearance.h and AppearanceTiles.h.
+
+  A frame doesn't allocate once the tracker has seen a frame with as many
+  blobs: the containers we fill every frame (`contours`, `new_blobs`, 
+  `similarities`) keep their capacity and the temporaries of matching 
+  come from `arena`, see FrameArena.h. Only findContours() allocates, 
+  inside OpenCV. To check it, set `alloc_counter` to a function that 
+  returns the number of allocations of e.g. a malloc() hook; see 
+  bench_blobtracker -a.
+
  */
 #ifndef TRACKER_BLOB_TRACKER_H
 #define TRACKER_BLOB_TRACKER_H
@@ -43,8 +72,18 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/video/background_segm.hpp>
 
+#include <tracker/Timings.h>
+#include <tracker/Latency.h>
+#include <tracker/MaskRecorder.h>
+#include <tracker/TrackIndex.h>
+#include <tracker/ZoneCounter.h>
+#include <tracker/Appearance.h>
+#include <tracker/FrameArena.h>
+
 /* ---------------------------------------------------*/
 
+typedef uint64_t(*blob_tracker_alloc_counter)();                      /* returns the number of heap allocations so far, see BlobTracker::alloc_counter */
+
 class Similarity {                                                    /* the Similarity class is used to compte the new detected blobs with the already found ones. */
   public:
    Similarity();
@@ -54,6 +93,8 @@ class Similarity {                                                    /* the Sim
    size_t old_dx;                                                     /* index of a blob detected earlier */
    int64_t area_dist_sq;                                              /* area different (squared) */
    int64_t pos_dist_sq;                                               /* position distance squared */
+   float appearance_dist;                                             /* appearance_distance() of the blobs; 0 when one of them has no appearance */
+   int64_t appearance_cost;                                           /* appearance_dist * BlobTracker::appearance_weight; added to the value */
    int64_t value;                                                     /* the actuall similarity value between blob new_dx and old_dx */
 };
 
@@ -72,12 +113,20 @@ public:
 
 public:
   int age;                                                            /* the number of frames we detected this same blob */
-  int id;                                                             /* @todo - assign a unique ID to each detected blob */
+  int id;                                                             /* unique id, assigned when we start tracking a new blob */
   int area;                                                           /* the area of the blob */
   bool matched;                                                       /* used in BlobTracker::track(), set to true when we found this blob in the last frame */
+  uint64_t frame_id;                                                  /* the id of the frame in which we detected this blob for the last time, see Latency.h */
   cv::Point2f direction;                                              /* the averaged direction the blob is heading towards */
   cv::Point position;                                                 /* the center position */
   std::vector<cv::Point> trail;                                       /* last N-positions */
+  AppearanceDescriptor appearance;                                    /* colour histogram of the blob, averaged over the frames we matched it; empty without BlobTracker::appearance */
+};
+
+struct BlobAreaSorter {                                                /* sorts blobs from large to small */
+  bool operator()(const Blob& a, const Blob& b) {
+    return a.area > b.area;
+  }
 };
 
 /* ---------------------------------------------------*/
@@ -86,26 +135,59 @@ class BlobTracker {
  public:
   BlobTracker(int w, int h);
   void track();                                                       /* once you've filled the input_image with some pixel data, call track() to perform the blob tracking. */
+  void label();                                                       /* records the input image (when `recorder` is set) and finds the contours and new_blobs in it; the first half of track() */
+  void match();                                                       /* matches new_blobs with the tracked blobs; the second half of track() */
+  bool isSkippedFrame();                                              /* returns true when we don't track `frame` because of `track_interval` */
   int getInputImageRowLength();                                       /* returns the row length for the input image; this is used for e.g. GL_PACK_ROW_LENGTH when reading back pixels from the GPU */
   unsigned char* getInputImagePtr();                                  /* returns a pointer to the image buffer that we can fill */
 
  private:
+  uint64_t countAllocs();                                             /* returns alloc_counter() or 0 */
+  void updateCoverage();                                              /* samples the input image and updates `coverage` */
   void updateContours();                                              /* uses openCV to find contours that are used in updateBlobs()/updateClusters(). */
   void updateBlobs();                                                 /* find the contour centers and create new blobs */
   void updateClusters();                                              /* this does the actual work. it finds and matches blobs based on similarty. */
+  void relinkBlobs(int* matches);                                     /* matches the new blobs that didn't match by position (matches[i] < 0) with lost blobs that look the same */
+  void updateIndex();                                                 /* inserts the blobs that were seen in `frame` into `index` */
 
  public:
   int w;                                                               /* the width of the image buffer on which we perform tracking. */
   int h;                                                               /* the height of the image buffer on which we perform tracking */
   cv::Mat input_image;                                                 /* the input image on which we perform the tracking. you need to copy pixel data into this one. */
+  FrameInfo frame;                                                     /* the frame that input_image was created from; set this before calling track() */
   std::vector<Blob> new_blobs;                                         /* blobs detected in the last frame */
   std::vector<Blob> blobs;                                             /* the blobs we found and that we are tracking */
   std::vector<std::vector<cv::Point> > contours;                       /* the found contours */
-  std::map<size_t, std::vector<Similarity> > similarities;             /* similarities between the new and old blobs; is updated every time you call track() */
+  std::vector<Similarity> similarities;                                /* similarities between the new and old blobs, row by row: new_blobs[i] starts at i * (number of blobs before matching); is updated every time you call track() */
+  Timings* timings;                                                    /* when set, we add the time spent in each step of track() to these timings. */
+  int last_id;                                                         /* the last id we assigned to a blob */
+  MaskRecorder* recorder;                                              /* when set, track() records every input_image before it starts tracking, see MaskRecorder.h */
+  int label_scale;                                                     /* 1 finds contours in the input image, 2 in an image of half the size (a pixel is set when one of its 2x2 input pixels is set), etc. */
+  int track_interval;                                                  /* 1 tracks every frame, 2 every other frame (on the frame ids), etc. Blobs don't age on the frames we skip. */
+  int max_blobs;                                                       /* when > 0 we only keep the `max_blobs` largest new blobs */
+  float coverage;                                                      /* the part [0, 1] of the last input image that is foreground; sampled on a 4x4 grid */
+  cv::Mat label_image;                                                 /* the downscaled input image when label_scale > 1 */
+  TrackIndex* index;                                                   /* when set, updateClusters() inserts the blobs of every frame, see TrackIndex.h */
+  std::vector<TrackSample> index_samples;                              /* the samples we insert into `index`; reused between frames */
+  ZoneCounter* zones;                                                  /* when set, updateClusters() tests every move of a blob against its lines and zones, see ZoneCounter.h */
+  AppearanceTable* appearance;                                         /* when set, and it was made from `frame`, the new blobs get an appearance descriptor, see Appearance.h */
+  int appearance_weight;                                               /* what a completely different appearance adds to the similarity value (squared pixels); default 500 */
+  int relink_radius;                                                   /* a new blob takes over a lost track within this distance (pixels) ... */
+  float relink_distance;                                               /* ... when their appearance_distance() is below this value; 0 disables it. Default 0.25 */
+  uint64_t num_relinked;                                               /* number of times a lost track was picked up again on its appearance */
+  FrameArena arena;                                                    /* the temporaries of one frame; reset by label() */
+  std::vector<std::vector<cv::Point> > spare_trails;                   /* the trails of removed blobs, new tracks reuse them so they don't allocate */
+  blob_tracker_alloc_counter alloc_counter;                            /* when set, we count the heap allocations of label() and match() with it ... */
+  uint64_t num_allocs_contours;                                        /* ... the ones of findContours() in the last frame ... */
+  uint64_t num_allocs_tracking;                                        /* ... and all others; 0 once the containers and the arena are large enough */
 };
 
 /* ---------------------------------------------------*/
 
+inline uint64_t BlobTracker::countAllocs() {
+  return (alloc_counter) ? alloc_counter() : 0;
+}
+
 inline int BlobTracker::getInputImageRowLength() {
   int row_len = (int) input_image.step / (int) input_image.elemSize();
   return row_len;
@@ -115,4 +197,8 @@ inline unsigned char* BlobTracker::getInputImagePtr() {
   return (unsigned char*)input_image.data;
 }
 
+inline bool BlobTracker::isSkippedFrame() {
+  return track_interval > 1 && 0 != (frame.id % (uint64_t)track_interval);
+}
+
 #endif
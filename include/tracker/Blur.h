@@ -31,7 +31,10 @@
 
   When you pass a texture into the `blur(texid)` function we will use that texture
   as input and blur it. The returned GLuint from `blur(texid)` is the texture that contains
-  the blurred image.
+  the blurred image. `blur(graph, texid)` adds the two passes to a RenderGraph
+  instead of drawing immediately, see RenderGraph.h. All FBOs are created on 
+  first use, so when you only blur into the targets of a RenderTargetPool we 
+  don't allocate anything.
 
   <example>
 
@@ -54,6 +57,9 @@
 #define ROXLU_USE_MATH
 #define ROXLU_USE_OPENGL
 #include <tinylib.h>
+#include <tracker/ProgramCache.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/Timings.h>
  
 static const char* B_VS = ""
   "#version 150\n"
@@ -92,12 +98,15 @@ class Blur {
   void end();
   GLuint blur(int tex= -1);
   GLuint blur();                                                                         /* applies the blur */
+  GLuint blur(RenderGraph& graph, GLuint tex);                                           /* adds the x and y blur passes to the graph; returns the texture that will contain the blurred image, a transient target when the graph has a pool */
+  size_t getNumBytes();                                                                  /* returns the number of bytes of VRAM used by our own FBOs */
   void blit();                                                                           /* will blit the current read buffer into the scene texture; you can use this instead of capturing a scene with begin()/end() */
   void setAsReadBuffer();                                                                /* sets the result to the current read buffer */
   void print();                                                                          /* print some debug info */
                                                                                          
  private:                                                                                
-  bool setupFBO();                                                                       /* sets up the FBOs and textures */
+  bool setupFBO();                                                                       /* sets up the x/y FBOs and textures; called on first use without a RenderTargetPool */
+  bool setupSceneFBO();                                                                  /* sets up the scene FBO, texture and depth buffer; called on first use of begin() or blit() */
   bool setupShader();                                                                    /* generates the shaders */
   float gauss(const float x, const float sigma2);                                        /* 1d gaussian function */
   void shutdown();                                                                       /* resets this class; destroys all allocated objects */
@@ -106,15 +115,12 @@ class Blur {
   int w;
   int h;
   GLuint vao;                                                                            /* we use attribute-less rendering; but we need a vao as GL core 3 does not allow drawing with the default VAO */
-  GLuint vert;                                                                           /* the above vertex shader */
   GLuint fbo_scene;                                                                      /* used to capture the scene; we blit the current read buffer into our scene texture, so you don't need "begin()" .. "end()" */
   GLuint tex_scene;                                                                      /* will hold the scene texture */
   GLuint fbo_x;                                                                          /* the framebuffer for rtt */
-  GLuint frag_x;                                                                         /* vertical fragment shader */
   GLuint prog_x;                                                                         /* program for the vertical blur */
   GLuint tex_x;                                                                          /* first pass (scene capture) + combined blur */
   GLuint fbo_y;                                                                          /* fbo for the y texture */
-  GLuint frag_y;                                                                         /* horizontal fragment shader */
   GLuint prog_y;                                                                         /* program for the horizontal blur */
   GLuint tex_y;                                                                          /* intermedia texture */
   GLuint depth;
@@ -123,6 +129,7 @@ class Blur {
   float blur_amount;                                                                     /* the blur amount, 5-8 normal, 8+ heavy */
   int num_fetches;                                                                       /* how many texel fetches (half), the more the heavier for the gpu but more blur  */
   int sample_size;
+  GLenum target_format;                                                                  /* the format of the targets we acquire from a RenderTargetPool; GL_R8 is enough when you only blur a mask */
 };
  
 #endif
@@ -0,0 +1,82 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  CaptureIngest
+  -------------
+
+  Decouples the capture thread from the GL thread. The capture thread writes
+  RGBA frames (w * h * 4 bytes, first row is the top of the image) into
+  `queue`, see FrameQueue.h. Once per render loop the GL thread calls
+  update() which takes the newest frame from the queue, copies it into one of
+  CAPTURE_INGEST_NUM_PBOS rotating pixel unpack buffers and lets
+  Tracker::uploadFrame() transfer it straight into the BackgroundBuffer
+  history slot. Camera jitter no longer stalls the GL pipeline and the
+  transfer to the GPU is asynchronous. When there is no new frame, update()
+  returns false and you can skip Tracker::apply().
+
+  We flip the rows while copying into the unpack buffer so the mask has the
+  same orientation as when you draw the frame between beginFrame()/endFrame().
+
+  ````c++
+  CaptureIngest ingest(320, 240);
+  ingest.setup(4, FRAME_QUEUE_LATEST);
+
+  // capture thread
+  unsigned char* dest = ingest.queue.beginWrite();
+  if(dest) {
+    memcpy(dest, pixels, ingest.queue.frame_size);
+    ingest.queue.endWrite(tracker_now_ns());
+  }
+
+  // GL thread
+  if(ingest.update(tracker)) {
+    tracker.apply();
+  }
+  ````
+
+ */
+#ifndef TRACKER_CAPTURE_INGEST_H
+#define TRACKER_CAPTURE_INGEST_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+#include <tracker/FrameQueue.h>
+
+#define CAPTURE_INGEST_NUM_PBOS 3                                  /* Number of pixel unpack buffers we rotate through */
+
+class Tracker;
+
+class CaptureIngest {
+ public:
+  CaptureIngest(int w, int h);
+  ~CaptureIngest();
+  bool setup(int numSlots = 4, int policy = FRAME_QUEUE_LATEST);   /* Allocates the queue and unpack buffers; call on the GL thread before the capture thread starts */
+  bool update(Tracker& tracker);                                   /* GL thread: uploads the newest frame into the tracker; returns false when there was no new frame */
+  void shutdown();                                                 /* Frees everything; stop the capture thread first */
+
+ public:
+  int w;                                                           /* Width of the frames */
+  int h;                                                           /* Height of the frames */
+  FrameQueue queue;                                                /* The capture thread writes into this queue */
+  GLuint pbos[CAPTURE_INGEST_NUM_PBOS];                            /* The pixel unpack buffers */
+  int pbo_index;                                                   /* The unpack buffer we use for the next frame */
+  uint64_t num_uploaded;                                           /* Number of frames we uploaded */
+};
+
+#endif
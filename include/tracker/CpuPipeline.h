@@ -0,0 +1,231 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  CpuPipeline
+  -----------
+
+  The CPU policies for a TrackerPipeline, for when there is no GL context
+  (e.g. a headless box or a test). They do the same as the GL stages with 
+  the BG_FORMAT_LUMA background format:
+
+    CpuBackground<Num>:  luma history of `Num` frames; a pixel is foreground 
+                         when it differs more than 0.06 from the average.
+    CpuMorphology:       erode and dilate with the same 6 neighbours as the 
+                         shaders of ErodeDilateThreshold.
+    CpuSmoothing:        the separable gaussian of Blur::setup(1.0, 10, 1) in
+                         8 bit steps (like the GL_R8 targets) and the threshold.
+
+  Images are one byte per pixel with a stride. Pass the pixels top row first
+  into addFrame(); the mask then has the same orientation as the mask of the
+  Tracker (and as your image) and we find the same blobs. There is no read 
+  back, so the blobs of apply() belong to the last frame you added.
+
+  ````c++
+  CpuTrackerPipeline pipeline(320, 240);
+
+  pipeline.background.addFrame(rgb_pixels, 320 * 3, 3);
+  pipeline.apply();
+  ````
+
+  The `cpu_` functions are the kernels that the policies use. They process 
+  the rows [y0, y1) of a w x h image, so the policies run them in bands on 
+  the CpuWorkers of the CpuContext (one thread per core by default). The 
+  kernels use SSE2 or NEON when the compiler targets them; define 
+  TRACKER_CPU_NO_SIMD to use the plain C versions. Their timings go into the 
+  same stages of `timings` as the GL passes, but measured with the CPU clock.
+
+  See CpuTracker.h for a Tracker that runs the same kernels as a graph of
+  tile tasks.
+
+ */
+#ifndef TRACKER_CPU_PIPELINE_H
+#define TRACKER_CPU_PIPELINE_H
+
+#include <stdint.h>
+#include <vector>
+#include <tracker/TrackerPipeline.h>
+#include <tracker/CpuWorkers.h>
+
+#define CPU_BLUR_MAX_TAPS 32                                         /* Max number of weights (center included) of the blur kernels */
+
+/* ---------------------------------------------------*/
+
+struct CpuImage {
+  unsigned char* pixels;                                             /* One byte per pixel */
+  int stride;                                                        /* Bytes per row */
+};
+
+/* ---------------------------------------------------*/
+
+void cpu_luma(const unsigned char* src, int srcStride, int channels, unsigned char* dst, int w, int h, int y0, int y1); /* Converts 1 (gray), 3 (RGB) or 4 (RGBA) channel pixels into luma, `dst` has a stride of `w` */
+void cpu_history_add(const unsigned char* luma, unsigned char* slot, uint16_t* sum, int w, int h, int y0, int y1);  /* Replaces `slot` with `luma` and updates the running sum of the history */
+void cpu_history_fill(const unsigned char* luma, unsigned char* history, int num, uint16_t* sum, int w, int h, int y0, int y1); /* Copies `luma` into all `num` slots of the history and sets the sum to num * luma; used to bootstrap */
+void cpu_background_subtract(const unsigned char* luma, const uint16_t* sum, int num, unsigned char* dst, int dstStride, int w, int h, int y0, int y1); /* 255 where luma differs more than 0.06 from sum / num */
+void cpu_erode(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1);  /* 255 when more than 2 of the 6 neighbours are set */
+void cpu_dilate(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1); /* 255 when one of the 6 neighbours is set */
+void cpu_blur_x(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1, const int32_t* weights, int num, unsigned char* scratch); /* Horizontal blur with `num` 16.16 fixed point weights (center first); `scratch` must hold w + 2 * (num - 1) bytes */
+void cpu_blur_y(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1, const int32_t* weights, int num); /* Vertical blur, see cpu_blur_x() */
+void cpu_threshold(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1); /* 255 where src > 127 */
+bool cpu_blur_weights(float blurAmount, int taps, std::vector<int32_t>& weights); /* The 16.16 weights of Blur::setup(blurAmount, taps, 1); false when taps is not in [1, CPU_BLUR_MAX_TAPS] */
+
+/* ---------------------------------------------------*/
+
+class CpuContext {
+ public:
+  CpuContext(int w, int h, Timings& timings);
+  void beginFrame();
+  bool transfer(CpuImage mask, const FrameInfo& frame, BlobTracker& blobs); /* Copies the mask into the input image of `blobs` */
+
+ public:
+  int w;
+  int h;
+  Timings& timings;
+  CpuWorkers workers;                                                /* The threads that run the kernels; call workers.setup(n) to change the number of threads */
+};
+
+/* ---------------------------------------------------*/
+
+template<int Num = 10>
+class CpuBackground {
+ public:
+  typedef CpuContext Context;
+  typedef CpuImage Image;
+
+  /* The running sum is 16 bit. */
+  static_assert(Num > 0 && Num <= 257, "CpuBackground: Num must be in [1, 257].");
+
+  CpuBackground(int w, int h);
+  void addFrame(const unsigned char* pixels, int stride, int channels, uint64_t captureNs = 0); /* Converts a 1 (gray), 3 (RGB) or 4 (RGBA) channel frame, top row first, to luma; apply() adds it to the history */
+  CpuImage apply(CpuContext& ctx);                                   /* Returns the foreground of the last frame */
+
+ public:
+  int w;
+  int h;
+  std::vector<unsigned char> luma;                                   /* Luma of the last frame */
+  std::vector<unsigned char> history;                                /* Num luma frames */
+  std::vector<uint16_t> sum;                                         /* Per pixel sum of the history */
+  std::vector<unsigned char> output;                                 /* The foreground mask */
+  int index;                                                         /* The history slot we write into next */
+  bool has_new_frame;                                                /* True when `luma` wasn't added to the history yet */
+  bool bootstrap;                                                    /* When true (default) the first frame is copied into all history slots, see BackgroundBuffer.h */
+  bool has_history;                                                  /* True once a frame was added to the history */
+  FrameInfo frame;                                                   /* The last frame we ingested */
+  uint64_t frame_count;                                              /* Number of frames; used for the frame ids */
+};
+
+template<int Num>
+CpuBackground<Num>::CpuBackground(int w, int h)
+  :w(w)
+  ,h(h)
+  ,luma(w * h, 0)
+  ,history(Num * w * h, 0)
+  ,sum(w * h, 0)
+  ,output(w * h, 0)
+  ,index(0)
+  ,has_new_frame(false)
+  ,bootstrap(true)
+  ,has_history(false)
+  ,frame_count(0)
+{
+}
+
+template<int Num>
+void CpuBackground<Num>::addFrame(const unsigned char* pixels, int stride, int channels, uint64_t captureNs) {
+
+  frame.id = ++frame_count;
+  frame.capture_ns = (captureNs) ? captureNs : tracker_now_ns();
+
+  cpu_luma(pixels, stride, channels, &luma[0], w, h, 0, h);
+  has_new_frame = true;
+}
+
+template<int Num>
+CpuImage CpuBackground<Num>::apply(CpuContext& ctx) {
+
+  ctx.timings.beginCpu(TRACKER_STAGE_BACKGROUND);
+
+  unsigned char* slot = has_new_frame ? &history[index * w * h] : NULL;
+  bool fill = slot && bootstrap && !has_history;
+
+  ctx.workers.run(h, [&](int y0, int y1) {
+    if(fill) {
+      cpu_history_fill(&luma[0], &history[0], Num, &sum[0], w, h, y0, y1);
+    }
+    else if(slot) {
+      cpu_history_add(&luma[0], slot, &sum[0], w, h, y0, y1);
+    }
+    cpu_background_subtract(&luma[0], &sum[0], Num, &output[0], w, w, h, y0, y1);
+  });
+
+  if(has_new_frame) {
+    index = (index + 1) % Num;
+    has_new_frame = false;
+    has_history = true;
+  }
+
+  ctx.timings.endCpu(TRACKER_STAGE_BACKGROUND);
+
+  CpuImage img = { &output[0], w };
+  return img;
+}
+
+/* ---------------------------------------------------*/
+
+class CpuMorphology {
+ public:
+  typedef CpuContext Context;
+  typedef CpuImage Image;
+
+  CpuMorphology(int w, int h);
+  CpuImage apply(CpuContext& ctx, CpuImage in);                      /* Erodes `erode_steps` and dilates `dilate_steps` times */
+
+ public:
+  int w;
+  int h;
+  int erode_steps;                                                   /* Number of erode iterations */
+  int dilate_steps;                                                  /* Number of dilate iterations */
+  std::vector<unsigned char> buffers[2];                             /* We ping/pong between these */
+};
+
+/* ---------------------------------------------------*/
+
+class CpuSmoothing {
+ public:
+  typedef CpuContext Context;
+  typedef CpuImage Image;
+
+  CpuSmoothing(int w, int h, float blurAmount = 1.0f, int taps = 10); /* See Blur::setup(), we use a sample size of 1 and at most CPU_BLUR_MAX_TAPS taps */
+  CpuImage apply(CpuContext& ctx, CpuImage in);                      /* Blurs and thresholds */
+
+ public:
+  int w;
+  int h;
+  std::vector<int32_t> weights;                                      /* 16.16 fixed point gaussian weights, center first */
+  std::vector<unsigned char> blurred_x;                              /* Output of the horizontal pass */
+  std::vector<unsigned char> scratch;                                /* One padded row per band for cpu_blur_x(), grows with the number of threads */
+  std::vector<unsigned char> blurred_y;                              /* Output of the vertical pass */
+  std::vector<unsigned char> output;                                 /* The thresholded mask */
+};
+
+/* ---------------------------------------------------*/
+
+typedef TrackerPipeline<CpuBackground<>, CpuMorphology, CpuSmoothing, ContourLabelling, SimilarityMatching> CpuTrackerPipeline;
+
+#endif
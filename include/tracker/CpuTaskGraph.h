@@ -0,0 +1,131 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  CpuTaskGraph
+  ------------
+
+  A dependency graph of CPU tasks and a work stealing pool that runs it. A 
+  task is a function with a user pointer and an int argument; it becomes 
+  ready when all the tasks it depends on are done. The graph is built once
+  (e.g. for every stage x tile of a frame) and can be run many times. 
+
+  CpuTaskPool runs one graph at a time. Every thread has its own queue: it
+  takes the task it queued last (so the tasks that a task made ready run on
+  the same core while their input is still in cache) and when its queue is
+  empty it steals the oldest task from another thread. run() queues the 
+  tasks without dependencies and returns immediately so the caller can do
+  something else (e.g. track the previous frame); wait() runs tasks on the
+  calling thread until the graph is done.
+
+  ````c++
+  CpuTaskGraph graph;
+  int a = graph.addTask(do_something, user, 0);
+  int b = graph.addTask(do_something, user, 1);
+  graph.addDependency(b, a);                  // b runs after a
+
+  CpuTaskPool pool;
+  pool.setup();
+  pool.run(graph);
+  ... 
+  pool.wait();
+  ````
+
+ */
+#ifndef TRACKER_CPU_TASK_GRAPH_H
+#define TRACKER_CPU_TASK_GRAPH_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+typedef void(*cpu_task_fn)(void* user, int arg);
+
+struct CpuTask {
+  CpuTask();
+  cpu_task_fn fn;
+  void* user;
+  int arg;
+  int num_deps;                                                      /* Number of tasks we depend on */
+  std::atomic<int> pending;                                          /* Number of tasks we still wait for while the graph runs */
+  std::vector<int> dependents;                                       /* Tasks that depend on us */
+};
+
+class CpuTaskGraph {
+ public:
+  int addTask(cpu_task_fn fn, void* user, int arg);                  /* Adds a task; returns its index */
+  void addDependency(int task, int dependsOn);                       /* `task` runs after `dependsOn` is done */
+  void clear();                                                      /* Removes all tasks */
+  size_t size();                                                     /* Returns the number of tasks */
+
+ public:
+  std::deque<CpuTask> tasks;                                         /* A deque because tasks can't be moved (atomics) */
+};
+
+/* ---------------------------------------------------*/
+
+struct CpuTaskQueue {
+  std::mutex mutex;
+  std::deque<int> tasks;                                             /* The owner pushes and pops at the back, thieves take from the front */
+};
+
+class CpuTaskPool {
+ public:
+  CpuTaskPool();
+  ~CpuTaskPool();
+  bool setup(int numThreads = 0);                                    /* Starts numThreads - 1 threads, the thread that calls wait() is the last one; 0 uses one thread per core */
+  void shutdown();                                                   /* Stops and joins the threads; call wait() first */
+  void run(CpuTaskGraph& graph);                                     /* Queues the tasks of `graph` without dependencies and returns */
+  void wait();                                                       /* Runs tasks on the calling thread until the graph is done */
+  bool isRunning();                                                  /* Returns true when a graph is running */
+
+ private:
+  void work(int self);                                               /* Main function of the threads */
+  bool runOne(int self);                                             /* Runs one task from our own queue or one we steal; false when we didn't find one */
+  void push(int queue, int task);                                    /* Queues a ready task */
+
+ public:
+  int num_threads;                                                   /* Number of threads, including the one that calls wait() */
+  std::vector<std::thread> threads;
+  std::vector<CpuTaskQueue*> queues;                                 /* One per thread; the last one is for the thread that calls run() and wait() */
+  CpuTaskGraph* graph;                                               /* The graph that runs */
+  std::atomic<int> num_remaining;                                    /* Tasks of the graph that are not done yet */
+  std::atomic<int> num_queued;                                       /* Tasks in the queues */
+  std::atomic<uint64_t> num_steals;                                  /* Number of tasks that were stolen, for stats */
+  std::mutex mutex;
+  std::condition_variable wake_cv;                                   /* Wakes the threads when there are tasks */
+  std::condition_variable done_cv;                                   /* Wakes wait() when the graph is done or when there are tasks */
+  bool must_stop;
+};
+
+/* ---------------------------------------------------*/
+
+inline size_t CpuTaskGraph::size() {
+  return tasks.size();
+}
+
+inline bool CpuTaskPool::isRunning() {
+  return NULL != graph && num_remaining.load() > 0;
+}
+
+#endif
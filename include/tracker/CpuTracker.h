@@ -0,0 +1,164 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  CpuTracker
+  ----------
+
+  The Tracker without GL: background subtraction, erode, dilate, blur, 
+  threshold and blob tracking on the CPU, with the kernels of CpuPipeline.h.
+  You pass frames from your own memory, e.g. from a camera callback or a 
+  decoder.
+
+  The frame is cut into tiles of `tile_rows` rows and every stage of every
+  tile is a task of a CpuTaskGraph. A task only waits for the tiles of the 
+  previous stage that it reads: the tile itself and the neighbours that 
+  overlap its halo (1 row for erode and dilate, taps - 1 rows for the 
+  vertical blur). The background subtraction and the horizontal blur don't
+  need a halo, so they run in the same task as the stage before. The 
+  CpuTaskPool runs the tasks on `numThreads` threads (one per core by 
+  default); a thread continues with the next stage of the tile it just did,
+  so a tile flows through the stages while it is in cache instead of every
+  stage walking over the whole frame.
+
+  With `overlap_frames` (the default) apply() starts the graph of the new 
+  frame and then finds and matches the blobs of the previous frame while 
+  the other threads process the new one. Like the pack buffers of the 
+  Tracker, the blobs are then one frame behind; `blobs.frame` tells you 
+  which frame they belong to. With one thread there is nothing to overlap
+  with, so we then run the graph and the tracking after each other.
+
+  The members that you read are the same as those of the Tracker (`blobs`, 
+  `timings`, `latency_mask`, `latency_tracks`) so code that reads the 
+  results works with both. The history is luma only (like BG_FORMAT_LUMA) 
+  and has CPU_TRACKER_NUM_HISTORY frames. The timings of the image stages
+  are the sum of the time their tasks took on all threads.
+
+  Like the BackgroundBuffer we copy the first frame into all history slots
+  (`bootstrap`). saveSnapshot() and loadSnapshot() store and restore the 
+  history and the tracked blobs, see Snapshot.h.
+
+  ````c++
+  CpuTracker tracker(320, 240);
+
+  tracker.addFrame(rgb_pixels, 320 * 3, 3);   // top row first
+  tracker.apply();
+
+  for(size_t i = 0; i < tracker.blobs.blobs.size(); ++i) {
+    Blob& blob = tracker.blobs.blobs[i];
+    ...
+  }
+  ````
+
+  This header does not depend on GL; build the library with 
+  OPT_BUILD_TRACKER_GL=OFF to get the CPU only version. When you want to 
+  combine the CPU stages with other policies, use the CpuTrackerPipeline of
+  CpuPipeline.h.
+
+ */
+#ifndef TRACKER_CPU_TRACKER_H
+#define TRACKER_CPU_TRACKER_H
+
+#include <stdint.h>
+#include <vector>
+#include <tracker/CpuPipeline.h>
+#include <tracker/CpuTaskGraph.h>
+#include <tracker/Snapshot.h>
+
+#define CPU_TRACKER_NUM_HISTORY 10                                   /* Number of luma frames in the background history */
+
+enum {
+  CPU_TRACKER_TASK_BACKGROUND,                                       /* History add and background subtraction */
+  CPU_TRACKER_TASK_ERODE,
+  CPU_TRACKER_TASK_DILATE,
+  CPU_TRACKER_TASK_BLUR                                              /* Vertical blur and threshold */
+};
+
+struct CpuTrackerTask {
+  int type;                                                          /* CPU_TRACKER_TASK_* */
+  int step;                                                          /* Index of the erode/dilate step; the output buffer in `morph` */
+  int tile;                                                          /* Index of the tile; the row in `blur_scratch` */
+  int y0;                                                            /* First row of the tile */
+  int y1;                                                            /* Row after the last row of the tile */
+  bool blur_x;                                                       /* True when this is the last task before the vertical blur, it also does the horizontal blur */
+  int stages[2];                                                     /* The timing stages of this task (and the horizontal blur) */
+  uint64_t ns[2];                                                    /* How long the stages took, in ns */
+};
+
+class CpuTracker {
+ public:
+  CpuTracker(int w, int h, int numThreads = 0);                     /* Create the tracker for frames of w x h; numThreads = 0 uses one thread per core */
+  ~CpuTracker();
+  void addFrame(const unsigned char* pixels, int stride, int channels, uint64_t captureNs = 0); /* Add a frame of 1 (gray), 3 (RGB) or 4 (RGBA) channels, top row first; `stride` is the number of bytes per row */
+  void apply();                                                      /* Starts the image stages of the last frame and tracks the blobs, see the overlap_frames comment above */
+  void runTask(int task);                                            /* Called by the pool */
+  bool saveSnapshot(std::string filepath);                           /* Saves the history and the tracked blobs, see Snapshot.h */
+  bool loadSnapshot(std::string filepath);                           /* Restores a snapshot of saveSnapshot(); call it before you add the first frame */
+
+ private:
+  void setupGraph();                                                 /* (Re)creates the tasks when the number of steps or the tile size changed */
+  void submit();                                                     /* Starts the graph for the frame in `luma[luma_index]` */
+  void finish();                                                     /* Waits for the graph and copies the mask into `blobs` */
+  void track();                                                      /* Labels and matches the mask in `blobs` */
+  unsigned char* getStageOutput(int stage);                          /* Returns the output of the given stage (0 = background, 1..n morphology steps) */
+
+ public:
+  int w;
+  int h;
+  int erode_steps;                                                   /* Number of erode iterations */
+  int dilate_steps;                                                  /* Number of dilate iterations */
+  int tile_rows;                                                     /* Number of rows of a tile */
+  bool overlap_frames;                                               /* Track the previous frame while the image stages of the new frame run */
+  Timings timings;                                                   /* Per stage timings, call timings.enable() to start measuring */
+  BlobTracker blobs;                                                 /* The input image and the new and tracked blobs */
+  LatencyHistogram latency_mask;                                     /* Time from capture until the mask is in `blobs` */
+  LatencyHistogram latency_tracks;                                   /* Time from capture until the tracks are updated */
+  CpuTaskPool pool;                                                  /* The threads that run the tasks */
+  CpuTaskGraph graph;                                                /* One task per stage and tile */
+  std::vector<CpuTrackerTask> tasks;                                 /* What the tasks of `graph` do */
+  int graph_erode_steps;                                             /* The erode_steps the graph was created for */
+  int graph_dilate_steps;                                            /* The dilate_steps the graph was created for */
+  int graph_tile_rows;                                               /* The tile_rows the graph was created for */
+
+  std::vector<unsigned char> luma[2];                                /* Luma of the last frame; we write into one while the graph reads the other */
+  int luma_index;                                                    /* The luma buffer that addFrame() wrote into last */
+  bool has_new_frame;                                                /* True when addFrame() was called after the last submit() */
+  std::vector<unsigned char> history;                                /* CPU_TRACKER_NUM_HISTORY luma frames */
+  std::vector<uint16_t> sum;                                         /* Per pixel sum of the history */
+  int history_index;                                                 /* The history slot we write into next */
+  bool bootstrap;                                                    /* When true (default) the first frame is copied into all history slots */
+  bool has_history;                                                  /* True once the history contains a frame (or a snapshot) */
+  std::vector<unsigned char> background;                             /* The foreground mask */
+  std::vector<unsigned char> morph;                                  /* The output of every erode and dilate step; separate buffers so the steps of different tiles can run at the same time */
+  std::vector<unsigned char> blurred_x;                              /* Output of the horizontal blur */
+  std::vector<unsigned char> blur_scratch;                           /* One padded row per tile for cpu_blur_x() */
+  std::vector<unsigned char> mask;                                   /* The blurred and thresholded mask */
+  std::vector<int32_t> weights;                                      /* Blur weights, see cpu_blur_weights() */
+
+  FrameInfo frame;                                                   /* The last frame that was added */
+  FrameInfo running_frame;                                           /* The frame the graph is processing */
+  int running_luma;                                                  /* The luma buffer the graph reads */
+  int running_slot;                                                  /* The history slot the graph writes into */
+  bool running_timed;                                                /* True when the tasks measure their time */
+  bool running_fill;                                                 /* True when the graph bootstraps the history */
+  bool is_running;                                                   /* True between submit() and finish() */
+  uint64_t frame_count;                                              /* Number of frames; used for the frame ids */
+};
+
+#endif
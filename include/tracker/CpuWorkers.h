@@ -0,0 +1,107 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  CpuWorkers
+  ----------
+
+  A small pool of worker threads for the CPU kernels. run() splits the rows
+  of an image into one band per thread, the calling thread works on a band 
+  too and run() returns when all bands are done; so you can call run() for 
+  each pass of a pipeline and the next pass sees the complete output of the 
+  previous one.
+
+  ````c++
+  CpuWorkers workers;
+  workers.setup();                 // one thread per core 
+
+  workers.run(h, [&](int y0, int y1) {
+    cpu_threshold(src, w, dst, w, w, h, y0, y1);
+  });
+  ````
+
+  Images smaller than `min_rows` rows per band are not split. Use runBands()
+  when a kernel needs scratch memory: it also passes the band, which is 
+  smaller than `num_threads` and is never used by two threads at once.
+
+ */
+#ifndef TRACKER_CPU_WORKERS_H
+#define TRACKER_CPU_WORKERS_H
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+typedef void(*cpu_rows_fn)(void* user, int band, int y0, int y1);
+
+class CpuWorkers {
+ public:
+  CpuWorkers();
+  ~CpuWorkers();
+  bool setup(int numThreads = 0);                                    /* Starts numThreads - 1 threads (the caller is the last one); 0 uses one thread per core */
+  void shutdown();                                                   /* Stops and joins the threads */
+  void run(int numRows, cpu_rows_fn fn, void* user);                 /* Calls fn(user, band, y0, y1) for bands of [0, numRows) on all threads; returns when all bands are done */
+  template<class Fn> void run(int numRows, Fn fn);                   /* Same, but calls fn(y0, y1) */
+  template<class Fn> void runBands(int numRows, Fn fn);              /* Same, but calls fn(band, y0, y1); band is in [0, num_threads) */
+
+ private:
+  void work(uint64_t seen);                                          /* Main function of the threads; `seen` is the last job that was started before the thread */
+  void processBands();                                               /* Processes bands until there are none left */
+
+ public:
+  int num_threads;                                                   /* Number of threads that run() uses, including the caller */
+  int min_rows;                                                      /* We don't make bands with less rows than this */
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable wake_cv;                                   /* Wakes the threads for a new job */
+  std::condition_variable done_cv;                                   /* Wakes the caller of run() when all threads finished */
+  uint64_t generation;                                               /* Incremented for every job */
+  size_t num_finished;                                               /* Number of threads that finished the current job */
+  bool must_stop;
+  cpu_rows_fn job_fn;
+  void* job_user;
+  int job_rows;
+  int job_bands;
+  std::atomic<int> next_band;                                        /* The next band that a thread picks up */
+};
+
+template<class Fn>
+static void cpu_workers_call(void* user, int, int y0, int y1) {
+  (*(Fn*)user)(y0, y1);
+}
+
+template<class Fn>
+static void cpu_workers_call_band(void* user, int band, int y0, int y1) {
+  (*(Fn*)user)(band, y0, y1);
+}
+
+template<class Fn>
+inline void CpuWorkers::run(int numRows, Fn fn) {
+  run(numRows, cpu_workers_call<Fn>, &fn);
+}
+
+template<class Fn>
+inline void CpuWorkers::runBands(int numRows, Fn fn) {
+  run(numRows, cpu_workers_call_band<Fn>, &fn);
+}
+
+#endif
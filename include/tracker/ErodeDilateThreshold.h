@@ -42,6 +42,15 @@
 
   ````      
 
+  Every function has a version that adds its passes to a RenderGraph instead
+  of drawing immediately; this is what the Tracker uses, see RenderGraph.h.
+  The functions without a graph execute their own graph and restore the 
+  GL state of the caller. When the graph has a RenderTargetPool, erode and
+  dilate draw into transient targets of the pool and release their input
+  once it's read; otherwise we use our own ping/pong FBOs which are created
+  on first use. The threshold output is always our own, because it's read
+  back and drawn after apply(); it's created on first use too.
+
  */
 #ifndef TRACKER_ERODE_DILATE_H
 #define TRACKER_ERODE_DILATE_H
@@ -51,6 +60,9 @@
 
 #define ROXLU_USE_OPENGL
 #include <tinylib.h>
+#include <tracker/ProgramCache.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/Timings.h>
 
 static const char* ERODE_FS = ""
   "#version 330\n"
@@ -113,10 +125,19 @@ class ErodeDilateThreshold {
   GLuint erode(GLuint intex, int num);              /* returns a reference to a texture that is the eroded version of the input texture */
   GLuint dilate(GLuint intex, int num);             /* returns a reference to a texture that is the dilated version of the input texture */
   GLuint threshold(GLuint intex);                   /* threshold the given texture */
+  GLuint erode(RenderGraph& graph, GLuint intex, int num);  /* adds the erode passes to the graph; returns the texture that will hold the result */
+  GLuint dilate(RenderGraph& graph, GLuint intex, int num); /* adds the dilate passes to the graph; returns the texture that will hold the result */
+  GLuint threshold(RenderGraph& graph, GLuint intex);       /* adds the threshold pass to the graph; returns getThresholdedTex() */
   bool createFBO(GLuint& fbo, GLuint& tex);         /* creates a FBO with one texture attachment (grayscale) */
   void setThresholdOutputAsReadBuffer();            /* this will make sure that a glReadPixels() wil read from the thresholded buffer */
   void resetReadBuffer();                           /* sets the default framebuffer again */
   GLuint getThresholdedTex();                       /* get the thresholded texture output. */
+  size_t getNumBytes();                             /* returns the number of bytes of VRAM used by our own textures */
+
+ private:
+  GLuint addPingPongPasses(RenderGraph& graph, int stage, GLuint prog, GLuint intex, int num); /* adds `num` passes that ping/pong between fbo[0] and fbo[1] or targets of the pool */
+  bool setupPingPong();                             /* creates fbo[] and tex[] when we don't have them yet */
+  bool setupThreshold();                            /* creates threshold_fbo and threshold_tex when we don't have them yet */
 
  public:
   int w; 
@@ -124,16 +145,12 @@ class ErodeDilateThreshold {
   int win_w;
   int win_h;
   GLuint fullscreen_vao;
-  GLuint fullscreen_vert;
-  GLuint erode_frag;
   GLuint erode_prog;
-  GLuint dilate_frag;
   GLuint dilate_prog;
-  GLuint threshold_frag;
   GLuint threshold_prog;
   GLuint threshold_fbo;
   GLuint threshold_tex;
-  GLuint fbo[2];
+  GLuint fbo[2];                                    /* ping/pong FBOs, only used when the graph has no RenderTargetPool */
   GLuint tex[2];
 };
 
@@ -0,0 +1,79 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  FrameArena
+  ----------
+
+  A bump allocator for data that only lives during one frame. allocate()
+  hands out the next aligned piece of one big block and reset() makes 
+  the whole block available again; there is no free(). When a frame needs 
+  more than the block, we allocate extra blocks for that frame, and the 
+  next reset() replaces the block by one that fits everything. So the 
+  capacity grows to what the busiest frame needed and never shrinks, and
+  once it's large enough a frame doesn't touch the heap at all.
+
+  Only use it for types that don't need a destructor (ints, PODs); we 
+  don't call constructors or destructors. allocate() never returns NULL:
+  like the constructor, allocate() and reset() exit when we can't get the
+  memory. An arena can't be copied.
+
+  ````c++
+  FrameArena arena;
+
+  arena.reset();                                     // start of the frame
+  int* matches = arena.allocate<int>(num_blobs);
+  ````
+
+ */
+#ifndef TRACKER_FRAME_ARENA_H
+#define TRACKER_FRAME_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+class FrameArena {
+ public:
+  FrameArena(size_t capacity = 16 * 1024);
+  ~FrameArena();
+  void* allocate(size_t nbytes, size_t align = 16);                /* Returns `nbytes` bytes that stay valid until reset() */
+  template<class T> T* allocate(size_t num);                       /* Returns room for `num` elements of T (not constructed) */
+  void reset();                                                    /* Releases everything; grows the block when the last frame didn't fit */
+
+ private:
+  FrameArena(const FrameArena&);                                   /* Not implemented; the copy would free our blocks too */
+  FrameArena& operator=(const FrameArena&);                        /* Not implemented */
+
+ public:
+  unsigned char* buffer;                                           /* The block we bump allocate from */
+  size_t capacity;                                                 /* Size of `buffer` */
+  size_t used;                                                     /* Number of bytes of `buffer` we handed out, including the alignment */
+  std::vector<unsigned char*> overflow;                            /* The extra blocks of the frame that didn't fit */
+  size_t overflow_bytes;                                           /* Total size of the extra blocks */
+  uint64_t num_heap_allocs;                                        /* Number of times we allocated from the heap, for statistics */
+};
+
+/* ---------------------------------------------------*/
+
+template<class T> inline T* FrameArena::allocate(size_t num) {
+  return (T*)allocate(num * sizeof(T), alignof(T));
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  FrameQueue
+  ----------
+
+  Bounded single producer / single consumer queue of preallocated frame
+  buffers, used to hand frames from a capture thread to the GL thread without
+  locks and without ever blocking either side. The producer (e.g. the camera
+  callback) asks for a free buffer with beginWrite(), fills it and publishes
+  it with endWrite(). The GL thread takes frames with beginRead()/endRead().
+
+  When the consumer is too slow we drop frames instead of waiting:
+
+     FRAME_QUEUE_LATEST:   triple buffering; the producer always gets a free
+                           buffer and a published frame replaces the one that
+                           wasn't read yet. beginRead() always returns the
+                           newest frame. This gives the lowest latency and is
+                           what you want for live tracking. Uses 3 buffers,
+                           whatever you pass as `numSlots`.
+     FRAME_QUEUE_FIFO:     ring of `numSlots` buffers which are read in order;
+                           when all buffers are full beginWrite() returns NULL
+                           and the new frame is dropped.
+
+  The buffers are page aligned and, where the OS allows it, locked in memory
+  so they never get paged out while we copy from them.
+
+  ````c++
+  // capture thread
+  unsigned char* dest = queue.beginWrite();
+  if(dest) {
+    memcpy(dest, pixels, queue.frame_size);
+    queue.endWrite(tracker_now_ns());
+  }
+
+  // GL thread
+  FrameQueueSlot* slot = queue.beginRead();
+  if(slot) {
+    ... use slot->data ...
+    queue.endRead();
+  }
+  ````
+
+ */
+#ifndef TRACKER_FRAME_QUEUE_H
+#define TRACKER_FRAME_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <atomic>
+
+#define FRAME_QUEUE_CACHE_LINE 64                                  /* We keep the producer and consumer counters on separate cache lines */
+#define FRAME_QUEUE_FRESH 0x80000000                               /* Flag of `latest`: the slot contains a frame that wasn't read yet */
+
+enum FrameQueuePolicy {
+  FRAME_QUEUE_LATEST,                                              /* The consumer always gets the newest frame, older frames are dropped */
+  FRAME_QUEUE_FIFO                                                 /* The consumer gets all frames in order, new frames are dropped when the queue is full */
+};
+
+struct FrameQueueSlot {
+  unsigned char* data;                                             /* The frame buffer, `frame_size` bytes */
+  uint64_t capture_ns;                                             /* Capture time that the producer passed into endWrite() */
+  uint64_t seq;                                                    /* Sequence number of the frame, starts at 1 */
+  bool is_locked;                                                  /* True when `data` is locked in memory */
+};
+
+class FrameQueue {
+ public:
+  FrameQueue();
+  ~FrameQueue();
+  bool setup(size_t frameSize, int numSlots, int policy = FRAME_QUEUE_LATEST); /* Allocates the buffers of `frameSize` bytes; call before the threads start */
+  void shutdown();                                                 /* Frees the buffers; make sure the threads stopped using the queue */
+
+  /* Producer */
+  unsigned char* beginWrite();                                     /* Returns a free buffer or NULL when the FIFO queue is full (the frame is dropped) */
+  void endWrite(uint64_t captureNs);                               /* Publishes the buffer from beginWrite() */
+
+  /* Consumer */
+  FrameQueueSlot* beginRead();                                     /* Returns the next frame (FIFO) or the newest frame (LATEST), NULL when there is no new frame */
+  void endRead();                                                  /* Returns the buffer from beginRead() to the producer */
+
+ public:
+  size_t frame_size;                                               /* Size of one buffer */
+  int policy;                                                      /* The FrameQueuePolicy */
+  std::vector<FrameQueueSlot> slots;                               /* The buffers */
+  uint64_t seq;                                                    /* Producer: sequence number of the last written frame */
+  uint32_t back;                                                   /* LATEST, producer: the slot we write into */
+  uint32_t front;                                                  /* LATEST, consumer: the slot we read from */
+
+  alignas(FRAME_QUEUE_CACHE_LINE) std::atomic<uint64_t> write_count; /* Number of frames published; only written by the producer */
+  std::atomic<uint64_t> num_dropped;                               /* FIFO: frames dropped because the queue was full; only written by the producer */
+  std::atomic<uint64_t> num_skipped;                               /* LATEST: frames replaced before they were read; only written by the producer */
+  std::atomic<uint32_t> latest;                                    /* LATEST: the slot that is exchanged between producer and consumer, with FRAME_QUEUE_FRESH */
+  alignas(FRAME_QUEUE_CACHE_LINE) std::atomic<uint64_t> read_count;  /* FIFO: number of frames released by the consumer; only written by the consumer */
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  FrameSource
+  -----------
+
+  A FrameSource delivers frames from a recording so you can feed the Tracker
+  without a live camera and as fast as the pipeline accepts them, e.g. to
+  reprocess hours of footage overnight. read() returns the next frame; the
+  pixels in the Frame stay valid until the next call to read(), seek() or
+  close(). Use a FrameUploader to get the frames into GL.
+
+     Y4MFrameSource:            YUV4MPEG2 files (4:2:0 and mono), memory mapped.
+     RawFrameSource:            headerless files with tightly packed frames of
+                                a fixed size and format, memory mapped.
+     ImageSequenceFrameSource:  numbered PNG or JPG files, e.g. "frames/%06d.png".
+
+  The memory mapped sources never copy the frames; they return pointers into
+  the mapping and release the pages of frames we've passed.
+
+  ````c++
+  Y4MFrameSource source;
+  FrameUploader uploader;
+  Frame frame;
+
+  source.open("recording.y4m");
+  uploader.setup(source.width, source.height, source.format);
+
+  while(source.read(frame)) {
+    uploader.upload(frame);
+    tracker.beginFrame();
+    uploader.draw();
+    tracker.endFrame();
+    tracker.apply();
+  }
+  ````
+
+ */
+#ifndef TRACKER_FRAME_SOURCE_H
+#define TRACKER_FRAME_SOURCE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <tracker/MappedFile.h>
+
+enum FrameFormat {
+  FRAME_FORMAT_NONE,
+  FRAME_FORMAT_RGB24,                                              /* 3 bytes per pixel */
+  FRAME_FORMAT_RGBA,                                               /* 4 bytes per pixel */
+  FRAME_FORMAT_GRAY,                                               /* 1 byte per pixel */
+  FRAME_FORMAT_I420                                                /* Planar Y, U, V; U and V have half the width and height */
+};
+
+struct Frame {
+  Frame();
+  unsigned char* data;                                             /* The pixels, tightly packed, first row is the top of the image */
+  uint64_t nbytes;                                                 /* Number of bytes in data */
+  uint64_t index;                                                  /* Index of the frame in the source, starts at 0 */
+  int width;                                                       /* Width in pixels */
+  int height;                                                      /* Height in pixels */
+  int format;                                                      /* The FrameFormat */
+};
+
+class FrameSource {
+ public:
+  FrameSource();
+  virtual ~FrameSource();
+  virtual bool open(std::string filepath) = 0;                     /* Opens the source; sets width, height, format and, when known, num_frames */
+  virtual bool read(Frame& frame) = 0;                             /* Gets the next frame; returns false at the end or on error */
+  virtual bool seek(uint64_t index) = 0;                           /* The next read() returns the frame with this index */
+  virtual void close() = 0;                                        /* Closes the source */
+
+ public:
+  int width;                                                       /* Width of the frames */
+  int height;                                                      /* Height of the frames */
+  int format;                                                      /* FrameFormat of the frames */
+  uint64_t num_frames;                                             /* Number of frames, 0 when we don't know (image sequences) */
+  uint64_t next_index;                                             /* Index of the frame that read() returns */
+};
+
+/* ---------------------------------------------------*/
+
+class Y4MFrameSource : public FrameSource {
+ public:
+  Y4MFrameSource();
+  ~Y4MFrameSource();
+  bool open(std::string filepath);
+  bool read(Frame& frame);
+  bool seek(uint64_t index);
+  void close();
+
+ private:
+  bool parseHeader(uint64_t& dataOffset);                          /* Parses the stream header; sets width, height, format and fps */
+  bool scanFrames(uint64_t dataOffset);                            /* Creates `offsets` by walking over all FRAME headers */
+
+ public:
+  MappedFile file;                                                 /* The mapped .y4m file */
+  double fps;                                                      /* Frame rate from the header, 0 when not given */
+  uint64_t frame_size;                                             /* Number of pixel bytes per frame */
+  uint64_t first_offset;                                           /* Offset of the pixels of the first frame */
+  uint64_t frame_stride;                                           /* Bytes between frames when all FRAME headers have no parameters, else 0 and we use `offsets` */
+  std::vector<uint64_t> offsets;                                   /* Offsets of the pixels of each frame, when frames have parameters */
+  uint64_t last_offset;                                            /* Offset of the previous frame we returned, we release its pages on the next read() */
+};
+
+/* ---------------------------------------------------*/
+
+class RawFrameSource : public FrameSource {
+ public:
+  RawFrameSource(int w, int h, int fmt);                           /* Raw files have no header so you need to give the size and FrameFormat */
+  ~RawFrameSource();
+  bool open(std::string filepath);
+  bool read(Frame& frame);
+  bool seek(uint64_t index);
+  void close();
+
+ public:
+  MappedFile file;                                                 /* The mapped file */
+  uint64_t frame_size;                                             /* Number of bytes per frame */
+};
+
+/* ---------------------------------------------------*/
+
+class ImageSequenceFrameSource : public FrameSource {
+ public:
+  ImageSequenceFrameSource(int firstNumber = 0);                   /* The number of the first file in the sequence */
+  ~ImageSequenceFrameSource();
+  bool open(std::string pattern);                                  /* printf() style pattern with the path of the images, e.g. "frames/%06d.png" */
+  bool read(Frame& frame);
+  bool seek(uint64_t index);
+  void close();
+
+ private:
+  bool load(uint64_t index);                                       /* Loads the image with the given index into `pixels` */
+
+ public:
+  std::string pattern;                                             /* The pattern we use to create the filenames */
+  int first_number;                                                /* Number of the first image */
+  bool is_jpg;                                                     /* True when we load JPGs, else PNGs */
+  unsigned char* pixels;                                           /* The last loaded image, is reused when big enough */
+  int allocated;                                                   /* Number of bytes allocated for `pixels` */
+  int nchannels;                                                   /* Number of channels of the images */
+  int64_t loaded_index;                                            /* Index of the image in `pixels`, -1 when none */
+};
+
+/* ---------------------------------------------------*/
+
+uint64_t frame_format_get_num_bytes(int fmt, int w, int h);        /* Returns the number of bytes of a frame, or 0 for an invalid format */
+
+#endif
@@ -0,0 +1,96 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  FrameUploader
+  -------------
+
+  Uploads the frames of a FrameSource into textures and draws them so you can
+  feed them into the Tracker. We copy each frame into one of
+  FRAME_UPLOADER_NUM_PBOS pixel unpack buffers and update the textures from
+  that buffer. The driver can then transfer the frame asynchronously while we
+  fill the other buffer with the next frame, instead of stalling in
+  glTexSubImage2D() until the copy is done.
+
+  I420 frames are uploaded as three GL_R8 planes and converted to RGB (BT.601,
+  video range) in the fragment shader, so we move 1.5 bytes per pixel instead
+  of 3 or 4. Gray frames are drawn as gray RGB.
+
+  draw() renders the frame into the complete viewport with the first row at
+  the top of the scene, like the BackgroundBuffer expects, so call it between
+  Tracker::beginFrame() and Tracker::endFrame(). See FrameSource.h.
+
+ */
+#ifndef TRACKER_FRAME_UPLOADER_H
+#define TRACKER_FRAME_UPLOADER_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+#include <tracker/FrameSource.h>
+
+#define FRAME_UPLOADER_NUM_PBOS 2                                  /* Number of pixel unpack buffers we cycle through */
+
+static const char* FRAME_UPLOADER_FS = ""
+  "uniform sampler2D u_tex_y;\n"
+  "uniform sampler2D u_tex_u;\n"
+  "uniform sampler2D u_tex_v;\n"
+  "in vec2 v_texcoord;\n"
+  "layout( location = 0 ) out vec4 fragcolor;\n"
+  "void main() {\n"
+  "#if defined(FRAME_I420)\n"
+  "  float y = 1.1643 * (texture(u_tex_y, v_texcoord).r - 0.0625);\n"
+  "  float u = texture(u_tex_u, v_texcoord).r - 0.5;\n"
+  "  float v = texture(u_tex_v, v_texcoord).r - 0.5;\n"
+  "  fragcolor.r = y + 1.5958 * v;\n"
+  "  fragcolor.g = y - 0.39173 * u - 0.81290 * v;\n"
+  "  fragcolor.b = y + 2.017 * u;\n"
+  "  fragcolor.a = 1.0;\n"
+  "#elif defined(FRAME_GRAY)\n"
+  "  fragcolor = vec4(texture(u_tex_y, v_texcoord).rrr, 1.0);\n"
+  "#else\n"
+  "  fragcolor = vec4(texture(u_tex_y, v_texcoord).rgb, 1.0);\n"
+  "#endif\n"
+  "}\n"
+  "";
+
+class FrameUploader {
+ public:
+  FrameUploader();
+  ~FrameUploader();
+  bool setup(int w, int h, int fmt);                               /* Creates the buffers, textures and shader for frames with this size and FrameFormat */
+  bool upload(Frame& frame);                                       /* Copies the frame into the next unpack buffer and updates the textures */
+  void draw();                                                     /* Draws the last uploaded frame into the complete viewport */
+  void shutdown();                                                 /* Destroys all GL objects */
+
+ private:
+  GLuint createTexture(GLenum internalFormat, int texW, int texH); /* Creates one of the plane textures */
+
+ public:
+  int width;                                                       /* Width of the frames */
+  int height;                                                      /* Height of the frames */
+  int format;                                                      /* The FrameFormat */
+  uint64_t frame_size;                                             /* Number of bytes of a frame */
+  GLuint pbos[FRAME_UPLOADER_NUM_PBOS];                            /* The pixel unpack buffers */
+  int pbo_index;                                                   /* The buffer we use for the next upload() */
+  GLuint tex[3];                                                   /* The textures; for I420 Y, U, V, for the other formats only tex[0] */
+  GLuint prog;                                                     /* Draws the textures; converts I420/gray to RGB */
+  GLuint vao;                                                      /* We use attribute less rendering */
+  uint64_t num_uploaded;                                           /* Number of frames we uploaded */
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  GlPipeline
+  ----------
+
+  The GL policies for a TrackerPipeline; together they do the same as the 
+  Tracker. The image stages add their passes to the RenderGraph of the 
+  GlContext, which reads back the mask with the double buffered PBOs, so 
+  the blobs of apply() belong to the frame of the previous apply() (see 
+  `blobs.frame`), like the Tracker.
+
+    GlBackground<Num, Format>:  BackgroundBuffer with `Num` frames in `Format`, see BackgroundBuffer.h 
+    GlMorphology:               erode and dilate with ErodeDilateThreshold
+    GlSmoothing:                Blur and the threshold of ErodeDilateThreshold
+
+  You can mix these with your own policies as long as they work on a 
+  GlContext and GLuint textures. 
+
+  ````c++
+  GlTrackerPipeline pipeline(320, 240);
+
+  pipeline.background.beginFrame();
+  {
+     draw the input here
+  }
+  pipeline.background.endFrame();
+  pipeline.apply();
+  ````
+
+ */
+#ifndef TRACKER_GL_PIPELINE_H
+#define TRACKER_GL_PIPELINE_H
+
+#include <glad/glad.h>
+#include <tracker/TrackerPipeline.h>
+#include <tracker/BackgroundBuffer.h>
+#include <tracker/ErodeDilateThreshold.h>
+#include <tracker/Blur.h>
+#include <tracker/GpuTimer.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/RenderTargetPool.h>
+
+/* ---------------------------------------------------*/
+
+class GlContext {
+ public:
+  GlContext(int w, int h, Timings& timings);
+  ~GlContext();
+  void beginFrame();                                                 /* Clears the graph and releases the transient targets */
+  bool transfer(GLuint mask, const FrameInfo& frame, BlobTracker& blobs); /* Executes the graph, reads back `mask` into PBO "A" and copies PBO "B" into `blobs`; false when we don't have a mask yet */
+  size_t getNumBytes();                                              /* Returns the number of bytes of VRAM used by the render targets and read back buffers */
+
+ public:
+  int w;
+  int h;
+  Timings& timings;
+  GpuTimer gpu_timer;                                                /* Measures the passes of the graph */
+  RenderGraph graph;                                                 /* The GL passes of one apply() */
+  RenderTargetPool targets;                                          /* The transient render targets, shared by all stages */
+  GLuint pbos[2];                                                    /* GL_PIXEL_PACK_BUFFERs for the async read back */
+  int pbo_toggle;                                                    /* Toggles between the PBOs */
+  FrameInfo pbo_frames[2];                                           /* The frames whose masks are in the PBOs */
+  GLuint read_fbo;                                                   /* We attach the mask to this fbo to read it back */
+  GLuint read_tex;                                                   /* The texture that is attached to read_fbo */
+};
+
+/* ---------------------------------------------------*/
+
+template<int Num = 10, int Format = BG_FORMAT_RGBA8>
+class GlBackground {
+ public:
+  typedef GlContext Context;
+  typedef GLuint Image;
+
+  GlBackground(int w, int h);
+  void beginFrame(uint64_t captureNs = 0);                           /* See Tracker::beginFrame() */
+  void endFrame();
+  void uploadFrame(const GLvoid* pixels, uint64_t captureNs = 0);    /* See Tracker::uploadFrame() */
+  bool addTexture(GLuint tex, int flags = 0, uint64_t captureNs = 0); /* See Tracker::addTexture() */
+  GLuint apply(GlContext& ctx);                                      /* Adds the background subtraction to the graph */
+
+ private:
+  void nextFrame(uint64_t captureNs);
+
+ public:
+  BackgroundBuffer buffer;
+  FrameInfo frame;                                                   /* The last frame we ingested */
+  uint64_t frame_count;                                              /* Number of frames; used for the frame ids */
+};
+
+template<int Num, int Format>
+GlBackground<Num, Format>::GlBackground(int w, int h)
+  :buffer(w, h, Num, Format)
+  ,frame_count(0)
+{
+}
+
+template<int Num, int Format>
+inline void GlBackground<Num, Format>::nextFrame(uint64_t captureNs) {
+  frame.id = ++frame_count;
+  frame.capture_ns = (captureNs) ? captureNs : tracker_now_ns();
+}
+
+template<int Num, int Format>
+inline void GlBackground<Num, Format>::beginFrame(uint64_t captureNs) {
+  nextFrame(captureNs);
+  buffer.beginFrame();
+}
+
+template<int Num, int Format>
+inline void GlBackground<Num, Format>::endFrame() {
+  buffer.endFrame();
+}
+
+template<int Num, int Format>
+inline void GlBackground<Num, Format>::uploadFrame(const GLvoid* pixels, uint64_t captureNs) {
+  nextFrame(captureNs);
+  buffer.uploadFrame(pixels);
+}
+
+template<int Num, int Format>
+inline bool GlBackground<Num, Format>::addTexture(GLuint tex, int flags, uint64_t captureNs) {
+  nextFrame(captureNs);
+  return buffer.addTexture(tex, flags);
+}
+
+template<int Num, int Format>
+inline GLuint GlBackground<Num, Format>::apply(GlContext& ctx) {
+  return buffer.apply(ctx.graph);
+}
+
+/* ---------------------------------------------------*/
+
+class GlMorphology {
+ public:
+  typedef GlContext Context;
+  typedef GLuint Image;
+
+  GlMorphology(int w, int h);
+  GLuint apply(GlContext& ctx, GLuint tex);                          /* Adds `erode_steps` erode and `dilate_steps` dilate passes to the graph */
+
+ public:
+  ErodeDilateThreshold edt;
+  int erode_steps;                                                   /* Number of erode iterations */
+  int dilate_steps;                                                  /* Number of dilate iterations */
+};
+
+inline GLuint GlMorphology::apply(GlContext& ctx, GLuint tex) {
+  GLuint eroded_tex = edt.erode(ctx.graph, tex, erode_steps);
+  return edt.dilate(ctx.graph, eroded_tex, dilate_steps);
+}
+
+/* ---------------------------------------------------*/
+
+class GlSmoothing {
+ public:
+  typedef GlContext Context;
+  typedef GLuint Image;
+
+  GlSmoothing(int w, int h);
+  GLuint apply(GlContext& ctx, GLuint tex);                          /* Adds the blur and threshold passes to the graph */
+
+ public:
+  Blur blur;
+  ErodeDilateThreshold edt;                                          /* We only use the threshold of this one */
+};
+
+inline GLuint GlSmoothing::apply(GlContext& ctx, GLuint tex) {
+  GLuint blurred_tex = blur.blur(ctx.graph, tex);
+  return edt.threshold(ctx.graph, blurred_tex);
+}
+
+/* ---------------------------------------------------*/
+
+typedef TrackerPipeline<GlBackground<>, GlMorphology, GlSmoothing, ContourLabelling, SimilarityMatching> GlTrackerPipeline;
+
+#endif
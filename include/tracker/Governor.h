@@ -0,0 +1,144 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  Governor
+  --------
+
+  Keeps the cost of a frame within a budget. When a crowd walks in, 
+  finding and matching the contours gets more expensive with every blob
+  and the render loop falls behind; when the scene is empty we don't need
+  to run the pipeline at full rate. The Governor watches the time of every
+  frame and the foreground coverage of the mask and adjusts the work:
+
+    level 0:  full quality
+    level 1:  fewer erode and dilate steps
+    level 2:  + find the contours at half the resolution 
+    level 3:  + track every other frame only
+    level 4:  + keep only the 32 largest blobs
+
+  We go one level down when `up_frames` of the last `up_window` frames take
+  longer than the budget and one level up again when `down_frames` frames 
+  in a row take less than `down_ratio` of the budget. We don't require the 
+  slow frames to be in a row: from level 3 on we only track every other 
+  frame and the frames in between are cheap. The settings of each level 
+  are in `levels`, change them when you want something else. 
+
+  When the coverage stays below `idle_coverage` for `idle_after_ms` we go 
+  idle: shouldProcess() then returns true once every `idle_interval_ms` 
+  only. As soon as a frame has foreground again, we run at full rate. Every
+  change of level and of the idle state is passed to `callback`.
+
+  ````c++
+  void on_governor(Governor* gov, int event, void* user) {
+    printf("level: %d, idle: %d\n", gov->level, gov->is_idle);
+  }
+
+  Governor governor;
+  governor.budget_ms = 8.0;
+  governor.callback = on_governor;
+
+  while(running) {
+    if(governor.shouldProcess()) {
+      uint64_t t = tracker_now_ns();
+      ... add the frame and call tracker.apply() ...
+      governor.update((tracker_now_ns() - t) / 1e6, tracker.blobs.coverage);
+      governor.apply(tracker);
+    }
+    tracker.draw();
+  }
+  ````
+
+  apply() works with a Tracker and a CpuTracker. Measure whatever part of 
+  the frame you want to keep in budget; with the Tracker the CPU time of 
+  apply() doesn't include the GL stages (see `tracker.timings` for those). 
+  The GL stages always run at full resolution, the lower resolution of 
+  level 2 is for the contours, which is where the time goes with many 
+  blobs. The Governor doesn't use GL.
+
+ */
+#ifndef TRACKER_GOVERNOR_H
+#define TRACKER_GOVERNOR_H
+
+#include <stdint.h>
+
+#define GOVERNOR_NUM_LEVELS 5
+
+enum {
+  GOVERNOR_EVENT_LEVEL,                                              /* `level` changed */
+  GOVERNOR_EVENT_IDLE,                                               /* We went idle */
+  GOVERNOR_EVENT_ACTIVE                                              /* We're not idle anymore */
+};
+
+class Governor;
+typedef void(*governor_callback)(Governor* gov, int event, void* user);
+
+struct GovernorLevel {
+  int erode_steps;                                                   /* Number of erode iterations */
+  int dilate_steps;                                                  /* Number of dilate iterations */
+  int label_scale;                                                   /* See BlobTracker::label_scale */
+  int track_interval;                                                /* See BlobTracker::track_interval */
+  int max_blobs;                                                     /* See BlobTracker::max_blobs; 0 means no limit */
+};
+
+class Governor {
+ public:
+  Governor();
+  bool shouldProcess(uint64_t nowNs = 0);                            /* Returns false when we're idle and it's not time for the next frame yet; nowNs defaults to tracker_now_ns() */
+  void update(double frameMs, float coverage, uint64_t nowNs = 0);  /* Call after every frame you processed with its cost and the coverage of its mask (BlobTracker::coverage) */
+  void setLevel(int lvl);                                            /* Forces a level; the governor continues from there */
+  template<class T> void apply(T& tracker);                          /* Writes the settings of the current level into a Tracker or CpuTracker */
+
+ private:
+  void notify(int event);
+
+ public:
+  double budget_ms;                                                  /* The time a frame may take */
+  double down_ratio;                                                 /* We go back to a better level when frames take less than budget_ms * down_ratio */
+  int up_frames;                                                     /* Number of frames over budget in the last `up_window` frames before we go one level down */
+  int up_window;                                                     /* Number of frames we look back for `up_frames`, at most 32 */
+  int down_frames;                                                   /* Number of frames in a row under budget_ms * down_ratio before we go one level up */
+  float idle_coverage;                                               /* Below this coverage the scene is empty */
+  double idle_after_ms;                                              /* We go idle when the scene is empty this long */
+  double idle_interval_ms;                                           /* Time between the frames we process when idle */
+  GovernorLevel levels[GOVERNOR_NUM_LEVELS];                         /* The settings of each level, 0 is the best quality */
+  int level;                                                         /* The current level */
+  bool is_idle;                                                      /* True when we're idle */
+  int num_over;                                                      /* Number of frames over budget in the last `up_window` frames */
+  uint32_t over_history;                                             /* Bit N is set when the frame N frames ago was over budget */
+  int num_under;                                                     /* Number of frames in a row under budget_ms * down_ratio */
+  uint64_t last_active_ns;                                           /* The last time we saw foreground */
+  uint64_t last_process_ns;                                          /* The last time shouldProcess() returned true */
+  governor_callback callback;                                        /* Gets called for every GOVERNOR_EVENT_* */
+  void* user;                                                        /* Passed into the callback */
+};
+
+/* ---------------------------------------------------*/
+
+template<class T>
+void Governor::apply(T& tracker) {
+  const GovernorLevel& lvl = levels[level];
+  tracker.erode_steps = lvl.erode_steps;
+  tracker.dilate_steps = lvl.dilate_steps;
+  tracker.blobs.label_scale = lvl.label_scale;
+  tracker.blobs.track_interval = lvl.track_interval;
+  tracker.blobs.max_blobs = lvl.max_blobs;
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  GpuTimer
+  --------
+
+  Measures the GPU time of the GL stages with GL_TIME_ELAPSED queries. We keep
+  GPU_TIMER_FRAMES sets of queries; the results of a set are only read when
+  we reuse it GPU_TIMER_FRAMES frames later and only when GL tells us they are
+  available, so measuring never stalls the pipeline. Results that are still not
+  available by then are dropped.
+
+  GL_TIME_ELAPSED queries can't be nested, so only one stage can be active at
+  a time. The results are added to the Timings you pass into the constructor.
+
+ */
+#ifndef TRACKER_GPU_TIMER_H
+#define TRACKER_GPU_TIMER_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+#include <tracker/Timings.h>
+
+#define GPU_TIMER_FRAMES 4                                         /* Number of frames we wait before reading back the query results */
+#define GPU_TIMER_MAX_NS 10000000000ull                            /* We drop results above 10 seconds, they're driver bugs, not timings */
+
+class GpuTimer {
+ public:
+  GpuTimer(Timings& timings);
+  ~GpuTimer();
+  void beginFrame();                                               /* Call once per frame before the first begin(); collects the results of GPU_TIMER_FRAMES frames ago */
+  void begin(int stage);                                           /* Start measuring the GPU time of a stage */
+  void end();                                                      /* Stop measuring the current stage */
+
+ private:
+  void collect(int frame);                                         /* Collects the available results of the given query set */
+
+ public:
+  Timings& timings;                                                /* The timings that receive our samples */
+  GLuint queries[GPU_TIMER_FRAMES][TRACKER_STAGE_COUNT];           /* The query objects per frame and stage; created on first use */
+  bool pending[GPU_TIMER_FRAMES][TRACKER_STAGE_COUNT];             /* Is set to true when we issued a query that we haven't read yet */
+  int frame;                                                       /* The query set we're currently using */
+  int active_stage;                                                /* The stage between begin() and end(), or -1 */
+  bool is_measuring;                                               /* Is set in beginFrame() when timings are enabled; stays the same for the whole frame */
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  Heatmap
+  -------
+
+  Accumulates the foreground mask of every frame into a float texture on 
+  the GPU, so you get a pixel accurate dwell/occupancy map instead of one 
+  built from blob centers on the CPU. Every frame adds the thresholded 
+  mask, weighted by the time since the previous frame, and multiplies what
+  was there with a decay: a pixel holds the number of seconds it was 
+  foreground, where a second that is `half_life_ms` old counts for half. 
+  With `half_life_ms` 0 nothing decays.
+
+  The accumulation is one fullscreen pass that ping/pongs between two R32F
+  textures (like erode and dilate). Every `readback_interval_ms` we add a 
+  pass that averages blocks of `scale` x `scale` pixels into a small 
+  texture and read that into a pack buffer. We don't wait for it: update()
+  puts a fence behind the read and copies the values into `values` once 
+  the GPU passed the fence, usually on the next frame. So the heatmap 
+  costs one pass per frame and a small copy every few seconds.
+
+  `values` has down_w x down_h floats, row by row, in the same coordinates
+  as the blobs (divided by `scale`). getTexture() returns the full size 
+  heatmap if you want to draw it.
+
+  ````c++
+  Heatmap heatmap(tracker.w, tracker.h, 8);
+  heatmap.half_life_ms = 60000;             // a minute ago counts for half
+  heatmap.readback_interval_ms = 5000;
+  tracker.heatmap = &heatmap;
+
+  tracker.apply();
+  if(heatmap.has_new_values) {
+    float dwell = heatmap.values[(y / 8) * heatmap.down_w + (x / 8)];
+    ...
+  }
+  ````
+
+  When you don't use the Tracker, add the passes to your own graph with 
+  apply() after the threshold pass and call update() after executing it.
+
+ */
+#ifndef TRACKER_HEATMAP_H
+#define TRACKER_HEATMAP_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+
+#define ROXLU_USE_OPENGL
+#include <tinylib.h>
+#include <vector>
+#include <tracker/ProgramCache.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/Timings.h>
+#include <tracker/Latency.h>
+
+static const char* HEATMAP_ACCUMULATE_FS = ""
+  "#version 330\n"
+  "uniform sampler2D u_heat;"
+  "uniform sampler2D u_mask;"
+  "uniform float u_decay;"
+  "uniform float u_weight;"
+  "layout( location = 0 ) out vec4 fragcolor;"
+  ""
+  "void main() {"
+  "  ivec2 p = ivec2(gl_FragCoord.xy);"
+  "  float heat = texelFetch(u_heat, p, 0).r * u_decay;"
+  "  float mask = texelFetch(u_mask, p, 0).r;"
+  "  fragcolor = vec4(heat + mask * u_weight, 0.0, 0.0, 1.0);"
+  "}"
+  "";
+
+static const char* HEATMAP_DOWNSAMPLE_FS = ""
+  "#version 330\n"
+  "uniform sampler2D u_tex;"
+  "uniform int u_scale;"
+  "layout( location = 0 ) out vec4 fragcolor;"
+  ""
+  "void main() {"
+  "  ivec2 size = textureSize(u_tex, 0);"
+  "  ivec2 start = ivec2(gl_FragCoord.xy) * u_scale;"
+  "  ivec2 end = min(start + ivec2(u_scale), size);"
+  "  float sum = 0.0;"
+  "  for(int j = start.y; j < end.y; ++j) {"
+  "    for(int i = start.x; i < end.x; ++i) {"
+  "      sum += texelFetch(u_tex, ivec2(i, j), 0).r;"
+  "    }"
+  "  }"
+  "  ivec2 n = end - start;"
+  "  fragcolor = vec4(sum / float(n.x * n.y), 0.0, 0.0, 1.0);"
+  "}"
+  "";
+
+class Heatmap {
+ public:
+  Heatmap(int w, int h, int scale = 8);
+  ~Heatmap();
+  GLuint apply(RenderGraph& graph, GLuint maskTex, const FrameInfo& frame); /* Adds the accumulation pass and, when it's time, the read back passes; returns the texture that will hold the heatmap */
+  bool update();                                                   /* Call after executing the graph: fences a new read back and copies a finished one into `values`; returns `has_new_values` */
+  void reset();                                                    /* Starts from an empty heatmap on the next apply() */
+  GLuint getTexture();                                             /* The full size heatmap (R32F) after the last apply() */
+  size_t getNumBytes();                                            /* Number of bytes of VRAM we use */
+
+ private:
+  bool setup();                                                    /* Creates the textures, FBOs and the pack buffer on first use */
+  bool createTarget(GLuint& fbo, GLuint& tex, int tw, int th);     /* Creates an FBO with a R32F texture */
+
+ public:
+  int w;                                                           /* Size of the mask and the heatmap */
+  int h;
+  int scale;                                                       /* We read back the average of blocks of scale x scale pixels */
+  int down_w;                                                      /* Size of the read back heatmap */
+  int down_h;
+  float half_life_ms;                                              /* After this time a contribution counts for half; 0 disables the decay. Default 0 */
+  uint64_t readback_interval_ms;                                   /* Time between two read backs, on the capture time of the frames. Default 1000 */
+  float max_frame_ms;                                              /* The max time between two frames we add, so a stall doesn't count as dwell. Default 250 */
+  GLuint fullscreen_vao;
+  GLuint accumulate_prog;
+  GLuint downsample_prog;
+  GLint u_decay;                                                   /* Uniform locations of accumulate_prog ... */
+  GLint u_weight;
+  GLint u_scale;                                                   /* ... and of downsample_prog */
+  GLuint fbo[2];                                                   /* We ping/pong between these */
+  GLuint tex[2];
+  int current;                                                     /* The index of tex[] that holds the heatmap */
+  GLuint down_fbo;                                                 /* The downsampled heatmap */
+  GLuint down_tex;
+  GLuint pbo;                                                      /* The pack buffer we read down_tex into */
+  GLsync fence;                                                    /* Is signalled when the read into `pbo` is done */
+  bool is_reading;                                                 /* True from the read back pass until we copied it into `values` */
+  bool needs_clear;                                                /* True when the next apply() starts from zero */
+  uint64_t last_frame_ns;                                          /* Capture time of the last frame we added */
+  uint64_t last_readback_ns;                                       /* Capture time of the last frame we read back */
+  FrameInfo readback_frame;                                        /* The frame of the read back that is in flight */
+  FrameInfo values_frame;                                          /* The last frame that is included in `values` */
+  std::vector<float> values;                                       /* The last read back, down_w * down_h */
+  bool has_new_values;                                             /* True when the last update() changed `values` */
+  uint64_t num_readbacks;                                          /* Number of read backs we copied into `values` */
+};
+
+/* ---------------------------------------------------*/
+
+inline GLuint Heatmap::getTexture() {
+  return tex[current];
+}
+
+#endif
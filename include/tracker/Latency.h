@@ -0,0 +1,74 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  Latency
+  -------
+
+  Every frame you grab with Tracker::beginFrame() gets a FrameInfo with a unique
+  id and the time it was captured. Because we read back the segmented mask
+  asynchronously, the blobs that BlobTracker::track() produces always belong to
+  an older frame; the FrameInfo travels with the mask through the read back
+  buffers so `BlobTracker::frame` tells you exactly which frame the tracking
+  result belongs to and `Blob::frame_id` in which frame a blob was last seen.
+
+  The Tracker records how long it takes from capture until the mask is on the
+  CPU and until the tracks are published in a LatencyHistogram. The histogram
+  uses LATENCY_SUB_BUCKETS logarithmic buckets per power of two microseconds,
+  so percentiles have a relative error of at most 25% from 1us up to ~67s at
+  a fixed, small memory cost.
+
+  ````c++
+  printf("p99 capture > tracks: %f ms\n", tracker.latency_tracks.getPercentile(99.0));
+  ````
+
+ */
+#ifndef TRACKER_LATENCY_H
+#define TRACKER_LATENCY_H
+
+#include <stdint.h>
+
+#define LATENCY_SUB_BUCKETS 4                                        /* Number of buckets per power of two */
+#define LATENCY_OCTAVES 27                                           /* We cover 1us - 2^26us (~67 sec) */
+#define LATENCY_NUM_BUCKETS (LATENCY_SUB_BUCKETS * LATENCY_OCTAVES)
+
+struct FrameInfo {
+  FrameInfo();
+  uint64_t id;                                                       /* Unique, increasing frame id; 0 means "no frame" */
+  uint64_t capture_ns;                                               /* Time the frame was captured, steady clock in ns, see tracker_now_ns() */
+};
+
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+  void reset();                                                      /* Removes all samples */
+  void add(uint64_t ns);                                             /* Adds a latency sample in ns */
+  double getPercentile(double p);                                    /* Returns the upper bound of the bucket that contains the p-th percentile (0-100), in ms */
+  double getAverage();                                               /* Returns the average latency in ms */
+  double getBucketUpperBound(int bucket);                            /* Returns the upper bound of the given bucket in ms */
+  void print(const char* name);                                      /* Prints the non-empty buckets */
+
+ public:
+  uint64_t buckets[LATENCY_NUM_BUCKETS];                             /* The number of samples in each bucket */
+  uint64_t count;                                                    /* Total number of samples */
+  uint64_t sum_ns;                                                   /* Sum of all samples, for the average */
+  uint64_t min_ns;                                                   /* Smallest sample */
+  uint64_t max_ns;                                                   /* Largest sample */
+};
+
+#endif
@@ -0,0 +1,77 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  MappedFile
+  ----------
+
+  Maps a complete file read-only into memory (mmap() or CreateFileMapping() on
+  Windows). We use this to read recorded video without copying it through
+  read(): the kernel pages the frames in and we hand out pointers into the
+  mapping. With `sequential` set we tell the kernel we read the file from
+  front to back so it reads ahead aggressively and drops pages behind us,
+  which keeps the page cache small when replaying hours of footage.
+
+  create() makes (or truncates) a file of `nbytes` and maps it writable, 
+  so you can write a file in place (e.g. a snapshot, see Snapshot.h). 
+  flush() writes the dirty pages to disk.
+
+  ````c++
+  MappedFile file;
+  if(file.open("recording.y4m")) {
+    printf("%llu bytes\n", (unsigned long long)file.size);
+  }
+  ````
+
+ */
+#ifndef TRACKER_MAPPED_FILE_H
+#define TRACKER_MAPPED_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+  bool open(std::string filepath, bool sequential = true);        /* Maps the complete file; returns false on error */
+  bool create(std::string filepath, uint64_t nbytes);              /* Creates or truncates the file, resizes it to nbytes and maps it writable */
+  bool flush();                                                    /* Writes the changes of a writable mapping to disk; returns false on error */
+  void close();                                                    /* Unmaps the file; is called by the destructor */
+  bool isOpen();                                                   /* Returns true when we have a mapping */
+  void release(uint64_t offset, uint64_t nbytes);                  /* Tells the kernel we don't need this range anymore (only a hint) */
+
+ public:
+  std::string filepath;                                            /* The file we mapped */
+  unsigned char* data;                                             /* Start of the mapping; NULL when not open */
+  uint64_t size;                                                   /* Size of the file in bytes */
+  bool is_writable;                                                /* True when created with create() */
+#if defined(_WIN32)
+  void* file_handle;                                               /* HANDLE of the file */
+  void* map_handle;                                                /* HANDLE of the file mapping */
+#else
+  int fd;                                                          /* File descriptor */
+#endif
+};
+
+inline bool MappedFile::isOpen() {
+  return NULL != data;
+}
+
+#endif
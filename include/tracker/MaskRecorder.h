@@ -0,0 +1,148 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  MaskRecorder / MaskPlayer
+  -------------------------
+
+  To reproduce tracking problems we want the exact masks the BlobTracker saw,
+  without storing w * h bytes per frame. The MaskRecorder stores each mask as
+  a run length encoded record in an append only file; set
+  `BlobTracker::recorder` and every call to track() records its input_image
+  before the tracking starts. The MaskPlayer reads the masks back so you can
+  feed them into BlobTracker::track() without a GPU; see
+  src/bench/replay_masks.cpp.
+
+  We store binary masks: every non-zero pixel is replayed as 255. This is
+  lossless for the BlobTracker because findContours() only looks at zero and
+  non-zero.
+
+  File layout (all values little endian):
+
+     header:    "TRKM", version, width, height                       (u32 each)
+     record:    "MREC", payload size (u32), frame id, capture ns (u64),
+                payload: run lengths as LEB128 varints, alternating
+                background and foreground, starting with background
+                (which may be 0). The runs go over all rows and add up
+                to width * height.
+     ...
+     index:     the offset of every record (u64 each)
+     trailer:   "TRKI", version (u32), num frames, offset of the index (u64)
+
+  The index and trailer are written by close(). When a recording was not
+  closed (e.g. the application crashed) the MaskPlayer rebuilds the index by
+  walking over the records and drops an incomplete last record.
+
+  ````c++
+  MaskRecorder recorder;
+  recorder.open("masks.trk", tracker.blobs.w, tracker.blobs.h);
+  tracker.blobs.recorder = &recorder;
+  ...
+  recorder.close();
+  ````
+
+ */
+#ifndef TRACKER_MASK_RECORDER_H
+#define TRACKER_MASK_RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <tracker/Latency.h>
+#include <tracker/MappedFile.h>
+
+#define MASK_FILE_MAGIC 0x4D4B5254                                 /* "TRKM" */
+#define MASK_RECORD_MAGIC 0x4345524D                               /* "MREC" */
+#define MASK_INDEX_MAGIC 0x494B5254                                /* "TRKI" */
+#define MASK_FILE_VERSION 1
+
+struct MaskFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+};
+
+struct MaskRecordHeader {
+  uint32_t magic;
+  uint32_t nbytes;                                                 /* Size of the run length payload that follows */
+  uint64_t frame_id;                                               /* FrameInfo::id */
+  uint64_t capture_ns;                                             /* FrameInfo::capture_ns */
+};
+
+struct MaskIndexTrailer {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t num_frames;
+  uint64_t index_offset;
+};
+
+/* ---------------------------------------------------*/
+
+class MaskRecorder {
+ public:
+  MaskRecorder();
+  ~MaskRecorder();
+  bool open(std::string filepath, int w, int h);                   /* Creates (or truncates) the file and writes the header */
+  bool record(const unsigned char* mask, int stride, FrameInfo& frame); /* Encodes and appends one mask; stride is the row length in bytes */
+  bool close();                                                    /* Writes the index and closes the file; is called by the destructor */
+  bool isOpen();                                                   /* Returns true when we're recording */
+
+ public:
+  std::string filepath;                                            /* The file we write */
+  FILE* fp;                                                        /* The file handle */
+  int width;                                                       /* Width of the masks */
+  int height;                                                      /* Height of the masks */
+  uint64_t offset;                                                 /* The offset where we write the next record */
+  std::vector<uint64_t> offsets;                                   /* Offsets of all records, written as index by close() */
+  std::vector<unsigned char> buffer;                               /* The encoded payload; reused between frames */
+  uint64_t num_encoded_bytes;                                      /* Total number of payload bytes we wrote, for statistics */
+};
+
+/* ---------------------------------------------------*/
+
+class MaskPlayer {
+ public:
+  MaskPlayer();
+  ~MaskPlayer();
+  bool open(std::string filepath);                                 /* Maps the file and reads or rebuilds the index */
+  bool read(unsigned char* mask, int stride, FrameInfo& frame);    /* Decodes the next mask; returns false at the end or on error */
+  bool seek(uint64_t index);                                       /* The next read() returns the mask with this index */
+  void close();
+
+ private:
+  bool readIndex();                                                /* Reads the index that MaskRecorder::close() wrote */
+  bool scanRecords();                                              /* Rebuilds the index by walking over the records */
+
+ public:
+  MappedFile file;                                                 /* The mapped recording */
+  int width;                                                       /* Width of the masks */
+  int height;                                                      /* Height of the masks */
+  uint64_t num_frames;                                             /* Number of masks in the file */
+  uint64_t next_index;                                             /* Index of the mask that read() returns */
+  std::vector<uint64_t> offsets;                                   /* Offsets of the records */
+};
+
+/* ---------------------------------------------------*/
+
+inline bool MaskRecorder::isOpen() {
+  return NULL != fp;
+}
+
+#endif
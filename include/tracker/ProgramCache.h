@@ -0,0 +1,88 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  ProgramCache
+  ------------
+
+  Every stage of the Tracker generates and compiles its shaders when it's created.
+  With many trackers, or when a camera restarts, this compile time adds up quickly.
+  The ProgramCache keeps the linked program binaries (glGetProgramBinary) in memory
+  and, when you call setup(), in a directory on disk. Programs are keyed on a hash
+  of the shader sources and the GL vendor/renderer/version strings so a driver
+  update invalidates the cache. When the driver rejects a binary we fall back to
+  compiling the sources and replace the cached binary.
+
+  All tracker stages create their programs through `tracker_program_cache()`.
+  To persist the binaries between runs, call setup() before you create a Tracker:
+
+  ````c++
+  tracker_program_cache().setup("cache/shaders");
+  Tracker tracker(320, 240, 10);
+  ````
+
+  When the GL implementation doesn't support program binaries (GL 4.1 or
+  GL_ARB_get_program_binary) the cache simply compiles every program.
+
+ */
+#ifndef TRACKER_PROGRAM_CACHE_H
+#define TRACKER_PROGRAM_CACHE_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+
+#define ROXLU_USE_OPENGL
+#include <tinylib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+struct ProgramBinary {
+  GLenum format;                                                   /* The binary format as returned by glGetProgramBinary() */
+  std::vector<unsigned char> data;                                 /* The program binary */
+};
+
+class ProgramCache {
+ public:
+  ProgramCache();
+  bool setup(std::string dir);                                     /* Enables the on-disk cache in `dir`; we create the directory when it doesn't exist. */
+  GLuint createProgram(const char* vs, const char* fs);            /* Returns a linked program for the given vertex and fragment shader sources. */
+
+ private:
+  bool init();                                                     /* Checks for program binary support and gets the driver string; called on first use because we need a GL context. */
+  uint64_t createKey(const char* vs, const char* fs);              /* Hashes the sources and driver string (FNV-1a) */
+  std::string createFilePath(uint64_t key);                        /* Returns the path of the cache file for the given key */
+  GLuint compileProgram(const char* vs, const char* fs);           /* Compiles and links the program from source */
+  bool loadProgram(uint64_t key, GLuint prog);                     /* Tries to load a binary from memory or disk into `prog`; returns false when not found or rejected */
+  bool readFile(uint64_t key, ProgramBinary& bin);                 /* Reads a binary from disk */
+  void storeProgram(uint64_t key, GLuint prog);                    /* Stores the binary of `prog` in memory and on disk */
+
+ public:
+  std::string dir;                                                 /* The cache directory; when empty we only cache in memory */
+  std::string driver;                                              /* GL_VENDOR, GL_RENDERER and GL_VERSION; part of the key */
+  std::map<uint64_t, ProgramBinary> binaries;                      /* Binaries we loaded or created during this run */
+  bool is_init;                                                    /* Is set to true after init() */
+  bool is_supported;                                               /* Is set to true when the GL supports program binaries */
+  int num_hits;                                                    /* Number of programs we created from a cached binary */
+  int num_misses;                                                  /* Number of programs we had to compile */
+};
+
+ProgramCache& tracker_program_cache();                             /* Returns the cache that is used by all tracker stages */
+
+#endif
@@ -0,0 +1,168 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  RenderGraph
+  -----------
+
+  The GL stages of the Tracker (BackgroundBuffer, ErodeDilateThreshold, Blur)
+  don't draw directly; they add passes to a RenderGraph. A pass declares the
+  textures it reads (bound to texture unit 0, 1, ...) and the framebuffer it
+  writes, plus the program, viewport and uniforms it needs. The graph is
+  rebuilt every frame (the pass storage is reused) and executed in the order
+  the passes were added; a stage always reads the output of an earlier pass.
+
+  The executor sets the shared state once and uses a GLStateCache to skip the
+  binds that don't change anything (e.g. the VAO, the viewport and program of
+  consecutive erode passes). Before the first pass we query the state of the
+  caller (framebuffers, viewport, program, VAO, pack state and the texture
+  units we touch) and we restore exactly that after the last pass, so you
+  don't need to tell us when your window resizes.
+
+  When `pool` is set, the stages draw into transient targets from that
+  RenderTargetPool instead of their own FBOs, see RenderTargetPool.h.
+
+  Passes with a `stage` (TRACKER_STAGE_*) are measured with the GpuTimer you
+  pass into execute(); consecutive passes of the same stage share one query.
+
+  ````c++
+  RenderGraph graph;
+
+  GLuint bg_tex = bg_buffer.apply(graph);
+  GLuint eroded_tex = edt.erode(graph, bg_tex, 2);
+  graph.execute(&gpu_timer);
+  ````
+
+ */
+#ifndef TRACKER_RENDER_GRAPH_H
+#define TRACKER_RENDER_GRAPH_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+#include <stdint.h>
+#include <vector>
+#include <tracker/RenderTargetPool.h>
+
+#define RENDER_GRAPH_MAX_INPUTS 32                                 /* Max number of textures a pass can read; these are the texture units we cache */
+#define RENDER_GRAPH_MAX_UNIFORMS 4                                /* Max number of uniforms per pass */
+
+class GpuTimer;
+
+enum RenderPassType {
+  RENDER_PASS_DRAW,                                                /* Draws a fullscreen triangle strip (attribute-less) into `fbo` */
+  RENDER_PASS_READ_PIXELS                                          /* Reads the first color attachment of `fbo` into the pack buffer `pbo` */
+};
+
+struct RenderPassUniform {
+  GLint location;
+  bool is_int;
+  GLint ivalue;
+  GLfloat fvalue;
+};
+
+struct RenderPass {
+  int type;                                                        /* RenderPassType */
+  int stage;                                                       /* TRACKER_STAGE_* that we measure with the GpuTimer, or -1 */
+  GLuint prog;                                                     /* The program we draw with */
+  GLuint vao;                                                      /* The (empty) VAO for attribute-less rendering */
+  GLuint fbo;                                                      /* Output: the framebuffer we draw into, input for RENDER_PASS_READ_PIXELS */
+  GLuint out_tex;                                                  /* Output: the texture attached to `fbo`; a pass may not read it */
+  GLuint inputs[RENDER_GRAPH_MAX_INPUTS];                          /* Input textures; inputs[i] is bound to GL_TEXTURE0 + i */
+  int num_inputs;
+  RenderPassUniform uniforms[RENDER_GRAPH_MAX_UNIFORMS];           /* Uniforms that are set right before we draw */
+  int num_uniforms;
+  GLint viewport[4];                                               /* x, y, w, h */
+  GLuint pbo;                                                      /* RENDER_PASS_READ_PIXELS: the pack buffer we read into */
+  GLenum read_format;                                              /* RENDER_PASS_READ_PIXELS: e.g. GL_RED */
+  GLenum read_type;                                                /* RENDER_PASS_READ_PIXELS: e.g. GL_UNSIGNED_BYTE or GL_FLOAT */
+  GLint pack_row_length;                                           /* RENDER_PASS_READ_PIXELS: GL_PACK_ROW_LENGTH, GL_PACK_ALIGNMENT is 1 */
+
+  void input(GLuint tex);                                          /* Adds an input texture on the next texture unit */
+  void uniform1i(GLint location, GLint value);
+  void uniform1f(GLint location, GLfloat value);
+};
+
+/* ---------------------------------------------------*/
+
+class GLStateCache {
+ public:
+  GLStateCache();
+  void save();                                                     /* Queries the state of the caller; the cache starts from this state */
+  void restore();                                                  /* Restores the state from save() */
+  void bindDrawFramebuffer(GLuint fbo);
+  void bindReadFramebuffer(GLuint fbo);
+  void viewport(GLint x, GLint y, GLint vw, GLint vh);
+  void bindVertexArray(GLuint vao);
+  void useProgram(GLuint prog);
+  void bindTexture(int unit, GLuint tex);                          /* Binds a GL_TEXTURE_2D on GL_TEXTURE0 + unit */
+  void bindPackBuffer(GLuint pbo);
+  void packAlignment(GLint align);
+  void packRowLength(GLint length);
+
+ private:
+  bool changed(GLint& current, GLint value);                       /* Sets current to value and returns true when it differs */
+  void activeTexture(int unit);
+
+ public:
+  GLint draw_fbo;                                                  /* The currently bound state ... */
+  GLint read_fbo;
+  GLint view[4];
+  GLint vao;
+  GLint prog;
+  GLint active_unit;
+  GLint pack_buffer;
+  GLint pack_alignment;
+  GLint pack_row_length;
+  GLint textures[RENDER_GRAPH_MAX_INPUTS];
+  bool has_texture[RENDER_GRAPH_MAX_INPUTS];                       /* True when we've queried the caller's texture on this unit */
+  GLint saved_draw_fbo;                                            /* ... and the state of the caller */
+  GLint saved_read_fbo;
+  GLint saved_view[4];
+  GLint saved_vao;
+  GLint saved_prog;
+  GLint saved_active_unit;
+  GLint saved_pack_buffer;
+  GLint saved_pack_alignment;
+  GLint saved_pack_row_length;
+  GLint saved_textures[RENDER_GRAPH_MAX_INPUTS];
+  uint64_t num_calls;                                              /* Number of state changes we sent to GL since save() */
+  uint64_t num_skipped;                                            /* Number of state changes we skipped since save() */
+};
+
+/* ---------------------------------------------------*/
+
+class RenderGraph {
+ public:
+  RenderGraph();
+  void clear();                                                    /* Removes all passes, keeps the storage */
+  RenderPass& addDrawPass(int stage, GLuint prog, GLuint vao, GLuint fbo, GLuint outTex, int vw, int vh); /* Adds a fullscreen draw into `fbo`, add the inputs on the returned pass */
+  RenderPass& addReadPixelsPass(int stage, GLuint fbo, GLuint pbo, int rw, int rh, GLenum format, int rowLength, GLenum type = GL_UNSIGNED_BYTE); /* Reads `fbo` into `pbo`, see RENDER_PASS_READ_PIXELS */
+  bool execute(GpuTimer* timer = NULL);                            /* Executes all passes and restores the caller's state; returns false and executes nothing when a pass reads its own output */
+
+ private:
+  RenderPass& addPass();
+
+ public:
+  std::vector<RenderPass> passes;
+  size_t num_passes;                                               /* The first num_passes of `passes` are used */
+  RenderTargetPool* pool;                                          /* When set, the stages acquire their transient outputs from this pool; not owned */
+  GLStateCache state;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  RenderTargetPool
+  ----------------
+
+  Most textures of the pipeline are only alive between the pass that writes
+  them and the pass that reads them, e.g. the output of the background
+  subtraction is dead once the first erode pass has read it. Instead of a
+  private FBO + texture per stage, the stages acquire these transient render
+  targets from a RenderTargetPool by format and size and release them as soon
+  as the last pass that reads them has been added to the RenderGraph.
+
+  Because the passes execute in the order they were added, a target that is
+  released can safely be handed out again for a later pass; GL orders the
+  reads and writes for us. The Tracker shares one pool between its stages and
+  calls reset() at the start of apply(), so the background, erode, dilate and
+  blur outputs alias two GL_R8 targets. Targets are never destroyed, so after
+  the first frame the pool doesn't create anything anymore.
+
+  ````c++
+  RenderTarget* target = pool.acquire(GL_R8, w, h);
+  RenderPass& pass = graph.addDrawPass(stage, prog, vao, target->fbo, target->tex, w, h);
+  pass.input(intex);
+  pool.release(intex);
+  ````
+
+ */
+#ifndef TRACKER_RENDER_TARGET_POOL_H
+#define TRACKER_RENDER_TARGET_POOL_H
+
+/* We use the glad GL wrapper, see: https://github.com/Dav1dde/glad */
+#include <glad/glad.h>
+#include <stddef.h>
+#include <vector>
+
+struct RenderTarget {
+  GLuint fbo;                                                      /* FBO with `tex` on GL_COLOR_ATTACHMENT0 */
+  GLuint tex;                                                      /* The texture, GL_LINEAR + GL_CLAMP_TO_EDGE */
+  GLenum format;                                                   /* Internal format, e.g. GL_R8 or GL_RGBA8 */
+  int w;
+  int h;
+  bool in_use;                                                     /* True between acquire() and release() */
+};
+
+class RenderTargetPool {
+ public:
+  RenderTargetPool();
+  ~RenderTargetPool();
+  RenderTarget* acquire(GLenum format, int w, int h);              /* Returns a free target with the given format and size; creates one when there is none. Returns NULL on error. */
+  bool release(GLuint tex);                                        /* Returns the target with texture `tex` to the pool; returns false (and does nothing) when `tex` isn't an acquired target of this pool */
+  void reset();                                                    /* Releases all targets; call this before you build a new frame */
+  void shutdown();                                                 /* Deletes all GL objects */
+  size_t getNumBytes();                                            /* Returns the number of bytes of VRAM used by the targets */
+  size_t getNumTargets();                                          /* Returns the number of targets we created */
+  size_t getNumInUse();                                            /* Returns the number of targets that are acquired */
+
+ private:
+  RenderTarget* create(GLenum format, int w, int h);               /* Creates a new target */
+
+ public:
+  std::vector<RenderTarget*> targets;                              /* All targets; heap allocated so the pointers stay valid */
+  size_t max_in_use;                                               /* The max number of targets that were acquired at the same time */
+};
+
+size_t render_target_get_bytes_per_pixel(GLenum format);           /* Returns the number of bytes per pixel of the internal formats we use */
+
+#endif
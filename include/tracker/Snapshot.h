@@ -0,0 +1,130 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  TrackerSnapshot
+  ---------------
+
+  After a restart the history of the background model is empty: for the 
+  first `num` frames nearly the whole frame is foreground and the 
+  BlobTracker finds a few huge blobs; the tracks we had are gone too. A 
+  TrackerSnapshot stores the history slots of the background model and the
+  tracked blobs in one memory mapped file so a restarted process continues
+  where the previous one stopped. 
+
+  Use Tracker::saveSnapshot()/loadSnapshot() or the same functions of the 
+  CpuTracker; they use this class. Save e.g. once every few seconds and 
+  when you shut down. We write into `filepath.tmp` and rename it when it's 
+  complete, so a crash while saving leaves the last snapshot intact. The 
+  history of a snapshot must have the same size, format and number of 
+  slots as the tracker that loads it.
+
+  ````c++
+  tracker.loadSnapshot("tracker.snap");   // fails (and does nothing) on the first run
+  ...
+  tracker.saveSnapshot("tracker.snap");
+  ````
+
+  File layout (all values little endian, no padding):
+
+     header:     SnapshotHeader
+     history:    num_slots * slot_bytes, the slots in ring order (slot 0 first)
+     long:       num_long * slot_bytes, see BackgroundBuffer::setupLongHistory()
+     blobs:      num_blobs * SnapshotBlob
+     trails:     num_trail_points * 2 int32 (x, y), the trails of the blobs after each other
+
+ */
+#ifndef TRACKER_SNAPSHOT_H
+#define TRACKER_SNAPSHOT_H
+
+#include <stdint.h>
+#include <string>
+#include <tracker/MappedFile.h>
+#include <tracker/BlobTracker.h>
+
+#define SNAPSHOT_MAGIC 0x534B5254                                  /* "TRKS" */
+#define SNAPSHOT_VERSION 1
+
+enum {                                                             /* The format of the history slots; the same values as BackgroundBufferFormat */
+  SNAPSHOT_HISTORY_RGBA8,
+  SNAPSHOT_HISTORY_RGB565,
+  SNAPSHOT_HISTORY_LUMA,
+  SNAPSHOT_HISTORY_LUMA_CHROMA
+};
+
+#pragma pack(push, 1)
+
+struct SnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width;                                                  /* Width of a history slot */
+  uint32_t height;                                                 /* Height of a history slot (h * 1.5 for SNAPSHOT_HISTORY_LUMA_CHROMA) */
+  uint32_t format;                                                 /* SNAPSHOT_HISTORY_* */
+  uint32_t num_slots;                                              /* Number of history slots */
+  uint32_t next_slot;                                              /* The slot that is overwritten by the next frame */
+  uint32_t num_long;                                               /* Number of long history slots; 0 when not used */
+  uint32_t long_index;                                             /* The long slot that is overwritten next */
+  uint32_t long_count;                                             /* Number of long slots that contain a frame */
+  uint64_t slot_bytes;                                             /* Size of one history slot */
+  uint64_t frame_count;                                            /* Number of frames the background model ingested */
+  uint64_t frame_id;                                               /* The id of the last frame of the tracker; new frames continue after it */
+  int32_t last_id;                                                 /* BlobTracker::last_id */
+  uint32_t num_blobs;                                              /* Number of SnapshotBlobs */
+  uint64_t num_trail_points;                                       /* Total number of trail points */
+};
+
+struct SnapshotBlob {
+  int32_t id;
+  int32_t age;
+  int32_t area;
+  int32_t x;                                                       /* Position */
+  int32_t y;
+  float direction_x;
+  float direction_y;
+  uint32_t num_trail_points;
+  uint64_t frame_id;
+};
+
+#pragma pack(pop)
+
+/* ---------------------------------------------------*/
+
+class TrackerSnapshot {
+ public:
+  TrackerSnapshot();
+  ~TrackerSnapshot();
+  bool create(std::string filepath, BlobTracker& tracker);         /* Creates `filepath.tmp` with the sizes of `header` (fill in the history fields first) and writes the blobs of `tracker` */
+  bool commit();                                                   /* Flushes and closes the file and renames it to `filepath` */
+  bool open(std::string filepath);                                 /* Maps a snapshot and validates its header */
+  bool restoreBlobs(BlobTracker& tracker);                         /* Replaces the blobs and last_id of `tracker` with those of the snapshot; sets the occupancy of `tracker.zones` */
+  void close();
+  unsigned char* getHistoryPtr(uint32_t slot);                     /* Returns the pixels of a history slot in the mapping */
+  unsigned char* getLongHistoryPtr(uint32_t slot);                 /* Returns the pixels of a long history slot in the mapping */
+  bool isCompatible(uint32_t width, uint32_t height, uint32_t format, uint32_t numSlots, uint64_t slotBytes); /* Returns true (and otherwise logs why not) when the history matches; slotBytes is the size of one history (and long history) slot the caller reads or writes. Call it before getHistoryPtr() */
+
+ private:
+  uint64_t getNumBytes();                                          /* The file size for `header` */
+
+ public:
+  std::string filepath;                                            /* The snapshot; we write into filepath + ".tmp" */
+  SnapshotHeader header;
+  MappedFile file;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+  Timings
+  -------
+
+  Collects the time spent in every stage of the tracking pipeline. The GL stages
+  are measured on the GPU with GL_TIME_ELAPSED queries (see GpuTimer.h) because
+  the CPU only queues the commands; the CPU stages are measured with a steady clock.
+  For every stage we keep the last TIMINGS_WINDOW samples from which we calculate
+  the min, average and 99th percentile.
+
+  Timings are disabled by default. When disabled, beginCpu()/endCpu() return
+  immediately and the GpuTimer doesn't create or issue any queries.
+
+  ````c++
+  tracker.timings.enable();
+
+  // ... after a couple of frames
+  TimingStats stats;
+  if(tracker.timings.getStats(TRACKER_STAGE_CONTOURS, stats)) {
+    printf("findContours: %f ms (p99: %f ms)\n", stats.avg_ms, stats.p99_ms);
+  }
+  ````
+
+  This header does not depend on GL so the BlobTracker can use it too.
+
+ */
+#ifndef TRACKER_TIMINGS_H
+#define TRACKER_TIMINGS_H
+
+#include <stdint.h>
+#include <chrono>
+
+#define TIMINGS_WINDOW 128                                           /* Number of samples we keep per stage */
+
+enum TrackerStage {
+  TRACKER_STAGE_BACKGROUND,                                          /* GPU: background subtraction (BackgroundBuffer::apply()) */
+  TRACKER_STAGE_ERODE,                                               /* GPU: erode iterations */
+  TRACKER_STAGE_DILATE,                                              /* GPU: dilate iterations */
+  TRACKER_STAGE_BLUR,                                                /* GPU: x and y blur */
+  TRACKER_STAGE_THRESHOLD,                                           /* GPU: threshold */
+  TRACKER_STAGE_READBACK,                                            /* GPU: glReadPixels() into the pack buffer */
+  TRACKER_STAGE_HEATMAP,                                             /* GPU: accumulating the heatmap and its downsampled read back (Heatmap::apply()) */
+  TRACKER_STAGE_APPEARANCE,                                          /* GPU: the colour histograms per tile and their read back (AppearanceTiles::apply()) */
+  TRACKER_STAGE_MAP,                                                 /* CPU: mapping and copying the previous pack buffer */
+  TRACKER_STAGE_CONTOURS,                                            /* CPU: findContours() */
+  TRACKER_STAGE_BLOBS,                                               /* CPU: creating blobs from the contours */
+  TRACKER_STAGE_MATCHING,                                            /* CPU: matching new blobs with the tracked blobs */
+  TRACKER_STAGE_APPLY,                                               /* CPU: the complete Tracker::apply() call */
+  TRACKER_STAGE_COUNT
+};
+
+struct TimingStats {
+  int num_samples;                                                   /* Number of samples the stats are based on (max. TIMINGS_WINDOW) */
+  double last_ms;                                                    /* The most recent sample */
+  double min_ms;                                                     /* Minimum of the samples */
+  double avg_ms;                                                     /* Average of the samples */
+  double p99_ms;                                                     /* 99th percentile of the samples */
+};
+
+class Timings {
+ public:
+  Timings();
+  void enable();                                                     /* Start collecting timings */
+  void disable();                                                    /* Stop collecting timings; keeps the collected samples */
+  bool isEnabled();                                                  /* Returns true when we collect timings */
+  void reset();                                                      /* Removes all samples */
+  void beginCpu(int stage);                                          /* Start measuring a CPU stage */
+  void endCpu(int stage);                                            /* Stop measuring a CPU stage and add the sample */
+  void addSample(int stage, double ms);                              /* Add a sample for the given stage, used by the GpuTimer */
+  bool getStats(int stage, TimingStats& stats);                      /* Get the stats for the given stage; returns false when we have no samples yet */
+  void print();                                                      /* Prints the stats for all stages */
+  static const char* getStageName(int stage);                        /* Returns a human readable name for the stage */
+
+ public:
+  bool is_enabled;                                                   /* Are we collecting timings */
+  uint64_t cpu_start[TRACKER_STAGE_COUNT];                           /* Start time of the CPU stages, in ns */
+  float samples[TRACKER_STAGE_COUNT][TIMINGS_WINDOW];                /* Ring buffers with the last samples of each stage, in ms */
+  int num_samples[TRACKER_STAGE_COUNT];                              /* Number of valid samples in the ring buffers */
+  int sample_index[TRACKER_STAGE_COUNT];                             /* Index where we write the next sample for a stage */
+};
+
+/* ---------------------------------------------------*/
+
+inline uint64_t tracker_now_ns() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline bool Timings::isEnabled() {
+  return is_enabled;
+}
+
+inline void Timings::beginCpu(int stage) {
+  if(!is_enabled) {
+    return;
+  }
+  cpu_start[stage] = tracker_now_ns();
+}
+
+inline void Timings::endCpu(int stage) {
+  if(!is_enabled) {
+    return;
+  }
+  addSample(stage, (tracker_now_ns() - cpu_start[stage]) / 1e6);
+}
+
+#endif
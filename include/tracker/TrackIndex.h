@@ -0,0 +1,131 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  TrackIndex
+  ----------
+
+  An index over the recent samples of the tracks for questions like "which 
+  tracks passed through this rectangle in the last 5 minutes" or "what's 
+  the nearest track to this point now" without walking over all blobs and 
+  trails. Set `BlobTracker::index` and updateClusters() inserts a sample of
+  every blob that was seen in the frame; you query from any thread.
+
+  The samples are stored in a ring of `num_buckets` time buckets of 
+  `bucket_ms` each (on FrameInfo::capture_ns); every bucket is a uniform 
+  grid with cells of `cell_size` pixels. When the time moves into a bucket
+  that holds old samples we clear it, so the index covers the last 
+  num_buckets * bucket_ms and never grows: a bucket keeps at most 
+  `max_bucket_samples` samples, the rest is counted in `num_dropped`. The 
+  vectors of the cells keep their memory when we clear them, so after the
+  first pass over the ring inserting doesn't allocate.
+
+  Every bucket has its own mutex. The tracker only locks the newest bucket 
+  (and the one it clears), so queries over older buckets never wait for 
+  the tracker and the tracker only waits for a query while that query 
+  reads the newest bucket.
+
+  ````c++
+  TrackIndex index(320, 240);               // 32 px cells, 300 buckets of 1 s: 5 minutes
+  tracker.blobs.index = &index;
+
+  // on another thread
+  uint64_t now = tracker_now_ns();
+  std::vector<int32_t> ids;
+  index.queryTrackIds(10, 10, 100, 50, (now > 300e9) ? now - 300e9 : 0, now, ids);
+
+  std::vector<TrackSample> nearest;
+  index.queryNearest(160, 120, 3, (now > 100e6) ? now - 100e6 : 0, now, nearest);
+  ````
+
+  All queries take a time window [t0, t1] in ns on the same clock as 
+  FrameInfo::capture_ns (tracker_now_ns() by default).
+
+ */
+#ifndef TRACKER_TRACK_INDEX_H
+#define TRACKER_TRACK_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+struct TrackSample {
+  int32_t id;                                                      /* Blob::id */
+  int32_t area;                                                    /* Blob::area */
+  float x;                                                         /* Blob::position */
+  float y;
+  uint64_t frame_id;                                               /* FrameInfo::id */
+  uint64_t time_ns;                                                /* FrameInfo::capture_ns */
+};
+
+struct TrackIndexBucket {
+  TrackIndexBucket();
+  std::mutex mutex;                                                /* Protects everything below */
+  uint64_t epoch;                                                  /* time_ns / bucket_ns of the samples in this bucket; UINT64_MAX when empty */
+  uint32_t num_samples;                                            /* Number of samples in all cells */
+  std::vector<std::vector<TrackSample> > cells;                    /* The samples per cell, row major */
+  std::vector<uint32_t> used_cells;                                /* The cells that have samples, so we clear only those */
+};
+
+/* ---------------------------------------------------*/
+
+class TrackIndex {
+ public:
+  TrackIndex(int w, int h, int cellSize = 32, uint32_t bucketMs = 1000, uint32_t numBuckets = 300);
+  ~TrackIndex();
+  void insert(const TrackSample* samples, size_t num);             /* Adds samples; they must belong to the newest bucket or one that hasn't expired yet */
+  void clear();                                                    /* Removes all samples */
+  size_t queryRange(float x0, float y0, float x1, float y1, uint64_t t0, uint64_t t1, std::vector<TrackSample>& result); /* Appends the samples inside the rectangle and time window to result; returns the number we added */
+  size_t queryTrackIds(float x0, float y0, float x1, float y1, uint64_t t0, uint64_t t1, std::vector<int32_t>& result); /* Sets result to the sorted ids of the tracks with a sample inside the rectangle and time window */
+  size_t queryWindow(uint64_t t0, uint64_t t1, std::vector<TrackSample>& result); /* Appends all samples of the time window to result */
+  size_t queryNearest(float x, float y, size_t k, uint64_t t0, uint64_t t1, std::vector<TrackSample>& result); /* Sets result to the nearest sample of the k nearest tracks, nearest first */
+
+ private:
+  TrackIndexBucket* lockBucket(uint64_t epoch);                    /* Locks the bucket of epoch, clears it when it holds older samples; NULL when epoch has expired */
+  bool isBucketInWindow(TrackIndexBucket& bucket, uint64_t t0, uint64_t t1); /* Call with the bucket locked */
+  int getCellX(float x);
+  int getCellY(float y);
+
+ public:
+  int w;                                                           /* Size of the frames */
+  int h;
+  int cell_size;                                                   /* Size of a grid cell in pixels */
+  int cols;                                                        /* Number of grid columns */
+  int rows;                                                        /* Number of grid rows */
+  uint64_t bucket_ns;                                              /* Time span of a bucket */
+  uint32_t num_buckets;                                            /* Number of buckets in the ring */
+  uint32_t max_bucket_samples;                                     /* Max number of samples per bucket, default 65536 */
+  TrackIndexBucket* buckets;                                       /* The ring */
+  std::atomic<uint64_t> num_dropped;                               /* Samples we dropped because of max_bucket_samples or because they were too old */
+};
+
+/* ---------------------------------------------------*/
+
+inline int TrackIndex::getCellX(float x) {
+  int c = (int)x / cell_size;
+  return (c < 0) ? 0 : (c >= cols) ? cols - 1 : c;
+}
+
+inline int TrackIndex::getCellY(float y) {
+  int r = (int)y / cell_size;
+  return (r < 0) ? 0 : (r >= rows) ? rows - 1 : r;
+}
+
+#endif
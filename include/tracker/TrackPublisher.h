@@ -0,0 +1,98 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  TrackPublisher
+  --------------
+
+  Publishes the tracked blobs of every frame into shared memory so other 
+  processes (a visualiser, a sound engine, a logger) get them without a 
+  socket, a copy through the kernel or any coupling with the render loop.
+  The publisher never waits for a reader and a reader never blocks the 
+  publisher; see TrackShm.h for the layout and the seqlock protocol and 
+  TrackReader.h for the reading side.
+
+  With TRACK_PUBLISH_FULL every slot contains all tracks of the frame; a 
+  reader only looks at the newest slot. With TRACK_PUBLISH_DELTA a slot 
+  contains only the tracks that moved, changed size or direction and the 
+  ids of the tracks that were removed; every `keyframe_interval` frames we
+  write a full slot so a reader that falls behind (or starts late) can 
+  resync. Because the age of an unmatched blob changes every frame we don't
+  consider it a change: in the delta mode `age` is the age of the last 
+  published change of a track.
+
+  ````c++
+  TrackPublisher publisher;
+  publisher.open("/tracker", TRACK_PUBLISH_DELTA);
+
+  tracker.apply();
+  publisher.publish(tracker.blobs);
+  ...
+  publisher.close();
+  ````
+
+  When there are more than `max_tracks` blobs, we publish the ones with the
+  lowest ids (the oldest tracks) and count the others in `num_overflows`.
+
+ */
+#ifndef TRACKER_TRACK_PUBLISHER_H
+#define TRACKER_TRACK_PUBLISHER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <tracker/TrackShm.h>
+#include <tracker/BlobTracker.h>
+
+enum TrackPublishMode {
+  TRACK_PUBLISH_FULL,                                              /* Every slot contains all tracks */
+  TRACK_PUBLISH_DELTA                                              /* Slots contain the changes, with a full slot every `keyframe_interval` frames */
+};
+
+/* ---------------------------------------------------*/
+
+class TrackPublisher {
+ public:
+  TrackPublisher();
+  ~TrackPublisher();
+  bool open(std::string name, int mode = TRACK_PUBLISH_FULL, uint32_t maxTracks = 256, uint32_t numSlots = 16); /* Creates the shared memory `name` (e.g. "/tracker"); replaces a segment that was left behind by a crashed publisher */
+  void close();                                                    /* Tells the readers we're gone and removes the segment */
+  bool isOpen();
+  bool publish(BlobTracker& tracker);                              /* Publishes `tracker.blobs` of `tracker.frame` */
+
+ private:
+  void updateRecords(BlobTracker& tracker);                        /* Fills `records` with the blobs, sorted on id */
+  void updateDelta();                                              /* Fills `changed` and `removed` by comparing `records` with `published`; unchanged records get the published age */
+  void writeSlot(uint32_t flags, const std::vector<TrackRecord>& tracks, const FrameInfo& frame); /* Writes the next slot */
+
+ public:
+  TrackShm shm;
+  TrackShmHeader* header;                                          /* Points into `shm` */
+  int mode;                                                        /* TRACK_PUBLISH_FULL or TRACK_PUBLISH_DELTA */
+  int keyframe_interval;                                           /* Delta mode: write a full slot every N frames; at most half the number of slots so a reader always finds one, default 8 */
+  uint64_t seq;                                                    /* The number of frames we published */
+  uint64_t num_overflows;                                          /* Number of blobs we couldn't publish because of `max_tracks` */
+  uint64_t num_bytes;                                              /* Total number of bytes we wrote into the slots; use it to compare the modes */
+  std::vector<TrackRecord> records;                                /* The tracks of the current frame */
+  std::vector<TrackRecord> published;                              /* The tracks as a reader has them after the last slot */
+  std::vector<TrackRecord> changed;                                /* The tracks that changed since `published` */
+  std::vector<int32_t> removed;                                    /* The ids that were removed since `published` */
+};
+
+#endif
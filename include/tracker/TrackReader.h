@@ -0,0 +1,110 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  TrackReader
+  -----------
+
+  Reads the tracks that a TrackPublisher (in another process) publishes. 
+  This is the only part of the tracker that a consumer needs: it depends 
+  on TrackShm.h only, no OpenCV and no GL. Link with the `tracker_reader` 
+  library (and `rt` on Linux).
+
+  Call update() whenever you want the latest tracks, e.g. once per frame 
+  of your application. It returns true when a new frame was published 
+  since the previous call and then `tracks` contains all tracks of 
+  `frame_id`, sorted on id. We never block the publisher: when it 
+  overwrites a slot while we read it we read it again.
+
+  With a full publisher we only read the newest slot; frames that were 
+  published between two calls are skipped (`num_skipped`). With a delta 
+  publisher we apply the slots after each other; when we fell more than 
+  the ring behind, we start again from the newest full slot (`num_resyncs`).
+  
+  When the publisher isn't running yet open() fails, but update() keeps 
+  trying to open the segment. When the publisher closes (or restarts) we 
+  drop our mapping and open the new segment on the next update().
+
+  ````c++
+  TrackReader reader;
+  reader.open("/tracker");
+
+  while(running) {
+    if(reader.update()) {
+      for(size_t i = 0; i < reader.tracks.size(); ++i) {
+        TrackRecord& track = reader.tracks[i];
+        printf("%d: %f, %f\n", track.id, track.x, track.y);
+      }
+    }
+  }
+  ````
+
+ */
+#ifndef TRACKER_TRACK_READER_H
+#define TRACKER_TRACK_READER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <tracker/TrackShm.h>
+
+struct TrackReaderSlot {                                           /* A copy of a slot */
+  uint32_t flags;
+  uint64_t frame_id;
+  uint64_t capture_ns;
+  uint64_t publish_ns;
+  uint32_t num_total;
+  std::vector<TrackRecord> tracks;
+  std::vector<int32_t> removed;
+};
+
+/* ---------------------------------------------------*/
+
+class TrackReader {
+ public:
+  TrackReader();
+  ~TrackReader();
+  bool open(std::string name);                                     /* Maps the segment of the publisher; returns false when it doesn't exist (yet) */
+  void close();
+  bool isOpen();
+  bool update();                                                   /* Returns true when `tracks` contains a new frame */
+
+ private:
+  bool mapSegment();                                               /* Maps `name` and validates the header */
+  bool peekFlags(uint64_t s, uint32_t& flags);                     /* Reads the flags of slot `s`; false when it was overwritten */
+  bool readSlot(uint64_t s, TrackReaderSlot& out);                 /* Copies slot `s`; false when it was overwritten */
+  void applySlot(TrackReaderSlot& slot);                           /* Applies a full or delta slot onto `tracks` */
+
+ public:
+  std::string name;
+  TrackShm shm;
+  TrackShmHeader* header;                                          /* Points into `shm` */
+  std::vector<TrackRecord> tracks;                                 /* The tracks of `frame_id`, sorted on id */
+  std::vector<TrackRecord> merged;                                 /* Used while applying a delta */
+  TrackReaderSlot slot;                                            /* The slot we read */
+  uint64_t frame_id;                                               /* FrameInfo::id of `tracks` */
+  uint64_t capture_ns;                                             /* FrameInfo::capture_ns of `tracks` */
+  uint64_t publish_ns;                                             /* The time the publisher wrote `tracks` (steady clock, ns) */
+  uint64_t last_seq;                                               /* The last slot we applied; 0 when we have nothing */
+  uint64_t num_skipped;                                            /* Number of published frames we didn't see */
+  uint64_t num_resyncs;                                            /* Number of times we restarted from a full slot because we fell behind */
+  uint64_t num_retries;                                            /* Number of times a slot was overwritten while we read it */
+};
+
+#endif
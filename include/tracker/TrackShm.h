@@ -0,0 +1,132 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  TrackShm
+  --------
+
+  The shared memory layout that a TrackPublisher writes and a TrackReader 
+  reads, and the functions that create and map it (shm_open() + mmap() on
+  POSIX, a named file mapping on Windows). Only the reader side is needed 
+  by other processes; this header does not depend on OpenCV or GL.
+
+  The segment is a TrackShmHeader followed by `num_slots` slots. Every slot
+  holds one published frame: a TrackShmSlot, `max_tracks` TrackRecords and
+  `max_tracks` removed ids. The publisher writes frame `seq` (1, 2, ...) 
+  into slot (seq - 1) % num_slots and then sets `write_seq` to seq. Each 
+  slot has a sequence counter, a seqlock: it's 2 * seq - 1 while the slot 
+  is written and 2 * seq when it's done. A reader copies a slot and checks
+  that the counter didn't change and is even; otherwise it was overwritten
+  while reading and we retry or skip it. No locks, no syscalls: any number
+  of readers can read while the publisher writes.
+
+  A slot is either a full frame (TRACK_SLOT_FULL, all tracks) or, in the 
+  delta mode of the publisher, a delta with only the tracks that changed 
+  since the previous frame plus the ids of the tracks that were removed.
+
+ */
+#ifndef TRACKER_TRACK_SHM_H
+#define TRACKER_TRACK_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+#define TRACK_SHM_MAGIC 0x4D534B54                                 /* "TKSM" */
+#define TRACK_SHM_VERSION 1
+
+enum {
+  TRACK_SLOT_FULL = 0x01,                                          /* The slot contains all tracks */
+  TRACK_SLOT_DELTA = 0x02                                          /* The slot contains the changes since the previous frame */
+};
+
+struct TrackRecord {
+  int32_t id;                                                      /* Blob::id */
+  int32_t age;                                                     /* Blob::age; in the delta mode the age of the last change */
+  int32_t area;                                                    /* Blob::area */
+  float x;                                                         /* Blob::position */
+  float y;
+  float direction_x;                                               /* Blob::direction */
+  float direction_y;
+  uint32_t reserved;
+  uint64_t frame_id;                                               /* The frame in which the blob was seen the last time */
+};
+
+struct TrackShmSlot {
+  std::atomic<uint64_t> seq;                                       /* The seqlock, see above */
+  uint64_t frame_id;                                               /* FrameInfo::id of the frame the tracks belong to */
+  uint64_t capture_ns;                                             /* FrameInfo::capture_ns */
+  uint64_t publish_ns;                                             /* When we published it, steady clock in ns (tracker_now_ns()) */
+  uint32_t flags;                                                  /* TRACK_SLOT_FULL or TRACK_SLOT_DELTA */
+  uint32_t num_tracks;                                             /* Number of TrackRecords */
+  uint32_t num_removed;                                            /* Number of removed ids (delta only) */
+  uint32_t num_total;                                              /* Number of tracks after applying this slot */
+};
+
+struct TrackShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_slots;                                              /* Number of slots in the ring */
+  uint32_t max_tracks;                                             /* Max number of tracks per frame; more are dropped */
+  uint64_t slot_bytes;                                             /* Size of one slot, a multiple of 64 */
+  std::atomic<uint64_t> write_seq;                                 /* The last frame that was completely written; 0 when nothing was published */
+  std::atomic<uint32_t> is_closed;                                 /* Set to 1 when the publisher closes; readers should reopen */
+  uint32_t reserved;
+};
+
+struct TrackShm {
+  TrackShm();
+  std::string name;                                                /* Name of the segment, e.g. "/tracker" */
+  unsigned char* data;                                             /* Start of the mapping */
+  size_t nbytes;                                                   /* Size of the mapping */
+  bool is_owner;                                                   /* True when we created it; we unlink it on close */
+#if defined(_WIN32)
+  void* handle;
+#endif
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == 8 && sizeof(std::atomic<uint32_t>) == 4, "TrackShm: the atomics must have the same layout as plain integers, other processes map this memory.");
+
+/* ---------------------------------------------------*/
+
+size_t track_shm_get_slot_bytes(uint32_t maxTracks);               /* The size of a slot for maxTracks tracks, rounded up to a cache line */
+bool track_shm_create(TrackShm& shm, std::string name, size_t nbytes); /* Creates (or replaces) the named segment and maps it read/write */
+bool track_shm_open(TrackShm& shm, std::string name);              /* Maps an existing segment read only */
+void track_shm_close(TrackShm& shm);                               /* Unmaps the segment; unlinks it when we created it */
+
+inline TrackShmHeader* track_shm_get_header(TrackShm& shm) {
+  return (TrackShmHeader*)shm.data;
+}
+
+inline TrackShmSlot* track_shm_get_slot(TrackShm& shm, uint64_t seq) {
+  TrackShmHeader* hdr = track_shm_get_header(shm);
+  size_t offset = (sizeof(TrackShmHeader) + 63) & ~(size_t)63;
+  return (TrackShmSlot*)(shm.data + offset + ((seq - 1) % hdr->num_slots) * hdr->slot_bytes);
+}
+
+inline TrackRecord* track_shm_get_records(TrackShmSlot* slot) {
+  return (TrackRecord*)((unsigned char*)slot + sizeof(TrackShmSlot));
+}
+
+inline int32_t* track_shm_get_removed(TrackShmSlot* slot, uint32_t maxTracks) {
+  return (int32_t*)(track_shm_get_records(slot) + maxTracks);
+}
+
+#endif
@@ -28,6 +28,7 @@
   the BlobTracker.
 
   ````c++
+  tracker_program_cache().setup("cache/shaders");  // optional, see ProgramCache.h
   Tracker tracker(320,240, 10);
   
   tracker.beginFrame();
@@ -48,6 +49,49 @@
   // draw some info 
   tracker.draw();
   ````
+
+  To find out where the time goes, call `tracker.timings.enable()` and 
+  query `tracker.timings.getStats()` or `tracker.timings.print()`. See Timings.h.
+
+  Every frame gets an id and capture time in beginFrame(). Because the mask is
+  read back asynchronously, the tracking result of apply() belongs to the frame
+  in `tracker.blobs.frame`. The latency from capture to mask/tracks is collected
+  in `latency_mask` and `latency_tracks`, see Latency.h.
+
+  When frames arrive on another thread (e.g. a camera callback) use a
+  CaptureIngest; it queues the frames and uploads the newest one with
+  uploadFrame() without stalling the GL thread. When the frame is already
+  in a texture, pass it to addTexture(); it's copied or referenced without
+  drawing when its format matches the history, see BackgroundBuffer.h.
+
+  apply() runs the GL stages as one RenderGraph and restores the GL state
+  (framebuffers, viewport, program, textures) that you had bound, see
+  RenderGraph.h. The intermediate textures of apply() are transient targets
+  of `targets`, a RenderTargetPool; call getNumBytes() to see the VRAM that
+  one Tracker uses.
+
+  To swap one of the stages (or run all of them on the CPU) use a 
+  TrackerPipeline with your own policies, see TrackerPipeline.h. When
+  there is no GL at all, use a CpuTracker, see CpuTracker.h.
+
+  After a restart the background model and the tracks are gone; call 
+  saveSnapshot() every now and then and loadSnapshot() at startup to 
+  continue where you were, see Snapshot.h. Without a snapshot we copy the 
+  first frame into the whole history (`bg_buffer.bootstrap`) so the first
+  masks are clean.
+
+  To reproduce tracking problems without a GPU, record the masks the
+  BlobTracker sees by setting `tracker.blobs.recorder`, see MaskRecorder.h.
+
+  Other processes can read the tracks from shared memory when you pass 
+  `tracker.blobs` to a TrackPublisher after apply(), see TrackPublisher.h.
+  A TrajectoryLog stores the tracks on disk for analysis, see 
+  TrajectoryLog.h. To query the recent tracks by area and time from other
+  threads, set `tracker.blobs.index`, see TrackIndex.h. A dwell heatmap 
+  of the masks is accumulated on the GPU when you set `tracker.heatmap`, 
+  see Heatmap.h. Lines and zones in which we count the tracks are set
+  with `tracker.blobs.zones`, see ZoneCounter.h. Set `tracker.appearance`
+  to match the blobs on their colours too, see AppearanceTiles.h.
  */
 #ifndef TRACKER_H
 #define TRACKER_H 
@@ -63,15 +107,29 @@
 #include <tracker/ErodeDilateThreshold.h>
 #include <tracker/Blur.h>
 #include <tracker/BlobTracker.h>
+#include <tracker/Timings.h>
+#include <tracker/GpuTimer.h>
+#include <tracker/Latency.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/RenderTargetPool.h>
+#include <tracker/Snapshot.h>
+#include <tracker/Heatmap.h>
+#include <tracker/AppearanceTiles.h>
 #include <iostream>
+#include <string>
 
 class Tracker {
  public:
-  Tracker(int w, int h, int bgBufferSize = 10);                     /* Create the tracker using the w/h dimensions to perform the computer vision algos on */
-  void beginFrame();                                                /* Begin drawing the frame on which you want to perform tracking */
+  Tracker(int w, int h, int bgBufferSize = 10, int bgFormat = BG_FORMAT_RGBA8); /* Create the tracker using the w/h dimensions to perform the computer vision algos on, see BackgroundBuffer.h for the formats */
+  void beginFrame(uint64_t captureNs = 0);                          /* Begin drawing the frame on which you want to perform tracking. Pass the capture time (tracker_now_ns() clock) when you know it, otherwise we use the current time. */
   void endFrame();                                                  /* End drawing the frame on which you want to perform tracking */
+  void uploadFrame(const GLvoid* pixels, uint64_t captureNs = 0);   /* Instead of beginFrame()/endFrame(): upload RGBA pixels (last row first) or an offset into the bound GL_PIXEL_UNPACK_BUFFER, see CaptureIngest.h */
+  bool addTexture(GLuint tex, int flags = 0, uint64_t captureNs = 0); /* Instead of beginFrame()/endFrame(): add the frame in `tex`, see BackgroundIngestFlags in BackgroundBuffer.h */
   void apply();                                                     /* Apply the tracking */
   void draw();                                                      /* Draw some tracking info */
+  size_t getNumBytes();                                             /* Returns the number of bytes of VRAM used by the history, render targets and read back buffers */
+  bool saveSnapshot(std::string filepath);                          /* Saves the background history and the tracked blobs into a memory mapped file, see Snapshot.h */
+  bool loadSnapshot(std::string filepath);                          /* Restores a snapshot of saveSnapshot(); call it before you grab the first frame */
 
  private:
   void drawContours(int x, int y);                                  /* Draw the found contours (gets called by draw()) */
@@ -91,5 +149,16 @@ class Tracker {
   int dilate_steps;                                                 /* Number of dilate iterations */
   GLuint pbos[2];                                                   /* GL_PIXEL_PACK_PACK bufers to optimize the GPU > CPU transfers */
   int pbo_toggle;                                                   /* Toggles between PBOs */
+  Timings timings;                                                  /* Per stage timings of apply(); call timings.enable() to start measuring, see Timings.h */
+  FrameInfo frame;                                                  /* The last frame grabbed with beginFrame()/endFrame() */
+  FrameInfo pbo_frames[2];                                          /* The frames whose masks are in the PBOs */
+  uint64_t frame_count;                                             /* Number of frames grabbed; used for the frame ids */
+  LatencyHistogram latency_mask;                                    /* Time from capture until the mask is copied to the CPU */
+  LatencyHistogram latency_tracks;                                  /* Time from capture until the tracks are updated */
+  GpuTimer gpu_timer;                                               /* Measures the GL stages of apply() */
+  RenderGraph graph;                                                /* The GL passes of apply(); rebuilt every frame, see RenderGraph.h */
+  RenderTargetPool targets;                                         /* The transient render targets of apply(), shared by all stages */
+  Heatmap* heatmap;                                                 /* When set, apply() accumulates the mask of every frame into it, see Heatmap.h */
+  AppearanceTiles* appearance;                                      /* When set, apply() makes the colour histograms that give the blobs an appearance, see AppearanceTiles.h */
 };
 #endif
@@ -0,0 +1,182 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  TrackerPipeline
+  ---------------
+
+  The Tracker hard-wires its stages. A TrackerPipeline gets them as policy
+  classes, so you can swap a stage (e.g. run everything on the CPU) without
+  forking the Tracker and without virtual calls in the inner loops; every
+  policy call is a plain, inlinable member call that the compiler resolves.
+
+  A pipeline has five policies:
+
+    Background:   ingests frames and returns the foreground image
+    Morphology:   erodes and dilates the foreground image
+    Smoothing:    blurs and thresholds it into the binary mask
+    Labelling:    finds the blobs in the mask (BlobTracker::new_blobs)
+    Matching:     matches them with the tracked blobs (BlobTracker::blobs)
+
+  The image stages (Background, Morphology, Smoothing) run on a `Context`,
+  e.g. the GL context with the RenderGraph and read back buffers or the CPU
+  context; they must all use the same Context and Image type, which we check
+  at compile time. The Context moves the mask into the BlobTracker.
+
+  Every policy is constructed with (w, h). An image stage looks like this:
+
+  ````c++
+  class MyMorphology {
+  public:
+    typedef CpuContext Context;
+    typedef CpuImage Image;
+    MyMorphology(int w, int h);
+    CpuImage apply(CpuContext& ctx, CpuImage in);
+  };
+  ````
+
+  The Background has `Image apply(Context& ctx)` and a `FrameInfo frame`
+  member with the last frame it ingested; how you give it frames depends on
+  the policy. Labelling and Matching have `void label(BlobTracker&)` and 
+  `void match(BlobTracker&)`. A Context has a (w, h, Timings&) constructor, 
+  beginFrame() and `bool transfer(Image mask, const FrameInfo&, BlobTracker&)` 
+  which fills the input image and frame of the BlobTracker and returns false 
+  when there is no mask yet.
+
+  GlPipeline.h has the GL policies that wrap the stages of the Tracker 
+  (GlTrackerPipeline), CpuPipeline.h the CPU policies (CpuTrackerPipeline).
+
+  ````c++
+  CpuTrackerPipeline pipeline(320, 240);
+
+  pipeline.background.addFrame(pixels, 320 * 3, 3);
+  pipeline.apply();
+
+  for(size_t i = 0; i < pipeline.blobs.blobs.size(); ++i) {
+    ...
+  }
+  ````
+
+  This header does not depend on GL.
+
+ */
+#ifndef TRACKER_PIPELINE_H
+#define TRACKER_PIPELINE_H
+
+#include <type_traits>
+#include <tracker/BlobTracker.h>
+#include <tracker/Timings.h>
+#include <tracker/Latency.h>
+
+/* ---------------------------------------------------*/
+
+class ContourLabelling {                                             /* Labelling with findContours(), see BlobTracker::label() */
+ public:
+  ContourLabelling(int, int) {}
+  void label(BlobTracker& tracker);
+};
+
+class SimilarityMatching {                                           /* Matching on the position distance, see BlobTracker::match() */
+ public:
+  SimilarityMatching(int, int) {}
+  void match(BlobTracker& tracker);
+};
+
+inline void ContourLabelling::label(BlobTracker& tracker) {
+  tracker.label();
+}
+
+inline void SimilarityMatching::match(BlobTracker& tracker) {
+  tracker.match();
+}
+
+/* ---------------------------------------------------*/
+
+template<class Background, class Morphology, class Smoothing, class Labelling = ContourLabelling, class Matching = SimilarityMatching>
+class TrackerPipeline {
+ public:
+  typedef typename Background::Context Context;
+  typedef typename Background::Image Image;
+
+  static_assert(std::is_same<Context, typename Morphology::Context>::value, "TrackerPipeline: the Background and Morphology policies must use the same Context.");
+  static_assert(std::is_same<Context, typename Smoothing::Context>::value, "TrackerPipeline: the Background and Smoothing policies must use the same Context.");
+  static_assert(std::is_same<Image, typename Morphology::Image>::value, "TrackerPipeline: the Background and Morphology policies must use the same Image type.");
+  static_assert(std::is_same<Image, typename Smoothing::Image>::value, "TrackerPipeline: the Background and Smoothing policies must use the same Image type.");
+
+  TrackerPipeline(int w, int h);
+  void apply();                                                      /* Runs all stages on the last frame that the background ingested */
+
+ public:
+  int w;
+  int h;
+  Timings timings;                                                   /* Per stage timings, call timings.enable() to start measuring */
+  Context context;                                                   /* Shared by the image stages; moves the mask into `blobs` */
+  Background background;
+  Morphology morphology;
+  Smoothing smoothing;
+  Labelling labelling;
+  Matching matching;
+  BlobTracker blobs;                                                 /* The input image and the new and tracked blobs */
+  LatencyHistogram latency_mask;                                     /* Time from capture until the mask is in `blobs` */
+  LatencyHistogram latency_tracks;                                   /* Time from capture until the tracks are updated */
+};
+
+template<class Background, class Morphology, class Smoothing, class Labelling, class Matching>
+TrackerPipeline<Background, Morphology, Smoothing, Labelling, Matching>::TrackerPipeline(int w, int h)
+  :w(w)
+  ,h(h)
+  ,context(w, h, timings)
+  ,background(w, h)
+  ,morphology(w, h)
+  ,smoothing(w, h)
+  ,labelling(w, h)
+  ,matching(w, h)
+  ,blobs(w, h)
+{
+  blobs.timings = &timings;
+}
+
+template<class Background, class Morphology, class Smoothing, class Labelling, class Matching>
+void TrackerPipeline<Background, Morphology, Smoothing, Labelling, Matching>::apply() {
+
+  timings.beginCpu(TRACKER_STAGE_APPLY);
+  context.beginFrame();
+
+  Image bg = background.apply(context);
+  Image morphed = morphology.apply(context, bg);
+  Image mask = smoothing.apply(context, morphed);
+
+  if(context.transfer(mask, background.frame, blobs)) {
+
+    if(blobs.frame.id) {
+      latency_mask.add(tracker_now_ns() - blobs.frame.capture_ns);
+    }
+
+    labelling.label(blobs);
+    matching.match(blobs);
+
+    if(blobs.frame.id) {
+      latency_tracks.add(tracker_now_ns() - blobs.frame.capture_ns);
+    }
+  }
+
+  timings.endCpu(TRACKER_STAGE_APPLY);
+}
+
+#endif
@@ -0,0 +1,208 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  TrajectoryLog / TrajectoryReader
+  --------------------------------
+
+  Blob::trail keeps the last positions of a blob only. The TrajectoryLog 
+  appends a sample of every blob that was seen in a frame (frame id, blob
+  id, position, area and direction) to memory mapped segment files, so you
+  can analyse the trajectories later. Appending is a few stores into the 
+  mapping per blob; there is no formatting and no write() call on the 
+  tracking thread.
+
+  The segments are columnar: a segment has a fixed capacity of `capacity`
+  samples and every column (see TrajectoryColumn) is an array of that 
+  capacity that starts on its own page. A reader that scans e.g. the x and
+  y columns doesn't touch (and the kernel doesn't read) the pages of the 
+  other columns. We start a new segment when the current one is full or,
+  when `segment_duration_ms` is set, when its first frame is older than 
+  that (on the capture time of the frames). Pages we never wrote don't use
+  disk space on file systems that support sparse files.
+
+  The index file contains a TrajectoryIndexEntry for every completed 
+  segment so a reader can skip the segments outside the frames it wants 
+  without opening them. A segment that was still open when the application
+  crashed is not in the index; open() of the log and the reader find it by
+  probing the segment after the last indexed one. We update the number of
+  samples in the header of a segment after every frame, so a reader sees 
+  complete frames only.
+
+  ````c++
+  TrajectoryLog log;
+  log.open("logs/traj");                   // logs/traj.index, logs/traj.000000, ...
+
+  tracker.apply();
+  log.append(tracker.blobs);
+  ...
+  log.close();
+
+  TrajectoryReader reader;
+  reader.open("logs/traj");
+
+  for(uint32_t i = 0; i < reader.index.size(); ++i) {
+    reader.mapSegment(i);
+    const float* x = reader.getColumn<float>(TRAJ_COLUMN_X);
+    for(uint64_t k = 0; k < reader.num_samples; ++k) {
+      ...
+    }
+  }
+  ````
+
+  Files (all values little endian):
+
+     prefix.index:    TrajectoryIndexHeader, TrajectoryIndexEntry, ...
+     prefix.NNNNNN:   TrajectorySegmentHeader, padding, the columns, each
+                      starting at `column_offsets[column]` (a multiple of
+                      TRAJ_PAGE_SIZE) with `capacity` values
+
+ */
+#ifndef TRACKER_TRAJECTORY_LOG_H
+#define TRACKER_TRAJECTORY_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <tracker/MappedFile.h>
+#include <tracker/BlobTracker.h>
+
+#define TRAJ_SEGMENT_MAGIC 0x534A5254                              /* "TRJS" */
+#define TRAJ_INDEX_MAGIC 0x494A5254                                /* "TRJI" */
+#define TRAJ_FILE_VERSION 1
+#define TRAJ_PAGE_SIZE 4096                                        /* The alignment of the columns */
+
+enum TrajectoryColumn {
+  TRAJ_COLUMN_FRAME,                                               /* uint64_t, FrameInfo::id */
+  TRAJ_COLUMN_ID,                                                  /* int32_t, Blob::id */
+  TRAJ_COLUMN_X,                                                   /* float, Blob::position */
+  TRAJ_COLUMN_Y,                                                   /* float */
+  TRAJ_COLUMN_AREA,                                                /* int32_t, Blob::area */
+  TRAJ_COLUMN_DIRECTION_X,                                         /* float, Blob::direction */
+  TRAJ_COLUMN_DIRECTION_Y,                                         /* float */
+  TRAJ_NUM_COLUMNS
+};
+
+enum {
+  TRAJ_ROLL_NONE,                                                  /* The segment is still open (or the application crashed) */
+  TRAJ_ROLL_SIZE,                                                  /* The segment was full */
+  TRAJ_ROLL_TIME,                                                  /* The segment was older than `segment_duration_ms` */
+  TRAJ_ROLL_CLOSE                                                  /* The log was closed */
+};
+
+struct TrajectorySegmentHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t segment;                                                /* The number of the segment, the NNNNNN of the file name */
+  uint32_t capacity;                                               /* The number of values in every column */
+  uint64_t num_samples;                                            /* The number of samples we wrote; updated after every frame */
+  uint64_t first_frame;                                            /* FrameInfo::id of the first sample */
+  uint64_t last_frame;                                             /* FrameInfo::id of the last sample */
+  uint64_t first_ns;                                               /* FrameInfo::capture_ns of the first sample */
+  uint64_t last_ns;                                                /* FrameInfo::capture_ns of the last sample */
+  uint64_t created_unix;                                           /* Wall clock time the segment was created, seconds since 1970 */
+  uint64_t column_offsets[TRAJ_NUM_COLUMNS];                       /* Offset of each column in the file */
+};
+
+struct TrajectoryIndexHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct TrajectoryIndexEntry {
+  uint32_t segment;
+  uint32_t reason;                                                 /* TRAJ_ROLL_* */
+  uint64_t num_samples;
+  uint64_t first_frame;
+  uint64_t last_frame;
+  uint64_t first_ns;
+  uint64_t last_ns;
+};
+
+size_t trajectory_get_column_size(int column);                     /* Size of one value of a column in bytes */
+std::string trajectory_get_segment_path(std::string prefix, uint32_t segment);
+bool trajectory_read_index(std::string prefix, std::vector<TrajectoryIndexEntry>& entries); /* Reads the index and adds the segments after it that were not indexed; false when there's no index */
+
+/* ---------------------------------------------------*/
+
+class TrajectoryLog {
+ public:
+  TrajectoryLog();
+  ~TrajectoryLog();
+  bool open(std::string prefix, uint32_t capacity = (1 << 20));    /* Opens or creates the log `prefix`; we continue after the existing segments. capacity is the number of samples per segment */
+  bool append(BlobTracker& tracker);                               /* Appends the blobs that were seen in `tracker.frame` */
+  bool close();                                                    /* Flushes and closes the segment and writes its index entry; is called by the destructor */
+  bool isOpen();
+
+ private:
+  bool createSegment();                                            /* Creates and maps segment `next_segment` */
+  bool closeSegment(uint32_t reason);                              /* Unmaps the current segment and appends its index entry */
+  bool writeIndexEntry(TrajectorySegmentHeader* hdr, uint32_t reason);
+
+ public:
+  std::string prefix;                                              /* The files are prefix.index and prefix.NNNNNN */
+  uint32_t capacity;                                               /* Number of samples per segment */
+  uint64_t segment_duration_ms;                                    /* When > 0 we start a new segment when the first frame of the current one is older than this */
+  uint32_t next_segment;                                           /* The number of the next segment we create */
+  FILE* index_fp;                                                  /* The index, opened for appending */
+  MappedFile segment;                                              /* The segment we write */
+  TrajectorySegmentHeader* header;                                 /* Points into `segment` */
+  unsigned char* columns[TRAJ_NUM_COLUMNS];                        /* Points to the columns in `segment` */
+  uint64_t num_samples;                                            /* Total number of samples we appended */
+  uint64_t num_segments;                                           /* Number of segments we created */
+};
+
+/* ---------------------------------------------------*/
+
+class TrajectoryReader {
+ public:
+  TrajectoryReader();
+  ~TrajectoryReader();
+  bool open(std::string prefix);                                   /* Reads the index; the segments are mapped by mapSegment() */
+  bool mapSegment(uint32_t dx);                                    /* Maps the segment of index[dx] and unmaps the previous one */
+  const void* getColumn(int column);                               /* The values of a column of the mapped segment; `num_samples` are valid */
+  template<class T> const T* getColumn(int column);                /* Same, checks that T has the size of the column */
+  void close();
+
+ public:
+  std::string prefix;
+  std::vector<TrajectoryIndexEntry> index;                         /* The segments, oldest first */
+  MappedFile segment;                                              /* The mapped segment */
+  TrajectorySegmentHeader* header;                                 /* Points into `segment` */
+  uint64_t num_samples;                                            /* Number of samples in the mapped segment when we mapped it; call mapSegment() again for a segment that is still written */
+};
+
+/* ---------------------------------------------------*/
+
+inline bool TrajectoryLog::isOpen() {
+  return NULL != index_fp;
+}
+
+template<class T> const T* TrajectoryReader::getColumn(int column) {
+
+  if(sizeof(T) != trajectory_get_column_size(column)) {
+    printf("Error: the values of column %d are %zu bytes, not %zu.\n", column, trajectory_get_column_size(column), sizeof(T));
+    return NULL;
+  }
+
+  return (const T*)getColumn(column);
+}
+
+#endif
@@ -0,0 +1,159 @@
+/*
+
+---------------------------------------------------------------------------------
+
+                                               oooo
+                                               `888
+                oooo d8b  .ooooo.  oooo    ooo  888  oooo  oooo
+                `888""8P d88' `88b  `88b..8P'   888  `888  `888
+                 888     888   888    Y888'     888   888   888
+                 888     888   888  .o8"'88b    888   888   888
+                d888b    `Y8bod8P' o88'   888o o888o  `V88V"V8P'
+
+                                                  www.roxlu.com
+                                             www.apollomedia.nl
+                                          www.twitter.com/roxlu
+
+---------------------------------------------------------------------------------
+
+
+
+  ZoneCounter
+  -----------
+
+  Counts the tracks that cross directed lines (e.g. a doorway) and that 
+  enter and leave polygon zones. Set `BlobTracker::zones` and the match 
+  step of the tracker tells us where every track moved; we test that 
+  movement against the lines and zones, update their counters and report
+  a ZoneEvent for every crossing.
+
+  The lines and zones are stored in a uniform grid with cells of 
+  `cell_size` pixels. A movement only visits the cells of its bounding box
+  and is only tested against the shapes in those cells, so the cost grows
+  with the number of tracks that move, not with tracks x shapes. Tracks 
+  that didn't move aren't tested at all.
+
+  A line from a to b counts a crossing as ZONE_EVENT_FORWARD when the track
+  moves to the side the normal (dy, -dx) of a -> b points to, otherwise as
+  ZONE_EVENT_BACKWARD. For a line from left to right (a.x < b.x), forward 
+  is moving up in the image. A zone counts ZONE_EVENT_ENTER and 
+  ZONE_EVENT_EXIT; a track that appears inside a zone enters it and a 
+  track that is removed inside a zone leaves it, so `occupancy` is the 
+  number of tracks in the zone. The tracks that TrackerSnapshot restores
+  are counted with restoreOccupancy(), without events. When the zones are
+  set after the snapshot was loaded we don't know about those tracks; 
+  they leave without having entered and occupancy stays at 0.
+
+  ````c++
+  void on_zone_event(ZoneCounter* counter, const ZoneEvent& ev, void* user) {
+    printf("track %d, shape %d, event %d\n", ev.track_id, ev.shape, ev.type);
+  }
+
+  ZoneCounter zones(320, 240);
+  int door = zones.addLine(100, 200, 220, 200);
+  float poly[] = { 10, 10, 100, 10, 100, 80, 10, 80 };
+  int waiting = zones.addZone(poly, 4);
+  zones.callback = on_zone_event;
+  tracker.blobs.zones = &zones;
+
+  tracker.apply();
+  printf("in: %llu, waiting: %d\n", zones.shapes[door].num_forward, zones.shapes[waiting].occupancy);
+  ````
+
+  The events of the last frame are also in `events`. The counter is used
+  on the tracking thread; add the shapes before you start tracking.
+
+ */
+#ifndef TRACKER_ZONE_COUNTER_H
+#define TRACKER_ZONE_COUNTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <tracker/Latency.h>
+
+enum {
+  ZONE_SHAPE_LINE,                                                 /* A directed line from points[0] to points[1] */
+  ZONE_SHAPE_POLYGON                                               /* A closed polygon */
+};
+
+enum {
+  ZONE_EVENT_FORWARD,                                              /* A track crossed a line in the direction of its normal */
+  ZONE_EVENT_BACKWARD,                                             /* A track crossed a line against its normal */
+  ZONE_EVENT_ENTER,                                                /* A track entered (or appeared in) a zone */
+  ZONE_EVENT_EXIT                                                  /* A track left (or disappeared in) a zone */
+};
+
+struct ZonePoint {
+  float x;
+  float y;
+};
+
+struct ZoneShape {
+  ZoneShape();
+  int type;                                                        /* ZONE_SHAPE_* */
+  std::vector<ZonePoint> points;
+  float min_x;                                                     /* Bounding box */
+  float min_y;
+  float max_x;
+  float max_y;
+  uint64_t num_forward;                                            /* Lines: number of ZONE_EVENT_FORWARD */
+  uint64_t num_backward;                                           /* Lines: number of ZONE_EVENT_BACKWARD */
+  uint64_t num_enters;                                             /* Zones: number of ZONE_EVENT_ENTER */
+  uint64_t num_exits;                                              /* Zones: number of ZONE_EVENT_EXIT */
+  int occupancy;                                                   /* Zones: number of tracks inside */
+};
+
+struct ZoneEvent {
+  int type;                                                        /* ZONE_EVENT_* */
+  int shape;                                                       /* Index into ZoneCounter::shapes */
+  int track_id;                                                    /* Blob::id */
+  uint64_t frame_id;                                               /* The frame in which it happened */
+  float x;                                                         /* Position of the track after the event */
+  float y;
+};
+
+class ZoneCounter;
+typedef void(*zone_callback)(ZoneCounter* counter, const ZoneEvent& event, void* user);
+
+/* ---------------------------------------------------*/
+
+class ZoneCounter {
+ public:
+  ZoneCounter(int w, int h, int cellSize = 32);
+  int addLine(float x0, float y0, float x1, float y1);             /* Adds a directed line; returns its index in `shapes` */
+  int addZone(const float* xy, int numPoints);                     /* Adds a polygon with numPoints x/y pairs; returns its index in `shapes` or -1 */
+  void clear();                                                    /* Removes all shapes */
+  void resetCounters();                                            /* Sets all counters to zero; occupancy is kept */
+  void beginFrame(const FrameInfo& frame);                         /* Clears `events`; the tracker calls this before it matches */
+  void appear(int trackId, float x, float y);                      /* A new track */
+  void move(int trackId, float x0, float y0, float x1, float y1);  /* A track moved from (x0, y0) to (x1, y1) */
+  void disappear(int trackId, float x, float y);                   /* A track was removed */
+  void restoreOccupancy(const float* xy, size_t num);              /* Sets the occupancy of the zones to the num x/y positions of the tracks we have now, e.g. after a snapshot was restored */
+  bool isInside(int shape, float x, float y);                      /* Returns true when the point is inside the zone */
+
+ private:
+  void updateGrid();                                               /* Adds all shapes to the cells of their bounding box */
+  void collect(float x0, float y0, float x1, float y1);            /* Fills `candidates` with the shapes in the cells of this box */
+  void emit(int type, int shape, int trackId, float x, float y);
+
+ public:
+  int w;                                                           /* Size of the frames */
+  int h;
+  int cell_size;
+  int cols;
+  int rows;
+  std::vector<ZoneShape> shapes;                                   /* The lines and zones */
+  std::vector<std::vector<int> > cells;                            /* The shapes per cell, row major */
+  std::vector<uint32_t> stamps;                                    /* Per shape: the last collect() that found it, so we test it once */
+  std::vector<int> candidates;                                     /* The shapes of the last collect() */
+  uint32_t stamp;
+  bool is_grid_dirty;                                              /* True when shapes were added since updateGrid() */
+  FrameInfo frame;                                                 /* The frame of beginFrame() */
+  std::vector<ZoneEvent> events;                                   /* The events since beginFrame() */
+  zone_callback callback;                                          /* Gets called for every event */
+  void* user;                                                      /* Passed into the callback */
+  uint64_t num_tests;                                              /* Number of shapes we tested a track against, for statistics */
+};
+
+#endif
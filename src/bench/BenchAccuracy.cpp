@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <math.h>
+#include <bench/BenchAccuracy.h>
+
+BenchAccuracy::BenchAccuracy()
+  :num_truths(0)
+  ,num_found(0)
+  ,num_tracks(0)
+  ,num_correct(0)
+  ,num_switches(0)
+  ,error_sum(0.0)
+{
+}
+
+void BenchAccuracy::print() {
+  printf("recall: %.2f%%\n", num_truths ? (100.0 * num_found) / num_truths : 0.0);
+  printf("precision: %.2f%%\n", num_tracks ? (100.0 * num_correct) / num_tracks : 0.0);
+  printf("error: %.2f px\n", num_correct ? error_sum / num_correct : 0.0);
+  printf("switches: %llu\n", (unsigned long long)num_switches);
+}
+
+void bench_evaluate(BlobTracker& tracker, BenchTruth& truth, BenchAccuracy& acc) {
+
+  std::vector<Blob>& blobs = tracker.blobs;
+  std::vector<bool> found(truth.blobs.size(), false);
+
+  for(size_t i = 0; i < blobs.size(); ++i) {
+
+    Blob& b = blobs[i];
+    if(!b.matched || b.frame_id != truth.frame) {
+      continue;
+    }
+
+    acc.num_tracks++;
+
+    /* Nearest ground truth blob. */
+    int nearest = -1;
+    float nearest_dist = 0.0f;
+    for(size_t j = 0; j < truth.blobs.size(); ++j) {
+      SceneBlob& t = truth.blobs[j];
+      float dx = b.position.x - t.x;
+      float dy = b.position.y - t.y;
+      float dist = sqrtf(dx * dx + dy * dy);
+      if(dist <= t.radius + 4.0f && (nearest < 0 || dist < nearest_dist)) {
+        nearest = (int)j;
+        nearest_dist = dist;
+      }
+    }
+
+    if(nearest < 0) {
+      continue;
+    }
+
+    acc.num_correct++;
+    acc.error_sum += nearest_dist;
+
+    if(!found[nearest]) {
+      found[nearest] = true;
+      acc.num_found++;
+
+      std::map<int, int>::iterator it = acc.track_ids.find(truth.blobs[nearest].id);
+      if(it != acc.track_ids.end() && it->second != b.id) {
+        acc.num_switches++;
+      }
+      acc.track_ids[truth.blobs[nearest].id] = b.id;
+    }
+  }
+
+  acc.num_truths += truth.blobs.size();
+}
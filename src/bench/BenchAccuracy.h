@@ -0,0 +1,47 @@
+/*
+
+  BenchAccuracy
+  -------------
+
+  Measures the tracking accuracy of the benchmarks against the ground truth
+  of the SceneGenerator. Keep the ground truth of the last BENCH_NUM_TRUTHS 
+  frames and call bench_evaluate() with the truth of the frame that the 
+  tracking result belongs to (`blobs.frame.id`):
+
+     - recall:      percentage of ground truth blobs with a tracked blob nearby
+     - precision:   percentage of tracked blobs with a ground truth blob nearby
+     - error:       average distance between a tracked blob and its ground truth
+     - switches:    number of times a ground truth blob got another track id
+
+ */
+#ifndef TRACKER_BENCH_ACCURACY_H
+#define TRACKER_BENCH_ACCURACY_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include <tracker/BlobTracker.h>
+#include <bench/SceneGenerator.h>
+
+#define BENCH_NUM_TRUTHS 8                      /* ground truth frames we keep; must be bigger than the tracker latency in frames */
+
+struct BenchTruth {
+  uint64_t frame;
+  std::vector<SceneBlob> blobs;
+};
+
+struct BenchAccuracy {
+  BenchAccuracy();
+  void print();                                 /* prints recall, precision, error and switches */
+  uint64_t num_truths;                          /* number of ground truth blobs we evaluated */
+  uint64_t num_found;                           /* number of ground truth blobs with a track nearby */
+  uint64_t num_tracks;                          /* number of tracked blobs we evaluated */
+  uint64_t num_correct;                         /* number of tracked blobs with a ground truth blob nearby */
+  uint64_t num_switches;                        /* number of times a ground truth blob changed track id */
+  double error_sum;                             /* sum of the distances between the tracks and ground truth */
+  std::map<int, int> track_ids;                 /* ground truth id => last track id */
+};
+
+void bench_evaluate(BlobTracker& tracker, BenchTruth& truth, BenchAccuracy& acc);
+
+#endif
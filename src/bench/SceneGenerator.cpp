@@ -0,0 +1,129 @@
+#include <bench/SceneGenerator.h>
+#include <math.h>
+
+SceneGenerator::SceneGenerator(int w, int h, int num, uint32_t seed)
+  :w(w)
+  ,h(h)
+  ,noise(6.0f)
+  ,drift(0.1f)
+  ,drift_period(600)
+  ,frame(0)
+  ,rng(seed ? seed : 1)
+{
+  createBackground();
+
+  float min_radius = 6.0f;
+  float max_radius = 6.0f + (w + h) / 40.0f;
+
+  for(int i = 0; i < num; ++i) {
+    SceneBlob b;
+    b.id = i + 1;
+    b.radius = randomFloat(min_radius, max_radius);
+    b.x = randomFloat(b.radius, w - b.radius);
+    b.y = randomFloat(b.radius, h - b.radius);
+    b.vx = randomFloat(-2.0f, 2.0f);
+    b.vy = randomFloat(-2.0f, 2.0f);
+
+    /* Keep the blobs away from the background brightness. */
+    b.color[0] = 150 + random() % 100;
+    b.color[1] = 150 + random() % 100;
+    b.color[2] = 150 + random() % 100;
+    blobs.push_back(b);
+  }
+
+  pixels.resize(w * h * 4, 255);
+}
+
+void SceneGenerator::createBackground() {
+
+  background.resize(w * h * 3);
+
+  for(int j = 0; j < h; ++j) {
+    for(int i = 0; i < w; ++i) {
+      unsigned char* p = &background[(j * w + i) * 3];
+      int tile = ((i / 16) + (j / 16)) & 1;
+      p[0] = 40 + (i * 40) / w + tile * 10;
+      p[1] = 40 + (j * 40) / h + tile * 10;
+      p[2] = 60 + tile * 10;
+    }
+  }
+}
+
+void SceneGenerator::update() {
+
+  ++frame;
+
+  /* Move and bounce. */
+  for(size_t k = 0; k < blobs.size(); ++k) {
+
+    SceneBlob& b = blobs[k];
+    b.x += b.vx;
+    b.y += b.vy;
+
+    if(b.x < b.radius || b.x > w - b.radius) {
+      b.vx = -b.vx;
+      b.x += 2 * b.vx;
+    }
+    if(b.y < b.radius || b.y > h - b.radius) {
+      b.vy = -b.vy;
+      b.y += 2 * b.vy;
+    }
+  }
+
+  /* Background with lighting drift and noise. */
+  float light = 1.0f + drift * sinf((2.0f * 3.14159265f * frame) / drift_period);
+  int amp = (int)noise;
+
+  for(int j = 0; j < h; ++j) {
+    for(int i = 0; i < w; ++i) {
+
+      unsigned char* src = &background[(j * w + i) * 3];
+      unsigned char* dest = &pixels[(j * w + i) * 4];
+
+      for(int c = 0; c < 3; ++c) {
+        int n = (amp > 0) ? (int)(random() % (2 * amp + 1)) - amp : 0;
+        int v = (int)(src[c] * light) + n;
+        dest[c] = (v < 0) ? 0 : (v > 255) ? 255 : v;
+      }
+    }
+  }
+
+  /* Blobs */
+  for(size_t k = 0; k < blobs.size(); ++k) {
+
+    SceneBlob& b = blobs[k];
+    int x0 = (int)(b.x - b.radius);
+    int x1 = (int)(b.x + b.radius);
+    int y0 = (int)(b.y - b.radius);
+    int y1 = (int)(b.y + b.radius);
+    float r2 = b.radius * b.radius;
+
+    for(int j = (y0 < 0 ? 0 : y0); j <= y1 && j < h; ++j) {
+      for(int i = (x0 < 0 ? 0 : x0); i <= x1 && i < w; ++i) {
+
+        float dx = i - b.x;
+        float dy = j - b.y;
+        if(dx * dx + dy * dy > r2) {
+          continue;
+        }
+
+        unsigned char* dest = &pixels[(j * w + i) * 4];
+        for(int c = 0; c < 3; ++c) {
+          int v = (int)(b.color[c] * light);
+          dest[c] = (v > 255) ? 255 : v;
+        }
+      }
+    }
+  }
+}
+
+uint32_t SceneGenerator::random() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+float SceneGenerator::randomFloat(float min, float max) {
+  return min + (max - min) * ((random() & 0xFFFFFF) / 16777216.0f);
+}
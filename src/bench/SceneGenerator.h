@@ -0,0 +1,53 @@
+/*
+
+  SceneGenerator
+  --------------
+
+  Deterministic generator of a synthetic scene for benchmarking the tracker
+  without a camera. We render `num` discs that move with a constant velocity
+  and bounce off the borders on top of a static textured background. Each frame
+  we add per pixel noise and a slow global lighting drift so the background
+  model has something to deal with. The same seed always gives the same frames,
+  and the blob positions are the ground truth to measure the tracking accuracy.
+
+ */
+#ifndef TRACKER_SCENE_GENERATOR_H
+#define TRACKER_SCENE_GENERATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+struct SceneBlob {
+  int id;                                                          /* Ground truth id */
+  float x;                                                         /* Center x in pixels */
+  float y;                                                         /* Center y in pixels */
+  float vx;                                                        /* Velocity in pixels per frame */
+  float vy;                                                        /* Velocity in pixels per frame */
+  float radius;                                                    /* Radius in pixels */
+  unsigned char color[3];                                          /* RGB color */
+};
+
+class SceneGenerator {
+ public:
+  SceneGenerator(int w, int h, int num, uint32_t seed = 1);
+  void update();                                                   /* Moves the blobs and renders the next frame into `pixels` */
+
+ private:
+  void createBackground();                                         /* Creates the static background pattern */
+  uint32_t random();                                               /* xorshift32 */
+  float randomFloat(float min, float max);                         /* Random float in [min, max) */
+
+ public:
+  int w;                                                           /* Width of the frames */
+  int h;                                                           /* Height of the frames */
+  float noise;                                                     /* Amplitude of the per pixel noise (0-255), default 6 */
+  float drift;                                                     /* Amplitude of the lighting drift (0-1), default 0.1 */
+  int drift_period;                                                /* Number of frames of one lighting drift cycle, default 600 */
+  uint64_t frame;                                                  /* Number of frames generated; the first frame is 1 */
+  uint32_t rng;                                                    /* Random state */
+  std::vector<SceneBlob> blobs;                                    /* The blobs with their positions in the last frame */
+  std::vector<unsigned char> background;                           /* The static RGB background */
+  std::vector<unsigned char> pixels;                               /* The last frame, RGBA, w * h * 4 bytes, first row is the top of the scene */
+};
+
+#endif
@@ -0,0 +1,618 @@
+/*
+
+  BENCHMARK: BLOB TRACKER
+  -----------------------
+
+  CPU only benchmark of BlobTracker::track(); no GL context is needed. We
+  generate binary masks with a number of moving discs and feed them into the
+  BlobTracker. For every number of blobs we measure the time spent in each
+  step of track() (see Timings.h) and count the heap allocations per frame.
+
+  Options:
+
+     -w, -h      size of the masks (default 1280 x 960)
+     -b          comma separated list with the number of blobs (default 1,10,100,1000,10000)
+     -r          average blob radius; 0 means: derived from the number of blobs (default 0)
+     -g          fragmentation: number of pieces each blob is cut into (default 1)
+     -m          max speed in pixels per frame (default 2)
+     -f          number of measured frames per configuration (default 200; the
+                 timings are computed over the last TIMINGS_WINDOW frames)
+     -u          number of warmup frames per configuration (default 20)
+     -s          random seed (default 1)
+     -x          when 1, set a TrackIndex on the tracker (the inserts are part of
+                 the matching time) and measure a range and a nearest query
+                 after every frame; the queries are not part of the other numbers
+     -z          number of lines and zones to set on a ZoneCounter (default 0: none);
+                 half of them are short lines, half squares, spread over a grid.
+                 The counting is part of the matching time
+     -a          when 1, exit with an error when a steady frame allocates outside
+                 findContours(), see BlobTracker::alloc_counter. A frame is steady
+                 when none of the containers of the tracker (and of the TrackIndex
+                 and ZoneCounter) grew, e.g. a new track that couldn't reuse the
+                 trail of a removed one. We print the number of frames we excluded
+
+  We write one JSON object per configuration to stdout, so results of
+  different matching or labelling strategies are easy to compare:
+
+     ./bench_blobtracker -b 10,1000 > before.json
+
+  Allocations are counted with a hook on malloc(), calloc(), realloc(), 
+  posix_memalign(), memalign() and aligned_alloc() when we're built against
+  glibc (this includes the allocations that OpenCV makes with fastMalloc()); 
+  valloc() and pvalloc() are not counted. On other platforms we hook the 
+  global operator new/delete only.
+
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <tracker/BlobTracker.h>
+#include <tracker/Timings.h>
+
+/* ---------------------------------------------------*/
+/* Allocation hook                                     */
+/* ---------------------------------------------------*/
+
+static uint64_t bench_num_allocs = 0;
+static uint64_t bench_num_bytes = 0;
+
+#if defined(__GLIBC__)
+
+extern "C" {
+  extern void* __libc_malloc(size_t n);
+  extern void* __libc_calloc(size_t n, size_t size);
+  extern void* __libc_realloc(void* ptr, size_t n);
+  extern void* __libc_memalign(size_t align, size_t n);
+
+  void* malloc(size_t n) {
+    bench_num_allocs++;
+    bench_num_bytes += n;
+    return __libc_malloc(n);
+  }
+
+  void* calloc(size_t n, size_t size) {
+    bench_num_allocs++;
+    bench_num_bytes += n * size;
+    return __libc_calloc(n, size);
+  }
+
+  void* realloc(void* ptr, size_t n) {
+    bench_num_allocs++;
+    bench_num_bytes += n;
+    return __libc_realloc(ptr, n);
+  }
+
+  void* memalign(size_t align, size_t n) {
+    bench_num_allocs++;
+    bench_num_bytes += n;
+    return __libc_memalign(align, n);
+  }
+
+  void* aligned_alloc(size_t align, size_t n) {
+    return memalign(align, n);
+  }
+
+  int posix_memalign(void** ptr, size_t align, size_t n) {
+
+    if(0 == align || 0 != (align & (align - 1)) || 0 != (align % sizeof(void*))) {
+      return EINVAL;
+    }
+
+    void* mem = memalign(align, n);
+    if(!mem) {
+      return ENOMEM;
+    }
+
+    *ptr = mem;
+    return 0;
+  }
+}
+
+#else
+
+#include <new>
+
+void* operator new(size_t n) {
+  bench_num_allocs++;
+  bench_num_bytes += n;
+  void* ptr = malloc(n ? n : 1);
+  if(!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t n) {
+  return operator new(n);
+}
+
+void operator delete(void* ptr) throw() {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) throw() {
+  free(ptr);
+}
+
+#endif
+
+/* ---------------------------------------------------*/
+/* Mask generator                                      */
+/* ---------------------------------------------------*/
+
+struct MaskBlob {
+  float x;
+  float y;
+  float vx;
+  float vy;
+  float radius;
+};
+
+struct BenchSettings {
+  int w;
+  int h;
+  std::vector<int> blob_counts;
+  float radius;
+  int fragments;
+  float speed;
+  int num_frames;
+  int num_warmup;
+  uint32_t seed;
+  int use_index;
+  int num_zones;
+  int check_allocs;
+};
+
+class MaskGenerator {
+ public:
+  MaskGenerator(BenchSettings& cfg, int num);
+  void update(unsigned char* pixels, int stride);                  /* moves the blobs and draws the next mask */
+
+ private:
+  float randomFloat(float min, float max);
+
+ public:
+  int w;
+  int h;
+  int fragments;
+  uint32_t rng;
+  std::vector<MaskBlob> blobs;
+};
+
+struct BenchCapacities {                                           /* the capacities of the containers that track() may grow */
+  size_t new_blobs;
+  size_t blobs;
+  size_t similarities;
+  size_t index_samples;
+  size_t max_trail;
+  size_t num_trails;
+  size_t spare_trails;
+  uint64_t arena_allocs;
+  size_t zone_events;
+  size_t zone_candidates;
+  size_t index_cells;
+};
+
+static bool bench_parse_args(int argc, char** argv, BenchSettings& cfg);
+static bool bench_run(BenchSettings& cfg, int num);
+static void bench_print_stats(Timings& timings, int stage, const char* name);
+static void bench_add_zones(ZoneCounter& zones, int num);
+static uint64_t bench_get_num_allocs();
+static void bench_get_capacities(BlobTracker& tracker, ZoneCounter& zones, TrackIndex& index, BenchCapacities& caps);
+static bool bench_capacities_grew(const BenchCapacities& before, const BenchCapacities& after);
+
+/* ---------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  BenchSettings cfg;
+  if(!bench_parse_args(argc, argv, cfg)) {
+    exit(EXIT_FAILURE);
+  }
+
+  bool is_ok = true;
+  for(size_t i = 0; i < cfg.blob_counts.size(); ++i) {
+    is_ok = bench_run(cfg, cfg.blob_counts[i]) && is_ok;
+  }
+
+  return (is_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ---------------------------------------------------*/
+
+static bool bench_run(BenchSettings& cfg, int num) {
+
+  MaskGenerator gen(cfg, num);
+  BlobTracker tracker(cfg.w, cfg.h);
+  Timings timings;
+  uint64_t num_allocs = 0;
+  uint64_t num_bytes = 0;
+  uint64_t max_allocs = 0;
+  uint64_t num_contours = 0;
+  uint64_t num_new_blobs = 0;
+  uint64_t num_tracked = 0;
+
+  tracker.timings = &timings;
+  tracker.alloc_counter = bench_get_num_allocs;
+
+  uint64_t num_tracking_allocs = 0;
+  uint64_t max_steady_allocs = 0;
+  int num_steady = 0;
+  int num_grown = 0;
+  BenchCapacities caps_before;
+  BenchCapacities caps_after;
+
+  TrackIndex index(cfg.w, cfg.h);
+  std::vector<TrackSample> query_samples;
+  std::vector<int32_t> query_ids;
+  uint64_t range_ns = 0;
+  uint64_t nearest_ns = 0;
+  uint64_t num_range_results = 0;
+
+  if(cfg.use_index) {
+    tracker.index = &index;
+  }
+
+  ZoneCounter zones(cfg.w, cfg.h);
+  uint64_t num_zone_events = 0;
+
+  if(cfg.num_zones > 0) {
+    bench_add_zones(zones, cfg.num_zones);
+    tracker.zones = &zones;
+  }
+
+  int num_total = cfg.num_warmup + cfg.num_frames;
+  for(int i = 0; i < num_total; ++i) {
+
+    if(i == cfg.num_warmup) {
+      timings.reset();
+      timings.enable();
+      zones.num_tests = 0;
+    }
+
+    gen.update(tracker.getInputImagePtr(), tracker.getInputImageRowLength());
+    tracker.frame.id = i + 1;
+    tracker.frame.capture_ns = tracker_now_ns();
+
+    uint64_t allocs = bench_num_allocs;
+    uint64_t bytes = bench_num_bytes;
+    bench_get_capacities(tracker, zones, index, caps_before);
+
+    timings.beginCpu(TRACKER_STAGE_APPLY);
+    tracker.track();
+    timings.endCpu(TRACKER_STAGE_APPLY);
+
+    /* The containers grow now and then; all other frames must be allocation free. */
+    bench_get_capacities(tracker, zones, index, caps_after);
+    bool is_steady = !bench_capacities_grew(caps_before, caps_after);
+
+    if(i < cfg.num_warmup) {
+      continue;
+    }
+
+    allocs = bench_num_allocs - allocs;
+    num_allocs += allocs;
+    num_bytes += bench_num_bytes - bytes;
+    max_allocs = (allocs > max_allocs) ? allocs : max_allocs;
+    num_contours += tracker.contours.size();
+    num_new_blobs += tracker.new_blobs.size();
+    num_tracked += tracker.blobs.size();
+    num_zone_events += zones.events.size();
+    num_tracking_allocs += tracker.num_allocs_tracking;
+
+    if(is_steady) {
+      max_steady_allocs = (tracker.num_allocs_tracking > max_steady_allocs) ? tracker.num_allocs_tracking : max_steady_allocs;
+      num_steady++;
+    }
+    else {
+      num_grown++;
+    }
+
+    if(cfg.use_index) {
+
+      /* Which tracks passed through the center of the mask in the last 5 seconds, and which are nearest to it now. */
+      uint64_t now = tracker.frame.capture_ns;
+      uint64_t t_query = tracker_now_ns();
+      num_range_results += index.queryTrackIds(cfg.w * 0.25f, cfg.h * 0.25f, cfg.w * 0.75f, cfg.h * 0.75f, now - 5000000000ull, now, query_ids);
+
+      uint64_t t_nearest = tracker_now_ns();
+      index.queryNearest(cfg.w * 0.5f, cfg.h * 0.5f, 5, now, now, query_samples);
+
+      nearest_ns += tracker_now_ns() - t_nearest;
+      range_ns += t_nearest - t_query;
+    }
+  }
+
+  printf("{\"blobs\": %d, \"w\": %d, \"h\": %d, \"fragments\": %d, \"speed\": %.2f, \"frames\": %d",
+         num, cfg.w, cfg.h, cfg.fragments, cfg.speed, cfg.num_frames);
+
+  printf(", \"contours\": %.1f, \"new_blobs\": %.1f, \"tracked\": %.1f",
+         num_contours / (double)cfg.num_frames,
+         num_new_blobs / (double)cfg.num_frames,
+         num_tracked / (double)cfg.num_frames);
+
+  bench_print_stats(timings, TRACKER_STAGE_CONTOURS, "contours");
+  bench_print_stats(timings, TRACKER_STAGE_BLOBS, "blobs");
+  bench_print_stats(timings, TRACKER_STAGE_MATCHING, "matching");
+  bench_print_stats(timings, TRACKER_STAGE_APPLY, "track");
+
+  printf(", \"allocs_per_frame\": %.1f, \"max_allocs_per_frame\": %llu, \"bytes_per_frame\": %.1f",
+         num_allocs / (double)cfg.num_frames,
+         (unsigned long long)max_allocs,
+         num_bytes / (double)cfg.num_frames);
+
+  if(cfg.use_index) {
+    printf(", \"range_query_avg_ms\": %.4f, \"range_query_tracks\": %.1f, \"nearest_query_avg_ms\": %.4f, \"index_dropped\": %llu",
+           (range_ns / 1e6) / cfg.num_frames,
+           num_range_results / (double)cfg.num_frames,
+           (nearest_ns / 1e6) / cfg.num_frames,
+           (unsigned long long)index.num_dropped.load());
+  }
+
+  if(cfg.num_zones > 0) {
+    printf(", \"zones\": %d, \"zone_events\": %.2f, \"zone_tests\": %.1f",
+           (int)zones.shapes.size(),
+           num_zone_events / (double)cfg.num_frames,
+           zones.num_tests / (double)cfg.num_frames);
+  }
+
+  printf(", \"tracking_allocs_per_frame\": %.2f, \"steady_frames\": %d, \"excluded_frames\": %d, \"max_steady_allocs\": %llu",
+         num_tracking_allocs / (double)cfg.num_frames,
+         num_steady,
+         num_grown,
+         (unsigned long long)max_steady_allocs);
+
+  printf("}\n");
+  fflush(stdout);
+
+  if(cfg.check_allocs && max_steady_allocs > 0) {
+    fprintf(stderr, "Error: a steady frame with %d blobs allocated %llu times outside findContours().\n", num, (unsigned long long)max_steady_allocs);
+    return false;
+  }
+
+  return true;
+}
+
+static uint64_t bench_get_num_allocs() {
+  return bench_num_allocs;
+}
+
+/* Stores the capacities of the containers that track() may grow, so we can see whether a frame allocated because one grew. */
+static void bench_get_capacities(BlobTracker& tracker, ZoneCounter& zones, TrackIndex& index, BenchCapacities& caps) {
+
+  caps.new_blobs = tracker.new_blobs.capacity();
+  caps.blobs = tracker.blobs.capacity();
+  caps.similarities = tracker.similarities.capacity();
+  caps.index_samples = tracker.index_samples.capacity();
+  caps.arena_allocs = tracker.arena.num_heap_allocs;
+  caps.zone_events = zones.events.capacity();
+  caps.zone_candidates = zones.candidates.capacity();
+
+  caps.spare_trails = tracker.spare_trails.capacity();
+  caps.num_trails = tracker.spare_trails.size();
+  caps.max_trail = 0;
+  for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+    caps.max_trail = std::max(caps.max_trail, tracker.blobs[i].trail.capacity());
+    caps.num_trails += (tracker.blobs[i].trail.capacity()) ? 1 : 0;
+  }
+
+  /* The buckets of the TrackIndex grow their cells until all of them were used once. */
+  caps.index_cells = 0;
+  if(NULL == tracker.index) {
+    return;
+  }
+
+  for(uint32_t i = 0; i < index.num_buckets; ++i) {
+    TrackIndexBucket& bucket = index.buckets[i];
+    for(size_t j = 0; j < bucket.cells.size(); ++j) {
+      caps.index_cells += bucket.cells[j].capacity();
+    }
+    caps.index_cells += bucket.used_cells.capacity();
+  }
+}
+
+static bool bench_capacities_grew(const BenchCapacities& before, const BenchCapacities& after) {
+  return after.new_blobs > before.new_blobs
+         || after.blobs > before.blobs
+         || after.similarities > before.similarities
+         || after.index_samples > before.index_samples
+         || after.max_trail > before.max_trail
+         || after.num_trails > before.num_trails
+         || after.spare_trails > before.spare_trails
+         || after.arena_allocs != before.arena_allocs
+         || after.zone_events > before.zone_events
+         || after.zone_candidates > before.zone_candidates
+         || after.index_cells > before.index_cells;
+}
+
+/* Lays out `num` shapes on a grid; even cells get a horizontal line through their center, odd cells a square. */
+static void bench_add_zones(ZoneCounter& zones, int num) {
+
+  int cols = (int)ceilf(sqrtf((float)num));
+  int rows = (num + cols - 1) / cols;
+  float cw = (float)zones.w / cols;
+  float ch = (float)zones.h / rows;
+
+  for(int i = 0; i < num; ++i) {
+
+    float x = (i % cols) * cw;
+    float y = (i / cols) * ch;
+
+    if(0 == (i & 1)) {
+      zones.addLine(x + cw * 0.25f, y + ch * 0.5f, x + cw * 0.75f, y + ch * 0.5f);
+    }
+    else {
+      float square[] = { x + cw * 0.25f, y + ch * 0.25f,
+                         x + cw * 0.75f, y + ch * 0.25f,
+                         x + cw * 0.75f, y + ch * 0.75f,
+                         x + cw * 0.25f, y + ch * 0.75f };
+      zones.addZone(square, 4);
+    }
+  }
+}
+
+static void bench_print_stats(Timings& timings, int stage, const char* name) {
+
+  TimingStats stats;
+  if(!timings.getStats(stage, stats)) {
+    return;
+  }
+
+  printf(", \"%s_min_ms\": %.4f, \"%s_avg_ms\": %.4f, \"%s_p99_ms\": %.4f",
+         name, stats.min_ms, name, stats.avg_ms, name, stats.p99_ms);
+}
+
+/* ---------------------------------------------------*/
+
+MaskGenerator::MaskGenerator(BenchSettings& cfg, int num)
+  :w(cfg.w)
+  ,h(cfg.h)
+  ,fragments(cfg.fragments)
+  ,rng(cfg.seed ? cfg.seed : 1)
+{
+  /* When no radius is given, make the blobs cover about 1/4th of the mask. */
+  float radius = cfg.radius;
+  if(radius <= 0.0f) {
+    radius = sqrtf((w * h * 0.25f) / (num * 3.14159265f));
+    radius = (radius < 2.0f) ? 2.0f : (radius > 60.0f) ? 60.0f : radius;
+  }
+
+  for(int i = 0; i < num; ++i) {
+    MaskBlob b;
+    b.radius = randomFloat(radius * 0.5f, radius * 1.5f);
+    b.x = randomFloat(0.0f, w);
+    b.y = randomFloat(0.0f, h);
+    b.vx = randomFloat(-cfg.speed, cfg.speed);
+    b.vy = randomFloat(-cfg.speed, cfg.speed);
+    blobs.push_back(b);
+  }
+}
+
+void MaskGenerator::update(unsigned char* pixels, int stride) {
+
+  for(int j = 0; j < h; ++j) {
+    memset(pixels + j * stride, 0, w);
+  }
+
+  for(size_t k = 0; k < blobs.size(); ++k) {
+
+    MaskBlob& b = blobs[k];
+    b.x += b.vx;
+    b.y += b.vy;
+
+    if(b.x < 0 || b.x >= w) {
+      b.vx = -b.vx;
+      b.x += 2 * b.vx;
+    }
+    if(b.y < 0 || b.y >= h) {
+      b.vy = -b.vy;
+      b.y += 2 * b.vy;
+    }
+
+    int x0 = (int)(b.x - b.radius);
+    int x1 = (int)(b.x + b.radius);
+    int y0 = (int)(b.y - b.radius);
+    int y1 = (int)(b.y + b.radius);
+    float r2 = b.radius * b.radius;
+    int piece = (int)(2 * b.radius) / fragments + 1;
+
+    for(int j = (y0 < 0 ? 0 : y0); j <= y1 && j < h; ++j) {
+      for(int i = (x0 < 0 ? 0 : x0); i <= x1 && i < w; ++i) {
+
+        /* Cut the blob in vertical pieces with a one pixel gap. */
+        if(fragments > 1 && ((i - x0) % piece) == piece - 1) {
+          continue;
+        }
+
+        float dx = i - b.x;
+        float dy = j - b.y;
+        if(dx * dx + dy * dy <= r2) {
+          pixels[j * stride + i] = 255;
+        }
+      }
+    }
+  }
+}
+
+float MaskGenerator::randomFloat(float min, float max) {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return min + (max - min) * ((rng & 0xFFFFFF) / 16777216.0f);
+}
+
+/* ---------------------------------------------------*/
+
+static bool bench_parse_args(int argc, char** argv, BenchSettings& cfg) {
+
+  std::string counts = "1,10,100,1000,10000";
+
+  cfg.w = 1280;
+  cfg.h = 960;
+  cfg.radius = 0.0f;
+  cfg.fragments = 1;
+  cfg.speed = 2.0f;
+  cfg.num_frames = 200;
+  cfg.num_warmup = 20;
+  cfg.seed = 1;
+  cfg.use_index = 0;
+  cfg.num_zones = 0;
+  cfg.check_allocs = 0;
+
+  for(int i = 1; i < argc; ++i) {
+
+    if(i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+      fprintf(stderr, "Error: invalid argument: %s, see the top of bench_blobtracker.cpp for the usage.\n", argv[i]);
+      return false;
+    }
+
+    const char* val = argv[++i];
+
+    switch(argv[i - 1][1]) {
+      case 'w': { cfg.w = atoi(val);                   break; }
+      case 'h': { cfg.h = atoi(val);                   break; }
+      case 'b': { counts = val;                        break; }
+      case 'r': { cfg.radius = atof(val);              break; }
+      case 'g': { cfg.fragments = atoi(val);           break; }
+      case 'm': { cfg.speed = atof(val);               break; }
+      case 'f': { cfg.num_frames = atoi(val);          break; }
+      case 'u': { cfg.num_warmup = atoi(val);          break; }
+      case 's': { cfg.seed = (uint32_t)atoi(val);      break; }
+      case 'x': { cfg.use_index = atoi(val);           break; }
+      case 'z': { cfg.num_zones = atoi(val);           break; }
+      case 'a': { cfg.check_allocs = atoi(val);        break; }
+      default: {
+        fprintf(stderr, "Error: unknown option: %s\n", argv[i - 1]);
+        return false;
+      }
+    }
+  }
+
+  size_t start = 0;
+  while(start < counts.size()) {
+    size_t end = counts.find(',', start);
+    if(end == std::string::npos) {
+      end = counts.size();
+    }
+    int num = atoi(counts.substr(start, end - start).c_str());
+    if(num <= 0) {
+      fprintf(stderr, "Error: invalid number of blobs in: %s\n", counts.c_str());
+      return false;
+    }
+    cfg.blob_counts.push_back(num);
+    start = end + 1;
+  }
+
+  if(cfg.w <= 0 || cfg.h <= 0 || cfg.num_frames <= 0 || cfg.num_warmup < 0 || cfg.fragments < 1) {
+    fprintf(stderr, "Error: invalid size, number of frames or fragments.\n");
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,273 @@
+/*
+
+  BENCHMARK: CPU TRACKER
+  ----------------------
+
+  Runs the CpuTracker (see CpuTracker.h) on frames of the SceneGenerator; no
+  GL context is needed so this also builds with OPT_BUILD_TRACKER_GL=OFF. We
+  report the same throughput, per stage timings, latency and accuracy numbers
+  as bench_pipeline, so you can compare both backends on the same scene:
+
+     ./bench_pipeline -c 2 -w 640 -h 480
+     ./bench_cpu -w 640 -h 480 -t 4
+
+  Usage:
+
+     ./bench_cpu [-w width] [-h height] [-b num_blobs] [-f num_frames]
+                 [-u warmup_frames] [-n noise] [-d drift] [-s seed]
+                 [-t num_threads] [-c channels] [-r tile_rows] [-o overlap]
+                 [-p shm_name] [-e delta] [-l log_prefix]
+
+  -t is the number of threads of the CpuTracker (default 0: one per core) and
+  -c the number of channels of the frames we pass in: 1 (gray), 3 (RGB) or 
+  4 (RGBA, the default). -r sets the number of rows of the tiles (default 32)
+  and -o 0 disables the overlap of the tracking of frame k and the image 
+  stages of frame k + 1 (see CpuTracker.h). The stage timings are the sum of
+  the time of all tile tasks, the apply row is the wall clock time.
+
+  -p publishes the tracks of every frame with a TrackPublisher into the 
+  shared memory `shm_name` (e.g. /tracker) so you can test a consumer with
+  `track_reader -i /tracker`; -e 1 uses the delta mode. We then also report
+  the time and the number of bytes the publisher needs per frame.
+
+  -l appends the tracks of every frame to a TrajectoryLog with the given 
+  prefix (e.g. logs/traj); read them back with `scan_trajectories`.
+
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+
+#include <tracker/CpuTracker.h>
+#include <tracker/TrackPublisher.h>
+#include <tracker/TrajectoryLog.h>
+#include <bench/SceneGenerator.h>
+#include <bench/BenchAccuracy.h>
+
+struct BenchSettings {
+  int w;
+  int h;
+  int num_blobs;
+  int num_frames;
+  int num_warmup;
+  int num_threads;
+  int num_channels;
+  int tile_rows;
+  int overlap;
+  int delta;
+  std::string shm_name;
+  std::string log_prefix;
+  float noise;
+  float drift;
+  uint32_t seed;
+};
+
+static bool bench_parse_args(int argc, char** argv, BenchSettings& cfg);
+static void bench_convert(SceneGenerator& scene, int channels, std::vector<unsigned char>& out);
+
+/* ---------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  BenchSettings cfg;
+  if(!bench_parse_args(argc, argv, cfg)) {
+    exit(EXIT_FAILURE);
+  }
+
+  SceneGenerator scene(cfg.w, cfg.h, cfg.num_blobs, cfg.seed);
+  scene.noise = cfg.noise;
+  scene.drift = cfg.drift;
+
+  uint64_t t_setup = tracker_now_ns();
+  CpuTracker tracker(cfg.w, cfg.h, cfg.num_threads);
+  tracker.tile_rows = cfg.tile_rows;
+  tracker.overlap_frames = (0 != cfg.overlap);
+  printf("setup: %.3f ms\n", (tracker_now_ns() - t_setup) / 1e6);
+  printf("size: %dx%d, blobs: %d, frames: %d, warmup: %d, threads: %d, channels: %d, tile rows: %d, overlap: %d\n", 
+         cfg.w, cfg.h, cfg.num_blobs, cfg.num_frames, cfg.num_warmup, 
+         tracker.pool.num_threads, cfg.num_channels, cfg.tile_rows, cfg.overlap);
+
+  TrackPublisher publisher;
+  if(!cfg.shm_name.empty() && !publisher.open(cfg.shm_name, cfg.delta ? TRACK_PUBLISH_DELTA : TRACK_PUBLISH_FULL)) {
+    exit(EXIT_FAILURE);
+  }
+
+  TrajectoryLog log;
+  if(!cfg.log_prefix.empty() && !log.open(cfg.log_prefix)) {
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<unsigned char> pixels;
+  uint64_t log_ns = 0;
+  uint64_t publish_ns = 0;
+  uint64_t publish_bytes = 0;
+  BenchTruth truths[BENCH_NUM_TRUTHS];
+  BenchAccuracy acc;
+  uint64_t t_start = 0;
+
+  for(int i = 0; i < cfg.num_warmup + cfg.num_frames; ++i) {
+
+    if(i == cfg.num_warmup) {
+      tracker.timings.reset();
+      tracker.timings.enable();
+      tracker.latency_mask.reset();
+      tracker.latency_tracks.reset();
+      t_start = tracker_now_ns();
+      publish_ns = 0;
+      log_ns = 0;
+      publish_bytes = publisher.num_bytes;
+    }
+
+    scene.update();
+
+    BenchTruth& truth = truths[scene.frame % BENCH_NUM_TRUTHS];
+    truth.frame = scene.frame;
+    truth.blobs = scene.blobs;
+
+    if(4 == cfg.num_channels) {
+      tracker.addFrame(&scene.pixels[0], cfg.w * 4, 4);
+    }
+    else {
+      bench_convert(scene, cfg.num_channels, pixels);
+      tracker.addFrame(&pixels[0], cfg.w * cfg.num_channels, cfg.num_channels);
+    }
+
+    tracker.apply();
+
+    if(publisher.isOpen()) {
+      uint64_t t_publish = tracker_now_ns();
+      publisher.publish(tracker.blobs);
+      publish_ns += tracker_now_ns() - t_publish;
+    }
+
+    if(log.isOpen()) {
+      uint64_t t_log = tracker_now_ns();
+      log.append(tracker.blobs);
+      log_ns += tracker_now_ns() - t_log;
+    }
+
+    FrameInfo& frame = tracker.blobs.frame;
+    if(i >= cfg.num_warmup && frame.id > (uint64_t)cfg.num_warmup) {
+      bench_evaluate(tracker.blobs, truths[frame.id % BENCH_NUM_TRUTHS], acc);
+    }
+  }
+
+  double seconds = (tracker_now_ns() - t_start) / 1e9;
+
+  printf("\n");
+  printf("frames: %d\n", cfg.num_frames);
+  printf("fps: %.2f\n", cfg.num_frames / seconds);
+  printf("ms_per_frame: %.3f\n", (seconds * 1e3) / cfg.num_frames);
+  printf("tasks_per_frame: %zu\n", tracker.graph.size());
+  printf("stolen_tasks: %llu\n", (unsigned long long)tracker.pool.num_steals.load());
+  if(publisher.isOpen()) {
+    printf("publish_us_per_frame: %.3f\n", (publish_ns / 1e3) / cfg.num_frames);
+    printf("publish_bytes_per_frame: %.1f\n", double(publisher.num_bytes - publish_bytes) / cfg.num_frames);
+  }
+  if(log.isOpen()) {
+    printf("log_us_per_frame: %.3f\n", (log_ns / 1e3) / cfg.num_frames);
+    printf("log_samples: %llu\n", (unsigned long long)log.num_samples);
+    printf("log_segments: %llu\n", (unsigned long long)log.num_segments);
+    log.close();
+  }
+  printf("\n");
+  tracker.timings.print();
+  printf("\n");
+  tracker.latency_mask.print("capture > mask");
+  tracker.latency_tracks.print("capture > tracks");
+  printf("\n");
+  acc.print();
+
+  return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------*/
+
+/* The conversion is not part of the measured time of the tracker, but it is part of the fps. */
+static void bench_convert(SceneGenerator& scene, int channels, std::vector<unsigned char>& out) {
+
+  size_t num = (size_t)scene.w * scene.h;
+  out.resize(num * channels);
+
+  const unsigned char* src = &scene.pixels[0];
+  unsigned char* dst = &out[0];
+
+  for(size_t i = 0; i < num; ++i, src += 4, dst += channels) {
+    if(1 == channels) {
+      dst[0] = (unsigned char)((77 * src[0] + 150 * src[1] + 29 * src[2]) >> 8);
+    }
+    else {
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+    }
+  }
+}
+
+static bool bench_parse_args(int argc, char** argv, BenchSettings& cfg) {
+
+  cfg.w = 320;
+  cfg.h = 240;
+  cfg.num_blobs = 8;
+  cfg.num_frames = 1000;
+  cfg.num_warmup = 60;
+  cfg.num_threads = 0;
+  cfg.num_channels = 4;
+  cfg.tile_rows = 32;
+  cfg.overlap = 1;
+  cfg.delta = 0;
+  cfg.noise = 6.0f;
+  cfg.drift = 0.1f;
+  cfg.seed = 1;
+
+  for(int i = 1; i < argc; ++i) {
+
+    if(i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+      printf("Error: invalid argument: %s, see the top of bench_cpu.cpp for the usage.\n", argv[i]);
+      return false;
+    }
+
+    const char* val = argv[++i];
+
+    switch(argv[i - 1][1]) {
+      case 'w': { cfg.w = atoi(val);                   break; }
+      case 'h': { cfg.h = atoi(val);                   break; }
+      case 'b': { cfg.num_blobs = atoi(val);           break; }
+      case 'f': { cfg.num_frames = atoi(val);          break; }
+      case 'u': { cfg.num_warmup = atoi(val);          break; }
+      case 't': { cfg.num_threads = atoi(val);         break; }
+      case 'c': { cfg.num_channels = atoi(val);        break; }
+      case 'r': { cfg.tile_rows = atoi(val);           break; }
+      case 'o': { cfg.overlap = atoi(val);             break; }
+      case 'e': { cfg.delta = atoi(val);               break; }
+      case 'p': { cfg.shm_name = val;                  break; }
+      case 'l': { cfg.log_prefix = val;                break; }
+      case 'n': { cfg.noise = atof(val);               break; }
+      case 'd': { cfg.drift = atof(val);               break; }
+      case 's': { cfg.seed = (uint32_t)atoi(val);      break; }
+      default: {
+        printf("Error: unknown option: %s\n", argv[i - 1]);
+        return false;
+      }
+    }
+  }
+
+  if(cfg.w <= 0 || cfg.h <= 0 || cfg.num_frames <= 0 || cfg.num_warmup < 0) {
+    printf("Error: invalid size or number of frames.\n");
+    return false;
+  }
+
+  if(cfg.tile_rows <= 0) {
+    printf("Error: the number of tile rows must be > 0.\n");
+    return false;
+  }
+
+  if(cfg.num_channels != 1 && cfg.num_channels != 3 && cfg.num_channels != 4) {
+    printf("Error: the number of channels must be 1, 3 or 4.\n");
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,545 @@
+/*
+
+  BENCHMARK: TRACKER PIPELINE
+  ---------------------------
+
+  Runs the complete Tracker on an offscreen GL context (EGL, no window and no
+  vsync) and feeds it with frames from the SceneGenerator. Mesa's llvmpipe works
+  fine, e.g. when there is no GPU: `LIBGL_ALWAYS_SOFTWARE=1 ./bench_pipeline`.
+
+  We report the throughput in frames per second, the per stage timings
+  (see Timings.h), the latency histograms (see Latency.h) and the tracking
+  accuracy against the ground truth of the generator:
+
+     - recall:      percentage of ground truth blobs with a tracked blob nearby
+     - precision:   percentage of tracked blobs with a ground truth blob nearby
+     - error:       average distance between a tracked blob and its ground truth
+     - switches:    number of times a ground truth blob got another track id
+
+  Usage:
+
+     ./bench_pipeline [-w width] [-h height] [-b num_blobs] [-f num_frames]
+                      [-u warmup_frames] [-n noise] [-d drift] [-s seed]
+                      [-l history_size] [-c bg_format]
+                      [-i input] [-r raw_format] [-o masks_file]
+                      [-a capture_fps]
+
+  With -i we replay a recording instead of the generated scene, as fast as
+  the pipeline accepts the frames (see FrameSource.h). The input can be a .y4m
+  file, an image sequence like "frames/%06d.png" or a raw file; for raw files
+  pass the size with -w/-h and the format with -r (rgb24, rgba, gray, i420).
+  We process all frames unless you pass -f; there is no ground truth so we
+  don't report the accuracy.
+
+  With -a we emulate a camera that delivers frames at the given rate on its
+  own thread; the frames go through a CaptureIngest (see CaptureIngest.h) and
+  we report how many frames were dropped. There is no accuracy report in this
+  mode because frames are skipped.
+
+  With -o we record all masks the BlobTracker sees (see MaskRecorder.h) so you
+  can replay them with replay_masks.
+
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define ROXLU_USE_JPG
+#define ROXLU_USE_MATH
+#define ROXLU_USE_PNG
+#define ROXLU_USE_OPENGL
+#define ROXLU_USE_FONT
+#define ROXLU_IMPLEMENTATION
+#include <tinylib.h>
+
+#include <tracker/Tracker.h>
+#include <tracker/FrameSource.h>
+#include <tracker/FrameUploader.h>
+#include <tracker/CaptureIngest.h>
+#include <bench/SceneGenerator.h>
+#include <bench/BenchAccuracy.h>
+
+static const char* BENCH_FS = ""
+  "#version 330\n"
+  "uniform sampler2D u_tex;"
+  "in vec2 v_texcoord;"
+  "layout( location = 0 ) out vec4 fragcolor;"
+  "void main() {"
+  "  fragcolor = texture(u_tex, v_texcoord);"
+  "}"
+  "";
+
+struct BenchSettings {
+  int w;
+  int h;
+  int num_blobs;
+  int num_frames;
+  int num_warmup;
+  int history_size;
+  int bg_format;
+  float noise;
+  float drift;
+  uint32_t seed;
+  std::string input;
+  std::string masks_file;
+  int raw_format;
+  float async_fps;
+};
+
+struct BenchProducer {
+  SceneGenerator* scene;
+  FrameQueue* queue;
+  float fps;
+  std::atomic<bool> must_stop;
+};
+
+static bool bench_parse_args(int argc, char** argv, BenchSettings& cfg);
+static bool bench_create_context();
+static FrameSource* bench_open_source(BenchSettings& cfg);
+static void bench_produce(BenchProducer* producer);
+
+/* ---------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  BenchSettings cfg;
+  if(!bench_parse_args(argc, argv, cfg)) {
+    exit(EXIT_FAILURE);
+  }
+
+  if(!bench_create_context()) {
+    exit(EXIT_FAILURE);
+  }
+
+  FrameSource* source = NULL;
+  FrameUploader uploader;
+  Frame input_frame;
+
+  if(cfg.input.size()) {
+
+    source = bench_open_source(cfg);
+    if(!source) {
+      exit(EXIT_FAILURE);
+    }
+
+    cfg.w = source->width;
+    cfg.h = source->height;
+    cfg.num_blobs = 0;
+
+    /* Image sequences don't know their length; we stop when read() fails. */
+    if(cfg.num_frames <= 0) {
+      cfg.num_frames = (0 == source->num_frames) ? 0x7FFFFFFF : (int)source->num_frames - cfg.num_warmup;
+    }
+
+    if(!uploader.setup(source->width, source->height, source->format)) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  else if(cfg.num_frames <= 0) {
+    cfg.num_frames = 1000;
+  }
+
+  printf("renderer: %s\n", glGetString(GL_RENDERER));
+  printf("size: %dx%d, blobs: %d, frames: %d, warmup: %d\n", cfg.w, cfg.h, cfg.num_blobs, cfg.num_frames, cfg.num_warmup);
+
+  SceneGenerator scene(cfg.w, cfg.h, cfg.num_blobs, cfg.seed);
+  scene.noise = cfg.noise;
+  scene.drift = cfg.drift;
+
+  uint64_t t_setup = tracker_now_ns();
+  Tracker tracker(cfg.w, cfg.h, cfg.history_size, cfg.bg_format);
+  printf("setup: %.3f ms\n", (tracker_now_ns() - t_setup) / 1e6);
+
+  MaskRecorder recorder;
+  if(cfg.masks_file.size()) {
+    if(!recorder.open(cfg.masks_file, tracker.blobs.w, tracker.blobs.h)) {
+      exit(EXIT_FAILURE);
+    }
+    tracker.blobs.recorder = &recorder;
+  }
+
+  bool is_async = cfg.async_fps > 0.0f;
+  CaptureIngest ingest(cfg.w, cfg.h);
+  BenchProducer producer;
+  std::thread producer_thread;
+
+  if(is_async) {
+    if(!ingest.setup(4, FRAME_QUEUE_LATEST)) {
+      exit(EXIT_FAILURE);
+    }
+    producer.scene = &scene;
+    producer.queue = &ingest.queue;
+    producer.fps = cfg.async_fps;
+    producer.must_stop = false;
+    producer_thread = std::thread(bench_produce, &producer);
+  }
+
+  /* The input texture; we draw it flipped (like the BackgroundBuffer does) so the mask has the same orientation as the scene. */
+  GLuint vao = 0;
+  GLuint tex = 0;
+  GLuint prog = tracker_program_cache().createProgram(BG_BUFFER_VS, BENCH_FS);
+  glUseProgram(prog);
+  rx_uniform_1i(prog, "u_tex", 0);
+  glGenVertexArrays(1, &vao);
+  glGenTextures(1, &tex);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cfg.w, cfg.h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  BenchTruth truths[BENCH_NUM_TRUTHS];
+  BenchAccuracy acc;
+  uint64_t t_start = 0;
+  int num_total = (cfg.num_frames > 0x7FFFFFFF - cfg.num_warmup) ? 0x7FFFFFFF : cfg.num_warmup + cfg.num_frames;
+  int num_measured = 0;
+
+  for(int i = 0; i < num_total; ++i) {
+
+    if(i == cfg.num_warmup) {
+      glFinish();
+      tracker.timings.reset();
+      tracker.timings.enable();
+      tracker.latency_mask.reset();
+      tracker.latency_tracks.reset();
+      t_start = tracker_now_ns();
+    }
+
+    if(is_async) {
+      /* Wait for the capture thread. */
+      while(!ingest.update(tracker)) {
+        std::this_thread::yield();
+      }
+    }
+    else {
+
+      if(source) {
+        if(!source->read(input_frame)) {
+          break;
+        }
+        if(!uploader.upload(input_frame)) {
+          exit(EXIT_FAILURE);
+        }
+      }
+      else {
+        scene.update();
+
+        BenchTruth& truth = truths[scene.frame % BENCH_NUM_TRUTHS];
+        truth.frame = scene.frame;
+        truth.blobs = scene.blobs;
+
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cfg.w, cfg.h, GL_RGBA, GL_UNSIGNED_BYTE, &scene.pixels[0]);
+      }
+
+      tracker.beginFrame();
+      {
+        if(source) {
+          uploader.draw();
+        }
+        else {
+          glBindVertexArray(vao);
+          glUseProgram(prog);
+          glActiveTexture(GL_TEXTURE0);
+          glBindTexture(GL_TEXTURE_2D, tex);
+          glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+      }
+      tracker.endFrame();
+    }
+
+    tracker.apply();
+
+    if(i >= cfg.num_warmup) {
+      num_measured++;
+    }
+
+    /* Evaluate against the frame the tracking result belongs to. */
+    FrameInfo& frame = tracker.blobs.frame;
+    if(!source && !is_async && i >= cfg.num_warmup && frame.id > (uint64_t)cfg.num_warmup) {
+      BenchTruth& result_truth = truths[frame.id % BENCH_NUM_TRUTHS];
+      if(result_truth.frame != frame.id) {
+        printf("Error: no ground truth for frame %llu.\n", (unsigned long long)frame.id);
+        exit(EXIT_FAILURE);
+      }
+      bench_evaluate(tracker.blobs, result_truth, acc);
+    }
+  }
+
+  glFinish();
+
+  if(is_async) {
+    producer.must_stop = true;
+    producer_thread.join();
+  }
+
+  if(num_measured <= 0) {
+    printf("Error: no frames left after the warmup.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  double seconds = (tracker_now_ns() - t_start) / 1e9;
+
+  printf("\n");
+  printf("frames: %d\n", num_measured);
+  printf("fps: %.2f\n", num_measured / seconds);
+  printf("ms_per_frame: %.3f\n", (seconds * 1e3) / num_measured);
+  printf("vram: %.2f MB (history: %.2f MB, render targets: %llu, %.2f MB)\n",
+         tracker.getNumBytes() / (1024.0 * 1024.0),
+         tracker.bg_buffer.getNumBytes() / (1024.0 * 1024.0),
+         (unsigned long long)tracker.targets.getNumTargets(),
+         tracker.targets.getNumBytes() / (1024.0 * 1024.0));
+  printf("\n");
+  tracker.timings.print();
+  printf("\n");
+  tracker.latency_mask.print("capture > mask");
+  tracker.latency_tracks.print("capture > tracks");
+
+  if(is_async) {
+    printf("\n");
+    printf("ingest: %llu frames, dropped (queue full): %llu, replaced before read: %llu\n",
+           (unsigned long long)ingest.queue.write_count.load(),
+           (unsigned long long)ingest.queue.num_dropped.load(),
+           (unsigned long long)ingest.queue.num_skipped.load());
+    ingest.shutdown();
+  }
+
+  if(recorder.isOpen()) {
+    uint64_t num_masks = recorder.offsets.size();
+    uint64_t num_bytes = recorder.num_encoded_bytes;
+    tracker.blobs.recorder = NULL;
+    recorder.close();
+    printf("recorded: %llu masks, %.1f bytes per mask\n", (unsigned long long)num_masks, num_masks ? (double)num_bytes / num_masks : 0.0);
+  }
+
+  if(source) {
+    uploader.shutdown();
+    delete source;
+    source = NULL;
+  }
+  else if(!is_async) {
+    printf("\n");
+    acc.print();
+  }
+
+  glDeleteTextures(1, &tex);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(prog);
+
+  return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------*/
+
+static bool bench_parse_args(int argc, char** argv, BenchSettings& cfg) {
+
+  cfg.w = 320;
+  cfg.h = 240;
+  cfg.num_blobs = 8;
+  cfg.num_frames = 0;
+  cfg.num_warmup = 60;
+  cfg.history_size = 10;
+  cfg.bg_format = BG_FORMAT_RGBA8;
+  cfg.noise = 6.0f;
+  cfg.drift = 0.1f;
+  cfg.seed = 1;
+  cfg.raw_format = FRAME_FORMAT_NONE;
+  cfg.async_fps = 0.0f;
+
+  for(int i = 1; i < argc; ++i) {
+
+    if(i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+      printf("Error: invalid argument: %s, see the top of bench_pipeline.cpp for the usage.\n", argv[i]);
+      return false;
+    }
+
+    const char* val = argv[++i];
+
+    switch(argv[i - 1][1]) {
+      case 'w': { cfg.w = atoi(val);                   break; }
+      case 'h': { cfg.h = atoi(val);                   break; }
+      case 'b': { cfg.num_blobs = atoi(val);           break; }
+      case 'f': { cfg.num_frames = atoi(val);          break; }
+      case 'u': { cfg.num_warmup = atoi(val);          break; }
+      case 'l': { cfg.history_size = atoi(val);        break; }
+      case 'c': { cfg.bg_format = atoi(val);           break; }
+      case 'n': { cfg.noise = atof(val);               break; }
+      case 'd': { cfg.drift = atof(val);               break; }
+      case 's': { cfg.seed = (uint32_t)atoi(val);      break; }
+      case 'i': { cfg.input = val;                     break; }
+      case 'o': { cfg.masks_file = val;                break; }
+      case 'a': { cfg.async_fps = atof(val);           break; }
+      case 'r': {
+        std::string fmt = val;
+        cfg.raw_format = (fmt == "rgb24") ? FRAME_FORMAT_RGB24
+                       : (fmt == "rgba")  ? FRAME_FORMAT_RGBA
+                       : (fmt == "gray")  ? FRAME_FORMAT_GRAY
+                       : (fmt == "i420")  ? FRAME_FORMAT_I420
+                       : FRAME_FORMAT_NONE;
+        if(cfg.raw_format == FRAME_FORMAT_NONE) {
+          printf("Error: unknown raw format: %s\n", val);
+          return false;
+        }
+        break;
+      }
+      default: {
+        printf("Error: unknown option: %s\n", argv[i - 1]);
+        return false;
+      }
+    }
+  }
+
+  if(cfg.async_fps > 0.0f && cfg.input.size()) {
+    printf("Error: -a can't be used together with -i.\n");
+    return false;
+  }
+
+  if(cfg.w <= 0 || cfg.h <= 0 || cfg.num_frames < 0 || cfg.num_warmup < 0) {
+    printf("Error: invalid size or number of frames.\n");
+    return false;
+  }
+
+  return true;
+}
+
+/* Emulates a camera thread that delivers frames at a fixed rate. */
+static void bench_produce(BenchProducer* producer) {
+
+  uint64_t period_ns = (uint64_t)(1e9 / producer->fps);
+  uint64_t next_ns = tracker_now_ns();
+
+  while(!producer->must_stop) {
+
+    producer->scene->update();
+
+    unsigned char* dest = producer->queue->beginWrite();
+    if(dest) {
+      memcpy(dest, &producer->scene->pixels[0], producer->queue->frame_size);
+      producer->queue->endWrite(tracker_now_ns());
+    }
+
+    next_ns += period_ns;
+    uint64_t now_ns = tracker_now_ns();
+    if(next_ns > now_ns) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(next_ns - now_ns));
+    }
+  }
+}
+
+static FrameSource* bench_open_source(BenchSettings& cfg) {
+
+  FrameSource* source = NULL;
+  std::string ext;
+
+  size_t dot = cfg.input.rfind('.');
+  if(dot != std::string::npos) {
+    ext = cfg.input.substr(dot + 1);
+  }
+
+  if(ext == "y4m") {
+    source = new Y4MFrameSource();
+  }
+  else if(ext == "png" || ext == "jpg" || ext == "jpeg") {
+    source = new ImageSequenceFrameSource();
+  }
+  else if(cfg.raw_format != FRAME_FORMAT_NONE) {
+    source = new RawFrameSource(cfg.w, cfg.h, cfg.raw_format);
+  }
+  else {
+    printf("Error: we don't know the format of %s; pass -r for raw files.\n", cfg.input.c_str());
+    return NULL;
+  }
+
+  if(!source->open(cfg.input)) {
+    delete source;
+    return NULL;
+  }
+
+  return source;
+}
+
+static bool bench_create_context() {
+
+  EGLDisplay display = EGL_NO_DISPLAY;
+
+  /* Prefer a surfaceless display so we don't need X11 or a GPU. */
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if(get_platform_display) {
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+  }
+
+  if(display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  EGLint major = 0;
+  EGLint minor = 0;
+  if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+    printf("Error: cannot initialize EGL.\n");
+    return false;
+  }
+
+  if(!eglBindAPI(EGL_OPENGL_API)) {
+    printf("Error: EGL doesn't support desktop GL.\n");
+    return false;
+  }
+
+  EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_NONE
+  };
+
+  EGLConfig config = NULL;
+  EGLint num_configs = 0;
+  if(!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+    printf("Error: cannot find an EGL config.\n");
+    return false;
+  }
+
+  EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+
+  EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+  if(context == EGL_NO_CONTEXT) {
+    printf("Error: cannot create a GL 3.3 core context.\n");
+    return false;
+  }
+
+  /* We render into FBOs only; fall back to a tiny pbuffer when surfaceless contexts are not supported. */
+  if(!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+
+    EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+
+    if(surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context)) {
+      printf("Error: cannot make the GL context current.\n");
+      return false;
+    }
+  }
+
+  if(!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    printf("Error: cannot load the GL functions.\n");
+    return false;
+  }
+
+  return true;
+}
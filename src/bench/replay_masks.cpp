@@ -0,0 +1,167 @@
+/*
+
+  REPLAY MASKS
+  ------------
+
+  Feeds the masks from a MaskRecorder file into BlobTracker::track() as fast
+  as possible, without a GPU. Use it to reproduce tracking problems or to
+  measure the tracking stage on real data. Record masks with `bench_pipeline -o`
+  or by setting `BlobTracker::recorder` in your application.
+
+  Usage:
+
+     ./replay_masks -i masks.trk [-n loops] [-p 1]
+
+     -i      the recording
+     -n      number of times we replay the recording, each time with a new BlobTracker (default 1)
+     -p      when 1, print the tracked blobs of every frame; the output is
+             deterministic so you can diff it between versions of the tracker
+
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include <tracker/BlobTracker.h>
+#include <tracker/MaskRecorder.h>
+#include <tracker/Timings.h>
+
+struct ReplaySettings {
+  std::string input;
+  int num_loops;
+  bool print_blobs;
+};
+
+static bool replay_parse_args(int argc, char** argv, ReplaySettings& cfg);
+static void replay_print_blobs(BlobTracker& tracker);
+
+/* ---------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  ReplaySettings cfg;
+  if(!replay_parse_args(argc, argv, cfg)) {
+    exit(EXIT_FAILURE);
+  }
+
+  MaskPlayer player;
+  if(!player.open(cfg.input)) {
+    exit(EXIT_FAILURE);
+  }
+
+  if(!cfg.print_blobs) {
+    printf("masks: %llu, size: %dx%d, file: %.1f bytes per mask\n",
+           (unsigned long long)player.num_frames, player.width, player.height,
+           player.num_frames ? (double)player.file.size / player.num_frames : 0.0);
+  }
+
+  Timings timings;
+  uint64_t decode_ns = 0;
+  uint64_t track_ns = 0;
+  uint64_t num_frames = 0;
+
+  for(int loop = 0; loop < cfg.num_loops; ++loop) {
+
+    BlobTracker tracker(player.width, player.height);
+    tracker.timings = &timings;
+    timings.enable();
+
+    player.seek(0);
+
+    while(true) {
+
+      uint64_t t0 = tracker_now_ns();
+      if(!player.read(tracker.getInputImagePtr(), tracker.getInputImageRowLength(), tracker.frame)) {
+        break;
+      }
+
+      uint64_t t1 = tracker_now_ns();
+      tracker.track();
+      uint64_t t2 = tracker_now_ns();
+
+      decode_ns += t1 - t0;
+      track_ns += t2 - t1;
+      num_frames++;
+
+      if(cfg.print_blobs) {
+        replay_print_blobs(tracker);
+      }
+    }
+  }
+
+  if(cfg.print_blobs) {
+    return EXIT_SUCCESS;
+  }
+
+  if(0 == num_frames) {
+    printf("Error: no masks in %s.\n", cfg.input.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  double seconds = (decode_ns + track_ns) / 1e9;
+
+  printf("\n");
+  printf("frames: %llu\n", (unsigned long long)num_frames);
+  printf("fps: %.2f\n", num_frames / seconds);
+  printf("decode_ms_per_frame: %.4f\n", (decode_ns / 1e6) / num_frames);
+  printf("track_ms_per_frame: %.4f\n", (track_ns / 1e6) / num_frames);
+  printf("\n");
+  timings.print();
+
+  return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------*/
+
+static void replay_print_blobs(BlobTracker& tracker) {
+
+  int num = 0;
+  for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+    num += tracker.blobs[i].matched ? 1 : 0;
+  }
+
+  printf("frame %llu, blobs: %d", (unsigned long long)tracker.frame.id, num);
+
+  for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+    Blob& b = tracker.blobs[i];
+    if(b.matched) {
+      printf(", %d: %d %d", b.id, b.position.x, b.position.y);
+    }
+  }
+
+  printf("\n");
+}
+
+static bool replay_parse_args(int argc, char** argv, ReplaySettings& cfg) {
+
+  cfg.num_loops = 1;
+  cfg.print_blobs = false;
+
+  for(int i = 1; i < argc; ++i) {
+
+    if(i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+      printf("Error: invalid argument: %s, see the top of replay_masks.cpp for the usage.\n", argv[i]);
+      return false;
+    }
+
+    const char* val = argv[++i];
+
+    switch(argv[i - 1][1]) {
+      case 'i': { cfg.input = val;                     break; }
+      case 'n': { cfg.num_loops = atoi(val);           break; }
+      case 'p': { cfg.print_blobs = atoi(val) != 0;    break; }
+      default: {
+        printf("Error: unknown option: %s\n", argv[i - 1]);
+        return false;
+      }
+    }
+  }
+
+  if(cfg.input.size() == 0 || cfg.num_loops <= 0) {
+    printf("Error: no input given or invalid number of loops, see the top of replay_masks.cpp for the usage.\n");
+    return false;
+  }
+
+  return true;
+}
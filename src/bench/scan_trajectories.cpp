@@ -0,0 +1,238 @@
+/*
+
+  SCAN TRAJECTORIES
+  -----------------
+
+  Reads the segments of a TrajectoryLog (see TrajectoryLog.h) and prints 
+  what's in them. Use it as the starting point of an analysis: by default 
+  we only scan the x and y columns (the pages of the other columns are 
+  never read) and print the bounds and the average position of the 
+  samples of every segment, with the time the scan took. Record a log with
+  `bench_cpu -l logs/traj` or with a TrajectoryLog in your application.
+
+  Usage:
+
+     ./scan_trajectories -i logs/traj [-p 1] [-f first_frame] [-l last_frame] [-r 1]
+
+     -i      the prefix of the log
+     -p      when 1, print every sample (this reads all columns)
+     -f, -l  only look at the segments with frames in this range; we 
+             skip the others on their index entry without opening them
+     -r      when 1, first reopen the log twice with a TrajectoryLog (like
+             an application that restarts) and check that the number of
+             entries in the index stays the same
+
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include <tracker/TrajectoryLog.h>
+#include <tracker/Timings.h>
+
+struct ScanSettings {
+  std::string input;
+  bool print_samples;
+  uint64_t first_frame;
+  uint64_t last_frame;
+  bool check_reopen;
+};
+
+static bool scan_parse_args(int argc, char** argv, ScanSettings& cfg);
+static void scan_print_samples(TrajectoryReader& reader);
+static bool scan_check_reopen(std::string prefix);
+static bool scan_count_index_entries(std::string prefix, uint64_t& count);
+
+/* ---------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  ScanSettings cfg;
+  if(!scan_parse_args(argc, argv, cfg)) {
+    exit(EXIT_FAILURE);
+  }
+
+  if(cfg.check_reopen && !scan_check_reopen(cfg.input)) {
+    exit(EXIT_FAILURE);
+  }
+
+  TrajectoryReader reader;
+  if(!reader.open(cfg.input)) {
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t total_samples = 0;
+  uint64_t total_ns = 0;
+  static const char* reasons[] = { "open", "size", "time", "close" };
+
+  printf("segments: %zu\n", reader.index.size());
+
+  for(uint32_t i = 0; i < reader.index.size(); ++i) {
+
+    TrajectoryIndexEntry& entry = reader.index[i];
+    if(entry.last_frame < cfg.first_frame || entry.first_frame > cfg.last_frame) {
+      continue;
+    }
+
+    if(!reader.mapSegment(i)) {
+      continue;
+    }
+
+    uint64_t t_start = tracker_now_ns();
+
+    const float* xs = reader.getColumn<float>(TRAJ_COLUMN_X);
+    const float* ys = reader.getColumn<float>(TRAJ_COLUMN_Y);
+    float min_x = 0.0f, max_x = 0.0f, min_y = 0.0f, max_y = 0.0f;
+    double sum_x = 0.0, sum_y = 0.0;
+
+    for(uint64_t k = 0; k < reader.num_samples; ++k) {
+      float x = xs[k];
+      float y = ys[k];
+      min_x = (0 == k || x < min_x) ? x : min_x;
+      max_x = (0 == k || x > max_x) ? x : max_x;
+      min_y = (0 == k || y < min_y) ? y : min_y;
+      max_y = (0 == k || y > max_y) ? y : max_y;
+      sum_x += x;
+      sum_y += y;
+    }
+
+    uint64_t ns = tracker_now_ns() - t_start;
+    double n = (reader.num_samples) ? (double)reader.num_samples : 1.0;
+
+    printf("segment: %06u, frames: %llu - %llu, samples: %llu, rolled: %s, x: %.1f - %.1f, y: %.1f - %.1f, average: %.1f, %.1f, scan: %.3f ms\n",
+           entry.segment, 
+           (unsigned long long)entry.first_frame, 
+           (unsigned long long)entry.last_frame, 
+           (unsigned long long)reader.num_samples, 
+           (entry.reason <= TRAJ_ROLL_CLOSE) ? reasons[entry.reason] : "?",
+           min_x, max_x, min_y, max_y, sum_x / n, sum_y / n, ns / 1e6);
+
+    if(cfg.print_samples) {
+      scan_print_samples(reader);
+    }
+
+    total_samples += reader.num_samples;
+    total_ns += ns;
+  }
+
+  printf("\n");
+  printf("samples: %llu\n", (unsigned long long)total_samples);
+  printf("scan_ms: %.3f\n", total_ns / 1e6);
+  if(0 != total_ns) {
+    printf("samples_per_second: %.0f\n", total_samples / (total_ns / 1e9));
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------*/
+
+static void scan_print_samples(TrajectoryReader& reader) {
+
+  const uint64_t* frames = reader.getColumn<uint64_t>(TRAJ_COLUMN_FRAME);
+  const int32_t* ids = reader.getColumn<int32_t>(TRAJ_COLUMN_ID);
+  const float* xs = reader.getColumn<float>(TRAJ_COLUMN_X);
+  const float* ys = reader.getColumn<float>(TRAJ_COLUMN_Y);
+  const int32_t* areas = reader.getColumn<int32_t>(TRAJ_COLUMN_AREA);
+  const float* dxs = reader.getColumn<float>(TRAJ_COLUMN_DIRECTION_X);
+  const float* dys = reader.getColumn<float>(TRAJ_COLUMN_DIRECTION_Y);
+
+  for(uint64_t k = 0; k < reader.num_samples; ++k) {
+    printf("  frame: %llu, id: %d, position: %.1f, %.1f, area: %d, direction: %.2f, %.2f\n",
+           (unsigned long long)frames[k], ids[k], xs[k], ys[k], areas[k], dxs[k], dys[k]);
+  }
+}
+
+/* Opening a log appends the segments that were not indexed yet (e.g. after a crash); opening it again must not add anything. */
+static bool scan_check_reopen(std::string prefix) {
+
+  uint64_t num_entries = 0;
+  uint64_t count = 0;
+
+  for(int i = 0; i < 2; ++i) {
+
+    TrajectoryLog log;
+    if(!log.open(prefix)) {
+      return false;
+    }
+    log.close();
+
+    if(!scan_count_index_entries(prefix, count)) {
+      return false;
+    }
+
+    if(0 != i && count != num_entries) {
+      printf("Error: reopening %s changed the number of index entries from %llu to %llu.\n",
+             prefix.c_str(), (unsigned long long)num_entries, (unsigned long long)count);
+      return false;
+    }
+
+    num_entries = count;
+  }
+
+  printf("reopen: ok, entries: %llu\n", (unsigned long long)num_entries);
+
+  return true;
+}
+
+/* Counts the entries that are stored in the index file; trajectory_read_index() also returns the segments that aren't indexed. */
+static bool scan_count_index_entries(std::string prefix, uint64_t& count) {
+
+  std::string path = prefix +".index";
+  FILE* fp = fopen(path.c_str(), "rb");
+  if(NULL == fp) {
+    printf("Error: cannot open %s.\n", path.c_str());
+    return false;
+  }
+
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fclose(fp);
+
+  if(size < (long)sizeof(TrajectoryIndexHeader)) {
+    printf("Error: %s is too small.\n", path.c_str());
+    return false;
+  }
+
+  count = (size - sizeof(TrajectoryIndexHeader)) / sizeof(TrajectoryIndexEntry);
+
+  return true;
+}
+
+static bool scan_parse_args(int argc, char** argv, ScanSettings& cfg) {
+
+  cfg.print_samples = false;
+  cfg.check_reopen = false;
+  cfg.first_frame = 0;
+  cfg.last_frame = UINT64_MAX;
+
+  for(int i = 1; i < argc; ++i) {
+
+    if(i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+      printf("Error: invalid argument: %s, see the top of scan_trajectories.cpp for the usage.\n", argv[i]);
+      return false;
+    }
+
+    const char* val = argv[++i];
+
+    switch(argv[i - 1][1]) {
+      case 'i': { cfg.input = val;                               break; }
+      case 'p': { cfg.print_samples = (1 == atoi(val));          break; }
+      case 'f': { cfg.first_frame = strtoull(val, NULL, 10);     break; }
+      case 'l': { cfg.last_frame = strtoull(val, NULL, 10);      break; }
+      case 'r': { cfg.check_reopen = (1 == atoi(val));           break; }
+      default: {
+        printf("Error: unknown option: %s\n", argv[i - 1]);
+        return false;
+      }
+    }
+  }
+
+  if(cfg.input.empty()) {
+    printf("Error: no input given, use -i prefix.\n");
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,145 @@
+/*
+
+  TRACK READER
+  ------------
+
+  A minimal consumer of the tracks that a TrackPublisher publishes into 
+  shared memory; use it as the starting point of your own service. It only
+  needs TrackReader.h and the `tracker_reader` library. Start a publisher,
+  e.g. `bench_cpu -p /tracker -f 100000`, and then:
+
+  Usage:
+
+     ./track_reader -i /tracker [-n num_frames] [-p 1] [-s sleep_us]
+
+     -i      the name of the shared memory of the publisher
+     -n      stop after this many frames (default 0: run until the publisher stops)
+     -p      when 1, print the tracks of every frame
+     -s      the time we sleep between two updates in us (default 1000); use a 
+             large value to see how the reader skips and resyncs when it falls 
+             behind
+
+  At the end we print the latency between publishing and reading a frame.
+
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#include <thread>
+
+#include <tracker/TrackReader.h>
+#include <tracker/Timings.h>
+
+struct ReaderSettings {
+  std::string input;
+  int num_frames;
+  int sleep_us;
+  bool print_tracks;
+};
+
+static bool reader_parse_args(int argc, char** argv, ReaderSettings& cfg);
+
+/* ---------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  ReaderSettings cfg;
+  if(!reader_parse_args(argc, argv, cfg)) {
+    exit(EXIT_FAILURE);
+  }
+
+  TrackReader reader;
+  if(!reader.open(cfg.input)) {
+    printf("Waiting for the publisher of %s.\n", cfg.input.c_str());
+  }
+
+  int num_frames = 0;
+  bool was_open = false;
+  double latency_ms = 0.0;
+  double max_latency_ms = 0.0;
+
+  while(0 == cfg.num_frames || num_frames < cfg.num_frames) {
+
+    if(reader.update()) {
+
+      /* The publisher uses the same steady clock; tracker_now_ns() is inline, we don't need the tracker library for it. */
+      double ms = (tracker_now_ns() - reader.publish_ns) / 1e6;
+      latency_ms += ms;
+      max_latency_ms = (ms > max_latency_ms) ? ms : max_latency_ms;
+      ++num_frames;
+
+      if(cfg.print_tracks) {
+        printf("frame: %llu, tracks: %zu\n", (unsigned long long)reader.frame_id, reader.tracks.size());
+        for(size_t i = 0; i < reader.tracks.size(); ++i) {
+          TrackRecord& track = reader.tracks[i];
+          printf("  id: %d, age: %d, area: %d, position: %.1f, %.1f, direction: %.2f, %.2f\n", 
+                 track.id, track.age, track.area, track.x, track.y, track.direction_x, track.direction_y);
+        }
+      }
+    }
+
+    /* Stop when the publisher stopped; update() closes the reader when it sees that. */
+    if(was_open && !reader.isOpen()) {
+      break;
+    }
+
+    was_open = reader.isOpen();
+
+    std::this_thread::sleep_for(std::chrono::microseconds(cfg.sleep_us));
+  }
+
+  printf("\n");
+  printf("frames: %d\n", num_frames);
+  printf("skipped: %llu\n", (unsigned long long)reader.num_skipped);
+  printf("resyncs: %llu\n", (unsigned long long)reader.num_resyncs);
+  printf("retries: %llu\n", (unsigned long long)reader.num_retries);
+  if(0 != num_frames) {
+    printf("latency_ms: %.3f (max %.3f)\n", latency_ms / num_frames, max_latency_ms);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------*/
+
+static bool reader_parse_args(int argc, char** argv, ReaderSettings& cfg) {
+
+  cfg.num_frames = 0;
+  cfg.sleep_us = 1000;
+  cfg.print_tracks = false;
+
+  for(int i = 1; i < argc; ++i) {
+
+    if(i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+      printf("Error: invalid argument: %s, see the top of track_reader.cpp for the usage.\n", argv[i]);
+      return false;
+    }
+
+    const char* val = argv[++i];
+
+    switch(argv[i - 1][1]) {
+      case 'i': { cfg.input = val;                     break; }
+      case 'n': { cfg.num_frames = atoi(val);          break; }
+      case 'p': { cfg.print_tracks = (1 == atoi(val)); break; }
+      case 's': { cfg.sleep_us = atoi(val);            break; }
+      default: {
+        printf("Error: unknown option: %s\n", argv[i - 1]);
+        return false;
+      }
+    }
+  }
+
+  if(cfg.input.empty()) {
+    printf("Error: no input given, use -i /name.\n");
+    return false;
+  }
+
+  if(cfg.num_frames < 0 || cfg.sleep_us < 0) {
+    printf("Error: invalid number of frames or sleep time.\n");
+    return false;
+  }
+
+  return true;
+}
@@ -27,6 +27,7 @@
 #include <videocapture/CaptureGL.h>
 
 #include <tracker/Tracker.h>
+#include <tracker/Governor.h>
 
 void button_callback(GLFWwindow* win, int bt, int action, int mods);
 void cursor_callback(GLFWwindow* win, double x, double y);
@@ -34,6 +35,7 @@ void key_callback(GLFWwindow* win, int key, int scancode, int action, int mods);
 void char_callback(GLFWwindow* win, unsigned int key);
 void error_callback(int err, const char* desc);
 void resize_callback(GLFWwindow* window, int width, int height);
+void on_governor_event(Governor* gov, int event, void* user);
 
 int main() {
 
@@ -81,6 +83,9 @@ int main() {
   
   ca::CaptureGL capture;
   Tracker tracker(320, 240, 10);
+  Governor governor;
+  governor.budget_ms = 8.0;
+  governor.callback = on_governor_event;
   capture.cap.listDevices();
   if(capture.open(0, tracker.w, tracker.h) < 0) {
     printf("Erorr: cannot open the tracker.\n");
@@ -96,14 +101,24 @@ int main() {
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    tracker.beginFrame();
-    {
-      capture.update();
-      capture.draw();
+    capture.update();
+
+    if(governor.shouldProcess()) {
+
+      uint64_t t = tracker_now_ns();
+
+      tracker.beginFrame();
+      {
+        capture.draw();
+      }
+      tracker.endFrame();
+
+      tracker.apply();
+
+      governor.update((tracker_now_ns() - t) / 1e6, tracker.blobs.coverage);
+      governor.apply(tracker);
     }
-    tracker.endFrame();
-    
-    tracker.apply();
+
     tracker.draw();
     
     glfwSwapBuffers(win);
@@ -135,6 +150,14 @@ void key_callback(GLFWwindow* win, int key, int scancode, int action, int mods)
   };
 }
 
+void on_governor_event(Governor* gov, int event, void*) {
+  switch(event) {
+    case GOVERNOR_EVENT_LEVEL:  { printf("Governor: level %d.\n", gov->level); break; }
+    case GOVERNOR_EVENT_IDLE:   { printf("Governor: idle.\n");               break; }
+    case GOVERNOR_EVENT_ACTIVE: { printf("Governor: active.\n");             break; }
+  }
+}
+
 void error_callback(int err, const char* desc) {
   printf("GLFW error: %s (%d)\n", desc, err);
 }
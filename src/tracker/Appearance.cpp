@@ -0,0 +1,105 @@
+#include <tracker/Appearance.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+/* ---------------------------------------------------*/
+
+AppearanceDescriptor::AppearanceDescriptor()
+  :num_pixels(0.0f)
+{
+  memset(bins, 0x00, sizeof(bins));
+}
+
+void AppearanceDescriptor::mix(const AppearanceDescriptor& other, float amount) {
+
+  if(other.num_pixels <= 0.0f) {
+    return;
+  }
+
+  if(num_pixels <= 0.0f) {
+    *this = other;
+    return;
+  }
+
+  float sum = 0.0f;
+  for(int i = 0; i < APPEARANCE_NUM_BINS; ++i) {
+    bins[i] = bins[i] * (1.0f - amount) + other.bins[i] * amount;
+    sum += bins[i];
+  }
+
+  if(sum > 0.0f) {
+    for(int i = 0; i < APPEARANCE_NUM_BINS; ++i) {
+      bins[i] /= sum;
+    }
+  }
+
+  num_pixels = num_pixels * (1.0f - amount) + other.num_pixels * amount;
+}
+
+/* ---------------------------------------------------*/
+
+AppearanceTable::AppearanceTable()
+  :tile_size(0)
+  ,tiles_x(0)
+  ,tiles_y(0)
+{
+}
+
+void AppearanceTable::resize(int w, int h, int tileSize) {
+  tile_size = tileSize;
+  tiles_x = (w + tileSize - 1) / tileSize;
+  tiles_y = (h + tileSize - 1) / tileSize;
+  values.assign(tiles_x * tiles_y * APPEARANCE_NUM_BINS, 0.0f);
+  frame = FrameInfo();
+}
+
+bool AppearanceTable::getDescriptor(int minX, int minY, int maxX, int maxY, AppearanceDescriptor& result) {
+
+  result = AppearanceDescriptor();
+
+  if(0 == tile_size || values.empty()) {
+    return false;
+  }
+
+  int x0 = std::max(0, minX / tile_size);
+  int y0 = std::max(0, minY / tile_size);
+  int x1 = std::min(tiles_x - 1, maxX / tile_size);
+  int y1 = std::min(tiles_y - 1, maxY / tile_size);
+
+  for(int j = y0; j <= y1; ++j) {
+    const float* tile = &values[(j * tiles_x + x0) * APPEARANCE_NUM_BINS];
+    for(int i = x0; i <= x1; ++i, tile += APPEARANCE_NUM_BINS) {
+      for(int k = 0; k < APPEARANCE_NUM_BINS; ++k) {
+        result.bins[k] += tile[k];
+      }
+    }
+  }
+
+  for(int k = 0; k < APPEARANCE_NUM_BINS; ++k) {
+    result.num_pixels += result.bins[k];
+  }
+
+  if(result.num_pixels <= 0.0f) {
+    return false;
+  }
+
+  for(int k = 0; k < APPEARANCE_NUM_BINS; ++k) {
+    result.bins[k] /= result.num_pixels;
+  }
+
+  return true;
+}
+
+/* ---------------------------------------------------*/
+
+float appearance_distance(const AppearanceDescriptor& a, const AppearanceDescriptor& b) {
+
+  /* Bhattacharyya coefficient: 1 for equal histograms, 0 for histograms that don't overlap. */
+  float bc = 0.0f;
+  for(int i = 0; i < APPEARANCE_NUM_BINS; ++i) {
+    bc += sqrtf(a.bins[i] * b.bins[i]);
+  }
+
+  return sqrtf(std::max(0.0f, 1.0f - bc));
+}
@@ -0,0 +1,168 @@
+#include <tracker/AppearanceTiles.h>
+#include <string.h>
+
+AppearanceTiles::AppearanceTiles(int w, int h, int tileSize)
+  :w(w)
+  ,h(h)
+  ,tile_size(tileSize)
+  ,out_w(0)
+  ,out_h(0)
+  ,fullscreen_vao(0)
+  ,prog(0)
+  ,u_tile_size(-1)
+  ,u_flip(-1)
+  ,fbo(0)
+  ,tex(0)
+  ,pbo_toggle(0)
+{
+  if(w <= 0 || h <= 0 || tileSize <= 0) {
+    printf("Error: invalid size or tile size for the appearance tiles.\n");
+    ::exit(EXIT_FAILURE);
+  }
+
+  table.resize(w, h, tile_size);
+  out_w = table.tiles_x * (APPEARANCE_NUM_BINS / 4);
+  out_h = table.tiles_y;
+
+  pbos[0] = pbos[1] = 0;
+
+  glGenVertexArrays(1, &fullscreen_vao);
+
+  prog = tracker_program_cache().createProgram(ROXLU_OPENGL_FULLSCREEN_VS, APPEARANCE_TILES_FS);
+  glUseProgram(prog);
+  rx_uniform_1i(prog, "u_color", 0);
+  rx_uniform_1i(prog, "u_mask", 1);
+  u_tile_size = glGetUniformLocation(prog, "u_tile_size");
+  u_flip = glGetUniformLocation(prog, "u_flip");
+
+  // The texture and pack buffers are created on first use, see setup().
+}
+
+AppearanceTiles::~AppearanceTiles() {
+
+  if(fbo) {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &tex);
+  }
+
+  if(pbos[0]) {
+    glDeleteBuffers(2, pbos);
+  }
+
+  if(fullscreen_vao) {
+    glDeleteVertexArrays(1, &fullscreen_vao);
+  }
+
+  fbo = 0;
+  tex = 0;
+  pbos[0] = pbos[1] = 0;
+  fullscreen_vao = 0;
+}
+
+void AppearanceTiles::apply(RenderGraph& graph, GLuint colorTex, GLuint maskTex, const FrameInfo& frame, bool flipY) {
+
+  if(!setup()) {
+    return;
+  }
+
+  RenderPass& pass = graph.addDrawPass(TRACKER_STAGE_APPEARANCE, prog, fullscreen_vao, fbo, tex, out_w, out_h);
+  pass.input(colorTex);
+  pass.input(maskTex);
+  pass.uniform1i(u_tile_size, tile_size);
+  pass.uniform1i(u_flip, (flipY) ? 1 : 0);
+
+  graph.addReadPixelsPass(TRACKER_STAGE_APPEARANCE, fbo, pbos[pbo_toggle], out_w, out_h, GL_RGBA, out_w, GL_FLOAT);
+  pbo_frames[pbo_toggle] = frame;
+}
+
+bool AppearanceTiles::update() {
+
+  if(0 == pbos[0]) {
+    return false;
+  }
+
+  int dx = 1 - pbo_toggle;
+  pbo_toggle = dx;
+
+  if(0 == pbo_frames[dx].id) {
+    return false;
+  }
+
+  GLint saved_pack_buffer = 0;
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &saved_pack_buffer);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[dx]);
+
+  bool result = false;
+  float* ptr = (float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, table.values.size() * sizeof(float), GL_MAP_READ_BIT);
+  if(ptr) {
+    memcpy(&table.values[0], ptr, table.values.size() * sizeof(float));
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    table.frame = pbo_frames[dx];
+    result = true;
+  }
+  else {
+    printf("Error: cannot map the appearance pack buffer.\n");
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, saved_pack_buffer);
+
+  /* We copied it; a pack buffer without a new read back must not be copied again. */
+  pbo_frames[dx] = FrameInfo();
+
+  return result;
+}
+
+size_t AppearanceTiles::getNumBytes() {
+
+  if(0 == fbo) {
+    return 0;
+  }
+
+  return 3 * table.values.size() * sizeof(float);   /* tex and the two pbos */
+}
+
+bool AppearanceTiles::setup() {
+
+  if(fbo) {
+    return true;
+  }
+
+  GLint saved_fbo = 0;
+  GLint saved_tex = 0;
+  GLint saved_pack_buffer = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &saved_fbo);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &saved_tex);
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &saved_pack_buffer);
+
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+  glGenTextures(1, &tex);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, out_w, out_h, 0, GL_RGBA, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+
+  bool is_complete = (GL_FRAMEBUFFER_COMPLETE == glCheckFramebufferStatus(GL_FRAMEBUFFER));
+
+  glGenBuffers(2, pbos);
+  for(int i = 0; i < 2; ++i) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, table.values.size() * sizeof(float), NULL, GL_STREAM_READ);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, saved_fbo);
+  glBindTexture(GL_TEXTURE_2D, saved_tex);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, saved_pack_buffer);
+
+  if(!is_complete) {
+    printf("Error: the appearance framebuffer is not complete.\n");
+    return false;
+  }
+
+  return true;
+}
@@ -1,35 +1,126 @@
 #include <tracker/BackgroundBuffer.h>
 #include <sstream>
 
-BackgroundBuffer::BackgroundBuffer(int w, int h, int num) 
-  :w(w)
+static_assert((int)BG_FORMAT_RGBA8 == (int)SNAPSHOT_HISTORY_RGBA8 && (int)BG_FORMAT_RGB565 == (int)SNAPSHOT_HISTORY_RGB565
+              && (int)BG_FORMAT_LUMA == (int)SNAPSHOT_HISTORY_LUMA && (int)BG_FORMAT_LUMA_CHROMA == (int)SNAPSHOT_HISTORY_LUMA_CHROMA,
+              "BackgroundBuffer: the snapshot formats must match the BackgroundBufferFormat values.");
+
+BackgroundBuffer::BackgroundBuffer(int w, int h, int num, int fmt) 
+  :index(0)
+  ,w(w)
   ,h(h)
-  ,win_w(0)
-  ,win_h(0)
+  ,caller_draw_fbo(0)
+  ,caller_read_fbo(0)
   ,num(num)
-  ,index(0)
-  ,vert(0)
-  ,frag(0)
+  ,fmt(fmt)
+  ,slot_format(GL_RGBA8)
+  ,slot_h(h)
+  ,ingest_tex(0)
+  ,ingest_flags(0)
+  ,ingest_is_luma(false)
+  ,read_fbo(0)
+  ,fbo(0)
   ,prog(0)
+  ,convert_prog(0)
+  ,u_convert_flip(-1)
+  ,accum_prog(0)
+  ,u_accum_weight(-1)
+  ,u_long_weight(-1)
+  ,long_interval(0)
+  ,long_weight(0.0f)
+  ,long_index(0)
+  ,long_count(0)
+  ,frame_count(0)
+  ,bootstrap(true)
   ,vao(0)
-  ,last_index(0)
   ,out_tex(0)
+  ,last_index(0)
 {
 #if 1
-  GLint vp[4] = { 0 };
-  glGetIntegerv(GL_VIEWPORT, vp);
-  win_w = vp[2];
-  win_h = vp[3];
+  glGetIntegerv(GL_VIEWPORT, caller_viewport);
+
+  capture.fbo = 0;
+  capture.tex = 0;
+  long_avg.fbo = 0;
+  long_avg.tex = 0;
+
+  // Every history slot + the last frame uses a sampler.
+  GLint max_units = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+  if(num + 1 > max_units) {
+    printf("Error: the background buffer needs %d texture units but the GPU has only %d.\n", num + 1, max_units);
+    ::exit(EXIT_FAILURE);
+  }
+
+  switch(fmt) {
+    case BG_FORMAT_RGBA8: {
+      slot_format = GL_RGBA8;
+      break;
+    }
+    case BG_FORMAT_RGB565: {
+      slot_format = GL_RGB565;
+      break;
+    }
+    case BG_FORMAT_LUMA: {
+      slot_format = GL_R8;
+      break;
+    }
+    case BG_FORMAT_LUMA_CHROMA: {
+      if(w & 1) {
+        printf("Error: BG_FORMAT_LUMA_CHROMA needs an even width, %d given.\n", w);
+        ::exit(EXIT_FAILURE);
+      }
+      slot_format = GL_R8;
+      slot_h = h + (h + 1) / 2;
+      break;
+    }
+    default: {
+      printf("Error: unknown background buffer format: %d\n", fmt);
+      ::exit(EXIT_FAILURE);
+    }
+  }
 
   // Create num fbos;
   for(int i = 0; i < num; ++i) {
-    BackgroundFBO buf = createBuffer();
+    BackgroundFBO buf = createBuffer(slot_format, w, slot_h);
     buffers.push_back(buf);
+    slot_tex.push_back(buf.tex);
   }
 
-  BackgroundFBO bg_fbo = createBuffer();
-  fbo = bg_fbo.fbo;
-  out_tex = bg_fbo.tex;
+  // The luma formats can't be drawn into directly; we capture RGBA and convert.
+  if(needsConversion()) {
+
+    capture = createBuffer(GL_RGBA8, w, h);
+
+    if(!setupConvertShader()) {
+      printf("Error: cannot create the background buffer conversion shader.\n");
+      ::exit(EXIT_FAILURE);
+    }
+  }
+
+  if(!setupShader()) {
+    printf("Error: cannot create the background buffer shader.\n");
+    ::exit(EXIT_FAILURE);
+  }
+
+  glGenVertexArrays(1, &vao);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+#endif
+}
+
+bool BackgroundBuffer::setupShader() {
+
+  float threshold = 0.1f;
+  const char* metric = "vec3(1.0, 1.0, 1.0)";
+
+  if(fmt == BG_FORMAT_LUMA) {
+    // A pure brightness change of `d` gives an RGB distance of sqrt(3) * d.
+    threshold = 0.06f;
+    metric = "vec3(1.0, 0.0, 0.0)";
+  }
+  else if(fmt == BG_FORMAT_LUMA_CHROMA) {
+    threshold = 0.06f;
+  }
 
   std::stringstream ss;
   float div = 1.0 / num;
@@ -43,20 +134,30 @@ BackgroundBuffer::BackgroundBuffer(int w, int h, int num)
     ss << "uniform sampler2D u_tex" << i << ";\n";
   }
 
+  if(long_buffers.size()) {
+    ss << "uniform sampler2D u_long_avg;\n";
+    ss << "uniform float u_long_weight;\n";
+  }
+
+  ss << getSampleFunction();
+
   ss << "void main() { \n"
      << "  fragcolor = vec4(0.0, 0.0, 0.0, 1.0);\n"
      << "  vec3 history = vec3(0.0);"
-     << "  vec3 last_col = texture(u_last_frame, v_texcoord).rgb;\n";
+     << "  vec3 last_col = sample_history(u_last_frame);\n";
   
   for(int i = 0; i < num; ++i) {
-    ss <<  "  history += texture(u_tex" << i << ", v_texcoord).rgb * " << div << ";\n";
+    ss <<  "  history += sample_history(u_tex" << i << ") * " << div << ";\n";
   }
 
-  ss << " float dr = last_col.r - history.r; \n"
-     << " float dg = last_col.g - history.g; \n"
-     << " float db = last_col.b - history.b; \n"
-     << " float d = sqrt(dr * dr + dg * dg + db * db); \n"
-     << " if(d > 0.1) { \n"   // only keep changes which are big enough
+  // Blend the short term average with the decimated long term average.
+  if(long_buffers.size()) {
+    ss << "  history = mix(history, sample_history(u_long_avg), u_long_weight);\n";
+  }
+
+  ss << " vec3 diff = last_col - history; \n"
+     << " float d = sqrt(dot(diff * diff, " << metric << ")); \n"
+     << " if(d > " << threshold << ") { \n"   // only keep changes which are big enough
      <<      "fragcolor.rgb = vec3(1.0);  \n"
      << "  } \n"
      << " } \n"
@@ -65,9 +166,12 @@ BackgroundBuffer::BackgroundBuffer(int w, int h, int num)
   std::string frag_src = ss.str();
   const char* frag_src_ptr = frag_src.c_str();
 
-  vert = rx_create_shader(GL_VERTEX_SHADER, BG_BUFFER_VS);
-  frag = rx_create_shader(GL_FRAGMENT_SHADER, frag_src_ptr);
-  prog = rx_create_program(vert, frag, true);
+  if(prog) {
+    glDeleteProgram(prog);
+    prog = 0;
+  }
+
+  prog = tracker_program_cache().createProgram(BG_BUFFER_VS, frag_src_ptr);
   glUseProgram(prog);
 
   for(int i = 0; i < num; ++i) {
@@ -77,14 +181,202 @@ BackgroundBuffer::BackgroundBuffer(int w, int h, int num)
   }
   rx_uniform_1i(prog, "u_last_frame", num);
 
-  glGenVertexArrays(1, &vao);
+  if(long_buffers.size()) {
+    rx_uniform_1i(prog, "u_long_avg", num + 1);
+    u_long_weight = glGetUniformLocation(prog, "u_long_weight");
+    glUniform1f(u_long_weight, 0.0f);
+  }
+
+  return true;
+}
+
+bool BackgroundBuffer::setupConvertShader() {
+
+  if(convert_prog) {
+    return true;
+  }
+
+  std::stringstream css;
+  css << "#version 330\n"
+      << "#define W " << w << "\n"
+      << "#define H " << h << "\n";
+
+  if(!needsConversion()) {
+    css << "#define BG_CONVERT_COPY\n";
+  }
+
+  css << BG_BUFFER_CONVERT_FS;
+
+  std::string convert_src = css.str();
+  convert_prog = tracker_program_cache().createProgram(BG_BUFFER_VS, convert_src.c_str());
+  if(!convert_prog) {
+    return false;
+  }
+
+  glUseProgram(convert_prog);
+  rx_uniform_1i(convert_prog, "u_tex", 0);
+  u_convert_flip = glGetUniformLocation(convert_prog, "u_flip");
+  glUniform1i(u_convert_flip, 0);
+
+  return true;
+}
+
+bool BackgroundBuffer::setupLongHistory(int longNum, int interval, float weight) {
+
+  if(long_buffers.size()) {
+    printf("Error: the long history has already been setup.\n");
+    return false;
+  }
+
+  if(longNum <= 0 || interval <= 0) {
+    printf("Error: invalid long history size (%d) or interval (%d).\n", longNum, interval);
+    return false;
+  }
+
+  if(weight <= 0.0f || weight >= 1.0f) {
+    printf("Error: the long history weight must be between 0 and 1, %f given.\n", weight);
+    return false;
+  }
+
+  GLint max_units = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+  if(num + 2 > max_units) {
+    printf("Error: the long history needs %d texture units but the GPU has only %d.\n", num + 2, max_units);
+    return false;
+  }
+
+  long_interval = interval;
+  long_weight = weight;
+
+  for(int i = 0; i < longNum; ++i) {
+    BackgroundFBO buf = createBuffer(slot_format, w, slot_h);
+    long_buffers.push_back(buf);
+  }
+
+  // We average the long history texel by texel; for the NV12 layout this averages luma and chroma separately.
+  long_avg = createBuffer((slot_format == GL_R8) ? GL_R16F : GL_RGBA16F, w, slot_h);
+
+  if(!accum_prog) {
+    accum_prog = tracker_program_cache().createProgram(BG_BUFFER_VS, BG_BUFFER_ACCUM_FS);
+    glUseProgram(accum_prog);
+    rx_uniform_1i(accum_prog, "u_tex", 0);
+    u_accum_weight = glGetUniformLocation(accum_prog, "u_weight");
+  }
+
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
-#endif
+
+  return setupShader();
+}
+
+void BackgroundBuffer::updateLongHistory() {
+  copyToLongHistory();
+  updateLongAverage();
+}
+
+void BackgroundBuffer::copyToLongHistory() {
+
+  // Copy the frame we just grabbed into the long history; the slot may reference an added texture.
+  if(slot_tex[index] != buffers[index].tex) {
+    if(!read_fbo) {
+      glGenFramebuffers(1, &read_fbo);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot_tex[index], 0);
+  }
+  else {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, buffers[index].fbo);
+  }
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, long_buffers[long_index].fbo);
+  glBlitFramebuffer(0, 0, w, slot_h, 0, 0, w, slot_h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+  ++long_index %= long_buffers.size();
+  if(long_count < long_buffers.size()) {
+    long_count++;
+  }
+}
+
+void BackgroundBuffer::updateLongAverage() {
+
+  if(0 == long_count) {
+    return;
+  }
+
+  // Recalculate the long term average; this happens only once every `long_interval` frames.
+  GLenum drawbuffers[] = { GL_COLOR_ATTACHMENT0 } ;
+  GLfloat zero[] = { 0.0f, 0.0f, 0.0f, 0.0f } ;
+  GLboolean blend_enabled = glIsEnabled(GL_BLEND);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, long_avg.fbo);
+  glDrawBuffers(1, drawbuffers);
+  glViewport(0, 0, w, slot_h);
+  glClearBufferfv(GL_COLOR, 0, zero);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  glBindVertexArray(vao);
+  glUseProgram(accum_prog);
+  glUniform1f(u_accum_weight, 1.0f / long_count);
+  glActiveTexture(GL_TEXTURE0);
+
+  for(size_t i = 0; i < long_count; ++i) {
+    glBindTexture(GL_TEXTURE_2D, long_buffers[i].tex);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  if(!blend_enabled) {
+    glDisable(GL_BLEND);
+  }
+
+  glUseProgram(prog);
+  glUniform1f(u_long_weight, long_weight);
 }
 
-BackgroundFBO BackgroundBuffer::createBuffer() {
+std::string BackgroundBuffer::getSampleFunction() {
+
+  std::stringstream ss;
+
+  if(fmt == BG_FORMAT_LUMA_CHROMA) {
+    // Luma at the pixel, the interleaved U/V pair below the luma plane.
+    ss << "vec3 sample_history(sampler2D tex) {\n"
+       << "  ivec2 p = ivec2(v_texcoord * vec2(" << w << ".0, " << h << ".0));\n"
+       << "  ivec2 c = ivec2((p.x / 2) * 2, " << h << " + p.y / 2);\n"
+       << "  return vec3(texelFetch(tex, p, 0).r, texelFetch(tex, c, 0).r, texelFetch(tex, c + ivec2(1, 0), 0).r);\n"
+       << "}\n";
+  }
+  else if(fmt == BG_FORMAT_LUMA) {
+    ss << "vec3 sample_history(sampler2D tex) {\n"
+       << "  return vec3(texture(tex, v_texcoord).r, 0.0, 0.0);\n"
+       << "}\n";
+  }
+  else {
+    ss << "vec3 sample_history(sampler2D tex) {\n"
+       << "  return texture(tex, v_texcoord).rgb;\n"
+       << "}\n";
+  }
+
+  return ss.str();
+}
+
+BackgroundFBO BackgroundBuffer::createBuffer(GLenum internalFormat, int texW, int texH) {
 
   BackgroundFBO bf;
+  GLenum format = GL_RGBA;
+  GLenum type = GL_UNSIGNED_BYTE;
+
+  if(internalFormat == GL_R8) {
+    format = GL_RED;
+  }
+  else if(internalFormat == GL_RGB565) {
+    format = GL_RGB;
+    type = GL_UNSIGNED_SHORT_5_6_5;
+  }
+  else if(internalFormat == GL_R16F) {
+    format = GL_RED;
+    type = GL_FLOAT;
+  }
+  else if(internalFormat == GL_RGBA16F) {
+    type = GL_FLOAT;
+  }
 
   glGenFramebuffers(1, &bf.fbo);
   glBindFramebuffer(GL_FRAMEBUFFER, bf.fbo);
@@ -92,16 +384,17 @@ BackgroundFBO BackgroundBuffer::createBuffer() {
   glGenTextures(1, &bf.tex);
   glBindTexture(GL_TEXTURE_2D, bf.tex);
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // We always sample 1:1, so there is no need for linear filtering.
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, texW, texH, 0, format, type, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bf.tex, 0);
 
   if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-    printf("Error: framebuffer not complete.\n");
+    printf("Error: framebuffer not complete (internal format: 0x%04X).\n", internalFormat);
     ::exit(EXIT_FAILURE);
   }
 
@@ -111,7 +404,10 @@ BackgroundFBO BackgroundBuffer::createBuffer() {
 
 void BackgroundBuffer::beginFrame() {
   GLenum drawbuffers[] = { GL_COLOR_ATTACHMENT0 } ;
-  glBindFramebuffer(GL_FRAMEBUFFER, buffers[index].fbo);
+  saveCallerState();
+  slot_tex[index] = buffers[index].tex;
+  ingest_tex = 0;
+  glBindFramebuffer(GL_FRAMEBUFFER, (capture.fbo) ? capture.fbo : buffers[index].fbo);
   glDrawBuffers(1, drawbuffers);
   glViewport(0,0,w,h);
   glClear(GL_COLOR_BUFFER_BIT); /* not 100% necessary */
@@ -119,32 +415,405 @@ void BackgroundBuffer::beginFrame() {
 }
 
 void BackgroundBuffer::endFrame() {
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glViewport(0, 0, win_w, win_h);
+
+  // Convert the captured RGBA frame into the history slot.
+  if(capture.fbo) {
+    GLenum drawbuffers[] = { GL_COLOR_ATTACHMENT0 } ;
+    glBindFramebuffer(GL_FRAMEBUFFER, buffers[index].fbo);
+    glDrawBuffers(1, drawbuffers);
+    glViewport(0, 0, w, slot_h);
+    glBindVertexArray(vao);
+    glUseProgram(convert_prog);
+    glUniform1i(u_convert_flip, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, capture.tex);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  finishFrame();
+}
+
+void BackgroundBuffer::finishFrame() {
+
+  if(bootstrap && 0 == frame_count) {
+    bootstrapHistory();
+  }
+
+  ++frame_count;
+  if(long_buffers.size() && 0 == (frame_count % long_interval)) {
+    updateLongHistory();
+  }
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, caller_draw_fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, caller_read_fbo);
+  glViewport(caller_viewport[0], caller_viewport[1], caller_viewport[2], caller_viewport[3]);
   ++index %= buffers.size();
 }
 
+void BackgroundBuffer::bootstrapHistory() {
+
+  for(size_t i = 0; i < buffers.size(); ++i) {
+    if(i != index) {
+      copyTexture(slot_tex[index], i);
+      slot_tex[i] = buffers[i].tex;
+    }
+  }
+
+  if(long_buffers.size()) {
+    for(size_t i = 0; i < long_buffers.size(); ++i) {
+      copyToLongHistory();
+    }
+    updateLongAverage();
+  }
+}
+
+void BackgroundBuffer::saveCallerState() {
+  glGetIntegerv(GL_VIEWPORT, caller_viewport);
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &caller_draw_fbo);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &caller_read_fbo);
+}
+
+void BackgroundBuffer::uploadFrame(const GLvoid* pixels) {
+
+  saveCallerState();
+  last_index = index;
+  slot_tex[index] = buffers[index].tex;
+  ingest_tex = 0;
+
+  // RGB565 slots are not color renderable everywhere, but we can always upload into them.
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, (capture.tex) ? capture.tex : buffers[index].tex);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+  endFrame();
+}
+
+bool BackgroundBuffer::addTexture(GLuint tex, int flags) {
+
+  if(!tex) {
+    printf("Error: cannot add texture 0 to the background buffer.\n");
+    return false;
+  }
+
+  GLint tex_w = 0;
+  GLint tex_h = 0;
+  GLint tex_fmt = 0;
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &tex_w);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &tex_h);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &tex_fmt);
+
+  bool is_same = (GLenum)tex_fmt == slot_format 
+    && tex_w == w 
+    && tex_h == slot_h 
+    && 0 == (flags & BG_INGEST_FLIP_Y);
+
+  if(!is_same && (tex_w != w || tex_h != h)) {
+    printf("Error: the texture (%dx%d) must be %dx%d to be converted into the background buffer.\n", tex_w, tex_h, w, h);
+    return false;
+  }
+
+  saveCallerState();
+  last_index = index;
+  slot_tex[index] = buffers[index].tex;
+
+  if(is_same && (flags & BG_INGEST_REFERENCE)) {
+    slot_tex[index] = tex;
+  }
+  else if(is_same) {
+    copyTexture(tex, index);
+  }
+  else {
+
+    if(!setupConvertShader()) {
+      printf("Error: cannot create the background buffer conversion shader.\n");
+      return false;
+    }
+
+    GLenum drawbuffers[] = { GL_COLOR_ATTACHMENT0 } ;
+    glBindFramebuffer(GL_FRAMEBUFFER, buffers[index].fbo);
+    glDrawBuffers(1, drawbuffers);
+    glViewport(0, 0, w, slot_h);
+    glBindVertexArray(vao);
+    glUseProgram(convert_prog);
+    glUniform1i(u_convert_flip, (flags & BG_INGEST_FLIP_Y) ? 1 : 0);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  ingest_tex = tex;
+  ingest_flags = flags;
+  ingest_is_luma = is_same && needsConversion();
+  finishFrame();
+
+  return true;
+}
+
+void BackgroundBuffer::copyTexture(GLuint src, size_t slot) {
+
+  if(GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_copy_image) {
+    glCopyImageSubData(src, GL_TEXTURE_2D, 0, 0, 0, 0, 
+                       buffers[slot].tex, GL_TEXTURE_2D, 0, 0, 0, 0, 
+                       w, slot_h, 1);
+    return;
+  }
+
+  if(!read_fbo) {
+    glGenFramebuffers(1, &read_fbo);
+  }
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, src, 0);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, buffers[slot].fbo);
+  glBlitFramebuffer(0, 0, w, slot_h, 0, 0, w, slot_h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
 GLuint BackgroundBuffer::apply() {
+  RenderGraph graph;
+  GLuint result = apply(graph);
+  graph.execute();
+  return result;
+}
 
-  GLenum drawbuffers[] = { GL_COLOR_ATTACHMENT0 } ;
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-  glDrawBuffers(1, drawbuffers);
-  glViewport(0, 0, w, h);
-  glBindVertexArray(vao);
-  glUseProgram(prog);
+GLuint BackgroundBuffer::apply(RenderGraph& graph) {
+
+  GLuint target_fbo = fbo;
+  GLuint target_tex = out_tex;
 
-  for(int i = 0; i < (int)buffers.size(); ++i) {
-    glActiveTexture(GL_TEXTURE0 + i);
+  if(graph.pool) {
+    RenderTarget* target = graph.pool->acquire(GL_R8, w, h);
+    if(!target) {
+      return 0;
+    }
+    target_fbo = target->fbo;
+    target_tex = target->tex;
+  }
+  else if(!setupOutput()) {
+    return 0;
+  }
+  else {
+    target_fbo = fbo;
+    target_tex = out_tex;
+  }
+
+  RenderPass& pass = graph.addDrawPass(TRACKER_STAGE_BACKGROUND, prog, vao, target_fbo, target_tex, w, h);
+
+  for(size_t i = 0; i < buffers.size(); ++i) {
+    pass.input(slot_tex[i]);
+  }
+
+  pass.input(slot_tex[last_index]);
+
+  if(long_buffers.size()) {
+    pass.input(long_avg.tex);
+  }
+
+  return target_tex;
+}
+
+bool BackgroundBuffer::setupOutput() {
+
+  if(out_tex) {
+    return true;
+  }
+
+  // We're called while the caller builds a graph; keep its framebuffers.
+  GLint prev_draw_fbo = 0;
+  GLint prev_read_fbo = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_draw_fbo);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
+
+  // The output only holds the segmented mask.
+  BackgroundFBO bg_fbo = createBuffer(GL_R8, w, h);
+  fbo = bg_fbo.fbo;
+  out_tex = bg_fbo.tex;
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prev_draw_fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_fbo);
+
+  return out_tex != 0;
+}
+
+size_t BackgroundBuffer::getNumBytes() {
+
+  size_t slot_bytes = (slot_format == GL_RGBA8) ? 4 : (slot_format == GL_RGB565) ? 2 : 1;
+  size_t nbytes = buffers.size() * slot_bytes * w * slot_h;
+
+  if(out_tex) {
+    nbytes += w * h;              /* output mask */
+  }
+
+  if(capture.tex) {
+    nbytes += w * h * 4;          /* capture buffer */
+  }
+
+  if(long_avg.tex) {
+    nbytes += long_buffers.size() * slot_bytes * w * slot_h;
+    nbytes += ((slot_format == GL_R8) ? 2 : 8) * w * slot_h;  /* 16 bit float average */
+  }
+
+  return nbytes;
+}
+
+void BackgroundBuffer::getPixelFormat(GLenum& format, GLenum& type, size_t& bytesPerPixel) {
+
+  format = GL_RGBA;
+  type = GL_UNSIGNED_BYTE;
+  bytesPerPixel = 4;
+
+  if(slot_format == GL_RGB565) {
+    format = GL_RGB;
+    type = GL_UNSIGNED_SHORT_5_6_5;
+    bytesPerPixel = 2;
+  }
+  else if(slot_format == GL_R8) {
+    format = GL_RED;
+    bytesPerPixel = 1;
+  }
+}
+
+void BackgroundBuffer::getSnapshotInfo(SnapshotHeader& hdr) {
+
+  GLenum format = 0;
+  GLenum type = 0;
+  size_t bpp = 0;
+  getPixelFormat(format, type, bpp);
+
+  hdr.width = w;
+  hdr.height = slot_h;
+  hdr.format = fmt;
+  hdr.num_slots = (uint32_t)buffers.size();
+  hdr.next_slot = (uint32_t)index;
+  hdr.num_long = (uint32_t)long_buffers.size();
+  hdr.long_index = (uint32_t)long_index;
+  hdr.long_count = (uint32_t)long_count;
+  hdr.slot_bytes = (uint64_t)bpp * w * slot_h;
+  hdr.frame_count = frame_count;
+}
+
+bool BackgroundBuffer::saveHistory(TrackerSnapshot& snap) {
+
+  if(!snap.file.isOpen() || !snap.file.is_writable) {
+    printf("Error: cannot save the history, the snapshot was not created.\n");
+    return false;
+  }
+
+  GLenum format = 0;
+  GLenum type = 0;
+  size_t bpp = 0;
+  GLint prev_pack_buffer = 0;
+  GLint prev_alignment = 0;
+  GLint prev_row_length = 0;
+  GLint prev_tex = 0;
+
+  getPixelFormat(format, type, bpp);
+
+  if(!snap.isCompatible(w, slot_h, fmt, (uint32_t)buffers.size(), (uint64_t)bpp * w * slot_h) || snap.header.num_long != long_buffers.size()) {
+    return false;
+  }
+
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &prev_pack_buffer);
+  glGetIntegerv(GL_PACK_ALIGNMENT, &prev_alignment);
+  glGetIntegerv(GL_PACK_ROW_LENGTH, &prev_row_length);
+  glActiveTexture(GL_TEXTURE0);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &prev_tex);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+  // The slots may reference textures added with BG_INGEST_REFERENCE; we store what we sample.
+  for(size_t i = 0; i < slot_tex.size(); ++i) {
+    glBindTexture(GL_TEXTURE_2D, slot_tex[i]);
+    glGetTexImage(GL_TEXTURE_2D, 0, format, type, snap.getHistoryPtr((uint32_t)i));
+  }
+
+  for(size_t i = 0; i < long_buffers.size(); ++i) {
+    glBindTexture(GL_TEXTURE_2D, long_buffers[i].tex);
+    glGetTexImage(GL_TEXTURE_2D, 0, format, type, snap.getLongHistoryPtr((uint32_t)i));
+  }
+
+  glBindTexture(GL_TEXTURE_2D, prev_tex);
+  glPixelStorei(GL_PACK_ALIGNMENT, prev_alignment);
+  glPixelStorei(GL_PACK_ROW_LENGTH, prev_row_length);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, prev_pack_buffer);
+
+  return true;
+}
+
+bool BackgroundBuffer::loadHistory(TrackerSnapshot& snap) {
+
+  if(!snap.file.isOpen()) {
+    printf("Error: cannot load the history, the snapshot is not open.\n");
+    return false;
+  }
+
+  GLenum format = 0;
+  GLenum type = 0;
+  size_t bpp = 0;
+  GLint prev_unpack_buffer = 0;
+  GLint prev_alignment = 0;
+  GLint prev_row_length = 0;
+  GLint prev_tex = 0;
+
+  getPixelFormat(format, type, bpp);
+
+  if(!snap.isCompatible(w, slot_h, fmt, (uint32_t)buffers.size(), (uint64_t)bpp * w * slot_h)) {
+    return false;
+  }
+
+  saveCallerState();
+
+  glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &prev_unpack_buffer);
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &prev_alignment);
+  glGetIntegerv(GL_UNPACK_ROW_LENGTH, &prev_row_length);
+  glActiveTexture(GL_TEXTURE0);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &prev_tex);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  for(size_t i = 0; i < buffers.size(); ++i) {
     glBindTexture(GL_TEXTURE_2D, buffers[i].tex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, slot_h, format, type, snap.getHistoryPtr((uint32_t)i));
+    slot_tex[i] = buffers[i].tex;
   }
 
-  glActiveTexture(GL_TEXTURE0 + buffers.size());
-  glBindTexture(GL_TEXTURE_2D, buffers[last_index].tex);
+  index = snap.header.next_slot;
+  last_index = (index + buffers.size() - 1) % buffers.size();
+  ingest_tex = 0;
+  frame_count = snap.header.frame_count;
 
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  // The long history is only restored when it has the same size; otherwise it starts empty.
+  long_index = 0;
+  long_count = 0;
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glViewport(0, 0, win_w, win_h);
+  if(long_buffers.size() && snap.header.num_long == long_buffers.size()) {
+    for(size_t i = 0; i < long_buffers.size(); ++i) {
+      glBindTexture(GL_TEXTURE_2D, long_buffers[i].tex);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, slot_h, format, type, snap.getLongHistoryPtr((uint32_t)i));
+    }
+    long_index = snap.header.long_index;
+    long_count = snap.header.long_count;
+    updateLongAverage();
+  }
+  else if(long_buffers.size() || snap.header.num_long) {
+    printf("Warning: the long history of %s has %u slots and ours %zu; we don't restore it.\n", 
+           snap.filepath.c_str(), snap.header.num_long, long_buffers.size());
+  }
+
+  glBindTexture(GL_TEXTURE_2D, prev_tex);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, prev_alignment);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, prev_row_length);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, prev_unpack_buffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, caller_draw_fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, caller_read_fbo);
+  glViewport(caller_viewport[0], caller_viewport[1], caller_viewport[2], caller_viewport[3]);
 
-  return out_tex;
+  return true;
 }
@@ -1,5 +1,7 @@
 #include <tracker/BlobTracker.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
 
 /* ---------------------------------------------------*/
 
@@ -9,12 +11,14 @@ Similarity::Similarity()
   ,value(0)
   ,area_dist_sq(0)
   ,pos_dist_sq(0)
+  ,appearance_dist(0.0f)
+  ,appearance_cost(0)
 {
 }
 
 void Similarity::update() {
   //value = 0.95 * pos_dist_sq + 0.05 * area_dist_sq;
-  value = pos_dist_sq;
+  value = pos_dist_sq + appearance_cost;
 }
 
 /* ---------------------------------------------------*/
@@ -24,6 +28,7 @@ Blob::Blob()
   ,area(0)
   ,age(0)
   ,matched(false)
+  ,frame_id(0)
 {
 }
 
@@ -70,21 +75,139 @@ BlobTracker::BlobTracker(int w, int h)
   :w(w)
   ,h(h)
   ,input_image(h, w, CV_8UC1, NULL, cv::Mat::AUTO_STEP)
+  ,timings(NULL)
+  ,last_id(0)
+  ,recorder(NULL)
+  ,label_scale(1)
+  ,track_interval(1)
+  ,max_blobs(0)
+  ,coverage(0.0f)
+  ,index(NULL)
+  ,zones(NULL)
+  ,appearance(NULL)
+  ,appearance_weight(500)
+  ,relink_radius(150)
+  ,relink_distance(0.25f)
+  ,num_relinked(0)
+  ,alloc_counter(NULL)
+  ,num_allocs_contours(0)
+  ,num_allocs_tracking(0)
 {
   input_image.create(h, w, CV_8UC1);
 }
 
 void BlobTracker::track() {
+  label();
+  match();
+}
+
+void BlobTracker::label() {
+
+  uint64_t allocs = countAllocs();
+
+  num_allocs_contours = 0;
+  num_allocs_tracking = 0;
+  arena.reset();
+
+  updateCoverage();
+
+  /* We don't clear the contours of a frame we track, so findContours() can reuse their capacity. */
+  if(isSkippedFrame()) {
+    contours.clear();
+    return;
+  }
 
-  contours.clear();
- 
+  /* findContours() may modify the input image, so record it first. */
+  if(recorder) {
+    recorder->record(input_image.data, (int)input_image.step, frame);
+  }
+
+  uint64_t contour_allocs = countAllocs();
+
+  if(timings) { timings->beginCpu(TRACKER_STAGE_CONTOURS); }
   updateContours();
+  if(timings) { timings->endCpu(TRACKER_STAGE_CONTOURS); }
+
+  num_allocs_contours = countAllocs() - contour_allocs;
+
+  if(timings) { timings->beginCpu(TRACKER_STAGE_BLOBS); }
   updateBlobs();
+  if(timings) { timings->endCpu(TRACKER_STAGE_BLOBS); }
+
+  num_allocs_tracking += countAllocs() - allocs - num_allocs_contours;
+}
+
+void BlobTracker::match() {
+
+  if(isSkippedFrame()) {
+    return;
+  }
+
+  uint64_t allocs = countAllocs();
+
+  if(timings) { timings->beginCpu(TRACKER_STAGE_MATCHING); }
   updateClusters();
+  if(timings) { timings->endCpu(TRACKER_STAGE_MATCHING); }
+
+  num_allocs_tracking += countAllocs() - allocs;
+}
+
+void BlobTracker::updateCoverage() {
+
+  int num_set = 0;
+  int num = 0;
+
+  for(int j = 0; j < h; j += 4) {
+    const unsigned char* row = input_image.ptr(j);
+    for(int i = 0; i < w; i += 4, ++num) {
+      num_set += (0 != row[i]);
+    }
+  }
+
+  coverage = (num) ? (float)num_set / num : 0.0f;
 }
 
 void BlobTracker::updateContours() {
- cv::findContours(input_image, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+  if(label_scale <= 1) {
+    cv::findContours(input_image, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    return;
+  }
+
+  // A pixel of the label image is set when one of the input pixels it covers is set, so thin blobs don't break up.
+  int s = label_scale;
+  int lw = (w + s - 1) / s;
+  int lh = (h + s - 1) / s;
+  if(label_image.rows != lh || label_image.cols != lw) {
+    label_image.create(lh, lw, CV_8UC1);
+  }
+
+  for(int j = 0; j < lh; ++j) {
+    unsigned char* dst = label_image.ptr(j);
+    memset(dst, 0, lw);
+    for(int k = j * s; k < (j + 1) * s && k < h; ++k) {
+      const unsigned char* src = input_image.ptr(k);
+      for(int i = 0, x = 0; i < lw; ++i) {
+        unsigned char v = dst[i];
+        for(int end = x + s; x < end && x < w; ++x) {
+          v |= src[x];
+        }
+        dst[i] = v;
+      }
+    }
+  }
+
+  cv::findContours(label_image, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+  // Back to input image coordinates; we use the center of the block.
+  int half = s / 2;
+  for(size_t i = 0; i < contours.size(); ++i) {
+    std::vector<cv::Point>& points = contours[i];
+    for(size_t j = 0; j < points.size(); ++j) {
+      points[j].x = points[j].x * s + half;
+      points[j].y = points[j].y * s + half;
+    }
+  }
 }
 
 void BlobTracker::updateBlobs() {
@@ -140,25 +263,48 @@ void BlobTracker::updateBlobs() {
       blob.area = area;
       blob.position.x = (x/points.size());
       blob.position.y = (y/points.size());
+      blob.frame_id = frame.id;
+
+      if(appearance && appearance->frame.id == frame.id) {
+        appearance->getDescriptor(min_x, min_y, max_x, max_y, blob.appearance);
+      }
+
       new_blobs.push_back(blob);
     }
   }
+
+  if(max_blobs > 0 && (int)new_blobs.size() > max_blobs) {
+    std::partial_sort(new_blobs.begin(), new_blobs.begin() + max_blobs, new_blobs.end(), BlobAreaSorter());
+    new_blobs.resize(max_blobs);
+  }
 }
 
 void BlobTracker::updateClusters() {
 
   similarities.clear();
 
+  if(zones) {
+    zones->beginFrame(frame);
+  }
+
   // unset all matched flags for this update
   for(size_t i = 0; i < blobs.size(); ++i) {
     blobs[i].matched = false;
   }
 
-  // update similarities
+  // update similarities; row i has the similarities of new_blobs[i] with all blobs.
+  // The number of pairs changes every frame; grow 2x so we don't reallocate each time it's a bit larger.
+  size_t num_old = blobs.size();
+  size_t num_sims = new_blobs.size() * num_old;
+  if(num_sims > similarities.capacity()) {
+    similarities.reserve(std::max(num_sims, 2 * similarities.capacity()));
+  }
+  similarities.resize(num_sims);
+
   for(size_t i = 0; i < new_blobs.size(); ++i) {
     Blob& new_blob = new_blobs[i];
 
-    for(size_t j  = 0; j < blobs.size(); ++j) {
+    for(size_t j  = 0; j < num_old; ++j) {
 
       Blob& old_blob = blobs[j];
       int64_t area_diff = old_blob.area - new_blob.area;
@@ -167,37 +313,37 @@ void BlobTracker::updateClusters() {
       int64_t dy = old_blob.position.y - new_blob.position.y;
       int64_t dp = (dx * dx) + (dy * dy);
 
-      Similarity sim;
+      Similarity& sim = similarities[i * num_old + j];
+      sim = Similarity();
       sim.new_dx = i;
       sim.old_dx = j;
       sim.area_dist_sq = (darea < 0) ? 0 : darea;
       sim.pos_dist_sq = (dp < 0) ? 0 : dp;
 
+      if(new_blob.appearance.num_pixels > 0.0f && old_blob.appearance.num_pixels > 0.0f) {
+        sim.appearance_dist = appearance_distance(new_blob.appearance, old_blob.appearance);
+        sim.appearance_cost = (int64_t)(sim.appearance_dist * appearance_weight);
+      }
+
       sim.update();
-      similarities[i].push_back(sim);
     }
   }
 
-  // Find matches between similarities
-  std::vector<size_t> matched_blobs; 
-  std::map<size_t, size_t> matched_with_indices;
+  // Find matches between similarities; matches[i] is the index of the blob that new_blobs[i] matched with, or -1.
+  int* matches = arena.allocate<int>(new_blobs.size());
+  for(size_t i = 0; i < new_blobs.size(); ++i) {
+    matches[i] = -1;
+  }
 
-  std::map<size_t, std::vector<Similarity> >::iterator it = similarities.begin();
-  while(it != similarities.end()) {
+  for(size_t i = 0; i < new_blobs.size() && num_old > 0; ++i) {
 
     // Sort similarities so the first one is the best match.
-    std::vector<Similarity>& sims = it->second;
-    std::sort(sims.begin(), sims.end(), SimilaritySorter());
+    Similarity* sims = &similarities[i * num_old];
+    std::sort(sims, sims + num_old, SimilaritySorter());
 
     // Find the best unmatched existing blob
-    for(size_t i = 0; i < sims.size(); ++i) {
-      Similarity& sim = sims[i];
-
-      // Check if the new blob already found a "partner"
-      std::vector<size_t>::iterator matched_it = std::find(matched_blobs.begin(), matched_blobs.end(), sim.new_dx);
-      if(matched_it != matched_blobs.end()) {
-        continue;
-      }
+    for(size_t k = 0; k < num_old; ++k) {
+      Similarity& sim = sims[k];
 
       // Check if the old blob was matched.
       Blob& old_blob = blobs[sim.old_dx];
@@ -206,37 +352,59 @@ void BlobTracker::updateClusters() {
       }
 
       //printf("Dist between: %ld and %ld is %lld\n", sim.new_dx, sim.old_dx, sim.value);
-      if(sim.value < 1000) {
+      if(sim.pos_dist_sq < 1000) {
         old_blob.matched = true;
-        matched_blobs.push_back(sim.new_dx);
-        matched_with_indices[sim.new_dx] = sim.old_dx;
+        matches[i] = (int)sim.old_dx;
       }
       break;
     }
-    ++it;
+  }
+
+  if(relink_distance > 0.0f) {
+    relinkBlobs(matches);
   }
 
   // Create new blobs for all unmatched ones.
-  std::vector<size_t> unmatched_blobs;
   for(size_t i = 0; i < new_blobs.size(); ++i) {
-  
-    std::vector<size_t>::iterator matched_it = std::find(matched_blobs.begin(), matched_blobs.end(), i);
 
-    if(matched_it == matched_blobs.end()) {
+    if(matches[i] < 0) {
 
       // not matched, created a new blob
+      new_blobs[i].id = ++last_id;
       blobs.push_back(new_blobs[i]);
+
+      // The trail grows to 55 points (+1 before we trim it); take the one of a removed blob or allocate it now so matching doesn't allocate later.
+      std::vector<cv::Point>& trail = blobs.back().trail;
+      if(spare_trails.size()) {
+        trail.swap(spare_trails.back());
+        trail.clear();
+        spare_trails.pop_back();
+      }
+      else {
+        trail.reserve(56);
+      }
+
+      if(zones) {
+        zones->appear(new_blobs[i].id, new_blobs[i].position.x, new_blobs[i].position.y);
+      }
     }
     else {
 
       // matched, increase age.
-      size_t old_dx = matched_with_indices[i];
+      size_t old_dx = matches[i];
       Blob& new_blob = new_blobs[i];
       Blob& old_blob = blobs[old_dx];
+
+      if(zones) {
+        zones->move(old_blob.id, old_blob.position.x, old_blob.position.y, new_blob.position.x, new_blob.position.y);
+      }
+
       old_blob.position = new_blob.position;
       old_blob.area = new_blob.area;
       old_blob.age++;
       old_blob.matched = true;
+      old_blob.frame_id = new_blob.frame_id;
+      old_blob.appearance.mix(new_blob.appearance, 0.1f);
 
       if(old_blob.age > 10) {
         old_blob.trail.push_back(old_blob.position);
@@ -261,6 +429,11 @@ void BlobTracker::updateClusters() {
     }
     
     if(b.age < -50) {
+      if(zones) {
+        zones->disappear(b.id, b.position.x, b.position.y);
+      }
+      spare_trails.push_back(std::vector<cv::Point>());
+      spare_trails.back().swap(b.trail);
       bit = blobs.erase(bit);
     }
     else {
@@ -268,6 +441,10 @@ void BlobTracker::updateClusters() {
     }
   }
 
+  if(index) {
+    updateIndex();
+  }
+
   // tmp print some info
 #if 0  
   for(size_t i = 0;i < blobs.size(); ++i) {
@@ -278,3 +455,78 @@ void BlobTracker::updateClusters() {
 #endif
 
 }
+
+// Gives the new blobs that didn't match by position the lost track that looks most like them.
+void BlobTracker::relinkBlobs(int* matches) {
+
+  int64_t max_dist_sq = (int64_t)relink_radius * relink_radius;
+
+  for(size_t i = 0; i < new_blobs.size(); ++i) {
+
+    Blob& new_blob = new_blobs[i];
+    if(new_blob.appearance.num_pixels <= 0.0f) {
+      continue;
+    }
+
+    if(matches[i] >= 0) {
+      continue;
+    }
+
+    int best_dx = -1;
+    float best_dist = relink_distance;
+
+    for(size_t j = 0; j < blobs.size(); ++j) {
+
+      Blob& old_blob = blobs[j];
+      if(old_blob.matched || old_blob.appearance.num_pixels <= 0.0f) {
+        continue;
+      }
+
+      int64_t dx = old_blob.position.x - new_blob.position.x;
+      int64_t dy = old_blob.position.y - new_blob.position.y;
+      if(dx * dx + dy * dy > max_dist_sq) {
+        continue;
+      }
+
+      float dist = appearance_distance(new_blob.appearance, old_blob.appearance);
+      if(dist < best_dist) {
+        best_dist = dist;
+        best_dx = (int)j;
+      }
+    }
+
+    if(best_dx < 0) {
+      continue;
+    }
+
+    blobs[best_dx].matched = true;
+    matches[i] = best_dx;
+    num_relinked++;
+  }
+}
+
+void BlobTracker::updateIndex() {
+
+  index_samples.clear();
+
+  for(size_t i = 0; i < blobs.size(); ++i) {
+
+    Blob& b = blobs[i];
+    if(b.frame_id != frame.id) {
+      continue;
+    }
+
+    TrackSample s;
+    s.id = b.id;
+    s.area = b.area;
+    s.x = b.position.x;
+    s.y = b.position.y;
+    s.frame_id = frame.id;
+    s.time_ns = frame.capture_ns;
+    index_samples.push_back(s);
+  }
+
+  if(!index_samples.empty()) {
+    index->insert(&index_samples[0], index_samples.size());
+  }
+}
@@ -7,14 +7,13 @@
 Blur::Blur(int w, int h)
   :w(w)
   ,h(h)
+  ,fbo_scene(0)
+  ,tex_scene(0)
   ,fbo_x(0)
   ,fbo_y(0)
   ,vao(0)
   ,prog_x(0)
   ,prog_y(0)
-  ,vert(0)
-  ,frag_x(0)
-  ,frag_y(0)
   ,tex_x(0)
   ,tex_y(0)
   ,depth(0)
@@ -23,6 +22,7 @@ Blur::Blur(int w, int h)
   ,blur_amount(0)
   ,num_fetches(0)
   ,sample_size(0)
+  ,target_format(GL_RGBA8)
 {
 }
  
@@ -47,11 +47,8 @@ bool Blur::setup(float blurAmount, int texFetches, int sampleSize) {
 
   glGenVertexArrays(1, &vao);
  
-  if(!setupFBO()) {
-    shutdown();
-    return false;
-  }
- 
+  // The FBOs are created on first use; when you blur into the targets of a 
+  // RenderTargetPool we don't need them at all.
   if(!setupShader()) {
     shutdown();
     return false;
@@ -60,7 +57,16 @@ bool Blur::setup(float blurAmount, int texFetches, int sampleSize) {
   return true;
 }
  
-bool Blur::setupFBO() { 
+bool Blur::setupSceneFBO() { 
+
+  if(fbo_scene) {
+    return true;
+  }
+
+  GLint prev_draw_fbo = 0;
+  GLint prev_read_fbo = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_draw_fbo);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
 
   // FBO - scene capture
   // ----------------------------------------------------------
@@ -93,6 +99,23 @@ bool Blur::setupFBO() {
     glDrawBuffers(1, drawbufs);
   }
 
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prev_draw_fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_fbo);
+
+  return true;
+}
+
+bool Blur::setupFBO() { 
+
+  if(fbo_x) {
+    return true;
+  }
+
+  GLint prev_draw_fbo = 0;
+  GLint prev_read_fbo = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_draw_fbo);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
+
   // FBO x-blur
   // ----------------------------------------------------------
   glGenFramebuffers(1, &fbo_x);
@@ -145,7 +168,8 @@ bool Blur::setupFBO() {
     glDrawBuffers(1, drawbufs);
   }
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prev_draw_fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_fbo);
 
   return true;
 }
@@ -211,17 +235,10 @@ bool Blur::setupShader() {
   const char* xblur_vss = xblur_s.c_str();
 
   // x-blur
-  vert = rx_create_shader(GL_VERTEX_SHADER, B_VS);
-  frag_x = rx_create_shader(GL_FRAGMENT_SHADER, xblur_vss);
-  prog_x = rx_create_program(vert, frag_x);
-  glLinkProgram(prog_x);
-  rx_print_shader_link_info(prog_x);
+  prog_x = tracker_program_cache().createProgram(B_VS, xblur_vss);
  
   // y-blur
-  frag_y = rx_create_shader(GL_FRAGMENT_SHADER, yblur_vss);
-  prog_y = rx_create_program(vert, frag_y);
-  glLinkProgram(prog_y);
-  rx_print_shader_link_info(prog_y);
+  prog_y = tracker_program_cache().createProgram(B_VS, yblur_vss);
  
   GLint u_scene_tex = 0;
  
@@ -249,6 +266,7 @@ bool Blur::setupShader() {
 }
  
 void Blur::begin() {
+  setupSceneFBO();
   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo_scene);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0,0,w, h);
@@ -260,6 +278,7 @@ void Blur::end() {
 }
 
 void Blur::blit() {
+  setupSceneFBO();
   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo_scene);
   glViewport(0,0, w, h);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -272,47 +291,69 @@ GLuint Blur::blur() {
 
 // returns the blurred tex
 GLuint Blur::blur(int tex) {
-  assert(fbo_x);
-  assert(fbo_y);
 
-  glViewport(0, 0, w, h); 
-  glBindVertexArray(vao);
+  if(tex < 0 && !setupSceneFBO()) {
+    return 0;
+  }
+
+  RenderGraph graph;
+  GLuint out_tex = blur(graph, (tex >= 0) ? tex : tex_scene);
+  graph.execute();
+  return out_tex;
+}
 
+GLuint Blur::blur(RenderGraph& graph, GLuint tex) {
 
-  // x-blur 
-  {
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo_x);
-    glActiveTexture(GL_TEXTURE0);
+  GLuint x_fbo = fbo_x;
+  GLuint x_tex = tex_x;
+  GLuint y_fbo = fbo_y;
+  GLuint y_tex = tex_y;
 
-    if(tex >= 0) {
-      glBindTexture(GL_TEXTURE_2D, tex);
+  if(graph.pool) {
+    RenderTarget* target_x = graph.pool->acquire(target_format, w, h);
+    if(!target_x) {
+      return 0;
     }
-    else {
-      glBindTexture(GL_TEXTURE_2D, tex_scene);
+    x_fbo = target_x->fbo;
+    x_tex = target_x->tex;
+  }
+  else if(!setupFBO()) {
+    return 0;
+  }
+  else {
+    x_fbo = fbo_x;
+    x_tex = tex_x;
+    y_fbo = fbo_y;
+    y_tex = tex_y;
+  }
+
+  // x-blur 
+  RenderPass& pass_x = graph.addDrawPass(TRACKER_STAGE_BLUR, prog_x, vao, x_fbo, x_tex, w, h);
+  pass_x.input(tex);
+
+  if(graph.pool) {
+    graph.pool->release(tex);
+    RenderTarget* target_y = graph.pool->acquire(target_format, w, h);
+    if(!target_y) {
+      return 0;
     }
- 
-    glUseProgram(prog_x);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    y_fbo = target_y->fbo;
+    y_tex = target_y->tex;
   }
 
   // y-blur
-  {
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo_y);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex_x);
- 
-    glUseProgram(prog_y);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-  }
+  RenderPass& pass_y = graph.addDrawPass(TRACKER_STAGE_BLUR, prog_y, vao, y_fbo, y_tex, w, h);
+  pass_y.input(x_tex);
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glViewport(0, 0, win_w, win_h);
+  if(graph.pool) {
+    graph.pool->release(x_tex);
+  }
 
-  return tex_y;
+  return y_tex;
 }
  
 void Blur::setAsReadBuffer() {
-  assert(fbo_x);
+  assert(fbo_y);
  
   glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo_y);
   glReadBuffer(GL_COLOR_ATTACHMENT0);
@@ -340,6 +381,16 @@ void Blur::shutdown() {
     glDeleteFramebuffers(1, &fbo_scene);
   }
   fbo_scene = 0;
+
+  if(tex_scene) {
+    glDeleteTextures(1, &tex_scene);
+  }
+  tex_scene = 0;
+
+  if(depth) {
+    glDeleteRenderbuffers(1, &depth);
+  }
+  depth = 0;
  
   if(vao) {
     glDeleteVertexArrays(1, &vao);
@@ -356,21 +407,6 @@ void Blur::shutdown() {
   }
   prog_y = 0;
  
-  if(vert) {
-    glDeleteShader(vert);
-  }
-  vert = 0;
- 
-  if(frag_x) {
-    glDeleteShader(frag_x);
-  }
-  frag_x = 0;
- 
-  if(frag_y) {
-    glDeleteShader(frag_y);
-  }
-  frag_y = 0;
- 
   if(tex_x) {
     glDeleteTextures(1, &tex_x);
   }
@@ -387,6 +423,22 @@ void Blur::shutdown() {
   num_fetches = 0;
 }
 
+size_t Blur::getNumBytes() {
+
+  size_t nbytes = 0;
+
+  if(tex_scene) {
+    nbytes += w * h * 4;          /* scene */
+    nbytes += w * h * 4;          /* depth, assuming 24 bit + padding */
+  }
+
+  if(tex_x) {
+    nbytes += 2 * w * h * 4;      /* x and y */
+  }
+
+  return nbytes;
+}
+
 void Blur::print() {
 
   printf("blur.tex_scene: %d\n", tex_scene);
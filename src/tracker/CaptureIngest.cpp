@@ -0,0 +1,91 @@
+#include <tracker/CaptureIngest.h>
+#include <tracker/Tracker.h>
+#include <string.h>
+
+CaptureIngest::CaptureIngest(int w, int h)
+  :w(w)
+  ,h(h)
+  ,pbo_index(0)
+  ,num_uploaded(0)
+{
+  memset(pbos, 0, sizeof(pbos));
+}
+
+CaptureIngest::~CaptureIngest() {
+  shutdown();
+}
+
+bool CaptureIngest::setup(int numSlots, int policy) {
+
+  if(pbos[0]) {
+    printf("Error: the CaptureIngest is already setup; call shutdown() first.\n");
+    return false;
+  }
+
+  size_t frame_size = (size_t)w * h * 4;
+  if(!queue.setup(frame_size, numSlots, policy)) {
+    return false;
+  }
+
+  glGenBuffers(CAPTURE_INGEST_NUM_PBOS, pbos);
+  for(int i = 0; i < CAPTURE_INGEST_NUM_PBOS; ++i) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_size, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  pbo_index = 0;
+  num_uploaded = 0;
+
+  return true;
+}
+
+bool CaptureIngest::update(Tracker& tracker) {
+
+  if(!pbos[0]) {
+    return false;
+  }
+
+  FrameQueueSlot* slot = queue.beginRead();
+  if(!slot) {
+    return false;
+  }
+
+  /* Invalidating the buffer lets the driver give us fresh memory when the GPU still reads the old contents. */
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[pbo_index]);
+  unsigned char* ptr = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, queue.frame_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if(!ptr) {
+    printf("Error: cannot map the pixel unpack buffer.\n");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    queue.endRead();
+    return false;
+  }
+
+  size_t stride = (size_t)w * 4;
+  for(int j = 0; j < h; ++j) {
+    memcpy(ptr + (h - 1 - j) * stride, slot->data + j * stride, stride);
+  }
+
+  uint64_t capture_ns = slot->capture_ns;
+  queue.endRead();
+
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  tracker.uploadFrame((const GLvoid*)0, capture_ns);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  pbo_index = (pbo_index + 1) % CAPTURE_INGEST_NUM_PBOS;
+  num_uploaded++;
+
+  return true;
+}
+
+void CaptureIngest::shutdown() {
+
+  if(pbos[0]) {
+    glDeleteBuffers(CAPTURE_INGEST_NUM_PBOS, pbos);
+    memset(pbos, 0, sizeof(pbos));
+  }
+
+  queue.shutdown();
+  num_uploaded = 0;
+}
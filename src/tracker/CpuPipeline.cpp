@@ -0,0 +1,554 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tracker/CpuPipeline.h>
+
+#if !defined(TRACKER_CPU_NO_SIMD)
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define CPU_USE_SSE2
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    include <arm_neon.h>
+#    define CPU_USE_NEON
+#  endif
+#endif
+
+/* 0.299, 0.587, 0.114 in 1.15 fixed point, like the luma() of the convert shader. */
+#define CPU_LUMA_R 9798
+#define CPU_LUMA_G 19235
+#define CPU_LUMA_B 3735
+
+static void cpu_morph(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1, int minCount);
+static void cpu_blur_row(const unsigned char** a, const unsigned char** b, const int32_t* weights, int num, unsigned char* dst, int w);
+
+/* ---------------------------------------------------*/
+
+void cpu_luma(const unsigned char* src, int srcStride, int channels, unsigned char* dst, int w, int, int y0, int y1) {
+
+  for(int j = y0; j < y1; ++j) {
+    const unsigned char* s = src + j * srcStride;
+    unsigned char* d = dst + j * w;
+    int i = 0;
+
+    if(1 == channels) {
+      memcpy(d, s, w);
+      continue;
+    }
+
+#if defined(CPU_USE_SSE2)
+    if(4 == channels) {
+      const __m128i weights = _mm_setr_epi16(CPU_LUMA_R, CPU_LUMA_G, CPU_LUMA_B, 0, CPU_LUMA_R, CPU_LUMA_G, CPU_LUMA_B, 0);
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i half = _mm_set1_epi32(1 << 14);
+      __m128i px[4];
+      for(; i + 16 <= w; i += 16) {
+        for(int k = 0; k < 4; ++k) {
+          __m128i q = _mm_loadu_si128((const __m128i*)(s + (i + k * 4) * 4));
+          __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(q, zero), weights);     /* r0 + g0, b0, r1 + g1, b1 */
+          __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(q, zero), weights);
+          lo = _mm_shuffle_epi32(_mm_add_epi32(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+          hi = _mm_shuffle_epi32(_mm_add_epi32(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+          px[k] = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi64(lo, hi), half), 15);
+        }
+        __m128i out = _mm_packus_epi16(_mm_packs_epi32(px[0], px[1]), _mm_packs_epi32(px[2], px[3]));
+        _mm_storeu_si128((__m128i*)(d + i), out);
+      }
+    }
+#elif defined(CPU_USE_NEON)
+    if(3 == channels || 4 == channels) {
+      for(; i + 16 <= w; i += 16) {
+        uint8x16_t r, g, b;
+        if(4 == channels) {
+          uint8x16x4_t px = vld4q_u8(s + i * 4);
+          r = px.val[0]; g = px.val[1]; b = px.val[2];
+        }
+        else {
+          uint8x16x3_t px = vld3q_u8(s + i * 3);
+          r = px.val[0]; g = px.val[1]; b = px.val[2];
+        }
+        uint16x8_t r_lo = vmovl_u8(vget_low_u8(r)), r_hi = vmovl_u8(vget_high_u8(r));
+        uint16x8_t g_lo = vmovl_u8(vget_low_u8(g)), g_hi = vmovl_u8(vget_high_u8(g));
+        uint16x8_t b_lo = vmovl_u8(vget_low_u8(b)), b_hi = vmovl_u8(vget_high_u8(b));
+        uint32x4_t acc[4];
+        acc[0] = vmull_n_u16(vget_low_u16(r_lo), CPU_LUMA_R);
+        acc[1] = vmull_n_u16(vget_high_u16(r_lo), CPU_LUMA_R);
+        acc[2] = vmull_n_u16(vget_low_u16(r_hi), CPU_LUMA_R);
+        acc[3] = vmull_n_u16(vget_high_u16(r_hi), CPU_LUMA_R);
+        acc[0] = vmlal_n_u16(acc[0], vget_low_u16(g_lo), CPU_LUMA_G);
+        acc[1] = vmlal_n_u16(acc[1], vget_high_u16(g_lo), CPU_LUMA_G);
+        acc[2] = vmlal_n_u16(acc[2], vget_low_u16(g_hi), CPU_LUMA_G);
+        acc[3] = vmlal_n_u16(acc[3], vget_high_u16(g_hi), CPU_LUMA_G);
+        acc[0] = vmlal_n_u16(acc[0], vget_low_u16(b_lo), CPU_LUMA_B);
+        acc[1] = vmlal_n_u16(acc[1], vget_high_u16(b_lo), CPU_LUMA_B);
+        acc[2] = vmlal_n_u16(acc[2], vget_low_u16(b_hi), CPU_LUMA_B);
+        acc[3] = vmlal_n_u16(acc[3], vget_high_u16(b_hi), CPU_LUMA_B);
+        uint16x8_t lo = vcombine_u16(vrshrn_n_u32(acc[0], 15), vrshrn_n_u32(acc[1], 15));
+        uint16x8_t hi = vcombine_u16(vrshrn_n_u32(acc[2], 15), vrshrn_n_u32(acc[3], 15));
+        vst1q_u8(d + i, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+      }
+    }
+#endif
+
+    for(s += i * channels; i < w; ++i, s += channels) {
+      d[i] = (unsigned char)((CPU_LUMA_R * s[0] + CPU_LUMA_G * s[1] + CPU_LUMA_B * s[2] + (1 << 14)) >> 15);
+    }
+  }
+}
+
+void cpu_history_add(const unsigned char* luma, unsigned char* slot, uint16_t* sum, int w, int, int y0, int y1) {
+
+  int n = (y1 - y0) * w;
+  int i = 0;
+
+  luma += y0 * w;
+  slot += y0 * w;
+  sum += y0 * w;
+
+#if defined(CPU_USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for(; i + 16 <= n; i += 16) {
+    __m128i l = _mm_loadu_si128((const __m128i*)(luma + i));
+    __m128i o = _mm_loadu_si128((const __m128i*)(slot + i));
+    __m128i s_lo = _mm_loadu_si128((const __m128i*)(sum + i));
+    __m128i s_hi = _mm_loadu_si128((const __m128i*)(sum + i + 8));
+    s_lo = _mm_add_epi16(_mm_sub_epi16(s_lo, _mm_unpacklo_epi8(o, zero)), _mm_unpacklo_epi8(l, zero));
+    s_hi = _mm_add_epi16(_mm_sub_epi16(s_hi, _mm_unpackhi_epi8(o, zero)), _mm_unpackhi_epi8(l, zero));
+    _mm_storeu_si128((__m128i*)(sum + i), s_lo);
+    _mm_storeu_si128((__m128i*)(sum + i + 8), s_hi);
+    _mm_storeu_si128((__m128i*)(slot + i), l);
+  }
+#elif defined(CPU_USE_NEON)
+  for(; i + 16 <= n; i += 16) {
+    uint8x16_t l = vld1q_u8(luma + i);
+    uint8x16_t o = vld1q_u8(slot + i);
+    uint16x8_t s_lo = vld1q_u16(sum + i);
+    uint16x8_t s_hi = vld1q_u16(sum + i + 8);
+    s_lo = vaddw_u8(vsubw_u8(s_lo, vget_low_u8(o)), vget_low_u8(l));
+    s_hi = vaddw_u8(vsubw_u8(s_hi, vget_high_u8(o)), vget_high_u8(l));
+    vst1q_u16(sum + i, s_lo);
+    vst1q_u16(sum + i + 8, s_hi);
+    vst1q_u8(slot + i, l);
+  }
+#endif
+
+  for(; i < n; ++i) {
+    sum[i] = sum[i] - slot[i] + luma[i];
+    slot[i] = luma[i];
+  }
+}
+
+void cpu_history_fill(const unsigned char* luma, unsigned char* history, int num, uint16_t* sum, int w, int h, int y0, int y1) {
+
+  size_t offset = (size_t)y0 * w;
+  size_t n = (size_t)(y1 - y0) * w;
+
+  for(int k = 0; k < num; ++k) {
+    memcpy(history + (size_t)k * w * h + offset, luma + offset, n);
+  }
+
+  for(size_t i = offset; i < offset + n; ++i) {
+    sum[i] = (uint16_t)(num * luma[i]);
+  }
+}
+
+void cpu_background_subtract(const unsigned char* luma, const uint16_t* sum, int num, unsigned char* dst, int dstStride, int w, int, int y0, int y1) {
+
+  // |luma - sum / num| > 0.06 * 255  <=>  |num * luma - sum| > 15.3 * num; both sides are integers.
+  int limit = (153 * num) / 10;
+
+  for(int j = y0; j < y1; ++j) {
+    const unsigned char* l = luma + j * w;
+    const uint16_t* s = sum + j * w;
+    unsigned char* d = dst + j * dstStride;
+    int i = 0;
+
+#if defined(CPU_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i n = _mm_set1_epi16((short)num);
+    const __m128i lim = _mm_set1_epi16((short)limit);
+    for(; i + 16 <= w; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(l + i));
+      __m128i a_lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), n);
+      __m128i a_hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), n);
+      __m128i s_lo = _mm_loadu_si128((const __m128i*)(s + i));
+      __m128i s_hi = _mm_loadu_si128((const __m128i*)(s + i + 8));
+      __m128i d_lo = _mm_or_si128(_mm_subs_epu16(a_lo, s_lo), _mm_subs_epu16(s_lo, a_lo));
+      __m128i d_hi = _mm_or_si128(_mm_subs_epu16(a_hi, s_hi), _mm_subs_epu16(s_hi, a_hi));
+      __m128i m_lo = _mm_cmpeq_epi16(_mm_subs_epu16(d_lo, lim), zero);                    /* 0xFFFF where diff <= limit */
+      __m128i m_hi = _mm_cmpeq_epi16(_mm_subs_epu16(d_hi, lim), zero);
+      __m128i m = _mm_packs_epi16(m_lo, m_hi);
+      _mm_storeu_si128((__m128i*)(d + i), _mm_andnot_si128(m, _mm_set1_epi8((char)0xFF)));
+    }
+#elif defined(CPU_USE_NEON)
+    const uint16x8_t lim = vdupq_n_u16((uint16_t)limit);
+    for(; i + 16 <= w; i += 16) {
+      uint8x16_t v = vld1q_u8(l + i);
+      uint16x8_t a_lo = vmulq_n_u16(vmovl_u8(vget_low_u8(v)), (uint16_t)num);
+      uint16x8_t a_hi = vmulq_n_u16(vmovl_u8(vget_high_u8(v)), (uint16_t)num);
+      uint16x8_t m_lo = vcgtq_u16(vabdq_u16(a_lo, vld1q_u16(s + i)), lim);
+      uint16x8_t m_hi = vcgtq_u16(vabdq_u16(a_hi, vld1q_u16(s + i + 8)), lim);
+      vst1q_u8(d + i, vcombine_u8(vmovn_u16(m_lo), vmovn_u16(m_hi)));
+    }
+#endif
+
+    for(; i < w; ++i) {
+      int diff = num * l[i] - s[i];
+      if(diff < 0) {
+        diff = -diff;
+      }
+      d[i] = (diff > limit) ? 255 : 0;
+    }
+  }
+}
+
+void cpu_erode(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1) {
+  cpu_morph(src, srcStride, dst, dstStride, w, h, y0, y1, 3);
+}
+
+void cpu_dilate(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1) {
+  cpu_morph(src, srcStride, dst, dstStride, w, h, y0, y1, 1);
+}
+
+void cpu_blur_x(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int, int y0, int y1, const int32_t* weights, int num, unsigned char* padded) {
+
+  /* We copy each row into `padded` with the edges repeated, like GL_CLAMP_TO_EDGE. */
+  int pad = num - 1;
+  const unsigned char* a[CPU_BLUR_MAX_TAPS];
+  const unsigned char* b[CPU_BLUR_MAX_TAPS];
+
+  for(int k = 0; k < num; ++k) {
+    a[k] = &padded[pad - k];
+    b[k] = &padded[pad + k];
+  }
+
+  for(int j = y0; j < y1; ++j) {
+    const unsigned char* s = src + j * srcStride;
+    memset(&padded[0], s[0], pad);
+    memcpy(&padded[pad], s, w);
+    memset(&padded[pad + w], s[w - 1], pad);
+    cpu_blur_row(a, b, weights, num, dst + j * dstStride, w);
+  }
+}
+
+void cpu_blur_y(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1, const int32_t* weights, int num) {
+
+  const unsigned char* a[CPU_BLUR_MAX_TAPS];
+  const unsigned char* b[CPU_BLUR_MAX_TAPS];
+
+  for(int j = y0; j < y1; ++j) {
+    for(int k = 0; k < num; ++k) {
+      a[k] = src + ((j - k < 0) ? 0 : j - k) * srcStride;
+      b[k] = src + ((j + k >= h) ? h - 1 : j + k) * srcStride;
+    }
+    cpu_blur_row(a, b, weights, num, dst + j * dstStride, w);
+  }
+}
+
+void cpu_threshold(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int, int y0, int y1) {
+
+  for(int j = y0; j < y1; ++j) {
+    const unsigned char* s = src + j * srcStride;
+    unsigned char* d = dst + j * dstStride;
+    int i = 0;
+
+#if defined(CPU_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= w; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+      _mm_storeu_si128((__m128i*)(d + i), _mm_cmplt_epi8(v, zero));          /* > 127 is negative as signed byte */
+    }
+#elif defined(CPU_USE_NEON)
+    const uint8x16_t lim = vdupq_n_u8(127);
+    for(; i + 16 <= w; i += 16) {
+      vst1q_u8(d + i, vcgtq_u8(vld1q_u8(s + i), lim));
+    }
+#endif
+
+    for(; i < w; ++i) {
+      d[i] = (s[i] > 127) ? 255 : 0;
+    }
+  }
+}
+
+bool cpu_blur_weights(float blurAmount, int taps, std::vector<int32_t>& weights) {
+
+  if(taps < 1 || taps > CPU_BLUR_MAX_TAPS) {
+    printf("Error: the number of blur taps must be in [1, %d], we got: %d\n", CPU_BLUR_MAX_TAPS, taps);
+    return false;
+  }
+
+  // Same (normalized) weights as Blur::setupShader()
+  std::vector<double> g(taps, 0.0);
+  double sum = 0.0;
+  for(int i = 0; i < taps; ++i) {
+    g[i] = exp(-(i * i) / (2.0 * blurAmount));
+    sum += (i == 0) ? g[i] : 2.0 * g[i];
+  }
+
+  weights.assign(taps, 0);
+  for(int i = 0; i < taps; ++i) {
+    weights[i] = (int32_t)(65536.0 * g[i] / sum + 0.5);
+  }
+
+  return true;
+}
+
+/* 
+   Counts the set pixels at the 6 offsets of the erode/dilate shaders: 
+   (-1,-1), (0,-1), (1,1), (1,0), (-1,0), (0,1), clamped to the edges.
+*/
+static void cpu_morph(const unsigned char* src, int srcStride, unsigned char* dst, int dstStride, int w, int h, int y0, int y1, int minCount) {
+
+  for(int j = y0; j < y1; ++j) {
+    const unsigned char* up = src + (j > 0 ? j - 1 : 0) * srcStride;
+    const unsigned char* row = src + j * srcStride;
+    const unsigned char* down = src + (j < h - 1 ? j + 1 : h - 1) * srcStride;
+    unsigned char* d = dst + j * dstStride;
+    int i = 0;
+
+    /* The vector loops handle the columns that don't need clamping. */
+#if defined(CPU_USE_SSE2)
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i min_count = _mm_set1_epi8((char)(minCount - 1));
+    if(w > 17) {
+      for(i = 1; i + 17 <= w; i += 16) {
+        __m128i c = _mm_min_epu8(_mm_loadu_si128((const __m128i*)(up + i - 1)), one);
+        c = _mm_add_epi8(c, _mm_min_epu8(_mm_loadu_si128((const __m128i*)(up + i)), one));
+        c = _mm_add_epi8(c, _mm_min_epu8(_mm_loadu_si128((const __m128i*)(down + i + 1)), one));
+        c = _mm_add_epi8(c, _mm_min_epu8(_mm_loadu_si128((const __m128i*)(row + i + 1)), one));
+        c = _mm_add_epi8(c, _mm_min_epu8(_mm_loadu_si128((const __m128i*)(row + i - 1)), one));
+        c = _mm_add_epi8(c, _mm_min_epu8(_mm_loadu_si128((const __m128i*)(down + i)), one));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_cmpgt_epi8(c, min_count));
+      }
+    }
+#elif defined(CPU_USE_NEON)
+    const uint8x16_t one = vdupq_n_u8(1);
+    const uint8x16_t min_count = vdupq_n_u8((uint8_t)(minCount - 1));
+    if(w > 17) {
+      for(i = 1; i + 17 <= w; i += 16) {
+        uint8x16_t c = vminq_u8(vld1q_u8(up + i - 1), one);
+        c = vaddq_u8(c, vminq_u8(vld1q_u8(up + i), one));
+        c = vaddq_u8(c, vminq_u8(vld1q_u8(down + i + 1), one));
+        c = vaddq_u8(c, vminq_u8(vld1q_u8(row + i + 1), one));
+        c = vaddq_u8(c, vminq_u8(vld1q_u8(row + i - 1), one));
+        c = vaddq_u8(c, vminq_u8(vld1q_u8(down + i), one));
+        vst1q_u8(d + i, vcgtq_u8(c, min_count));
+      }
+    }
+#endif
+
+    /* The first column and what's left of the row. */
+    for(int k = 0; k < 2; ++k) {
+      int start = (0 == k) ? 0 : i;
+      int end = (0 == k) ? ((i > 0) ? 1 : 0) : w;
+      for(int x = start; x < end; ++x) {
+        int l = (x > 0) ? x - 1 : 0;
+        int r = (x < w - 1) ? x + 1 : w - 1;
+        int count = (up[l] != 0) + (up[x] != 0) + (down[r] != 0) + (row[r] != 0) + (row[l] != 0) + (down[x] != 0);
+        d[x] = (count >= minCount) ? 255 : 0;
+      }
+    }
+  }
+}
+
+/* 
+   dst[i] = weights[0] * a[0][i] + sum(weights[k] * (a[k][i] + b[k][i])), in 16.16 fixed 
+   point and rounded. `a[0]` is the center; `b[0]` is not used.
+*/
+static void cpu_blur_row(const unsigned char** a, const unsigned char** b, const int32_t* weights, int num, unsigned char* dst, int w) {
+
+  int i = 0;
+
+#if defined(CPU_USE_SSE2)
+  /* _mm_madd_epi16() multiplies with signed 16 bit weights: two taps per multiply. */
+  if(weights[0] < 32768) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << 15);
+    for(; i + 16 <= w; i += 16) {
+      __m128i acc[4] = { half, half, half, half };
+      for(int k = 0; k < num; k += 2) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(a[k] + i));
+        __m128i v0_lo = _mm_unpacklo_epi8(v0, zero);
+        __m128i v0_hi = _mm_unpackhi_epi8(v0, zero);
+        if(k > 0) {
+          __m128i t = _mm_loadu_si128((const __m128i*)(b[k] + i));
+          v0_lo = _mm_add_epi16(v0_lo, _mm_unpacklo_epi8(t, zero));
+          v0_hi = _mm_add_epi16(v0_hi, _mm_unpackhi_epi8(t, zero));
+        }
+        __m128i v1_lo = zero;
+        __m128i v1_hi = zero;
+        int32_t w1 = 0;
+        if(k + 1 < num) {
+          __m128i s0 = _mm_loadu_si128((const __m128i*)(a[k + 1] + i));
+          __m128i s1 = _mm_loadu_si128((const __m128i*)(b[k + 1] + i));
+          v1_lo = _mm_add_epi16(_mm_unpacklo_epi8(s0, zero), _mm_unpacklo_epi8(s1, zero));
+          v1_hi = _mm_add_epi16(_mm_unpackhi_epi8(s0, zero), _mm_unpackhi_epi8(s1, zero));
+          w1 = weights[k + 1];
+        }
+        __m128i wk = _mm_set1_epi32((w1 << 16) | (weights[k] & 0xFFFF));
+        acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi16(v0_lo, v1_lo), wk));
+        acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi16(v0_lo, v1_lo), wk));
+        acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi16(v0_hi, v1_hi), wk));
+        acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi16(v0_hi, v1_hi), wk));
+      }
+      __m128i lo = _mm_packs_epi32(_mm_srai_epi32(acc[0], 16), _mm_srai_epi32(acc[1], 16));
+      __m128i hi = _mm_packs_epi32(_mm_srai_epi32(acc[2], 16), _mm_srai_epi32(acc[3], 16));
+      _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+  }
+#elif defined(CPU_USE_NEON)
+  if(weights[0] < 65536) {
+    for(; i + 16 <= w; i += 16) {
+      uint8x16_t c = vld1q_u8(a[0] + i);
+      uint16x8_t c_lo = vmovl_u8(vget_low_u8(c));
+      uint16x8_t c_hi = vmovl_u8(vget_high_u8(c));
+      uint32x4_t acc[4];
+      acc[0] = vmull_n_u16(vget_low_u16(c_lo), (uint16_t)weights[0]);
+      acc[1] = vmull_n_u16(vget_high_u16(c_lo), (uint16_t)weights[0]);
+      acc[2] = vmull_n_u16(vget_low_u16(c_hi), (uint16_t)weights[0]);
+      acc[3] = vmull_n_u16(vget_high_u16(c_hi), (uint16_t)weights[0]);
+      for(int k = 1; k < num; ++k) {
+        uint8x16_t s0 = vld1q_u8(a[k] + i);
+        uint8x16_t s1 = vld1q_u8(b[k] + i);
+        uint16x8_t v_lo = vaddl_u8(vget_low_u8(s0), vget_low_u8(s1));
+        uint16x8_t v_hi = vaddl_u8(vget_high_u8(s0), vget_high_u8(s1));
+        acc[0] = vmlal_n_u16(acc[0], vget_low_u16(v_lo), (uint16_t)weights[k]);
+        acc[1] = vmlal_n_u16(acc[1], vget_high_u16(v_lo), (uint16_t)weights[k]);
+        acc[2] = vmlal_n_u16(acc[2], vget_low_u16(v_hi), (uint16_t)weights[k]);
+        acc[3] = vmlal_n_u16(acc[3], vget_high_u16(v_hi), (uint16_t)weights[k]);
+      }
+      uint16x8_t lo = vcombine_u16(vqrshrn_n_u32(acc[0], 16), vqrshrn_n_u32(acc[1], 16));
+      uint16x8_t hi = vcombine_u16(vqrshrn_n_u32(acc[2], 16), vqrshrn_n_u32(acc[3], 16));
+      vst1q_u8(dst + i, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+  }
+#endif
+
+  for(; i < w; ++i) {
+    int32_t acc = a[0][i] * weights[0];
+    for(int k = 1; k < num; ++k) {
+      acc += (a[k][i] + b[k][i]) * weights[k];
+    }
+    acc = (acc + 32768) >> 16;
+    dst[i] = (unsigned char)((acc > 255) ? 255 : acc);
+  }
+}
+
+/* ---------------------------------------------------*/
+
+CpuContext::CpuContext(int w, int h, Timings& timings)
+  :w(w)
+  ,h(h)
+  ,timings(timings)
+{
+  workers.setup();
+}
+
+void CpuContext::beginFrame() {
+}
+
+bool CpuContext::transfer(CpuImage mask, const FrameInfo& frame, BlobTracker& blobs) {
+
+  timings.beginCpu(TRACKER_STAGE_MAP);
+
+  unsigned char* dst = blobs.getInputImagePtr();
+  int dst_stride = blobs.getInputImageRowLength();
+  for(int j = 0; j < h; ++j) {
+    memcpy(dst + j * dst_stride, mask.pixels + j * mask.stride, w);
+  }
+
+  timings.endCpu(TRACKER_STAGE_MAP);
+
+  blobs.frame = frame;
+
+  return true;
+}
+
+/* ---------------------------------------------------*/
+
+CpuMorphology::CpuMorphology(int w, int h)
+  :w(w)
+  ,h(h)
+  ,erode_steps(2)
+  ,dilate_steps(3)
+{
+  buffers[0].resize(w * h, 0);
+  buffers[1].resize(w * h, 0);
+}
+
+CpuImage CpuMorphology::apply(CpuContext& ctx, CpuImage in) {
+
+  CpuImage out = in;
+  int dx = 0;
+
+  ctx.timings.beginCpu(TRACKER_STAGE_ERODE);
+  for(int i = 0; i < erode_steps; ++i) {
+    CpuImage src = out;
+    unsigned char* dst = &buffers[dx][0];
+    ctx.workers.run(h, [&](int y0, int y1) {
+      cpu_erode(src.pixels, src.stride, dst, w, w, h, y0, y1);
+    });
+    out.pixels = dst;
+    out.stride = w;
+    dx = 1 - dx;
+  }
+  ctx.timings.endCpu(TRACKER_STAGE_ERODE);
+
+  ctx.timings.beginCpu(TRACKER_STAGE_DILATE);
+  for(int i = 0; i < dilate_steps; ++i) {
+    CpuImage src = out;
+    unsigned char* dst = &buffers[dx][0];
+    ctx.workers.run(h, [&](int y0, int y1) {
+      cpu_dilate(src.pixels, src.stride, dst, w, w, h, y0, y1);
+    });
+    out.pixels = dst;
+    out.stride = w;
+    dx = 1 - dx;
+  }
+  ctx.timings.endCpu(TRACKER_STAGE_DILATE);
+
+  return out;
+}
+
+/* ---------------------------------------------------*/
+
+CpuSmoothing::CpuSmoothing(int w, int h, float blurAmount, int taps)
+  :w(w)
+  ,h(h)
+  ,blurred_x(w * h, 0)
+  ,blurred_y(w * h, 0)
+  ,output(w * h, 0)
+{
+  if(!cpu_blur_weights(blurAmount, taps, weights)) {
+    ::exit(EXIT_FAILURE);
+  }
+}
+
+CpuImage CpuSmoothing::apply(CpuContext& ctx, CpuImage in) {
+
+  int num = (int)weights.size();
+  size_t row = (size_t)w + 2 * (num - 1);
+
+  if(scratch.size() < row * ctx.workers.num_threads) {
+    scratch.resize(row * ctx.workers.num_threads);
+  }
+
+  ctx.timings.beginCpu(TRACKER_STAGE_BLUR);
+  ctx.workers.runBands(h, [&](int band, int y0, int y1) {
+    cpu_blur_x(in.pixels, in.stride, &blurred_x[0], w, w, h, y0, y1, &weights[0], num, &scratch[band * row]);
+  });
+  ctx.workers.run(h, [&](int y0, int y1) {
+    cpu_blur_y(&blurred_x[0], w, &blurred_y[0], w, w, h, y0, y1, &weights[0], num);
+  });
+  ctx.timings.endCpu(TRACKER_STAGE_BLUR);
+
+  ctx.timings.beginCpu(TRACKER_STAGE_THRESHOLD);
+  ctx.workers.run(h, [&](int y0, int y1) {
+    cpu_threshold(&blurred_y[0], w, &output[0], w, w, h, y0, y1);
+  });
+  ctx.timings.endCpu(TRACKER_STAGE_THRESHOLD);
+
+  CpuImage img = { &output[0], w };
+  return img;
+}
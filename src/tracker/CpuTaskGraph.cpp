@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <tracker/CpuTaskGraph.h>
+
+/* ---------------------------------------------------*/
+
+CpuTask::CpuTask()
+  :fn(NULL)
+  ,user(NULL)
+  ,arg(0)
+  ,num_deps(0)
+  ,pending(0)
+{
+}
+
+/* ---------------------------------------------------*/
+
+int CpuTaskGraph::addTask(cpu_task_fn fn, void* user, int arg) {
+  tasks.emplace_back();
+  CpuTask& task = tasks.back();
+  task.fn = fn;
+  task.user = user;
+  task.arg = arg;
+  return (int)tasks.size() - 1;
+}
+
+void CpuTaskGraph::addDependency(int task, int dependsOn) {
+
+  if(task < 0 || dependsOn < 0 || task >= (int)tasks.size() || dependsOn >= (int)tasks.size() || task == dependsOn) {
+    printf("Error: invalid dependency: %d on %d\n", task, dependsOn);
+    return;
+  }
+
+  tasks[task].num_deps++;
+  tasks[dependsOn].dependents.push_back(task);
+}
+
+void CpuTaskGraph::clear() {
+  tasks.clear();
+}
+
+/* ---------------------------------------------------*/
+
+CpuTaskPool::CpuTaskPool()
+  :num_threads(1)
+  ,graph(NULL)
+  ,num_remaining(0)
+  ,num_queued(0)
+  ,num_steals(0)
+  ,must_stop(false)
+{
+  queues.push_back(new CpuTaskQueue());
+}
+
+CpuTaskPool::~CpuTaskPool() {
+
+  shutdown();
+
+  for(size_t i = 0; i < queues.size(); ++i) {
+    delete queues[i];
+  }
+  queues.clear();
+}
+
+bool CpuTaskPool::setup(int numThreads) {
+
+  if(isRunning()) {
+    printf("Error: cannot setup the CpuTaskPool while a graph is running.\n");
+    return false;
+  }
+
+  shutdown();
+
+  if(numThreads <= 0) {
+    numThreads = (int)std::thread::hardware_concurrency();
+  }
+  if(numThreads <= 0) {
+    numThreads = 1;
+  }
+
+  for(size_t i = 0; i < queues.size(); ++i) {
+    delete queues[i];
+  }
+  queues.clear();
+
+  num_threads = numThreads;
+  must_stop = false;
+
+  for(int i = 0; i < num_threads; ++i) {
+    queues.push_back(new CpuTaskQueue());
+  }
+
+  for(int i = 0; i < num_threads - 1; ++i) {
+    threads.push_back(std::thread(&CpuTaskPool::work, this, i));
+  }
+
+  return true;
+}
+
+void CpuTaskPool::shutdown() {
+
+  if(threads.size()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      must_stop = true;
+    }
+    wake_cv.notify_all();
+
+    for(size_t i = 0; i < threads.size(); ++i) {
+      threads[i].join();
+    }
+    threads.clear();
+  }
+
+  num_threads = 1;
+}
+
+void CpuTaskPool::run(CpuTaskGraph& g) {
+
+  if(isRunning()) {
+    printf("Error: the CpuTaskPool already runs a graph; call wait() first.\n");
+    return;
+  }
+
+  if(0 == g.size()) {
+    return;
+  }
+
+  graph = &g;
+  num_remaining = (int)g.size();
+
+  for(size_t i = 0; i < g.tasks.size(); ++i) {
+    g.tasks[i].pending = g.tasks[i].num_deps;
+  }
+
+  /* Spread the roots over the threads; they continue with the tasks these make ready. */
+  int queue = 0;
+  for(size_t i = 0; i < g.tasks.size(); ++i) {
+    if(0 == g.tasks[i].num_deps) {
+      push(queue, (int)i);
+      queue = (queue + 1) % (int)queues.size();
+    }
+  }
+}
+
+void CpuTaskPool::wait() {
+
+  if(NULL == graph) {
+    return;
+  }
+
+  int self = (int)queues.size() - 1;
+
+  while(num_remaining.load() > 0) {
+    if(runOne(self)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while(num_remaining.load() > 0 && 0 == num_queued.load()) {
+      done_cv.wait(lock);
+    }
+  }
+
+  graph = NULL;
+}
+
+void CpuTaskPool::push(int queue, int task) {
+
+  {
+    CpuTaskQueue* q = queues[queue];
+    std::lock_guard<std::mutex> lock(q->mutex);
+    q->tasks.push_back(task);
+  }
+
+  num_queued++;
+
+  /* Taking the lock makes sure a thread that's about to sleep sees the task; wait() sleeps on done_cv and helps too. */
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+  wake_cv.notify_one();
+  done_cv.notify_one();
+}
+
+bool CpuTaskPool::runOne(int self) {
+
+  int task = -1;
+  int num_queues = (int)queues.size();
+
+  /* Our own newest task first ... */
+  {
+    CpuTaskQueue* q = queues[self];
+    std::lock_guard<std::mutex> lock(q->mutex);
+    if(q->tasks.size()) {
+      task = q->tasks.back();
+      q->tasks.pop_back();
+    }
+  }
+
+  /* ... otherwise the oldest task of someone else. */
+  for(int i = 1; i < num_queues && task < 0; ++i) {
+    CpuTaskQueue* q = queues[(self + i) % num_queues];
+    std::lock_guard<std::mutex> lock(q->mutex);
+    if(q->tasks.size()) {
+      task = q->tasks.front();
+      q->tasks.pop_front();
+      num_steals++;
+    }
+  }
+
+  if(task < 0) {
+    return false;
+  }
+
+  num_queued--;
+
+  CpuTask& t = graph->tasks[task];
+  t.fn(t.user, t.arg);
+
+  for(size_t i = 0; i < t.dependents.size(); ++i) {
+    int dep = t.dependents[i];
+    if(1 == graph->tasks[dep].pending.fetch_sub(1)) {
+      push(self, dep);
+    }
+  }
+
+  if(1 == num_remaining.fetch_sub(1)) {
+    std::lock_guard<std::mutex> lock(mutex);
+    done_cv.notify_all();
+  }
+
+  return true;
+}
+
+void CpuTaskPool::work(int self) {
+
+  while(true) {
+
+    if(runOne(self)) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!must_stop && 0 == num_queued.load()) {
+      wake_cv.wait(lock);
+    }
+    if(must_stop) {
+      break;
+    }
+  }
+}
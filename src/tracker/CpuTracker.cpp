@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tracker/CpuTracker.h>
+
+static void cpu_tracker_run_task(void* user, int arg);
+
+/* ---------------------------------------------------*/
+
+CpuTracker::CpuTracker(int w, int h, int numThreads)
+  :w(w)
+  ,h(h)
+  ,erode_steps(2)
+  ,dilate_steps(3)
+  ,tile_rows(32)
+  ,overlap_frames(true)
+  ,blobs(w, h)
+  ,graph_erode_steps(-1)
+  ,graph_dilate_steps(-1)
+  ,graph_tile_rows(-1)
+  ,luma_index(0)
+  ,has_new_frame(false)
+  ,history(CPU_TRACKER_NUM_HISTORY * w * h, 0)
+  ,sum(w * h, 0)
+  ,history_index(0)
+  ,bootstrap(true)
+  ,has_history(false)
+  ,background(w * h, 0)
+  ,blurred_x(w * h, 0)
+  ,mask(w * h, 0)
+  ,running_luma(0)
+  ,running_slot(0)
+  ,running_timed(false)
+  ,running_fill(false)
+  ,is_running(false)
+  ,frame_count(0)
+{
+  luma[0].resize(w * h, 0);
+  luma[1].resize(w * h, 0);
+
+  if(!cpu_blur_weights(1.0f, 10, weights)) {
+    ::exit(EXIT_FAILURE);
+  }
+
+  blobs.timings = &timings;
+  pool.setup(numThreads);
+}
+
+CpuTracker::~CpuTracker() {
+  if(is_running) {
+    pool.wait();
+  }
+}
+
+void CpuTracker::addFrame(const unsigned char* pixels, int stride, int channels, uint64_t captureNs) {
+
+  /* The graph may still read the luma of the previous frame. */
+  luma_index = (is_running) ? 1 - running_luma : luma_index;
+
+  frame.id = ++frame_count;
+  frame.capture_ns = (captureNs) ? captureNs : tracker_now_ns();
+
+  cpu_luma(pixels, stride, channels, &luma[luma_index][0], w, h, 0, h);
+  has_new_frame = true;
+}
+
+void CpuTracker::apply() {
+
+  bool overlap = overlap_frames && pool.num_threads > 1;
+
+  timings.beginCpu(TRACKER_STAGE_APPLY);
+
+  if(is_running) {
+    finish();
+    if(has_new_frame && overlap) {
+      submit();
+    }
+    track();
+  }
+
+  if(has_new_frame) {
+    submit();
+    if(!overlap) {
+      finish();
+      track();
+    }
+  }
+
+  timings.endCpu(TRACKER_STAGE_APPLY);
+}
+
+void CpuTracker::submit() {
+
+  if(erode_steps != graph_erode_steps || dilate_steps != graph_dilate_steps || tile_rows != graph_tile_rows) {
+    setupGraph();
+  }
+
+  running_frame = frame;
+  running_luma = luma_index;
+  running_slot = history_index;
+  running_timed = timings.isEnabled();
+  running_fill = bootstrap && !has_history;
+  has_history = true;
+  history_index = (history_index + 1) % CPU_TRACKER_NUM_HISTORY;
+  has_new_frame = false;
+
+  for(size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i].ns[0] = 0;
+    tasks[i].ns[1] = 0;
+  }
+
+  is_running = true;
+  pool.run(graph);
+}
+
+void CpuTracker::finish() {
+
+  pool.wait();
+  is_running = false;
+
+  if(running_timed && timings.isEnabled()) {
+    double ms[TRACKER_STAGE_COUNT] = { 0 };
+    bool used[TRACKER_STAGE_COUNT] = { false };
+    for(size_t i = 0; i < tasks.size(); ++i) {
+      for(int k = 0; k < 2; ++k) {
+        if(tasks[i].stages[k] >= 0) {
+          ms[tasks[i].stages[k]] += tasks[i].ns[k] / 1e6;
+          used[tasks[i].stages[k]] = true;
+        }
+      }
+    }
+    for(int i = 0; i < TRACKER_STAGE_COUNT; ++i) {
+      if(used[i]) {
+        timings.addSample(i, ms[i]);
+      }
+    }
+  }
+
+  timings.beginCpu(TRACKER_STAGE_MAP);
+
+  unsigned char* dst = blobs.getInputImagePtr();
+  int dst_stride = blobs.getInputImageRowLength();
+  for(int j = 0; j < h; ++j) {
+    memcpy(dst + j * dst_stride, &mask[j * w], w);
+  }
+
+  timings.endCpu(TRACKER_STAGE_MAP);
+
+  blobs.frame = running_frame;
+  latency_mask.add(tracker_now_ns() - blobs.frame.capture_ns);
+}
+
+void CpuTracker::track() {
+
+  blobs.label();
+  blobs.match();
+
+  latency_tracks.add(tracker_now_ns() - blobs.frame.capture_ns);
+}
+
+/* 
+   Stage 0 is the background subtraction, stages 1 .. erode_steps + dilate_steps
+   the morphology steps and the last stage the vertical blur and threshold. 
+   The task of stage s and tile t has index s * num_tiles + t.
+*/
+void CpuTracker::setupGraph() {
+
+  int rows = (tile_rows > 0) ? tile_rows : h;
+  int num_tiles = (h + rows - 1) / rows;
+  int num_morph = erode_steps + dilate_steps;
+  int num_stages = num_morph + 2;
+  int blur_halo = (int)weights.size() - 1;
+
+  graph.clear();
+  tasks.clear();
+  morph.assign((size_t)num_morph * w * h, 0);
+  blur_scratch.assign((size_t)num_tiles * (w + 2 * blur_halo), 0);
+
+  for(int s = 0; s < num_stages; ++s) {
+    for(int t = 0; t < num_tiles; ++t) {
+
+      CpuTrackerTask task;
+      task.step = s - 1;
+      task.tile = t;
+      task.y0 = t * rows;
+      task.y1 = (task.y0 + rows < h) ? task.y0 + rows : h;
+      task.blur_x = (s == num_stages - 2);
+      task.ns[0] = 0;
+      task.ns[1] = 0;
+
+      int halo = 1;
+      if(0 == s) {
+        task.type = CPU_TRACKER_TASK_BACKGROUND;
+        task.stages[0] = TRACKER_STAGE_BACKGROUND;
+        halo = 0;
+      }
+      else if(s <= erode_steps) {
+        task.type = CPU_TRACKER_TASK_ERODE;
+        task.stages[0] = TRACKER_STAGE_ERODE;
+      }
+      else if(s <= num_morph) {
+        task.type = CPU_TRACKER_TASK_DILATE;
+        task.stages[0] = TRACKER_STAGE_DILATE;
+      }
+      else {
+        task.type = CPU_TRACKER_TASK_BLUR;
+        task.stages[0] = TRACKER_STAGE_BLUR;
+        halo = blur_halo;
+      }
+      task.stages[1] = (task.blur_x) ? TRACKER_STAGE_BLUR : -1;
+      if(CPU_TRACKER_TASK_BLUR == task.type) {
+        task.stages[1] = TRACKER_STAGE_THRESHOLD;
+      }
+
+      int id = graph.addTask(cpu_tracker_run_task, this, (int)tasks.size());
+      tasks.push_back(task);
+
+      if(0 == s) {
+        continue;
+      }
+
+      /* We read the rows [y0 - halo, y1 + halo) of the previous stage. */
+      int lo = (task.y0 - halo > 0) ? task.y0 - halo : 0;
+      int hi = (task.y1 + halo < h) ? task.y1 + halo : h;
+      for(int u = lo / rows; u <= (hi - 1) / rows; ++u) {
+        graph.addDependency(id, (s - 1) * num_tiles + u);
+      }
+    }
+  }
+
+  graph_erode_steps = erode_steps;
+  graph_dilate_steps = dilate_steps;
+  graph_tile_rows = tile_rows;
+}
+
+void CpuTracker::runTask(int dx) {
+
+  CpuTrackerTask& task = tasks[dx];
+  int num = (int)weights.size();
+  uint64_t t0 = (running_timed) ? tracker_now_ns() : 0;
+  unsigned char* out = NULL;
+
+  switch(task.type) {
+    case CPU_TRACKER_TASK_BACKGROUND: {
+      const unsigned char* l = &luma[running_luma][0];
+      if(running_fill) {
+        cpu_history_fill(l, &history[0], CPU_TRACKER_NUM_HISTORY, &sum[0], w, h, task.y0, task.y1);
+      }
+      else {
+        cpu_history_add(l, &history[(size_t)running_slot * w * h], &sum[0], w, h, task.y0, task.y1);
+      }
+      cpu_background_subtract(l, &sum[0], CPU_TRACKER_NUM_HISTORY, &background[0], w, w, h, task.y0, task.y1);
+      out = &background[0];
+      break;
+    }
+    case CPU_TRACKER_TASK_ERODE: {
+      out = getStageOutput(task.step + 1);
+      cpu_erode(getStageOutput(task.step), w, out, w, w, h, task.y0, task.y1);
+      break;
+    }
+    case CPU_TRACKER_TASK_DILATE: {
+      out = getStageOutput(task.step + 1);
+      cpu_dilate(getStageOutput(task.step), w, out, w, w, h, task.y0, task.y1);
+      break;
+    }
+    case CPU_TRACKER_TASK_BLUR: {
+      cpu_blur_y(&blurred_x[0], w, &mask[0], w, w, h, task.y0, task.y1, &weights[0], num);
+      break;
+    }
+    default: {
+      printf("Error: unknown cpu tracker task: %d\n", task.type);
+      return;
+    }
+  }
+
+  uint64_t t1 = (running_timed) ? tracker_now_ns() : 0;
+  task.ns[0] = t1 - t0;
+
+  if(CPU_TRACKER_TASK_BLUR == task.type) {
+    cpu_threshold(&mask[0], w, &mask[0], w, w, h, task.y0, task.y1);
+  }
+  else if(task.blur_x) {
+    cpu_blur_x(out, w, &blurred_x[0], w, w, h, task.y0, task.y1, &weights[0], num, &blur_scratch[(size_t)task.tile * (w + 2 * (num - 1))]);
+  }
+  else {
+    return;
+  }
+
+  if(running_timed) {
+    task.ns[1] = tracker_now_ns() - t1;
+  }
+}
+
+bool CpuTracker::saveSnapshot(std::string filepath) {
+
+  /* The graph may still write into the history. */
+  if(is_running) {
+    pool.wait();
+  }
+
+  TrackerSnapshot snap;
+  snap.header.width = w;
+  snap.header.height = h;
+  snap.header.format = SNAPSHOT_HISTORY_LUMA;
+  snap.header.num_slots = CPU_TRACKER_NUM_HISTORY;
+  snap.header.next_slot = history_index;
+  snap.header.slot_bytes = (uint64_t)w * h;
+  snap.header.frame_count = frame_count;
+  snap.header.frame_id = frame_count;
+
+  if(!snap.create(filepath, blobs)) {
+    return false;
+  }
+
+  memcpy(snap.getHistoryPtr(0), &history[0], history.size());
+
+  return snap.commit();
+}
+
+bool CpuTracker::loadSnapshot(std::string filepath) {
+
+  TrackerSnapshot snap;
+  if(!snap.open(filepath)) {
+    return false;
+  }
+
+  if(!snap.isCompatible(w, h, SNAPSHOT_HISTORY_LUMA, CPU_TRACKER_NUM_HISTORY, (uint64_t)w * h)) {
+    return false;
+  }
+
+  if(is_running) {
+    pool.wait();
+    is_running = false;
+  }
+
+  if(!snap.restoreBlobs(blobs)) {
+    return false;
+  }
+
+  memcpy(&history[0], snap.getHistoryPtr(0), history.size());
+
+  size_t n = (size_t)w * h;
+  for(size_t i = 0; i < n; ++i) {
+    uint16_t s = 0;
+    for(int k = 0; k < CPU_TRACKER_NUM_HISTORY; ++k) {
+      s += history[k * n + i];
+    }
+    sum[i] = s;
+  }
+
+  history_index = snap.header.next_slot;
+  frame_count = snap.header.frame_id;
+  has_history = true;
+
+  return true;
+}
+
+unsigned char* CpuTracker::getStageOutput(int stage) {
+  return (0 == stage) ? &background[0] : &morph[(size_t)(stage - 1) * w * h];
+}
+
+/* ---------------------------------------------------*/
+
+static void cpu_tracker_run_task(void* user, int arg) {
+  static_cast<CpuTracker*>(user)->runTask(arg);
+}
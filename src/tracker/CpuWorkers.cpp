@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <tracker/CpuWorkers.h>
+
+/* ---------------------------------------------------*/
+
+CpuWorkers::CpuWorkers()
+  :num_threads(1)
+  ,min_rows(16)
+  ,generation(0)
+  ,num_finished(0)
+  ,must_stop(false)
+  ,job_fn(NULL)
+  ,job_user(NULL)
+  ,job_rows(0)
+  ,job_bands(0)
+  ,next_band(0)
+{
+}
+
+CpuWorkers::~CpuWorkers() {
+  shutdown();
+}
+
+bool CpuWorkers::setup(int numThreads) {
+
+  shutdown();
+
+  if(numThreads <= 0) {
+    numThreads = (int)std::thread::hardware_concurrency();
+  }
+  if(numThreads <= 0) {
+    numThreads = 1;
+  }
+
+  num_threads = numThreads;
+  must_stop = false;
+
+  for(int i = 1; i < num_threads; ++i) {
+    threads.push_back(std::thread(&CpuWorkers::work, this, generation));
+  }
+
+  return true;
+}
+
+void CpuWorkers::shutdown() {
+
+  if(threads.size()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      must_stop = true;
+    }
+    wake_cv.notify_all();
+
+    for(size_t i = 0; i < threads.size(); ++i) {
+      threads[i].join();
+    }
+    threads.clear();
+  }
+
+  num_threads = 1;
+}
+
+void CpuWorkers::run(int numRows, cpu_rows_fn fn, void* user) {
+
+  int num_bands = num_threads;
+  if(min_rows > 0 && numRows / min_rows < num_bands) {
+    num_bands = numRows / min_rows;
+  }
+
+  if(threads.empty() || num_bands <= 1) {
+    fn(user, 0, 0, numRows);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job_fn = fn;
+    job_user = user;
+    job_rows = numRows;
+    job_bands = num_bands;
+    next_band = 0;
+    num_finished = 0;
+    generation++;
+  }
+  wake_cv.notify_all();
+
+  processBands();
+
+  /* All threads must be done with this job before we can change it. */
+  std::unique_lock<std::mutex> lock(mutex);
+  while(num_finished < threads.size()) {
+    done_cv.wait(lock);
+  }
+}
+
+void CpuWorkers::processBands() {
+
+  int band = 0;
+  while((band = next_band.fetch_add(1)) < job_bands) {
+    int y0 = (int)(((int64_t)band * job_rows) / job_bands);
+    int y1 = (int)(((int64_t)(band + 1) * job_rows) / job_bands);
+    job_fn(job_user, band, y0, y1);
+  }
+}
+
+void CpuWorkers::work(uint64_t seen) {
+
+  while(true) {
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while(!must_stop && seen == generation) {
+        wake_cv.wait(lock);
+      }
+      if(must_stop) {
+        break;
+      }
+      seen = generation;
+    }
+
+    processBands();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      num_finished++;
+      if(num_finished == threads.size()) {
+        done_cv.notify_one();
+      }
+    }
+  }
+}
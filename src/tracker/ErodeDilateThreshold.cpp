@@ -6,10 +6,8 @@ ErodeDilateThreshold::ErodeDilateThreshold(int w, int h)
   ,win_w(0)
   ,win_h(0)
   ,fullscreen_vao(0)
-  ,fullscreen_vert(0)
-  ,erode_frag(0)
   ,erode_prog(0)
-  ,threshold_frag(0)
+  ,dilate_prog(0)
   ,threshold_prog(0)
   ,threshold_fbo(0)
   ,threshold_tex(0)
@@ -22,34 +20,36 @@ ErodeDilateThreshold::ErodeDilateThreshold(int w, int h)
 
   glGenVertexArrays(1, &fullscreen_vao);
 
-  // Create ping/pong fbos for erode/dilate
-  createFBO(fbo[0], tex[0]);
-  createFBO(fbo[1], tex[1]);
+  // The ping/pong fbos for erode/dilate are created on first use, see setupPingPong().
+  fbo[0] = fbo[1] = 0;
+  tex[0] = tex[1] = 0;
 
   // Shaders
-  fullscreen_vert = rx_create_shader(GL_VERTEX_SHADER, ROXLU_OPENGL_FULLSCREEN_VS);
-  erode_frag = rx_create_shader(GL_FRAGMENT_SHADER, ERODE_FS);
-  erode_prog = rx_create_program(fullscreen_vert, erode_frag, true);
+  ProgramCache& cache = tracker_program_cache();
+  erode_prog = cache.createProgram(ROXLU_OPENGL_FULLSCREEN_VS, ERODE_FS);
 
   glUseProgram(erode_prog);
   rx_uniform_1i(erode_prog, "u_tex", 0);
 
-  dilate_frag = rx_create_shader(GL_FRAGMENT_SHADER, DILATE_FS);
-  dilate_prog = rx_create_program(fullscreen_vert, dilate_frag, true);
+  dilate_prog = cache.createProgram(ROXLU_OPENGL_FULLSCREEN_VS, DILATE_FS);
 
   glUseProgram(dilate_prog);
   rx_uniform_1i(dilate_prog, "u_tex", 0);
 
-  threshold_frag = rx_create_shader(GL_FRAGMENT_SHADER, THRESHOLD_FS);
-  threshold_prog = rx_create_program(fullscreen_vert, threshold_frag, true);
+  threshold_prog = cache.createProgram(ROXLU_OPENGL_FULLSCREEN_VS, THRESHOLD_FS);
   glUseProgram(threshold_prog);
   rx_uniform_1i(threshold_prog, "u_tex", 0);
 
-  createFBO(threshold_fbo, threshold_tex);
+  // The threshold output is created on first use, see setupThreshold().
 #endif
 }
 
 void ErodeDilateThreshold::setThresholdOutputAsReadBuffer() {
+  GLint viewp[4] = { 0 } ;
+  glGetIntegerv(GL_VIEWPORT, viewp);
+  win_w = viewp[2];
+  win_h = viewp[3];
+  setupThreshold();
   glBindFramebuffer(GL_READ_FRAMEBUFFER, threshold_fbo);
   glReadBuffer(GL_COLOR_ATTACHMENT0);
   glViewport(0, 0, w, h);
@@ -87,102 +87,142 @@ bool ErodeDilateThreshold::createFBO(GLuint& fbo, GLuint& tex) {
 }
 
 GLuint ErodeDilateThreshold::erode(GLuint intex, int num) {
+  RenderGraph graph;
+  GLuint out_tex = erode(graph, intex, num);
+  graph.execute();
+  return out_tex;
+}
 
-  GLenum drawbufs[] = { GL_COLOR_ATTACHMENT0 } ;
+GLuint ErodeDilateThreshold::dilate(GLuint intex, int num) {
+  RenderGraph graph;
+  GLuint out_tex = dilate(graph, intex, num);
+  graph.execute();
+  return out_tex;
+}
 
-  glViewport(0, 0, w, h);
-  glBindVertexArray(fullscreen_vao);
-  glUseProgram(erode_prog);  
+GLuint ErodeDilateThreshold::threshold(GLuint intex) {
+  RenderGraph graph;
+  GLuint out_tex = threshold(graph, intex);
+  graph.execute();
+  return out_tex;
+}
+
+GLuint ErodeDilateThreshold::erode(RenderGraph& graph, GLuint intex, int num) {
+  return addPingPongPasses(graph, TRACKER_STAGE_ERODE, erode_prog, intex, num);
+}
 
-  // first step we read from the incoming tex
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, intex);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo[0]);
-  glDrawBuffers(1, drawbufs);
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+GLuint ErodeDilateThreshold::dilate(RenderGraph& graph, GLuint intex, int num) {
+  return addPingPongPasses(graph, TRACKER_STAGE_DILATE, dilate_prog, intex, num);
+}
 
-  // next we ping/pong num times to apply erode
-  int toggle = 1;
-  GLuint last_tex = 0;
-  num = num - 1; // we performed one erode already
+GLuint ErodeDilateThreshold::threshold(RenderGraph& graph, GLuint intex) {
 
-  for(int i = 0; i < num; ++i) {
+  if(!setupThreshold()) {
+    return 0;
+  }
 
-    int read_index = 1 - toggle;
-    int write_index = toggle;
-  
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex[read_index]);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo[write_index]);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  RenderPass& pass = graph.addDrawPass(TRACKER_STAGE_THRESHOLD, threshold_prog, fullscreen_vao, threshold_fbo, threshold_tex, w, h);
+  pass.input(intex);
 
-    last_tex = tex[write_index];
-    toggle = 1 - toggle;
+  if(graph.pool) {
+    graph.pool->release(intex);
   }
 
-  // reset
-  glViewport(0, 0, win_w, win_h);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  return last_tex;
+  return threshold_tex;
 }
 
-GLuint ErodeDilateThreshold::dilate(GLuint intex, int num) {
-
-  GLenum drawbufs[] = { GL_COLOR_ATTACHMENT0 } ;
+GLuint ErodeDilateThreshold::addPingPongPasses(RenderGraph& graph, int stage, GLuint prog, GLuint intex, int num) {
 
-  glViewport(0, 0, w, h);
-  glBindVertexArray(fullscreen_vao);
-  glUseProgram(dilate_prog);  
+  GLuint last_tex = intex;
 
-  // first step we read from the incoming tex
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, intex);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo[0]);
-  glDrawBuffers(1, drawbufs);
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  if(!graph.pool && num > 0 && !setupPingPong()) {
+    return 0;
+  }
 
-  // next we ping/pong num times to apply dilate
-  int toggle = 1;
-  GLuint last_tex = 0;
-  num = num - 1; // we performed one dilate already
+  // when we get the result of a previous erode/dilate we start with the other buffer
+  int write_index = (intex == tex[0]) ? 1 : 0;
 
   for(int i = 0; i < num; ++i) {
 
-    int read_index = 1 - toggle;
-    int write_index = toggle;
-  
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex[read_index]);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo[write_index]);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    GLuint out_fbo = fbo[write_index];
+    GLuint out_tex = tex[write_index];
+
+    if(graph.pool) {
+      RenderTarget* target = graph.pool->acquire(GL_R8, w, h);
+      if(!target) {
+        return 0;
+      }
+      out_fbo = target->fbo;
+      out_tex = target->tex;
+    }
+
+    RenderPass& pass = graph.addDrawPass(stage, prog, fullscreen_vao, out_fbo, out_tex, w, h);
+    pass.input(last_tex);
 
-    last_tex = tex[write_index];
-    toggle = 1 - toggle;
+    // the input is dead now; a later pass can reuse it
+    if(graph.pool) {
+      graph.pool->release(last_tex);
+    }
+
+    last_tex = out_tex;
+    write_index = 1 - write_index;
   }
 
-  // reset
-  glViewport(0, 0, win_w, win_h);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
   return last_tex;
 }
 
+bool ErodeDilateThreshold::setupThreshold() {
 
-GLuint ErodeDilateThreshold::threshold(GLuint intex) {
+  if(threshold_fbo) {
+    return true;
+  }
 
-  GLenum drawbufs[] = { GL_COLOR_ATTACHMENT0 } ;
+  // we're called while the caller builds a graph; keep its framebuffers.
+  GLint prev_draw_fbo = 0;
+  GLint prev_read_fbo = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_draw_fbo);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
 
-  glViewport(0, 0, w, h);
-  glBindVertexArray(fullscreen_vao);
-  glUseProgram(threshold_prog);  
+  createFBO(threshold_fbo, threshold_tex);
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, intex);
-  glBindFramebuffer(GL_FRAMEBUFFER, threshold_fbo);
-  glDrawBuffers(1, drawbufs);
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prev_draw_fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_fbo);
 
-  // reset
-  glViewport(0, 0, win_w, win_h);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  return threshold_tex;
+  return true;
+}
+
+bool ErodeDilateThreshold::setupPingPong() {
+
+  if(fbo[0]) {
+    return true;
+  }
+
+  // we're called while the caller builds a graph; keep its framebuffers.
+  GLint prev_draw_fbo = 0;
+  GLint prev_read_fbo = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_draw_fbo);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
+
+  createFBO(fbo[0], tex[0]);
+  createFBO(fbo[1], tex[1]);
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prev_draw_fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_fbo);
+
+  return true;
+}
+
+size_t ErodeDilateThreshold::getNumBytes() {
+
+  size_t nbytes = 0;
+
+  if(threshold_tex) {
+    nbytes += w * h;              /* threshold output */
+  }
+
+  if(tex[0]) {
+    nbytes += 2 * w * h;          /* ping/pong */
+  }
+
+  return nbytes;
 }
@@ -0,0 +1,93 @@
+#include <tracker/FrameArena.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+FrameArena::FrameArena(size_t capacity)
+  :buffer(NULL)
+  ,capacity(capacity)
+  ,used(0)
+  ,overflow_bytes(0)
+  ,num_heap_allocs(0)
+{
+  if(0 == capacity) {
+    printf("Error: the capacity of a FrameArena must be > 0.\n");
+    ::exit(EXIT_FAILURE);
+  }
+
+  buffer = (unsigned char*)malloc(capacity);
+  if(NULL == buffer) {
+    printf("Error: cannot allocate the frame arena.\n");
+    ::exit(EXIT_FAILURE);
+  }
+
+  num_heap_allocs++;
+}
+
+FrameArena::~FrameArena() {
+
+  for(size_t i = 0; i < overflow.size(); ++i) {
+    free(overflow[i]);
+  }
+
+  free(buffer);
+
+  buffer = NULL;
+  capacity = 0;
+  used = 0;
+}
+
+void* FrameArena::allocate(size_t nbytes, size_t align) {
+
+  /* Align on the address; malloc() gives us at least 8 or 16 byte aligned blocks. */
+  uintptr_t start = ((uintptr_t)(buffer + used) + (align - 1)) & ~(uintptr_t)(align - 1);
+  size_t end = (start - (uintptr_t)buffer) + nbytes;
+
+  if(end <= capacity) {
+    used = end;
+    return (void*)start;
+  }
+
+  /* Doesn't fit; this frame gets an extra block and reset() grows the buffer. */
+  unsigned char* block = (unsigned char*)malloc(nbytes + align);
+  if(NULL == block) {
+    printf("Error: cannot allocate %zu bytes in the frame arena.\n", nbytes);
+    ::exit(EXIT_FAILURE);
+  }
+
+  overflow.push_back(block);
+  overflow_bytes += nbytes + align;
+  num_heap_allocs++;
+
+  return (void*)(((uintptr_t)block + (align - 1)) & ~(uintptr_t)(align - 1));
+}
+
+void FrameArena::reset() {
+
+  used = 0;
+
+  if(overflow.empty()) {
+    return;
+  }
+
+  size_t needed = capacity + overflow_bytes;
+
+  for(size_t i = 0; i < overflow.size(); ++i) {
+    free(overflow[i]);
+  }
+
+  overflow.clear();
+  overflow_bytes = 0;
+
+  /* Grow at least 2x, so a slowly growing number of blobs doesn't make us reallocate every frame. */
+  size_t new_capacity = (needed > capacity * 2) ? needed : capacity * 2;
+  unsigned char* new_buffer = (unsigned char*)malloc(new_capacity);
+  if(NULL == new_buffer) {
+    printf("Error: cannot grow the frame arena to %zu bytes.\n", new_capacity);
+    ::exit(EXIT_FAILURE);
+  }
+
+  free(buffer);
+  buffer = new_buffer;
+  capacity = new_capacity;
+  num_heap_allocs++;
+}
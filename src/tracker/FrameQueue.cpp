@@ -0,0 +1,238 @@
+#include <tracker/FrameQueue.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+static unsigned char* frame_queue_alloc(size_t nbytes, bool& isLocked);
+static void frame_queue_free(unsigned char* ptr, size_t nbytes, bool isLocked);
+
+/* ---------------------------------------------------*/
+
+FrameQueue::FrameQueue()
+  :frame_size(0)
+  ,policy(FRAME_QUEUE_LATEST)
+  ,seq(0)
+  ,back(0)
+  ,front(0)
+  ,write_count(0)
+  ,num_dropped(0)
+  ,num_skipped(0)
+  ,latest(0)
+  ,read_count(0)
+{
+}
+
+FrameQueue::~FrameQueue() {
+  shutdown();
+}
+
+bool FrameQueue::setup(size_t frameSize, int numSlots, int pol) {
+
+  if(slots.size()) {
+    printf("Error: the FrameQueue is already setup; call shutdown() first.\n");
+    return false;
+  }
+
+  if(0 == frameSize || numSlots < 2) {
+    printf("Error: invalid frame size or number of slots (we need at least 2): %d\n", numSlots);
+    return false;
+  }
+
+  /* Triple buffering: the producer, the consumer and the one in between. */
+  if(pol == FRAME_QUEUE_LATEST) {
+    numSlots = 3;
+  }
+
+  /* shutdown() frees the slots with frame_size, also when we fail halfway. */
+  frame_size = frameSize;
+
+  for(int i = 0; i < numSlots; ++i) {
+
+    FrameQueueSlot slot;
+    slot.is_locked = false;
+    slot.data = frame_queue_alloc(frameSize, slot.is_locked);
+    slot.capture_ns = 0;
+    slot.seq = 0;
+
+    if(!slot.data) {
+      printf("Error: cannot allocate the FrameQueue buffers.\n");
+      shutdown();
+      return false;
+    }
+
+    slots.push_back(slot);
+  }
+
+  policy = pol;
+  seq = 0;
+  write_count.store(0);
+  read_count.store(0);
+  num_dropped.store(0);
+  num_skipped.store(0);
+  back = 0;
+  front = 1;
+  latest.store(2);
+
+  return true;
+}
+
+void FrameQueue::shutdown() {
+
+  for(size_t i = 0; i < slots.size(); ++i) {
+    frame_queue_free(slots[i].data, frame_size, slots[i].is_locked);
+  }
+
+  slots.clear();
+  frame_size = 0;
+}
+
+unsigned char* FrameQueue::beginWrite() {
+
+  if(slots.empty()) {
+    return NULL;
+  }
+
+  if(policy == FRAME_QUEUE_LATEST) {
+    return slots[back].data;
+  }
+
+  uint64_t w = write_count.load(std::memory_order_relaxed);
+  uint64_t r = read_count.load(std::memory_order_acquire);
+
+  if(w - r >= slots.size()) {
+    num_dropped.store(num_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return NULL;
+  }
+
+  return slots[w % slots.size()].data;
+}
+
+void FrameQueue::endWrite(uint64_t captureNs) {
+
+  uint64_t w = write_count.load(std::memory_order_relaxed);
+
+  if(policy == FRAME_QUEUE_LATEST) {
+
+    FrameQueueSlot& slot = slots[back];
+    slot.capture_ns = captureNs;
+    slot.seq = ++seq;
+
+    /* Publish our slot and continue with the one we get back; when that one was never read we replaced it. */
+    uint32_t prev = latest.exchange(back | FRAME_QUEUE_FRESH, std::memory_order_acq_rel);
+    if(prev & FRAME_QUEUE_FRESH) {
+      num_skipped.store(num_skipped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    back = prev & ~FRAME_QUEUE_FRESH;
+    write_count.store(w + 1, std::memory_order_release);
+    return;
+  }
+
+  FrameQueueSlot& slot = slots[w % slots.size()];
+  slot.capture_ns = captureNs;
+  slot.seq = ++seq;
+
+  write_count.store(w + 1, std::memory_order_release);
+}
+
+FrameQueueSlot* FrameQueue::beginRead() {
+
+  if(slots.empty()) {
+    return NULL;
+  }
+
+  if(policy == FRAME_QUEUE_LATEST) {
+
+    if(0 == (latest.load(std::memory_order_relaxed) & FRAME_QUEUE_FRESH)) {
+      return NULL;
+    }
+
+    /* Only the producer sets the fresh flag, so the slot we get is always a new frame. */
+    front = latest.exchange(front, std::memory_order_acq_rel) & ~FRAME_QUEUE_FRESH;
+    return &slots[front];
+  }
+
+  uint64_t r = read_count.load(std::memory_order_relaxed);
+  uint64_t w = write_count.load(std::memory_order_acquire);
+
+  if(r == w) {
+    return NULL;
+  }
+
+  return &slots[r % slots.size()];
+}
+
+void FrameQueue::endRead() {
+
+  /* With LATEST we keep the front slot until the next beginRead(). */
+  if(policy == FRAME_QUEUE_LATEST) {
+    return;
+  }
+
+  uint64_t r = read_count.load(std::memory_order_relaxed);
+  read_count.store(r + 1, std::memory_order_release);
+}
+
+/* ---------------------------------------------------*/
+
+#if defined(_WIN32)
+
+static unsigned char* frame_queue_alloc(size_t nbytes, bool& isLocked) {
+
+  void* ptr = VirtualAlloc(NULL, nbytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if(!ptr) {
+    return NULL;
+  }
+
+  isLocked = (0 != VirtualLock(ptr, nbytes));
+  return (unsigned char*)ptr;
+}
+
+static void frame_queue_free(unsigned char* ptr, size_t nbytes, bool isLocked) {
+
+  if(!ptr) {
+    return;
+  }
+
+  if(isLocked) {
+    VirtualUnlock(ptr, nbytes);
+  }
+
+  VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+#else
+
+static unsigned char* frame_queue_alloc(size_t nbytes, bool& isLocked) {
+
+  void* ptr = NULL;
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  if(0 != posix_memalign(&ptr, page, nbytes)) {
+    return NULL;
+  }
+
+  /* Locking is a best effort; it fails when we're over RLIMIT_MEMLOCK. */
+  isLocked = (0 == mlock(ptr, nbytes));
+  return (unsigned char*)ptr;
+}
+
+static void frame_queue_free(unsigned char* ptr, size_t nbytes, bool isLocked) {
+
+  if(!ptr) {
+    return;
+  }
+
+  if(isLocked) {
+    munlock(ptr, nbytes);
+  }
+
+  free(ptr);
+}
+
+#endif
@@ -0,0 +1,536 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROXLU_USE_PNG
+#define ROXLU_USE_JPG
+#include <tinylib.h>
+
+#include <tracker/FrameSource.h>
+
+#define Y4M_MAX_HEADER_SIZE 1024
+
+static bool y4m_get_line(MappedFile& file, uint64_t offset, uint64_t& end);
+
+/* ---------------------------------------------------*/
+
+Frame::Frame()
+  :data(NULL)
+  ,nbytes(0)
+  ,index(0)
+  ,width(0)
+  ,height(0)
+  ,format(FRAME_FORMAT_NONE)
+{
+}
+
+/* ---------------------------------------------------*/
+
+FrameSource::FrameSource()
+  :width(0)
+  ,height(0)
+  ,format(FRAME_FORMAT_NONE)
+  ,num_frames(0)
+  ,next_index(0)
+{
+}
+
+FrameSource::~FrameSource() {
+}
+
+/* ---------------------------------------------------*/
+
+Y4MFrameSource::Y4MFrameSource()
+  :fps(0.0)
+  ,frame_size(0)
+  ,first_offset(0)
+  ,frame_stride(0)
+  ,last_offset(0)
+{
+}
+
+Y4MFrameSource::~Y4MFrameSource() {
+  close();
+}
+
+bool Y4MFrameSource::open(std::string filepath) {
+
+  if(!file.open(filepath)) {
+    return false;
+  }
+
+  uint64_t data_offset = 0;
+  if(!parseHeader(data_offset)) {
+    close();
+    return false;
+  }
+
+  frame_size = frame_format_get_num_bytes(format, width, height);
+
+  /* 
+     Frame headers may contain parameters, so in theory every frame can have 
+     a different offset. Writers hardly ever use them; when the first frame 
+     has a plain "FRAME\n" header we assume all of them have one and compute
+     the offsets, so we don't have to touch every frame when opening hours
+     of video. read() checks the header and falls back to a scan.
+  */
+  uint64_t line_end = 0;
+  if(!y4m_get_line(file, data_offset, line_end) || 0 != memcmp(file.data + data_offset, "FRAME", 5)) {
+    printf("Error: no frames in %s.\n", filepath.c_str());
+    close();
+    return false;
+  }
+
+  if(line_end - data_offset == 5) {
+    frame_stride = 6 + frame_size;
+    first_offset = data_offset + 6;
+    num_frames = (file.size - data_offset) / frame_stride;
+  }
+  else if(!scanFrames(data_offset)) {
+    close();
+    return false;
+  }
+
+  if(0 == num_frames) {
+    printf("Error: %s doesn't contain a complete frame.\n", filepath.c_str());
+    close();
+    return false;
+  }
+
+  next_index = 0;
+
+  return true;
+}
+
+bool Y4MFrameSource::parseHeader(uint64_t& dataOffset) {
+
+  uint64_t end = 0;
+  if(!y4m_get_line(file, 0, end) || end < 10 || 0 != memcmp(file.data, "YUV4MPEG2 ", 10)) {
+    printf("Error: %s is not a Y4M file.\n", file.filepath.c_str());
+    return false;
+  }
+
+  std::string header((const char*)file.data, (size_t)end);
+  std::string colorspace = "420";
+  size_t pos = 10;
+
+  while(pos < header.size()) {
+
+    size_t next = header.find(' ', pos);
+    if(next == std::string::npos) {
+      next = header.size();
+    }
+
+    std::string param = header.substr(pos, next - pos);
+    pos = next + 1;
+
+    if(param.size() < 2) {
+      continue;
+    }
+
+    switch(param[0]) {
+      case 'W': { width = atoi(param.c_str() + 1);                            break; }
+      case 'H': { height = atoi(param.c_str() + 1);                           break; }
+      case 'C': { colorspace = param.substr(1);                               break; }
+      case 'F': {
+        int num = 0;
+        int den = 0;
+        if(2 == sscanf(param.c_str() + 1, "%d:%d", &num, &den) && den > 0) {
+          fps = (double)num / den;
+        }
+        break;
+      }
+      default: {
+        /* Interlacing, aspect ratio and extensions don't matter for us. */
+        break;
+      }
+    }
+  }
+
+  if(width <= 0 || height <= 0) {
+    printf("Error: invalid size in the Y4M header of %s.\n", file.filepath.c_str());
+    return false;
+  }
+
+  if(0 == colorspace.compare(0, 3, "420")) {
+    format = FRAME_FORMAT_I420;
+  }
+  else if(colorspace == "mono") {
+    format = FRAME_FORMAT_GRAY;
+  }
+  else {
+    printf("Error: unsupported Y4M colorspace C%s in %s; we support 4:2:0 and mono.\n", colorspace.c_str(), file.filepath.c_str());
+    return false;
+  }
+
+  dataOffset = end + 1;
+
+  return true;
+}
+
+bool Y4MFrameSource::scanFrames(uint64_t dataOffset) {
+
+  uint64_t offset = dataOffset;
+  uint64_t end = 0;
+
+  offsets.clear();
+  frame_stride = 0;
+
+  while(offset < file.size) {
+
+    if(!y4m_get_line(file, offset, end) || 0 != memcmp(file.data + offset, "FRAME", 5)) {
+      printf("Error: invalid frame header at offset %llu in %s.\n", (unsigned long long)offset, file.filepath.c_str());
+      return false;
+    }
+
+    if(end + 1 + frame_size > file.size) {
+      printf("Warning: %s ends with an incomplete frame; we skip it.\n", file.filepath.c_str());
+      break;
+    }
+
+    offsets.push_back(end + 1);
+    offset = end + 1 + frame_size;
+  }
+
+  num_frames = offsets.size();
+
+  return true;
+}
+
+bool Y4MFrameSource::read(Frame& frame) {
+
+  if(!file.isOpen() || next_index >= num_frames) {
+    return false;
+  }
+
+  uint64_t offset = 0;
+
+  if(frame_stride) {
+    offset = first_offset + next_index * frame_stride;
+    if(0 != memcmp(file.data + offset - 6, "FRAME\n", 6)) {
+      printf("Warning: %s has frame parameters, we scan all frames.\n", file.filepath.c_str());
+      if(!scanFrames(first_offset - 6) || next_index >= num_frames) {
+        return false;
+      }
+      offset = offsets[next_index];
+    }
+  }
+  else {
+    offset = offsets[next_index];
+  }
+
+  /* We don't need the previous frame anymore. */
+  if(last_offset) {
+    file.release(last_offset, frame_size);
+  }
+
+  last_offset = offset;
+
+  frame.data = file.data + offset;
+  frame.nbytes = frame_size;
+  frame.index = next_index;
+  frame.width = width;
+  frame.height = height;
+  frame.format = format;
+
+  next_index++;
+
+  return true;
+}
+
+bool Y4MFrameSource::seek(uint64_t index) {
+
+  if(index >= num_frames) {
+    printf("Error: cannot seek to frame %llu, we have %llu frames.\n", (unsigned long long)index, (unsigned long long)num_frames);
+    return false;
+  }
+
+  next_index = index;
+
+  return true;
+}
+
+void Y4MFrameSource::close() {
+  file.close();
+  offsets.clear();
+  num_frames = 0;
+  next_index = 0;
+  frame_stride = 0;
+  last_offset = 0;
+}
+
+/* ---------------------------------------------------*/
+
+RawFrameSource::RawFrameSource(int w, int h, int fmt)
+  :frame_size(0)
+{
+  width = w;
+  height = h;
+  format = fmt;
+}
+
+RawFrameSource::~RawFrameSource() {
+  close();
+}
+
+bool RawFrameSource::open(std::string filepath) {
+
+  frame_size = frame_format_get_num_bytes(format, width, height);
+  if(0 == frame_size) {
+    printf("Error: invalid size or format for the raw file %s.\n", filepath.c_str());
+    return false;
+  }
+
+  if(!file.open(filepath)) {
+    return false;
+  }
+
+  num_frames = file.size / frame_size;
+  next_index = 0;
+
+  if(0 == num_frames) {
+    printf("Error: %s doesn't contain a complete frame.\n", filepath.c_str());
+    close();
+    return false;
+  }
+
+  if(file.size % frame_size) {
+    printf("Warning: %s ends with an incomplete frame; we skip it.\n", filepath.c_str());
+  }
+
+  return true;
+}
+
+bool RawFrameSource::read(Frame& frame) {
+
+  if(!file.isOpen() || next_index >= num_frames) {
+    return false;
+  }
+
+  uint64_t offset = next_index * frame_size;
+
+  if(next_index > 0) {
+    file.release(offset - frame_size, frame_size);
+  }
+
+  frame.data = file.data + offset;
+  frame.nbytes = frame_size;
+  frame.index = next_index;
+  frame.width = width;
+  frame.height = height;
+  frame.format = format;
+
+  next_index++;
+
+  return true;
+}
+
+bool RawFrameSource::seek(uint64_t index) {
+
+  if(index >= num_frames) {
+    printf("Error: cannot seek to frame %llu, we have %llu frames.\n", (unsigned long long)index, (unsigned long long)num_frames);
+    return false;
+  }
+
+  next_index = index;
+
+  return true;
+}
+
+void RawFrameSource::close() {
+  file.close();
+  num_frames = 0;
+  next_index = 0;
+}
+
+/* ---------------------------------------------------*/
+
+ImageSequenceFrameSource::ImageSequenceFrameSource(int firstNumber)
+  :first_number(firstNumber)
+  ,is_jpg(false)
+  ,pixels(NULL)
+  ,allocated(0)
+  ,nchannels(0)
+  ,loaded_index(-1)
+{
+}
+
+ImageSequenceFrameSource::~ImageSequenceFrameSource() {
+  close();
+}
+
+bool ImageSequenceFrameSource::open(std::string filepattern) {
+
+  if(pixels) {
+    printf("Error: cannot open %s, we're already open; call close() first.\n", filepattern.c_str());
+    return false;
+  }
+
+  std::string ext;
+  size_t dot = filepattern.rfind('.');
+  if(dot != std::string::npos) {
+    ext = filepattern.substr(dot + 1);
+    for(size_t i = 0; i < ext.size(); ++i) {
+      ext[i] = tolower(ext[i]);
+    }
+  }
+
+  if(ext == "jpg" || ext == "jpeg") {
+    is_jpg = true;
+  }
+  else if(ext == "png") {
+    is_jpg = false;
+  }
+  else {
+    printf("Error: we only support png and jpg image sequences: %s.\n", filepattern.c_str());
+    return false;
+  }
+
+  pattern = filepattern;
+  width = 0;
+  height = 0;
+  num_frames = 0;
+
+  /* Load the first image to get the size and format. */
+  if(!load(0)) {
+    printf("Error: cannot load the first image of %s.\n", filepattern.c_str());
+    close();
+    return false;
+  }
+
+  next_index = 0;
+
+  return true;
+}
+
+bool ImageSequenceFrameSource::load(uint64_t index) {
+
+  char filepath[1024];
+  int w = 0;
+  int h = 0;
+  int nchan = 0;
+  int nbytes = 0;
+
+  snprintf(filepath, sizeof(filepath), pattern.c_str(), (int)(first_number + index));
+
+  if(is_jpg) {
+    nbytes = rx_load_jpg(filepath, &pixels, w, h, nchan, &allocated);
+  }
+  else {
+    nbytes = rx_load_png(filepath, &pixels, w, h, nchan, &allocated);
+  }
+
+  if(nbytes <= 0) {
+    loaded_index = -1;
+    return false;
+  }
+
+  if(0 == width) {
+    width = w;
+    height = h;
+    nchannels = nchan;
+    switch(nchan) {
+      case 1:  { format = FRAME_FORMAT_GRAY;   break; }
+      case 3:  { format = FRAME_FORMAT_RGB24;  break; }
+      case 4:  { format = FRAME_FORMAT_RGBA;   break; }
+      default: {
+        printf("Error: unsupported number of channels (%d) in %s.\n", nchan, filepath);
+        loaded_index = -1;
+        return false;
+      }
+    }
+  }
+  else if(w != width || h != height || nchan != nchannels) {
+    printf("Error: %s has a different size or number of channels than the first image.\n", filepath);
+    loaded_index = -1;
+    return false;
+  }
+
+  loaded_index = (int64_t)index;
+
+  return true;
+}
+
+bool ImageSequenceFrameSource::read(Frame& frame) {
+
+  /* open() and seek() already loaded the image. */
+  if(!pixels || (loaded_index != (int64_t)next_index && !load(next_index))) {
+    return false;
+  }
+
+  frame.data = pixels;
+  frame.nbytes = frame_format_get_num_bytes(format, width, height);
+  frame.index = next_index;
+  frame.width = width;
+  frame.height = height;
+  frame.format = format;
+
+  next_index++;
+
+  return true;
+}
+
+bool ImageSequenceFrameSource::seek(uint64_t index) {
+
+  if(!pixels) {
+    return false;
+  }
+
+  if(!load(index)) {
+    printf("Error: cannot seek to image %llu.\n", (unsigned long long)index);
+    return false;
+  }
+
+  next_index = index;
+
+  return true;
+}
+
+void ImageSequenceFrameSource::close() {
+
+  if(pixels) {
+    delete[] pixels;
+    pixels = NULL;
+  }
+
+  allocated = 0;
+  next_index = 0;
+  loaded_index = -1;
+}
+
+/* ---------------------------------------------------*/
+
+uint64_t frame_format_get_num_bytes(int fmt, int w, int h) {
+
+  if(w <= 0 || h <= 0) {
+    return 0;
+  }
+
+  uint64_t n = (uint64_t)w * h;
+
+  switch(fmt) {
+    case FRAME_FORMAT_RGB24: { return n * 3;                                         }
+    case FRAME_FORMAT_RGBA:  { return n * 4;                                         }
+    case FRAME_FORMAT_GRAY:  { return n;                                             }
+    case FRAME_FORMAT_I420:  { return n + 2 * (uint64_t)((w + 1) / 2) * ((h + 1) / 2); }
+    default:                 { return 0;                                             }
+  }
+}
+
+/* ---------------------------------------------------*/
+
+/* Finds the '\n' that ends the line which starts at `offset`. */
+static bool y4m_get_line(MappedFile& file, uint64_t offset, uint64_t& end) {
+
+  uint64_t max = offset + Y4M_MAX_HEADER_SIZE;
+  max = (max > file.size) ? file.size : max;
+
+  for(uint64_t i = offset; i < max; ++i) {
+    if(file.data[i] == '\n') {
+      end = i;
+      return true;
+    }
+  }
+
+  return false;
+}
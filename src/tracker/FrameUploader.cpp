@@ -0,0 +1,231 @@
+#include <tracker/FrameUploader.h>
+#include <tracker/BackgroundBuffer.h>
+#include <tracker/ProgramCache.h>
+#include <string.h>
+#include <sstream>
+
+FrameUploader::FrameUploader()
+  :width(0)
+  ,height(0)
+  ,format(FRAME_FORMAT_NONE)
+  ,frame_size(0)
+  ,pbo_index(0)
+  ,prog(0)
+  ,vao(0)
+  ,num_uploaded(0)
+{
+  memset(pbos, 0, sizeof(pbos));
+  memset(tex, 0, sizeof(tex));
+}
+
+FrameUploader::~FrameUploader() {
+  shutdown();
+}
+
+bool FrameUploader::setup(int w, int h, int fmt) {
+
+  if(prog) {
+    printf("Error: the FrameUploader is already setup; call shutdown() first.\n");
+    return false;
+  }
+
+  frame_size = frame_format_get_num_bytes(fmt, w, h);
+  if(0 == frame_size) {
+    printf("Error: invalid frame size or format: %dx%d, format: %d\n", w, h, fmt);
+    return false;
+  }
+
+  width = w;
+  height = h;
+  format = fmt;
+
+  std::stringstream ss;
+  ss << "#version 330\n";
+
+  switch(format) {
+    case FRAME_FORMAT_RGB24: {
+      tex[0] = createTexture(GL_RGB8, w, h);
+      break;
+    }
+    case FRAME_FORMAT_RGBA: {
+      tex[0] = createTexture(GL_RGBA8, w, h);
+      break;
+    }
+    case FRAME_FORMAT_GRAY: {
+      tex[0] = createTexture(GL_R8, w, h);
+      ss << "#define FRAME_GRAY\n";
+      break;
+    }
+    case FRAME_FORMAT_I420: {
+      tex[0] = createTexture(GL_R8, w, h);
+      tex[1] = createTexture(GL_R8, (w + 1) / 2, (h + 1) / 2);
+      tex[2] = createTexture(GL_R8, (w + 1) / 2, (h + 1) / 2);
+      ss << "#define FRAME_I420\n";
+      break;
+    }
+  }
+
+  ss << FRAME_UPLOADER_FS;
+
+  std::string fs = ss.str();
+  prog = tracker_program_cache().createProgram(BG_BUFFER_VS, fs.c_str());
+  glUseProgram(prog);
+  rx_uniform_1i(prog, "u_tex_y", 0);
+  if(format == FRAME_FORMAT_I420) {
+    rx_uniform_1i(prog, "u_tex_u", 1);
+    rx_uniform_1i(prog, "u_tex_v", 2);
+  }
+
+  glGenVertexArrays(1, &vao);
+
+  glGenBuffers(FRAME_UPLOADER_NUM_PBOS, pbos);
+  for(int i = 0; i < FRAME_UPLOADER_NUM_PBOS; ++i) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_size, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  pbo_index = 0;
+  num_uploaded = 0;
+
+  return true;
+}
+
+GLuint FrameUploader::createTexture(GLenum internalFormat, int texW, int texH) {
+
+  GLenum fmt = GL_RED;
+  if(internalFormat == GL_RGB8) {
+    fmt = GL_RGB;
+  }
+  else if(internalFormat == GL_RGBA8) {
+    fmt = GL_RGBA;
+  }
+
+  GLuint t = 0;
+  glGenTextures(1, &t);
+  glBindTexture(GL_TEXTURE_2D, t);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, texW, texH, 0, fmt, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  return t;
+}
+
+bool FrameUploader::upload(Frame& frame) {
+
+  if(!prog) {
+    printf("Error: cannot upload a frame, the FrameUploader is not setup.\n");
+    return false;
+  }
+
+  if(frame.width != width || frame.height != height || frame.format != format || frame.nbytes < frame_size) {
+    printf("Error: frame %llu has a different size or format than the FrameUploader.\n", (unsigned long long)frame.index);
+    return false;
+  }
+
+  /* Orphan the buffer so we never wait for a transfer that is still using it. */
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[pbo_index]);
+  unsigned char* ptr = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frame_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if(!ptr) {
+    printf("Error: cannot map the pixel unpack buffer.\n");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+
+  memcpy(ptr, frame.data, frame_size);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  switch(format) {
+    case FRAME_FORMAT_RGB24: {
+      glBindTexture(GL_TEXTURE_2D, tex[0]);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+      break;
+    }
+    case FRAME_FORMAT_RGBA: {
+      glBindTexture(GL_TEXTURE_2D, tex[0]);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+      break;
+    }
+    case FRAME_FORMAT_GRAY: {
+      glBindTexture(GL_TEXTURE_2D, tex[0]);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, 0);
+      break;
+    }
+    case FRAME_FORMAT_I420: {
+      int cw = (width + 1) / 2;
+      int ch = (height + 1) / 2;
+      size_t u_offset = (size_t)width * height;
+      size_t v_offset = u_offset + (size_t)cw * ch;
+      glBindTexture(GL_TEXTURE_2D, tex[0]);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, 0);
+      glBindTexture(GL_TEXTURE_2D, tex[1]);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cw, ch, GL_RED, GL_UNSIGNED_BYTE, (GLvoid*)u_offset);
+      glBindTexture(GL_TEXTURE_2D, tex[2]);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cw, ch, GL_RED, GL_UNSIGNED_BYTE, (GLvoid*)v_offset);
+      break;
+    }
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  pbo_index = (pbo_index + 1) % FRAME_UPLOADER_NUM_PBOS;
+  num_uploaded++;
+
+  return true;
+}
+
+void FrameUploader::draw() {
+
+  if(!prog || 0 == num_uploaded) {
+    return;
+  }
+
+  glBindVertexArray(vao);
+  glUseProgram(prog);
+
+  for(int i = 2; i >= 0; --i) {
+    if(tex[i]) {
+      glActiveTexture(GL_TEXTURE0 + i);
+      glBindTexture(GL_TEXTURE_2D, tex[i]);
+    }
+  }
+
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void FrameUploader::shutdown() {
+
+  if(pbos[0]) {
+    glDeleteBuffers(FRAME_UPLOADER_NUM_PBOS, pbos);
+    memset(pbos, 0, sizeof(pbos));
+  }
+
+  for(int i = 0; i < 3; ++i) {
+    if(tex[i]) {
+      glDeleteTextures(1, &tex[i]);
+      tex[i] = 0;
+    }
+  }
+
+  if(vao) {
+    glDeleteVertexArrays(1, &vao);
+    vao = 0;
+  }
+
+  if(prog) {
+    glDeleteProgram(prog);
+    prog = 0;
+  }
+
+  width = 0;
+  height = 0;
+  format = FRAME_FORMAT_NONE;
+  frame_size = 0;
+  num_uploaded = 0;
+}
@@ -0,0 +1,103 @@
+#include <string.h>
+#include <tracker/GlPipeline.h>
+
+/* ---------------------------------------------------*/
+
+GlContext::GlContext(int w, int h, Timings& timings)
+  :w(w)
+  ,h(h)
+  ,timings(timings)
+  ,gpu_timer(timings)
+  ,pbo_toggle(0)
+  ,read_fbo(0)
+  ,read_tex(0)
+{
+  graph.pool = &targets;
+
+  // PBOs for async read back
+  int nbytes = w * h;
+  glGenBuffers(2, pbos);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[0]);
+  glBufferData(GL_PIXEL_PACK_BUFFER, nbytes, NULL, GL_STREAM_COPY);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[1]);
+  glBufferData(GL_PIXEL_PACK_BUFFER, nbytes, NULL, GL_STREAM_COPY);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  glGenFramebuffers(1, &read_fbo);
+}
+
+GlContext::~GlContext() {
+  glDeleteBuffers(2, pbos);
+  glDeleteFramebuffers(1, &read_fbo);
+  targets.shutdown();
+}
+
+void GlContext::beginFrame() {
+  gpu_timer.beginFrame();
+  graph.clear();
+  targets.reset();
+}
+
+bool GlContext::transfer(GLuint mask, const FrameInfo& frame, BlobTracker& blobs) {
+
+  // Attach the mask to our read fbo; we keep the attachment while the mask doesn't change.
+  if(mask != read_tex) {
+    GLint prev_read_fbo = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mask, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_fbo);
+    read_tex = mask;
+  }
+
+  // Read back the mask into PBO "A"
+  graph.addReadPixelsPass(TRACKER_STAGE_READBACK, read_fbo, pbos[pbo_toggle], w, h, GL_RED, blobs.getInputImageRowLength());
+  pbo_frames[pbo_toggle] = frame;
+
+  graph.execute(&gpu_timer);
+
+  // Copy the pixels from the previous read back (PBO "B")
+  timings.beginCpu(TRACKER_STAGE_MAP);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[1 - pbo_toggle]);
+  unsigned char* ptr = (unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  if(ptr) {
+    memcpy(blobs.getInputImagePtr(), ptr,  w * h);
+  }
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, graph.state.saved_pack_buffer);
+  timings.endCpu(TRACKER_STAGE_MAP);
+
+  // The mask we just copied belongs to the frame of the previous transfer().
+  blobs.frame = pbo_frames[1 - pbo_toggle];
+  pbo_toggle = 1 - pbo_toggle;
+
+  return NULL != ptr;
+}
+
+size_t GlContext::getNumBytes() {
+  return targets.getNumBytes() + 2 * (size_t)w * (size_t)h;
+}
+
+/* ---------------------------------------------------*/
+
+GlMorphology::GlMorphology(int w, int h)
+  :edt(w, h)
+  ,erode_steps(2)
+  ,dilate_steps(3)
+{
+}
+
+/* ---------------------------------------------------*/
+
+GlSmoothing::GlSmoothing(int w, int h)
+  :blur(w, h)
+  ,edt(w, h)
+{
+  // We only blur the one channel mask.
+  blur.target_format = GL_R8;
+
+  if(!blur.setup(1.0, 10, 1)) {
+    printf("Error: cannot setup the blur handler.\n");
+    ::exit(EXIT_FAILURE);
+  }
+}
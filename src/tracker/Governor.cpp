@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <tracker/Governor.h>
+#include <tracker/Timings.h>
+
+/* ---------------------------------------------------*/
+
+Governor::Governor()
+  :budget_ms(12.0)
+  ,down_ratio(0.6)
+  ,up_frames(3)
+  ,up_window(8)
+  ,down_frames(60)
+  ,idle_coverage(0.001f)
+  ,idle_after_ms(3000.0)
+  ,idle_interval_ms(250.0)
+  ,level(0)
+  ,is_idle(false)
+  ,num_over(0)
+  ,over_history(0)
+  ,num_under(0)
+  ,last_active_ns(0)
+  ,last_process_ns(0)
+  ,callback(NULL)
+  ,user(NULL)
+{
+  GovernorLevel defaults[GOVERNOR_NUM_LEVELS] = {
+    /* erode, dilate, label scale, track interval, max blobs */
+    { 2, 3, 1, 1, 0 },
+    { 1, 2, 1, 1, 0 },
+    { 1, 2, 2, 1, 0 },
+    { 1, 2, 2, 2, 0 },
+    { 1, 2, 2, 2, 32 }
+  };
+
+  for(int i = 0; i < GOVERNOR_NUM_LEVELS; ++i) {
+    levels[i] = defaults[i];
+  }
+}
+
+bool Governor::shouldProcess(uint64_t nowNs) {
+
+  uint64_t now = (nowNs) ? nowNs : tracker_now_ns();
+
+  if(is_idle && (now - last_process_ns) < (uint64_t)(idle_interval_ms * 1e6)) {
+    return false;
+  }
+
+  last_process_ns = now;
+
+  return true;
+}
+
+void Governor::update(double frameMs, float coverage, uint64_t nowNs) {
+
+  uint64_t now = (nowNs) ? nowNs : tracker_now_ns();
+
+  /* Idle detection. */
+  if(0 == last_active_ns || coverage >= idle_coverage) {
+    last_active_ns = now;
+    if(is_idle) {
+      is_idle = false;
+      notify(GOVERNOR_EVENT_ACTIVE);
+    }
+  }
+  else if(!is_idle && (now - last_active_ns) >= (uint64_t)(idle_after_ms * 1e6)) {
+    is_idle = true;
+    notify(GOVERNOR_EVENT_IDLE);
+  }
+
+  /* Load: one level at a time with hysteresis, so we don't oscillate. */
+  int window = (up_window < 1) ? 1 : (up_window > 32) ? 32 : up_window;
+  uint32_t mask = (32 == window) ? 0xFFFFFFFFu : ((1u << window) - 1u);
+
+  over_history = ((over_history << 1) | ((frameMs > budget_ms) ? 1u : 0u)) & mask;
+  num_over = 0;
+  for(uint32_t bits = over_history; 0 != bits; bits &= bits - 1) {
+    ++num_over;
+  }
+
+  num_under = (frameMs < budget_ms * down_ratio) ? num_under + 1 : 0;
+
+  if(num_over >= up_frames && level < GOVERNOR_NUM_LEVELS - 1) {
+    setLevel(level + 1);
+  }
+  else if(num_under >= down_frames && level > 0) {
+    setLevel(level - 1);
+  }
+}
+
+void Governor::setLevel(int lvl) {
+
+  if(lvl < 0 || lvl >= GOVERNOR_NUM_LEVELS) {
+    printf("Error: invalid governor level: %d\n", lvl);
+    return;
+  }
+
+  num_over = 0;
+  num_under = 0;
+  over_history = 0;
+
+  if(lvl == level) {
+    return;
+  }
+
+  level = lvl;
+  notify(GOVERNOR_EVENT_LEVEL);
+}
+
+void Governor::notify(int event) {
+  if(callback) {
+    callback(this, event, user);
+  }
+}
@@ -0,0 +1,103 @@
+#include <tracker/GpuTimer.h>
+#include <stdio.h>
+#include <string.h>
+
+GpuTimer::GpuTimer(Timings& timings)
+  :timings(timings)
+  ,frame(0)
+  ,active_stage(-1)
+  ,is_measuring(false)
+{
+  memset(queries, 0, sizeof(queries));
+  memset(pending, 0, sizeof(pending));
+}
+
+GpuTimer::~GpuTimer() {
+
+  if(queries[0][0]) {
+    glDeleteQueries(GPU_TIMER_FRAMES * TRACKER_STAGE_COUNT, &queries[0][0]);
+  }
+
+  memset(queries, 0, sizeof(queries));
+}
+
+void GpuTimer::beginFrame() {
+
+  if(active_stage >= 0) {
+    printf("Error: GpuTimer::beginFrame() called while measuring a stage.\n");
+    end();
+  }
+
+  is_measuring = timings.isEnabled();
+  if(!is_measuring) {
+    return;
+  }
+
+  if(!queries[0][0]) {
+    glGenQueries(GPU_TIMER_FRAMES * TRACKER_STAGE_COUNT, &queries[0][0]);
+  }
+
+  /* Move to the oldest set and read what was issued GPU_TIMER_FRAMES frames ago. */
+  frame = (frame + 1) % GPU_TIMER_FRAMES;
+  collect(frame);
+}
+
+void GpuTimer::begin(int stage) {
+
+  if(!is_measuring) {
+    return;
+  }
+
+  if(active_stage >= 0) {
+    printf("Error: GpuTimer::begin(%s) called while measuring %s.\n", Timings::getStageName(stage), Timings::getStageName(active_stage));
+    return;
+  }
+
+  if(stage < 0 || stage >= TRACKER_STAGE_COUNT) {
+    printf("Error: invalid timing stage: %d\n", stage);
+    return;
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED, queries[frame][stage]);
+  active_stage = stage;
+}
+
+void GpuTimer::end() {
+
+  if(active_stage < 0) {
+    return;
+  }
+
+  glEndQuery(GL_TIME_ELAPSED);
+  pending[frame][active_stage] = true;
+  active_stage = -1;
+}
+
+void GpuTimer::collect(int dx) {
+
+  for(int i = 0; i < TRACKER_STAGE_COUNT; ++i) {
+
+    if(!pending[dx][i]) {
+      continue;
+    }
+
+    pending[dx][i] = false;
+
+    /* Not available yet; we drop the sample instead of waiting. */
+    GLint available = 0;
+    glGetQueryObjectiv(queries[dx][i], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available) {
+      continue;
+    }
+
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(queries[dx][i], GL_QUERY_RESULT, &ns);
+
+    /* Mesa's llvmpipe returns a timestamp instead of a duration when the query starts on an empty command stream. */
+    if(ns > GPU_TIMER_MAX_NS) {
+      continue;
+    }
+
+    timings.addSample(i, ns / 1e6);
+  }
+}
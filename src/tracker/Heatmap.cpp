@@ -0,0 +1,268 @@
+#include <tracker/Heatmap.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+Heatmap::Heatmap(int w, int h, int scale)
+  :w(w)
+  ,h(h)
+  ,scale(scale)
+  ,down_w(0)
+  ,down_h(0)
+  ,half_life_ms(0.0f)
+  ,readback_interval_ms(1000)
+  ,max_frame_ms(250.0f)
+  ,fullscreen_vao(0)
+  ,accumulate_prog(0)
+  ,downsample_prog(0)
+  ,u_decay(-1)
+  ,u_weight(-1)
+  ,u_scale(-1)
+  ,current(0)
+  ,down_fbo(0)
+  ,down_tex(0)
+  ,pbo(0)
+  ,fence(0)
+  ,is_reading(false)
+  ,needs_clear(true)
+  ,last_frame_ns(0)
+  ,last_readback_ns(0)
+  ,has_new_values(false)
+  ,num_readbacks(0)
+{
+  if(w <= 0 || h <= 0 || scale <= 0) {
+    printf("Error: invalid size or scale for the heatmap.\n");
+    ::exit(EXIT_FAILURE);
+  }
+
+  down_w = (w + scale - 1) / scale;
+  down_h = (h + scale - 1) / scale;
+  values.assign(down_w * down_h, 0.0f);
+
+  fbo[0] = fbo[1] = 0;
+  tex[0] = tex[1] = 0;
+
+  glGenVertexArrays(1, &fullscreen_vao);
+
+  ProgramCache& cache = tracker_program_cache();
+  accumulate_prog = cache.createProgram(ROXLU_OPENGL_FULLSCREEN_VS, HEATMAP_ACCUMULATE_FS);
+  glUseProgram(accumulate_prog);
+  rx_uniform_1i(accumulate_prog, "u_heat", 0);
+  rx_uniform_1i(accumulate_prog, "u_mask", 1);
+  u_decay = glGetUniformLocation(accumulate_prog, "u_decay");
+  u_weight = glGetUniformLocation(accumulate_prog, "u_weight");
+
+  downsample_prog = cache.createProgram(ROXLU_OPENGL_FULLSCREEN_VS, HEATMAP_DOWNSAMPLE_FS);
+  glUseProgram(downsample_prog);
+  rx_uniform_1i(downsample_prog, "u_tex", 0);
+  u_scale = glGetUniformLocation(downsample_prog, "u_scale");
+
+  // The textures are created on first use, see setup().
+}
+
+Heatmap::~Heatmap() {
+
+  if(fence) {
+    glDeleteSync(fence);
+  }
+
+  if(fbo[0]) {
+    glDeleteFramebuffers(2, fbo);
+    glDeleteTextures(2, tex);
+  }
+
+  if(down_fbo) {
+    glDeleteFramebuffers(1, &down_fbo);
+    glDeleteTextures(1, &down_tex);
+  }
+
+  if(pbo) {
+    glDeleteBuffers(1, &pbo);
+  }
+
+  if(fullscreen_vao) {
+    glDeleteVertexArrays(1, &fullscreen_vao);
+  }
+
+  fence = 0;
+  pbo = 0;
+  fullscreen_vao = 0;
+}
+
+GLuint Heatmap::apply(RenderGraph& graph, GLuint maskTex, const FrameInfo& frame) {
+
+  if(!setup()) {
+    return 0;
+  }
+
+  /* The weight is the time this mask was visible, so the heatmap is in seconds and doesn't depend on the frame rate. */
+  float dt_ms = 0.0f;
+  if(0 != last_frame_ns && frame.capture_ns > last_frame_ns) {
+    dt_ms = (frame.capture_ns - last_frame_ns) / 1e6;
+    dt_ms = (dt_ms > max_frame_ms) ? max_frame_ms : dt_ms;
+  }
+
+  float decay = (half_life_ms > 0.0f) ? exp2f(-dt_ms / half_life_ms) : 1.0f;
+  if(needs_clear) {
+    decay = 0.0f;
+    needs_clear = false;
+  }
+
+  last_frame_ns = frame.capture_ns;
+
+  int next = 1 - current;
+  RenderPass& pass = graph.addDrawPass(TRACKER_STAGE_HEATMAP, accumulate_prog, fullscreen_vao, fbo[next], tex[next], w, h);
+  pass.input(tex[current]);
+  pass.input(maskTex);
+  pass.uniform1f(u_decay, decay);
+  pass.uniform1f(u_weight, dt_ms / 1000.0f);
+  current = next;
+
+  /* We only have one pack buffer; while a read back is in flight we wait with the next one. When the capture time went back we restart the interval. */
+  bool is_early = frame.capture_ns >= last_readback_ns && frame.capture_ns - last_readback_ns < readback_interval_ms * 1000000ull;
+  if(is_reading || is_early) {
+    return tex[current];
+  }
+
+  RenderPass& down = graph.addDrawPass(TRACKER_STAGE_HEATMAP, downsample_prog, fullscreen_vao, down_fbo, down_tex, down_w, down_h);
+  down.input(tex[current]);
+  down.uniform1i(u_scale, scale);
+
+  graph.addReadPixelsPass(TRACKER_STAGE_HEATMAP, down_fbo, pbo, down_w, down_h, GL_RED, down_w, GL_FLOAT);
+
+  is_reading = true;
+  last_readback_ns = frame.capture_ns;
+  readback_frame = frame;
+
+  return tex[current];
+}
+
+bool Heatmap::update() {
+
+  has_new_values = false;
+
+  if(!is_reading) {
+    return false;
+  }
+
+  /* The read back passes were executed in this frame. */
+  if(0 == fence) {
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    return false;
+  }
+
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if(GL_TIMEOUT_EXPIRED == status) {
+    return false;
+  }
+
+  glDeleteSync(fence);
+  fence = 0;
+  is_reading = false;
+
+  if(GL_WAIT_FAILED == status) {
+    printf("Error: waiting for the heatmap read back failed.\n");
+    return false;
+  }
+
+  GLint saved_pack_buffer = 0;
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &saved_pack_buffer);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+
+  float* ptr = (float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, values.size() * sizeof(float), GL_MAP_READ_BIT);
+  if(ptr) {
+    memcpy(&values[0], ptr, values.size() * sizeof(float));
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    values_frame = readback_frame;
+    has_new_values = true;
+    ++num_readbacks;
+  }
+  else {
+    printf("Error: cannot map the heatmap pack buffer.\n");
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, saved_pack_buffer);
+
+  return has_new_values;
+}
+
+void Heatmap::reset() {
+  needs_clear = true;
+  std::fill(values.begin(), values.end(), 0.0f);
+}
+
+size_t Heatmap::getNumBytes() {
+
+  size_t nbytes = 0;
+
+  if(fbo[0]) {
+    nbytes += 2 * w * h * sizeof(float);
+  }
+
+  if(down_fbo) {
+    nbytes += 2 * down_w * down_h * sizeof(float);  /* down_tex and pbo */
+  }
+
+  return nbytes;
+}
+
+bool Heatmap::setup() {
+
+  if(fbo[0]) {
+    return true;
+  }
+
+  if(!createTarget(fbo[0], tex[0], w, h)
+     || !createTarget(fbo[1], tex[1], w, h)
+     || !createTarget(down_fbo, down_tex, down_w, down_h))
+    {
+      return false;
+    }
+
+  GLint saved_pack_buffer = 0;
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &saved_pack_buffer);
+  glGenBuffers(1, &pbo);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+  glBufferData(GL_PIXEL_PACK_BUFFER, down_w * down_h * sizeof(float), NULL, GL_STREAM_READ);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, saved_pack_buffer);
+
+  current = 0;
+  needs_clear = true;
+
+  return true;
+}
+
+bool Heatmap::createTarget(GLuint& outFbo, GLuint& outTex, int tw, int th) {
+
+  GLint saved_fbo = 0;
+  GLint saved_tex = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &saved_fbo);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &saved_tex);
+
+  glGenFramebuffers(1, &outFbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+
+  /* Zero filled, so the first accumulation never reads garbage. */
+  std::vector<float> zeros(tw * th, 0.0f);
+  glGenTextures(1, &outTex);
+  glBindTexture(GL_TEXTURE_2D, outTex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, tw, th, 0, GL_RED, GL_FLOAT, &zeros[0]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outTex, 0);
+
+  bool is_complete = (GL_FRAMEBUFFER_COMPLETE == glCheckFramebufferStatus(GL_FRAMEBUFFER));
+
+  glBindFramebuffer(GL_FRAMEBUFFER, saved_fbo);
+  glBindTexture(GL_TEXTURE_2D, saved_tex);
+
+  if(!is_complete) {
+    printf("Error: the heatmap framebuffer is not complete.\n");
+    return false;
+  }
+
+  return true;
+}
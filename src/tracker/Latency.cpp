@@ -0,0 +1,116 @@
+#include <tracker/Latency.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ---------------------------------------------------*/
+
+FrameInfo::FrameInfo()
+  :id(0)
+  ,capture_ns(0)
+{
+}
+
+/* ---------------------------------------------------*/
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  sum_ns = 0;
+  min_ns = UINT64_MAX;
+  max_ns = 0;
+}
+
+void LatencyHistogram::add(uint64_t ns) {
+
+  uint64_t us = ns / 1000;
+  int bucket = 0;
+
+  if(us > 0) {
+
+    int octave = 0;
+    while((us >> (octave + 1)) != 0) {
+      ++octave;
+    }
+
+    int sub = (int)(((us - (1ULL << octave)) * LATENCY_SUB_BUCKETS) >> octave);
+    bucket = octave * LATENCY_SUB_BUCKETS + sub;
+
+    if(bucket >= LATENCY_NUM_BUCKETS) {
+      bucket = LATENCY_NUM_BUCKETS - 1;
+    }
+  }
+
+  buckets[bucket]++;
+  count++;
+  sum_ns += ns;
+
+  if(ns < min_ns) {
+    min_ns = ns;
+  }
+  if(ns > max_ns) {
+    max_ns = ns;
+  }
+}
+
+double LatencyHistogram::getPercentile(double p) {
+
+  if(count == 0) {
+    return 0.0;
+  }
+
+  uint64_t rank = (uint64_t)((p / 100.0) * count + 0.5);
+  if(rank < 1) {
+    rank = 1;
+  }
+
+  uint64_t total = 0;
+  for(int i = 0; i < LATENCY_NUM_BUCKETS; ++i) {
+    total += buckets[i];
+    if(total >= rank) {
+      return getBucketUpperBound(i);
+    }
+  }
+
+  return getBucketUpperBound(LATENCY_NUM_BUCKETS - 1);
+}
+
+double LatencyHistogram::getAverage() {
+
+  if(count == 0) {
+    return 0.0;
+  }
+
+  return (sum_ns / (double)count) / 1e6;
+}
+
+double LatencyHistogram::getBucketUpperBound(int bucket) {
+
+  int octave = bucket / LATENCY_SUB_BUCKETS;
+  int sub = bucket % LATENCY_SUB_BUCKETS;
+  double base = (double)(1ULL << octave);
+  double us = base + (sub + 1) * base / LATENCY_SUB_BUCKETS;
+
+  return us / 1000.0;
+}
+
+void LatencyHistogram::print(const char* name) {
+
+  printf("%s: n=%llu, avg=%.3fms, p50=%.3fms, p99=%.3fms, max=%.3fms\n",
+         name,
+         (unsigned long long)count,
+         getAverage(),
+         getPercentile(50.0),
+         getPercentile(99.0),
+         max_ns / 1e6);
+
+  for(int i = 0; i < LATENCY_NUM_BUCKETS; ++i) {
+    if(buckets[i] == 0) {
+      continue;
+    }
+    printf("  <= %10.3fms: %llu\n", getBucketUpperBound(i), (unsigned long long)buckets[i]);
+  }
+}
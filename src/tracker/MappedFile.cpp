@@ -0,0 +1,287 @@
+#include <tracker/MappedFile.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+  :data(NULL)
+  ,size(0)
+  ,is_writable(false)
+#if defined(_WIN32)
+  ,file_handle(NULL)
+  ,map_handle(NULL)
+#else
+  ,fd(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(std::string path, bool sequential) {
+
+  if(isOpen()) {
+    printf("Error: cannot open %s, we already mapped %s.\n", path.c_str(), filepath.c_str());
+    return false;
+  }
+
+  DWORD flags = FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0);
+  HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+  if(INVALID_HANDLE_VALUE == fh) {
+    printf("Error: cannot open %s.\n", path.c_str());
+    return false;
+  }
+
+  LARGE_INTEGER fsize;
+  if(!GetFileSizeEx(fh, &fsize) || 0 == fsize.QuadPart) {
+    printf("Error: cannot map %s, the file is empty.\n", path.c_str());
+    CloseHandle(fh);
+    return false;
+  }
+
+  HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+  if(NULL == mh) {
+    printf("Error: cannot create a file mapping for %s.\n", path.c_str());
+    CloseHandle(fh);
+    return false;
+  }
+
+  void* ptr = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+  if(NULL == ptr) {
+    printf("Error: cannot map %s.\n", path.c_str());
+    CloseHandle(mh);
+    CloseHandle(fh);
+    return false;
+  }
+
+  filepath = path;
+  file_handle = fh;
+  map_handle = mh;
+  data = (unsigned char*)ptr;
+  size = (uint64_t)fsize.QuadPart;
+  is_writable = false;
+
+  return true;
+}
+
+bool MappedFile::create(std::string path, uint64_t nbytes) {
+
+  if(isOpen()) {
+    printf("Error: cannot create %s, we already mapped %s.\n", path.c_str(), filepath.c_str());
+    return false;
+  }
+
+  if(0 == nbytes) {
+    printf("Error: cannot create %s with a size of 0 bytes.\n", path.c_str());
+    return false;
+  }
+
+  HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(INVALID_HANDLE_VALUE == fh) {
+    printf("Error: cannot create %s.\n", path.c_str());
+    return false;
+  }
+
+  /* The mapping grows the file to its size. */
+  HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READWRITE, (DWORD)(nbytes >> 32), (DWORD)(nbytes & 0xFFFFFFFF), NULL);
+  if(NULL == mh) {
+    printf("Error: cannot create a file mapping for %s.\n", path.c_str());
+    CloseHandle(fh);
+    return false;
+  }
+
+  void* ptr = MapViewOfFile(mh, FILE_MAP_WRITE, 0, 0, 0);
+  if(NULL == ptr) {
+    printf("Error: cannot map %s.\n", path.c_str());
+    CloseHandle(mh);
+    CloseHandle(fh);
+    return false;
+  }
+
+  filepath = path;
+  file_handle = fh;
+  map_handle = mh;
+  data = (unsigned char*)ptr;
+  size = nbytes;
+  is_writable = true;
+
+  return true;
+}
+
+bool MappedFile::flush() {
+
+  if(!data || !is_writable) {
+    return false;
+  }
+
+  if(!FlushViewOfFile(data, 0) || !FlushFileBuffers((HANDLE)file_handle)) {
+    printf("Error: cannot flush %s.\n", filepath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::close() {
+
+  if(data) {
+    UnmapViewOfFile(data);
+    data = NULL;
+  }
+  if(map_handle) {
+    CloseHandle((HANDLE)map_handle);
+    map_handle = NULL;
+  }
+  if(file_handle) {
+    CloseHandle((HANDLE)file_handle);
+    file_handle = NULL;
+  }
+
+  size = 0;
+  is_writable = false;
+}
+
+void MappedFile::release(uint64_t offset, uint64_t nbytes) {
+}
+
+#else
+
+bool MappedFile::open(std::string path, bool sequential) {
+
+  if(isOpen()) {
+    printf("Error: cannot open %s, we already mapped %s.\n", path.c_str(), filepath.c_str());
+    return false;
+  }
+
+  int fh = ::open(path.c_str(), O_RDONLY);
+  if(fh < 0) {
+    printf("Error: cannot open %s.\n", path.c_str());
+    return false;
+  }
+
+  struct stat st;
+  if(0 != fstat(fh, &st) || 0 == st.st_size) {
+    printf("Error: cannot map %s, the file is empty.\n", path.c_str());
+    ::close(fh);
+    return false;
+  }
+
+  void* ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fh, 0);
+  if(MAP_FAILED == ptr) {
+    printf("Error: cannot map %s.\n", path.c_str());
+    ::close(fh);
+    return false;
+  }
+
+  if(sequential) {
+    madvise(ptr, (size_t)st.st_size, MADV_SEQUENTIAL);
+  }
+
+  filepath = path;
+  fd = fh;
+  data = (unsigned char*)ptr;
+  size = (uint64_t)st.st_size;
+  is_writable = false;
+
+  return true;
+}
+
+bool MappedFile::create(std::string path, uint64_t nbytes) {
+
+  if(isOpen()) {
+    printf("Error: cannot create %s, we already mapped %s.\n", path.c_str(), filepath.c_str());
+    return false;
+  }
+
+  if(0 == nbytes) {
+    printf("Error: cannot create %s with a size of 0 bytes.\n", path.c_str());
+    return false;
+  }
+
+  int fh = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fh < 0) {
+    printf("Error: cannot create %s.\n", path.c_str());
+    return false;
+  }
+
+  if(0 != ftruncate(fh, (off_t)nbytes)) {
+    printf("Error: cannot resize %s to %llu bytes.\n", path.c_str(), (unsigned long long)nbytes);
+    ::close(fh);
+    return false;
+  }
+
+  void* ptr = mmap(NULL, (size_t)nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fh, 0);
+  if(MAP_FAILED == ptr) {
+    printf("Error: cannot map %s.\n", path.c_str());
+    ::close(fh);
+    return false;
+  }
+
+  filepath = path;
+  fd = fh;
+  data = (unsigned char*)ptr;
+  size = nbytes;
+  is_writable = true;
+
+  return true;
+}
+
+bool MappedFile::flush() {
+
+  if(!data || !is_writable) {
+    return false;
+  }
+
+  if(0 != msync(data, (size_t)size, MS_SYNC)) {
+    printf("Error: cannot flush %s.\n", filepath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void MappedFile::close() {
+
+  if(data) {
+    munmap(data, (size_t)size);
+    data = NULL;
+  }
+  if(fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+
+  size = 0;
+  is_writable = false;
+}
+
+void MappedFile::release(uint64_t offset, uint64_t nbytes) {
+
+  if(!data || offset >= size) {
+    return;
+  }
+
+  /* madvise() wants page aligned ranges; we only release complete pages. */
+  uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t start = ((offset + page - 1) / page) * page;
+  uint64_t end = offset + nbytes;
+  end = (end > size) ? size : end;
+  end = (end / page) * page;
+
+  if(end > start) {
+    madvise(data + start, (size_t)(end - start), MADV_DONTNEED);
+  }
+}
+
+#endif
@@ -0,0 +1,373 @@
+#include <tracker/MaskRecorder.h>
+#include <string.h>
+
+static void mask_put_varint(std::vector<unsigned char>& out, uint64_t v);
+static bool mask_get_varint(const unsigned char*& ptr, const unsigned char* end, uint64_t& v);
+
+/* ---------------------------------------------------*/
+
+MaskRecorder::MaskRecorder()
+  :fp(NULL)
+  ,width(0)
+  ,height(0)
+  ,offset(0)
+  ,num_encoded_bytes(0)
+{
+}
+
+MaskRecorder::~MaskRecorder() {
+  close();
+}
+
+bool MaskRecorder::open(std::string path, int w, int h) {
+
+  if(fp) {
+    printf("Error: cannot open %s, we're already recording into %s.\n", path.c_str(), filepath.c_str());
+    return false;
+  }
+
+  if(w <= 0 || h <= 0) {
+    printf("Error: invalid mask size: %dx%d\n", w, h);
+    return false;
+  }
+
+  fp = fopen(path.c_str(), "wb");
+  if(!fp) {
+    printf("Error: cannot open %s for writing.\n", path.c_str());
+    return false;
+  }
+
+  MaskFileHeader header;
+  header.magic = MASK_FILE_MAGIC;
+  header.version = MASK_FILE_VERSION;
+  header.width = w;
+  header.height = h;
+
+  if(1 != fwrite(&header, sizeof(header), 1, fp)) {
+    printf("Error: cannot write the header of %s.\n", path.c_str());
+    fclose(fp);
+    fp = NULL;
+    return false;
+  }
+
+  filepath = path;
+  width = w;
+  height = h;
+  offset = sizeof(header);
+  offsets.clear();
+  num_encoded_bytes = 0;
+
+  return true;
+}
+
+bool MaskRecorder::record(const unsigned char* mask, int stride, FrameInfo& frame) {
+
+  if(!fp) {
+    return false;
+  }
+
+  buffer.clear();
+
+  /* Runs go over the row boundaries; we only flush a run when the value changes. */
+  bool fg = false;
+  uint64_t run = 0;
+
+  for(int j = 0; j < height; ++j) {
+
+    const unsigned char* row = mask + (size_t)j * stride;
+    int i = 0;
+
+    while(i < width) {
+
+      /* Most of the mask is background; skip it 8 pixels at a time. */
+      if(!fg) {
+        while(i + 8 <= width) {
+          uint64_t v;
+          memcpy(&v, row + i, 8);
+          if(v) {
+            break;
+          }
+          run += 8;
+          i += 8;
+        }
+        if(i >= width) {
+          break;
+        }
+      }
+
+      bool is_fg = (0 != row[i]);
+      if(is_fg != fg) {
+        mask_put_varint(buffer, run);
+        run = 0;
+        fg = is_fg;
+      }
+
+      run++;
+      i++;
+    }
+  }
+
+  mask_put_varint(buffer, run);
+
+  MaskRecordHeader header;
+  header.magic = MASK_RECORD_MAGIC;
+  header.nbytes = (uint32_t)buffer.size();
+  header.frame_id = frame.id;
+  header.capture_ns = frame.capture_ns;
+
+  bool ok = (1 == fwrite(&header, sizeof(header), 1, fp));
+  ok = ok && (buffer.size() == fwrite(&buffer[0], 1, buffer.size(), fp));
+
+  if(!ok) {
+    printf("Error: cannot write a mask record into %s; we stop recording.\n", filepath.c_str());
+    fclose(fp);
+    fp = NULL;
+    return false;
+  }
+
+  offsets.push_back(offset);
+  offset += sizeof(header) + buffer.size();
+  num_encoded_bytes += buffer.size();
+
+  return true;
+}
+
+bool MaskRecorder::close() {
+
+  if(!fp) {
+    return false;
+  }
+
+  MaskIndexTrailer trailer;
+  trailer.magic = MASK_INDEX_MAGIC;
+  trailer.version = MASK_FILE_VERSION;
+  trailer.num_frames = offsets.size();
+  trailer.index_offset = offset;
+
+  bool ok = true;
+  if(offsets.size() && offsets.size() != fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), fp)) {
+    ok = false;
+  }
+  if(ok && 1 != fwrite(&trailer, sizeof(trailer), 1, fp)) {
+    ok = false;
+  }
+  if(0 != fclose(fp)) {
+    ok = false;
+  }
+
+  if(!ok) {
+    printf("Error: cannot write the index of %s; the player will rebuild it.\n", filepath.c_str());
+  }
+
+  fp = NULL;
+  offsets.clear();
+
+  return ok;
+}
+
+/* ---------------------------------------------------*/
+
+MaskPlayer::MaskPlayer()
+  :width(0)
+  ,height(0)
+  ,num_frames(0)
+  ,next_index(0)
+{
+}
+
+MaskPlayer::~MaskPlayer() {
+  close();
+}
+
+bool MaskPlayer::open(std::string filepath) {
+
+  if(!file.open(filepath)) {
+    return false;
+  }
+
+  MaskFileHeader header;
+  if(file.size < sizeof(header)) {
+    printf("Error: %s is not a mask recording.\n", filepath.c_str());
+    close();
+    return false;
+  }
+
+  memcpy(&header, file.data, sizeof(header));
+  if(header.magic != MASK_FILE_MAGIC || header.version != MASK_FILE_VERSION || 0 == header.width || 0 == header.height) {
+    printf("Error: %s is not a mask recording or has an unsupported version.\n", filepath.c_str());
+    close();
+    return false;
+  }
+
+  width = header.width;
+  height = header.height;
+
+  if(!readIndex()) {
+    printf("Warning: %s has no valid index (not closed?); we scan the records.\n", filepath.c_str());
+    if(!scanRecords()) {
+      close();
+      return false;
+    }
+  }
+
+  next_index = 0;
+
+  return true;
+}
+
+bool MaskPlayer::readIndex() {
+
+  MaskIndexTrailer trailer;
+  if(file.size < sizeof(MaskFileHeader) + sizeof(trailer)) {
+    return false;
+  }
+
+  memcpy(&trailer, file.data + file.size - sizeof(trailer), sizeof(trailer));
+  if(trailer.magic != MASK_INDEX_MAGIC || trailer.version != MASK_FILE_VERSION) {
+    return false;
+  }
+
+  if(trailer.index_offset + trailer.num_frames * sizeof(uint64_t) + sizeof(trailer) != file.size) {
+    return false;
+  }
+
+  offsets.resize(trailer.num_frames);
+  if(trailer.num_frames) {
+    memcpy(&offsets[0], file.data + trailer.index_offset, trailer.num_frames * sizeof(uint64_t));
+  }
+
+  for(size_t i = 0; i < offsets.size(); ++i) {
+    if(offsets[i] + sizeof(MaskRecordHeader) > trailer.index_offset) {
+      offsets.clear();
+      return false;
+    }
+  }
+
+  num_frames = offsets.size();
+
+  return true;
+}
+
+bool MaskPlayer::scanRecords() {
+
+  uint64_t offset = sizeof(MaskFileHeader);
+  MaskRecordHeader header;
+
+  offsets.clear();
+
+  while(offset + sizeof(header) <= file.size) {
+
+    memcpy(&header, file.data + offset, sizeof(header));
+    if(header.magic != MASK_RECORD_MAGIC) {
+      break;
+    }
+
+    if(offset + sizeof(header) + header.nbytes > file.size) {
+      printf("Warning: %s ends with an incomplete record; we skip it.\n", file.filepath.c_str());
+      break;
+    }
+
+    offsets.push_back(offset);
+    offset += sizeof(header) + header.nbytes;
+  }
+
+  num_frames = offsets.size();
+
+  return true;
+}
+
+bool MaskPlayer::read(unsigned char* mask, int stride, FrameInfo& frame) {
+
+  if(!file.isOpen() || next_index >= num_frames) {
+    return false;
+  }
+
+  MaskRecordHeader header;
+  uint64_t offset = offsets[next_index];
+  memcpy(&header, file.data + offset, sizeof(header));
+
+  if(header.magic != MASK_RECORD_MAGIC || offset + sizeof(header) + header.nbytes > file.size) {
+    printf("Error: invalid mask record %llu.\n", (unsigned long long)next_index);
+    return false;
+  }
+
+  const unsigned char* ptr = file.data + offset + sizeof(header);
+  const unsigned char* end = ptr + header.nbytes;
+  uint64_t total = (uint64_t)width * height;
+  uint64_t pos = 0;
+  uint64_t run = 0;
+  unsigned char value = 0;
+
+  while(pos < total) {
+
+    if(!mask_get_varint(ptr, end, run) || run > total - pos) {
+      printf("Error: corrupt mask record %llu.\n", (unsigned long long)next_index);
+      return false;
+    }
+
+    /* Write the run row by row. */
+    while(run > 0) {
+      int x = (int)(pos % width);
+      int y = (int)(pos / width);
+      int n = (run < (uint64_t)(width - x)) ? (int)run : (width - x);
+      memset(mask + (size_t)y * stride + x, value, n);
+      run -= n;
+      pos += n;
+    }
+
+    value = value ? 0 : 255;
+  }
+
+  frame.id = header.frame_id;
+  frame.capture_ns = header.capture_ns;
+  next_index++;
+
+  return true;
+}
+
+bool MaskPlayer::seek(uint64_t index) {
+
+  if(index >= num_frames) {
+    printf("Error: cannot seek to mask %llu, we have %llu masks.\n", (unsigned long long)index, (unsigned long long)num_frames);
+    return false;
+  }
+
+  next_index = index;
+
+  return true;
+}
+
+void MaskPlayer::close() {
+  file.close();
+  offsets.clear();
+  num_frames = 0;
+  next_index = 0;
+}
+
+/* ---------------------------------------------------*/
+
+static void mask_put_varint(std::vector<unsigned char>& out, uint64_t v) {
+  while(v >= 0x80) {
+    out.push_back((unsigned char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((unsigned char)v);
+}
+
+static bool mask_get_varint(const unsigned char*& ptr, const unsigned char* end, uint64_t& v) {
+
+  v = 0;
+
+  for(int shift = 0; shift < 64; shift += 7) {
+    if(ptr >= end) {
+      return false;
+    }
+    unsigned char b = *ptr++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if(!(b & 0x80)) {
+      return true;
+    }
+  }
+
+  return false;
+}
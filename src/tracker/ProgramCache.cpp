@@ -0,0 +1,301 @@
+#include <tracker/ProgramCache.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#  include <direct.h>
+#  include <process.h>
+#  define program_cache_getpid _getpid
+#else
+#  include <unistd.h>
+#  define program_cache_getpid getpid
+#endif
+
+#define PROGRAM_CACHE_MAGIC 0x504B5254       /* "TRKP" */
+#define PROGRAM_CACHE_VERSION 1
+
+struct ProgramCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t nbytes;
+};
+
+static bool program_cache_create_dir(std::string path);
+
+/* ---------------------------------------------------*/
+
+ProgramCache::ProgramCache()
+  :is_init(false)
+  ,is_supported(false)
+  ,num_hits(0)
+  ,num_misses(0)
+{
+}
+
+bool ProgramCache::setup(std::string cacheDir) {
+
+  if(cacheDir.size() == 0) {
+    printf("Error: no program cache directory given.\n");
+    return false;
+  }
+
+  if(!program_cache_create_dir(cacheDir)) {
+    printf("Error: cannot create the program cache directory: %s\n", cacheDir.c_str());
+    return false;
+  }
+
+  dir = cacheDir;
+  return true;
+}
+
+bool ProgramCache::init() {
+
+  if(is_init) {
+    return is_supported;
+  }
+
+  is_init = true;
+
+  const char* vendor = (const char*)glGetString(GL_VENDOR);
+  const char* renderer = (const char*)glGetString(GL_RENDERER);
+  const char* version = (const char*)glGetString(GL_VERSION);
+
+  driver = std::string(vendor ? vendor : "") + "/" + std::string(renderer ? renderer : "") + "/" + std::string(version ? version : "");
+
+  GLint num_formats = 0;
+  if(GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+  }
+
+  is_supported = num_formats > 0;
+  return is_supported;
+}
+
+GLuint ProgramCache::createProgram(const char* vs, const char* fs) {
+
+  if(!init()) {
+    num_misses++;
+    return compileProgram(vs, fs);
+  }
+
+  uint64_t key = createKey(vs, fs);
+  GLuint prog = glCreateProgram();
+
+  if(loadProgram(key, prog)) {
+    num_hits++;
+    return prog;
+  }
+
+  glDeleteProgram(prog);
+
+  num_misses++;
+  prog = compileProgram(vs, fs);
+  storeProgram(key, prog);
+
+  return prog;
+}
+
+GLuint ProgramCache::compileProgram(const char* vs, const char* fs) {
+
+  GLuint vert = rx_create_shader(GL_VERTEX_SHADER, vs);
+  GLuint frag = rx_create_shader(GL_FRAGMENT_SHADER, fs);
+  GLuint prog = rx_create_program(vert, frag);
+
+  if(is_supported) {
+    glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
+  glLinkProgram(prog);
+  rx_print_shader_link_info(prog);
+
+  /* The program keeps what it needs after linking. */
+  glDetachShader(prog, vert);
+  glDetachShader(prog, frag);
+  glDeleteShader(vert);
+  glDeleteShader(frag);
+
+  return prog;
+}
+
+bool ProgramCache::loadProgram(uint64_t key, GLuint prog) {
+
+  std::map<uint64_t, ProgramBinary>::iterator it = binaries.find(key);
+
+  if(it == binaries.end()) {
+
+    ProgramBinary bin;
+    if(!readFile(key, bin)) {
+      return false;
+    }
+
+    it = binaries.insert(std::pair<uint64_t, ProgramBinary>(key, bin)).first;
+  }
+
+  ProgramBinary& bin = it->second;
+  glProgramBinary(prog, bin.format, &bin.data[0], (GLsizei)bin.data.size());
+
+  /* The driver may reject binaries, e.g. after an update with the same version string. */
+  GLint status = GL_FALSE;
+  glGetProgramiv(prog, GL_LINK_STATUS, &status);
+  if(status == GL_FALSE) {
+    binaries.erase(it);
+    return false;
+  }
+
+  return true;
+}
+
+bool ProgramCache::readFile(uint64_t key, ProgramBinary& bin) {
+
+  if(dir.size() == 0) {
+    return false;
+  }
+
+  std::string filepath = createFilePath(key);
+  FILE* fp = fopen(filepath.c_str(), "rb");
+  if(!fp) {
+    return false;
+  }
+
+  ProgramCacheHeader header;
+  if(fread(&header, sizeof(header), 1, fp) != 1
+     || header.magic != PROGRAM_CACHE_MAGIC
+     || header.version != PROGRAM_CACHE_VERSION
+     || header.key != key
+     || header.nbytes == 0)
+    {
+      printf("Warning: ignoring invalid program cache file: %s\n", filepath.c_str());
+      fclose(fp);
+      return false;
+    }
+
+  bin.format = header.format;
+  bin.data.resize(header.nbytes);
+
+  if(fread(&bin.data[0], header.nbytes, 1, fp) != 1) {
+    printf("Warning: cannot read the program cache file: %s\n", filepath.c_str());
+    fclose(fp);
+    return false;
+  }
+
+  fclose(fp);
+  return true;
+}
+
+void ProgramCache::storeProgram(uint64_t key, GLuint prog) {
+
+  GLint nbytes = 0;
+  glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &nbytes);
+  if(nbytes <= 0) {
+    return;
+  }
+
+  ProgramBinary bin;
+  bin.data.resize(nbytes);
+  glGetProgramBinary(prog, nbytes, NULL, &bin.format, &bin.data[0]);
+
+  binaries[key] = bin;
+
+  if(dir.size() == 0) {
+    return;
+  }
+
+  /* Write to a temporary file first, so other processes never read a partial binary; the pid keeps processes that store the same key apart. */
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)program_cache_getpid());
+  std::string filepath = createFilePath(key);
+  std::string tmppath = filepath + suffix;
+  FILE* fp = fopen(tmppath.c_str(), "wb");
+  if(!fp) {
+    printf("Warning: cannot write the program cache file: %s\n", tmppath.c_str());
+    return;
+  }
+
+  ProgramCacheHeader header;
+  header.magic = PROGRAM_CACHE_MAGIC;
+  header.version = PROGRAM_CACHE_VERSION;
+  header.key = key;
+  header.format = bin.format;
+  header.nbytes = (uint32_t)bin.data.size();
+
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+    && fwrite(&bin.data[0], bin.data.size(), 1, fp) == 1;
+
+  fclose(fp);
+
+  if(!ok) {
+    printf("Warning: cannot write the program cache file: %s\n", tmppath.c_str());
+    remove(tmppath.c_str());
+    return;
+  }
+
+#if defined(_WIN32)
+  remove(filepath.c_str());
+#endif
+
+  if(rename(tmppath.c_str(), filepath.c_str()) != 0) {
+    printf("Warning: cannot rename the program cache file: %s\n", tmppath.c_str());
+    remove(tmppath.c_str());
+  }
+}
+
+uint64_t ProgramCache::createKey(const char* vs, const char* fs) {
+
+  const char* parts[] = { vs, fs, driver.c_str() } ;
+  uint64_t hash = 14695981039346656037ULL;
+
+  for(int i = 0; i < 3; ++i) {
+    const unsigned char* p = (const unsigned char*)parts[i];
+    while(*p) {
+      hash ^= *p++;
+      hash *= 1099511628211ULL;
+    }
+    /* separator, so moving text between the parts changes the key */
+    hash ^= 0xFF;
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+std::string ProgramCache::createFilePath(uint64_t key) {
+  char name[32] = { 0 } ;
+  sprintf(name, "%016llx.bin", (unsigned long long)key);
+  return dir + "/" + name;
+}
+
+/* ---------------------------------------------------*/
+
+ProgramCache& tracker_program_cache() {
+  static ProgramCache cache;
+  return cache;
+}
+
+static bool program_cache_create_dir(std::string path) {
+
+  /* Create every component of the path. */
+  for(size_t i = 1; i <= path.size(); ++i) {
+
+    if(i != path.size() && path[i] != '/' && path[i] != '\\') {
+      continue;
+    }
+
+    std::string part = path.substr(0, i);
+
+#if defined(_WIN32)
+    int r = _mkdir(part.c_str());
+#else
+    int r = mkdir(part.c_str(), 0755);
+#endif
+
+    if(r != 0 && errno != EEXIST) {
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <string.h>
+#include <tracker/RenderGraph.h>
+#include <tracker/GpuTimer.h>
+
+/* ---------------------------------------------------*/
+
+void RenderPass::input(GLuint tex) {
+
+  if(num_inputs >= RENDER_GRAPH_MAX_INPUTS) {
+    printf("Error: a render pass can't have more than %d inputs.\n", RENDER_GRAPH_MAX_INPUTS);
+    return;
+  }
+
+  inputs[num_inputs++] = tex;
+}
+
+void RenderPass::uniform1i(GLint location, GLint value) {
+
+  if(num_uniforms >= RENDER_GRAPH_MAX_UNIFORMS) {
+    printf("Error: a render pass can't have more than %d uniforms.\n", RENDER_GRAPH_MAX_UNIFORMS);
+    return;
+  }
+
+  RenderPassUniform& u = uniforms[num_uniforms++];
+  u.location = location;
+  u.is_int = true;
+  u.ivalue = value;
+  u.fvalue = 0.0f;
+}
+
+void RenderPass::uniform1f(GLint location, GLfloat value) {
+
+  if(num_uniforms >= RENDER_GRAPH_MAX_UNIFORMS) {
+    printf("Error: a render pass can't have more than %d uniforms.\n", RENDER_GRAPH_MAX_UNIFORMS);
+    return;
+  }
+
+  RenderPassUniform& u = uniforms[num_uniforms++];
+  u.location = location;
+  u.is_int = false;
+  u.ivalue = 0;
+  u.fvalue = value;
+}
+
+/* ---------------------------------------------------*/
+
+GLStateCache::GLStateCache()
+  :draw_fbo(0)
+  ,read_fbo(0)
+  ,vao(0)
+  ,prog(0)
+  ,active_unit(0)
+  ,pack_buffer(0)
+  ,pack_alignment(4)
+  ,pack_row_length(0)
+  ,saved_draw_fbo(0)
+  ,saved_read_fbo(0)
+  ,saved_vao(0)
+  ,saved_prog(0)
+  ,saved_active_unit(0)
+  ,saved_pack_buffer(0)
+  ,saved_pack_alignment(4)
+  ,saved_pack_row_length(0)
+  ,num_calls(0)
+  ,num_skipped(0)
+{
+  memset(view, 0, sizeof(view));
+  memset(saved_view, 0, sizeof(saved_view));
+  memset(textures, 0, sizeof(textures));
+  memset(saved_textures, 0, sizeof(saved_textures));
+  memset(has_texture, 0, sizeof(has_texture));
+}
+
+void GLStateCache::save() {
+
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &saved_draw_fbo);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &saved_read_fbo);
+  glGetIntegerv(GL_VIEWPORT, saved_view);
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &saved_vao);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &saved_prog);
+  glGetIntegerv(GL_ACTIVE_TEXTURE, &saved_active_unit);
+  glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &saved_pack_buffer);
+  glGetIntegerv(GL_PACK_ALIGNMENT, &saved_pack_alignment);
+  glGetIntegerv(GL_PACK_ROW_LENGTH, &saved_pack_row_length);
+
+  saved_active_unit -= GL_TEXTURE0;
+
+  draw_fbo = saved_draw_fbo;
+  read_fbo = saved_read_fbo;
+  memcpy(view, saved_view, sizeof(view));
+  vao = saved_vao;
+  prog = saved_prog;
+  active_unit = saved_active_unit;
+  pack_buffer = saved_pack_buffer;
+  pack_alignment = saved_pack_alignment;
+  pack_row_length = saved_pack_row_length;
+
+  /* We query the texture bindings when we first touch a unit, see bindTexture(). */
+  memset(has_texture, 0, sizeof(has_texture));
+
+  num_calls = 0;
+  num_skipped = 0;
+}
+
+void GLStateCache::restore() {
+
+  for(int i = 0; i < RENDER_GRAPH_MAX_INPUTS; ++i) {
+    if(has_texture[i]) {
+      bindTexture(i, saved_textures[i]);
+      has_texture[i] = false;
+    }
+  }
+
+  activeTexture(saved_active_unit);
+  bindDrawFramebuffer(saved_draw_fbo);
+  bindReadFramebuffer(saved_read_fbo);
+  viewport(saved_view[0], saved_view[1], saved_view[2], saved_view[3]);
+  bindVertexArray(saved_vao);
+  useProgram(saved_prog);
+  bindPackBuffer(saved_pack_buffer);
+  packAlignment(saved_pack_alignment);
+  packRowLength(saved_pack_row_length);
+}
+
+void GLStateCache::bindDrawFramebuffer(GLuint fbo) {
+  if(changed(draw_fbo, fbo)) {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+  }
+}
+
+void GLStateCache::bindReadFramebuffer(GLuint fbo) {
+  if(changed(read_fbo, fbo)) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+  }
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLint vw, GLint vh) {
+
+  if(view[0] == x && view[1] == y && view[2] == vw && view[3] == vh) {
+    num_skipped++;
+    return;
+  }
+
+  view[0] = x;
+  view[1] = y;
+  view[2] = vw;
+  view[3] = vh;
+  num_calls++;
+
+  glViewport(x, y, vw, vh);
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray) {
+  if(changed(vao, vertexArray)) {
+    glBindVertexArray(vertexArray);
+  }
+}
+
+void GLStateCache::useProgram(GLuint program) {
+  if(changed(prog, program)) {
+    glUseProgram(program);
+  }
+}
+
+void GLStateCache::bindTexture(int unit, GLuint tex) {
+
+  if(!has_texture[unit]) {
+    activeTexture(unit);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &saved_textures[unit]);
+    textures[unit] = saved_textures[unit];
+    has_texture[unit] = true;
+  }
+
+  if(textures[unit] == (GLint)tex) {
+    num_skipped++;
+    return;
+  }
+
+  activeTexture(unit);
+  changed(textures[unit], tex);
+  glBindTexture(GL_TEXTURE_2D, tex);
+}
+
+void GLStateCache::bindPackBuffer(GLuint pbo) {
+  if(changed(pack_buffer, pbo)) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+  }
+}
+
+void GLStateCache::packAlignment(GLint align) {
+  if(changed(pack_alignment, align)) {
+    glPixelStorei(GL_PACK_ALIGNMENT, align);
+  }
+}
+
+void GLStateCache::packRowLength(GLint length) {
+  if(changed(pack_row_length, length)) {
+    glPixelStorei(GL_PACK_ROW_LENGTH, length);
+  }
+}
+
+void GLStateCache::activeTexture(int unit) {
+  if(changed(active_unit, unit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+}
+
+bool GLStateCache::changed(GLint& current, GLint value) {
+
+  if(current == value) {
+    num_skipped++;
+    return false;
+  }
+
+  current = value;
+  num_calls++;
+
+  return true;
+}
+
+/* ---------------------------------------------------*/
+
+RenderGraph::RenderGraph()
+  :num_passes(0)
+  ,pool(NULL)
+{
+}
+
+void RenderGraph::clear() {
+  num_passes = 0;
+}
+
+RenderPass& RenderGraph::addPass() {
+
+  if(num_passes == passes.size()) {
+    passes.push_back(RenderPass());
+  }
+
+  RenderPass& pass = passes[num_passes++];
+  memset(&pass, 0, sizeof(pass));
+  pass.stage = -1;
+
+  return pass;
+}
+
+RenderPass& RenderGraph::addDrawPass(int stage, GLuint prog, GLuint vao, GLuint fbo, GLuint outTex, int vw, int vh) {
+
+  RenderPass& pass = addPass();
+  pass.type = RENDER_PASS_DRAW;
+  pass.stage = stage;
+  pass.prog = prog;
+  pass.vao = vao;
+  pass.fbo = fbo;
+  pass.out_tex = outTex;
+  pass.viewport[2] = vw;
+  pass.viewport[3] = vh;
+
+  return pass;
+}
+
+RenderPass& RenderGraph::addReadPixelsPass(int stage, GLuint fbo, GLuint pbo, int rw, int rh, GLenum format, int rowLength, GLenum type) {
+
+  RenderPass& pass = addPass();
+  pass.type = RENDER_PASS_READ_PIXELS;
+  pass.stage = stage;
+  pass.fbo = fbo;
+  pass.pbo = pbo;
+  pass.viewport[2] = rw;
+  pass.viewport[3] = rh;
+  pass.read_format = format;
+  pass.read_type = type;
+  pass.pack_row_length = rowLength;
+
+  return pass;
+}
+
+bool RenderGraph::execute(GpuTimer* timer) {
+
+  /* Reading the texture you're drawing into is undefined in GL. */
+  for(size_t i = 0; i < num_passes; ++i) {
+    RenderPass& pass = passes[i];
+    for(int k = 0; k < pass.num_inputs; ++k) {
+      if(pass.out_tex && pass.inputs[k] == pass.out_tex) {
+        printf("Error: render pass %zu reads the texture it draws into (%u).\n", i, pass.out_tex);
+        return false;
+      }
+    }
+  }
+
+  int active_stage = -1;
+
+  state.save();
+
+  for(size_t i = 0; i < num_passes; ++i) {
+
+    RenderPass& pass = passes[i];
+
+    if(timer && pass.stage != active_stage) {
+      if(active_stage >= 0) {
+        timer->end();
+      }
+      if(pass.stage >= 0) {
+        timer->begin(pass.stage);
+      }
+      active_stage = pass.stage;
+    }
+
+    if(pass.type == RENDER_PASS_READ_PIXELS) {
+      state.bindReadFramebuffer(pass.fbo);
+      state.bindPackBuffer(pass.pbo);
+      state.packAlignment(1);
+      state.packRowLength(pass.pack_row_length);
+      glReadPixels(pass.viewport[0], pass.viewport[1], pass.viewport[2], pass.viewport[3], pass.read_format, pass.read_type, NULL);
+      continue;
+    }
+
+    state.bindDrawFramebuffer(pass.fbo);
+    state.viewport(pass.viewport[0], pass.viewport[1], pass.viewport[2], pass.viewport[3]);
+    state.bindVertexArray(pass.vao);
+    state.useProgram(pass.prog);
+
+    for(int k = 0; k < pass.num_inputs; ++k) {
+      state.bindTexture(k, pass.inputs[k]);
+    }
+
+    for(int k = 0; k < pass.num_uniforms; ++k) {
+      RenderPassUniform& u = pass.uniforms[k];
+      if(u.is_int) {
+        glUniform1i(u.location, u.ivalue);
+      }
+      else {
+        glUniform1f(u.location, u.fvalue);
+      }
+    }
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  if(timer && active_stage >= 0) {
+    timer->end();
+  }
+
+  state.restore();
+
+  return true;
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <tracker/RenderTargetPool.h>
+
+RenderTargetPool::RenderTargetPool()
+  :max_in_use(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool() {
+  shutdown();
+}
+
+RenderTarget* RenderTargetPool::acquire(GLenum format, int w, int h) {
+
+  RenderTarget* target = NULL;
+
+  for(size_t i = 0; i < targets.size(); ++i) {
+    RenderTarget* t = targets[i];
+    if(!t->in_use && t->format == format && t->w == w && t->h == h) {
+      target = t;
+      break;
+    }
+  }
+
+  if(!target) {
+    target = create(format, w, h);
+    if(!target) {
+      return NULL;
+    }
+  }
+
+  target->in_use = true;
+
+  size_t num_in_use = getNumInUse();
+  if(num_in_use > max_in_use) {
+    max_in_use = num_in_use;
+  }
+
+  return target;
+}
+
+bool RenderTargetPool::release(GLuint tex) {
+
+  for(size_t i = 0; i < targets.size(); ++i) {
+    RenderTarget* t = targets[i];
+    if(t->tex == tex && t->in_use) {
+      t->in_use = false;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void RenderTargetPool::reset() {
+  for(size_t i = 0; i < targets.size(); ++i) {
+    targets[i]->in_use = false;
+  }
+}
+
+RenderTarget* RenderTargetPool::create(GLenum format, int w, int h) {
+
+  if(0 == render_target_get_bytes_per_pixel(format)) {
+    printf("Error: unsupported render target format: 0x%04X.\n", format);
+    return NULL;
+  }
+
+  GLint prev_fbo = 0;
+  GLint prev_tex = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_fbo);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &prev_tex);
+
+  RenderTarget* target = new RenderTarget();
+  target->format = format;
+  target->w = w;
+  target->h = h;
+  target->in_use = false;
+
+  glGenTextures(1, &target->tex);
+  glBindTexture(GL_TEXTURE_2D, target->tex);
+  GLenum channels = (format == GL_R8 || format == GL_R16F) ? GL_RED : (format == GL_RG8) ? GL_RG : GL_RGBA;
+  glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, channels, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  glGenFramebuffers(1, &target->fbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->fbo);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->tex, 0);
+
+  GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prev_fbo);
+  glBindTexture(GL_TEXTURE_2D, prev_tex);
+
+  if(status != GL_FRAMEBUFFER_COMPLETE) {
+    printf("Error: render target framebuffer is not complete.\n");
+    glDeleteFramebuffers(1, &target->fbo);
+    glDeleteTextures(1, &target->tex);
+    delete target;
+    return NULL;
+  }
+
+  targets.push_back(target);
+
+  return target;
+}
+
+void RenderTargetPool::shutdown() {
+
+  for(size_t i = 0; i < targets.size(); ++i) {
+    glDeleteFramebuffers(1, &targets[i]->fbo);
+    glDeleteTextures(1, &targets[i]->tex);
+    delete targets[i];
+  }
+
+  targets.clear();
+  max_in_use = 0;
+}
+
+size_t RenderTargetPool::getNumBytes() {
+
+  size_t nbytes = 0;
+
+  for(size_t i = 0; i < targets.size(); ++i) {
+    RenderTarget* t = targets[i];
+    nbytes += render_target_get_bytes_per_pixel(t->format) * t->w * t->h;
+  }
+
+  return nbytes;
+}
+
+size_t RenderTargetPool::getNumTargets() {
+  return targets.size();
+}
+
+size_t RenderTargetPool::getNumInUse() {
+
+  size_t num = 0;
+
+  for(size_t i = 0; i < targets.size(); ++i) {
+    num += (targets[i]->in_use) ? 1 : 0;
+  }
+
+  return num;
+}
+
+/* ---------------------------------------------------*/
+
+size_t render_target_get_bytes_per_pixel(GLenum format) {
+
+  switch(format) {
+    case GL_R8:     { return 1; }
+    case GL_RG8:    { return 2; }
+    case GL_RGBA8:  { return 4; }
+    case GL_R16F:   { return 2; }
+    case GL_RGBA16F:{ return 8; }
+    default:        { return 0; }
+  }
+}
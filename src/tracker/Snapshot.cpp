@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <string.h>
+#include <tracker/Snapshot.h>
+
+TrackerSnapshot::TrackerSnapshot() {
+  memset(&header, 0, sizeof(header));
+}
+
+TrackerSnapshot::~TrackerSnapshot() {
+  close();
+}
+
+bool TrackerSnapshot::create(std::string path, BlobTracker& tracker) {
+
+  if(file.isOpen()) {
+    printf("Error: the snapshot is already open.\n");
+    return false;
+  }
+
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.last_id = tracker.last_id;
+  header.num_blobs = (uint32_t)tracker.blobs.size();
+  header.num_trail_points = 0;
+
+  for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+    header.num_trail_points += tracker.blobs[i].trail.size();
+  }
+
+  filepath = path;
+
+  if(!file.create(filepath + ".tmp", getNumBytes())) {
+    return false;
+  }
+
+  memcpy(file.data, &header, sizeof(header));
+
+  unsigned char* ptr = getLongHistoryPtr(header.num_long);
+  int32_t* trail = (int32_t*)(ptr + header.num_blobs * sizeof(SnapshotBlob));
+
+  for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+
+    Blob& blob = tracker.blobs[i];
+    SnapshotBlob sb;
+    sb.id = blob.id;
+    sb.age = blob.age;
+    sb.area = blob.area;
+    sb.x = blob.position.x;
+    sb.y = blob.position.y;
+    sb.direction_x = blob.direction.x;
+    sb.direction_y = blob.direction.y;
+    sb.num_trail_points = (uint32_t)blob.trail.size();
+    sb.frame_id = blob.frame_id;
+
+    memcpy(ptr, &sb, sizeof(sb));
+    ptr += sizeof(sb);
+
+    for(size_t j = 0; j < blob.trail.size(); ++j) {
+      int32_t p[2] = { blob.trail[j].x, blob.trail[j].y };
+      memcpy(trail, p, sizeof(p));
+      trail += 2;
+    }
+  }
+
+  return true;
+}
+
+bool TrackerSnapshot::commit() {
+
+  if(!file.isOpen() || !file.is_writable) {
+    printf("Error: cannot commit the snapshot, it was not created.\n");
+    return false;
+  }
+
+  bool ok = file.flush();
+  file.close();
+
+  std::string tmp = filepath + ".tmp";
+  if(!ok) {
+    remove(tmp.c_str());
+    return false;
+  }
+
+#if defined(_WIN32)
+  remove(filepath.c_str());                                        /* rename() doesn't replace on Windows */
+#endif
+
+  if(0 != rename(tmp.c_str(), filepath.c_str())) {
+    printf("Error: cannot rename %s to %s.\n", tmp.c_str(), filepath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool TrackerSnapshot::open(std::string path) {
+
+  if(file.isOpen()) {
+    printf("Error: the snapshot is already open.\n");
+    return false;
+  }
+
+  if(!file.open(path, false)) {
+    return false;
+  }
+
+  filepath = path;
+
+  if(file.size < sizeof(header)) {
+    printf("Error: %s is not a snapshot, it's too small.\n", path.c_str());
+    close();
+    return false;
+  }
+
+  memcpy(&header, file.data, sizeof(header));
+
+  if(SNAPSHOT_MAGIC != header.magic || SNAPSHOT_VERSION != header.version) {
+    printf("Error: %s is not a snapshot or has an unsupported version.\n", path.c_str());
+    close();
+    return false;
+  }
+
+  if(getNumBytes() != file.size) {
+    printf("Error: %s has %llu bytes but the header describes %llu bytes.\n", path.c_str(), 
+           (unsigned long long)file.size, (unsigned long long)getNumBytes());
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+bool TrackerSnapshot::restoreBlobs(BlobTracker& tracker) {
+
+  if(!file.isOpen()) {
+    printf("Error: cannot restore the blobs, the snapshot is not open.\n");
+    return false;
+  }
+
+  const unsigned char* ptr = getLongHistoryPtr(header.num_long);
+  const unsigned char* trail = ptr + header.num_blobs * sizeof(SnapshotBlob);
+  uint64_t num_points = 0;
+
+  tracker.blobs.clear();
+  tracker.new_blobs.clear();
+  tracker.last_id = header.last_id;
+
+  for(uint32_t i = 0; i < header.num_blobs; ++i) {
+
+    SnapshotBlob sb;
+    memcpy(&sb, ptr, sizeof(sb));
+    ptr += sizeof(sb);
+
+    num_points += sb.num_trail_points;
+    if(num_points > header.num_trail_points) {
+      printf("Error: the trails of the snapshot are invalid.\n");
+      tracker.blobs.clear();
+      return false;
+    }
+
+    Blob blob;
+    blob.id = sb.id;
+    blob.age = sb.age;
+    blob.area = sb.area;
+    blob.position.x = sb.x;
+    blob.position.y = sb.y;
+    blob.direction.x = sb.direction_x;
+    blob.direction.y = sb.direction_y;
+    blob.frame_id = sb.frame_id;
+
+    for(uint32_t j = 0; j < sb.num_trail_points; ++j) {
+      int32_t p[2];
+      memcpy(p, trail, sizeof(p));
+      trail += sizeof(p);
+      blob.trail.push_back(cv::Point(p[0], p[1]));
+    }
+
+    tracker.blobs.push_back(blob);
+  }
+
+  /* The restored tracks never entered the zones they're in. */
+  if(tracker.zones) {
+    std::vector<float> xy;
+    for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+      xy.push_back(tracker.blobs[i].position.x);
+      xy.push_back(tracker.blobs[i].position.y);
+    }
+    tracker.zones->restoreOccupancy((xy.size()) ? &xy[0] : NULL, tracker.blobs.size());
+  }
+
+  return true;
+}
+
+void TrackerSnapshot::close() {
+
+  bool was_created = file.isOpen() && file.is_writable;
+
+  file.close();
+
+  /* A snapshot that was created but not committed is incomplete. */
+  if(was_created) {
+    std::string tmp = filepath + ".tmp";
+    remove(tmp.c_str());
+  }
+}
+
+unsigned char* TrackerSnapshot::getHistoryPtr(uint32_t slot) {
+  return file.data + sizeof(SnapshotHeader) + slot * header.slot_bytes;
+}
+
+unsigned char* TrackerSnapshot::getLongHistoryPtr(uint32_t slot) {
+  return getHistoryPtr(header.num_slots) + slot * header.slot_bytes;
+}
+
+bool TrackerSnapshot::isCompatible(uint32_t width, uint32_t height, uint32_t format, uint32_t numSlots, uint64_t slotBytes) {
+
+  if(header.width != width || header.height != height || header.format != format || header.num_slots != numSlots) {
+    printf("Error: the history of %s (%ux%u, format %u, %u slots) doesn't match the tracker (%ux%u, format %u, %u slots).\n",
+           filepath.c_str(), header.width, header.height, header.format, header.num_slots,
+           width, height, format, numSlots);
+    return false;
+  }
+
+  /* The slots are copied with the size of the caller; a smaller slot_bytes would make it read past the mapping. */
+  if(header.slot_bytes != slotBytes) {
+    printf("Error: the history slots of %s have %llu bytes but the tracker uses %llu bytes.\n",
+           filepath.c_str(), (unsigned long long)header.slot_bytes, (unsigned long long)slotBytes);
+    return false;
+  }
+
+  if(header.next_slot >= header.num_slots || (header.num_long && (header.long_index >= header.num_long || header.long_count > header.num_long))) {
+    printf("Error: the history indices of %s are invalid.\n", filepath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+uint64_t TrackerSnapshot::getNumBytes() {
+  return sizeof(SnapshotHeader)
+    + ((uint64_t)header.num_slots + header.num_long) * header.slot_bytes
+    + (uint64_t)header.num_blobs * sizeof(SnapshotBlob)
+    + header.num_trail_points * 2 * sizeof(int32_t);
+}
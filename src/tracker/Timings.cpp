@@ -0,0 +1,109 @@
+#include <tracker/Timings.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+Timings::Timings()
+  :is_enabled(false)
+{
+  reset();
+}
+
+void Timings::enable() {
+  is_enabled = true;
+}
+
+void Timings::disable() {
+  is_enabled = false;
+}
+
+void Timings::reset() {
+  memset(cpu_start, 0, sizeof(cpu_start));
+  memset(samples, 0, sizeof(samples));
+  memset(num_samples, 0, sizeof(num_samples));
+  memset(sample_index, 0, sizeof(sample_index));
+}
+
+void Timings::addSample(int stage, double ms) {
+
+  if(stage < 0 || stage >= TRACKER_STAGE_COUNT) {
+    printf("Error: invalid timing stage: %d\n", stage);
+    return;
+  }
+
+  samples[stage][sample_index[stage]] = (float)ms;
+  sample_index[stage] = (sample_index[stage] + 1) % TIMINGS_WINDOW;
+
+  if(num_samples[stage] < TIMINGS_WINDOW) {
+    num_samples[stage]++;
+  }
+}
+
+bool Timings::getStats(int stage, TimingStats& stats) {
+
+  if(stage < 0 || stage >= TRACKER_STAGE_COUNT) {
+    printf("Error: invalid timing stage: %d\n", stage);
+    return false;
+  }
+
+  int n = num_samples[stage];
+  if(n == 0) {
+    return false;
+  }
+
+  float sorted[TIMINGS_WINDOW];
+  memcpy(sorted, samples[stage], n * sizeof(float));
+
+  double sum = 0.0;
+  float min_value = sorted[0];
+  for(int i = 0; i < n; ++i) {
+    sum += sorted[i];
+    min_value = std::min(min_value, sorted[i]);
+  }
+
+  /* Nearest rank 99th percentile. */
+  int rank = (99 * n + 99) / 100 - 1;
+  std::nth_element(sorted, sorted + rank, sorted + n);
+
+  stats.num_samples = n;
+  stats.last_ms = samples[stage][(sample_index[stage] + TIMINGS_WINDOW - 1) % TIMINGS_WINDOW];
+  stats.min_ms = min_value;
+  stats.avg_ms = sum / n;
+  stats.p99_ms = sorted[rank];
+
+  return true;
+}
+
+void Timings::print() {
+
+  TimingStats stats;
+
+  printf("%-12s %8s %8s %8s %6s\n", "stage", "min", "avg", "p99", "n");
+
+  for(int i = 0; i < TRACKER_STAGE_COUNT; ++i) {
+    if(!getStats(i, stats)) {
+      continue;
+    }
+    printf("%-12s %8.3f %8.3f %8.3f %6d\n", getStageName(i), stats.min_ms, stats.avg_ms, stats.p99_ms, stats.num_samples);
+  }
+}
+
+const char* Timings::getStageName(int stage) {
+
+  switch(stage) {
+    case TRACKER_STAGE_BACKGROUND:   { return "background";  }
+    case TRACKER_STAGE_ERODE:        { return "erode";       }
+    case TRACKER_STAGE_DILATE:       { return "dilate";      }
+    case TRACKER_STAGE_BLUR:         { return "blur";        }
+    case TRACKER_STAGE_THRESHOLD:    { return "threshold";   }
+    case TRACKER_STAGE_READBACK:     { return "readback";    }
+    case TRACKER_STAGE_HEATMAP:      { return "heatmap";     }
+    case TRACKER_STAGE_APPEARANCE:   { return "appearance";  }
+    case TRACKER_STAGE_MAP:          { return "map";         }
+    case TRACKER_STAGE_CONTOURS:     { return "contours";    }
+    case TRACKER_STAGE_BLOBS:        { return "blobs";       }
+    case TRACKER_STAGE_MATCHING:     { return "matching";    }
+    case TRACKER_STAGE_APPLY:        { return "apply";       }
+    default:                         { return "unknown";     }
+  }
+}
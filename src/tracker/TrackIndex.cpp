@@ -0,0 +1,297 @@
+#include <tracker/TrackIndex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+
+/* ---------------------------------------------------*/
+
+struct TrackNeighbour {
+  float dist_sq;
+  TrackSample sample;
+};
+
+struct TrackNeighbourSorter {
+  bool operator()(const TrackNeighbour& a, const TrackNeighbour& b) const {
+    return a.dist_sq < b.dist_sq;
+  }
+};
+
+/* ---------------------------------------------------*/
+
+TrackIndexBucket::TrackIndexBucket()
+  :epoch(UINT64_MAX)
+  ,num_samples(0)
+{
+}
+
+/* ---------------------------------------------------*/
+
+TrackIndex::TrackIndex(int w, int h, int cellSize, uint32_t bucketMs, uint32_t numBuckets)
+  :w(w)
+  ,h(h)
+  ,cell_size(cellSize)
+  ,cols(0)
+  ,rows(0)
+  ,bucket_ns((uint64_t)bucketMs * 1000000ull)
+  ,num_buckets(numBuckets)
+  ,max_bucket_samples(65536)
+  ,buckets(NULL)
+  ,num_dropped(0)
+{
+  if(w <= 0 || h <= 0 || cellSize <= 0 || 0 == bucketMs || 0 == numBuckets) {
+    printf("Error: invalid size, cell size or buckets for the TrackIndex.\n");
+    ::exit(EXIT_FAILURE);
+  }
+
+  cols = (w + cell_size - 1) / cell_size;
+  rows = (h + cell_size - 1) / cell_size;
+
+  buckets = new TrackIndexBucket[num_buckets];
+  for(uint32_t i = 0; i < num_buckets; ++i) {
+    buckets[i].cells.resize(cols * rows);
+  }
+}
+
+TrackIndex::~TrackIndex() {
+  delete[] buckets;
+  buckets = NULL;
+}
+
+void TrackIndex::insert(const TrackSample* samples, size_t num) {
+
+  size_t i = 0;
+
+  while(i < num) {
+
+    /* The samples of a frame all have the same time, so we lock once per frame. */
+    uint64_t epoch = samples[i].time_ns / bucket_ns;
+    TrackIndexBucket* bucket = lockBucket(epoch);
+
+    for( ; i < num && samples[i].time_ns / bucket_ns == epoch; ++i) {
+
+      if(NULL == bucket || bucket->num_samples >= max_bucket_samples) {
+        num_dropped++;
+        continue;
+      }
+
+      const TrackSample& s = samples[i];
+      uint32_t dx = getCellY(s.y) * cols + getCellX(s.x);
+      std::vector<TrackSample>& cell = bucket->cells[dx];
+      if(cell.empty()) {
+        bucket->used_cells.push_back(dx);
+      }
+
+      cell.push_back(s);
+      bucket->num_samples++;
+    }
+
+    if(NULL != bucket) {
+      bucket->mutex.unlock();
+    }
+  }
+}
+
+void TrackIndex::clear() {
+
+  for(uint32_t i = 0; i < num_buckets; ++i) {
+
+    TrackIndexBucket& bucket = buckets[i];
+    std::lock_guard<std::mutex> lock(bucket.mutex);
+
+    for(size_t j = 0; j < bucket.used_cells.size(); ++j) {
+      bucket.cells[bucket.used_cells[j]].clear();
+    }
+
+    bucket.used_cells.clear();
+    bucket.num_samples = 0;
+    bucket.epoch = UINT64_MAX;
+  }
+}
+
+size_t TrackIndex::queryRange(float x0, float y0, float x1, float y1, uint64_t t0, uint64_t t1, std::vector<TrackSample>& result) {
+
+  size_t num = result.size();
+  int c0 = getCellX(x0);
+  int c1 = getCellX(x1);
+  int r0 = getCellY(y0);
+  int r1 = getCellY(y1);
+
+  for(uint32_t i = 0; i < num_buckets; ++i) {
+
+    TrackIndexBucket& bucket = buckets[i];
+    std::lock_guard<std::mutex> lock(bucket.mutex);
+
+    if(!isBucketInWindow(bucket, t0, t1)) {
+      continue;
+    }
+
+    for(int r = r0; r <= r1; ++r) {
+      for(int c = c0; c <= c1; ++c) {
+        std::vector<TrackSample>& cell = bucket.cells[r * cols + c];
+        for(size_t k = 0; k < cell.size(); ++k) {
+          TrackSample& s = cell[k];
+          if(s.x >= x0 && s.x <= x1 && s.y >= y0 && s.y <= y1 && s.time_ns >= t0 && s.time_ns <= t1) {
+            result.push_back(s);
+          }
+        }
+      }
+    }
+  }
+
+  return result.size() - num;
+}
+
+size_t TrackIndex::queryTrackIds(float x0, float y0, float x1, float y1, uint64_t t0, uint64_t t1, std::vector<int32_t>& result) {
+
+  std::vector<TrackSample> samples;
+  queryRange(x0, y0, x1, y1, t0, t1, samples);
+
+  result.resize(samples.size());
+  for(size_t i = 0; i < samples.size(); ++i) {
+    result[i] = samples[i].id;
+  }
+
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+
+  return result.size();
+}
+
+size_t TrackIndex::queryWindow(uint64_t t0, uint64_t t1, std::vector<TrackSample>& result) {
+  return queryRange(-1e30f, -1e30f, 1e30f, 1e30f, t0, t1, result);
+}
+
+size_t TrackIndex::queryNearest(float x, float y, size_t k, uint64_t t0, uint64_t t1, std::vector<TrackSample>& result) {
+
+  result.clear();
+
+  if(0 == k) {
+    return 0;
+  }
+
+  std::vector<TrackNeighbour> found;
+  std::map<int32_t, size_t> found_ids;
+  int cx = getCellX(x);
+  int cy = getCellY(y);
+  int max_ring = std::max(std::max(cx, cols - 1 - cx), std::max(cy, rows - 1 - cy));
+
+  /* 
+     We visit the cells in rings around the cell of (x, y). A sample in a 
+     cell of ring r + 1 is at least r * cell_size away, so we can stop when
+     we have k tracks that are closer than that.
+  */
+  for(int ring = 0; ring <= max_ring; ++ring) {
+
+    int r0 = std::max(cy - ring, 0);
+    int r1 = std::min(cy + ring, rows - 1);
+    int c0 = std::max(cx - ring, 0);
+    int c1 = std::min(cx + ring, cols - 1);
+
+    for(uint32_t i = 0; i < num_buckets; ++i) {
+
+      TrackIndexBucket& bucket = buckets[i];
+      std::lock_guard<std::mutex> lock(bucket.mutex);
+
+      if(!isBucketInWindow(bucket, t0, t1)) {
+        continue;
+      }
+
+      for(int r = r0; r <= r1; ++r) {
+
+        /* Inside the ring we only visit the border cells. */
+        bool is_border_row = (r == cy - ring || r == cy + ring);
+        int step = (is_border_row) ? 1 : std::max(c1 - c0, 1);
+
+        for(int c = c0; c <= c1; c += step) {
+
+          if(!is_border_row && c != cx - ring && c != cx + ring) {
+            continue;
+          }
+
+          std::vector<TrackSample>& cell = bucket.cells[r * cols + c];
+          for(size_t j = 0; j < cell.size(); ++j) {
+
+            TrackSample& s = cell[j];
+            if(s.time_ns < t0 || s.time_ns > t1) {
+              continue;
+            }
+
+            float dx = s.x - x;
+            float dy = s.y - y;
+            float dist_sq = dx * dx + dy * dy;
+
+            std::map<int32_t, size_t>::iterator it = found_ids.find(s.id);
+            if(it == found_ids.end()) {
+              TrackNeighbour n;
+              n.dist_sq = dist_sq;
+              n.sample = s;
+              found_ids[s.id] = found.size();
+              found.push_back(n);
+            }
+            else if(dist_sq < found[it->second].dist_sq) {
+              found[it->second].dist_sq = dist_sq;
+              found[it->second].sample = s;
+            }
+          }
+        }
+      }
+    }
+
+    float bound = (float)ring * cell_size;
+    size_t num_closer = 0;
+    for(size_t i = 0; i < found.size(); ++i) {
+      num_closer += (found[i].dist_sq <= bound * bound);
+    }
+
+    if(num_closer >= k) {
+      break;
+    }
+  }
+
+  std::sort(found.begin(), found.end(), TrackNeighbourSorter());
+
+  for(size_t i = 0; i < found.size() && i < k; ++i) {
+    result.push_back(found[i].sample);
+  }
+
+  return result.size();
+}
+
+TrackIndexBucket* TrackIndex::lockBucket(uint64_t epoch) {
+
+  TrackIndexBucket& bucket = buckets[epoch % num_buckets];
+  bucket.mutex.lock();
+
+  if(bucket.epoch == epoch) {
+    return &bucket;
+  }
+
+  /* This bucket was reused for a newer epoch already: the samples are too old. */
+  if(UINT64_MAX != bucket.epoch && bucket.epoch > epoch) {
+    bucket.mutex.unlock();
+    return NULL;
+  }
+
+  for(size_t i = 0; i < bucket.used_cells.size(); ++i) {
+    bucket.cells[bucket.used_cells[i]].clear();
+  }
+
+  bucket.used_cells.clear();
+  bucket.num_samples = 0;
+  bucket.epoch = epoch;
+
+  return &bucket;
+}
+
+bool TrackIndex::isBucketInWindow(TrackIndexBucket& bucket, uint64_t t0, uint64_t t1) {
+
+  if(UINT64_MAX == bucket.epoch || 0 == bucket.num_samples) {
+    return false;
+  }
+
+  uint64_t start = bucket.epoch * bucket_ns;
+  uint64_t end = start + bucket_ns;
+
+  return start <= t1 && end > t0;
+}
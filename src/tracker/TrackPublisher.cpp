@@ -0,0 +1,221 @@
+#include <tracker/TrackPublisher.h>
+#include <tracker/Timings.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+/* ---------------------------------------------------*/
+
+struct TrackRecordIdSorter {
+  bool operator()(const TrackRecord& a, const TrackRecord& b) const {
+    return a.id < b.id;
+  }
+};
+
+/* The age of an unmatched blob changes every frame, so we ignore it. */
+static bool track_publisher_is_changed(const TrackRecord& a, const TrackRecord& b) {
+  return a.x != b.x
+    || a.y != b.y
+    || a.area != b.area
+    || a.direction_x != b.direction_x
+    || a.direction_y != b.direction_y
+    || a.frame_id != b.frame_id;
+}
+
+/* ---------------------------------------------------*/
+
+TrackPublisher::TrackPublisher()
+  :header(NULL)
+  ,mode(TRACK_PUBLISH_FULL)
+  ,keyframe_interval(8)
+  ,seq(0)
+  ,num_overflows(0)
+  ,num_bytes(0)
+{
+}
+
+TrackPublisher::~TrackPublisher() {
+  close();
+}
+
+bool TrackPublisher::open(std::string name, int publishMode, uint32_t maxTracks, uint32_t numSlots) {
+
+  if(isOpen()) {
+    printf("Error: the publisher is already open.\n");
+    return false;
+  }
+
+  if(0 == maxTracks || numSlots < 2) {
+    printf("Error: we need at least one track and two slots.\n");
+    return false;
+  }
+
+  if(TRACK_PUBLISH_FULL != publishMode && TRACK_PUBLISH_DELTA != publishMode) {
+    printf("Error: invalid publish mode: %d.\n", publishMode);
+    return false;
+  }
+
+  std::atomic<uint64_t> test(0);
+  if(!test.is_lock_free()) {
+    printf("Error: 64 bit atomics are not lock free on this platform; we can't share them with other processes.\n");
+    return false;
+  }
+
+  size_t slot_bytes = track_shm_get_slot_bytes(maxTracks);
+  size_t header_bytes = (sizeof(TrackShmHeader) + 63) & ~(size_t)63;
+  if(!track_shm_create(shm, name, header_bytes + numSlots * slot_bytes)) {
+    return false;
+  }
+
+  /* The memory is zeroed; a reader that maps it before we wrote the magic ignores it. */
+  header = track_shm_get_header(shm);
+  header->version = TRACK_SHM_VERSION;
+  header->num_slots = numSlots;
+  header->max_tracks = maxTracks;
+  header->slot_bytes = slot_bytes;
+  header->write_seq.store(0, std::memory_order_relaxed);
+  header->is_closed.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = TRACK_SHM_MAGIC;
+
+  mode = publishMode;
+  seq = 0;
+  num_overflows = 0;
+  num_bytes = 0;
+  published.clear();
+
+  return true;
+}
+
+void TrackPublisher::close() {
+
+  if(!isOpen()) {
+    return;
+  }
+
+  header->is_closed.store(1, std::memory_order_release);
+  header = NULL;
+
+  track_shm_close(shm);
+}
+
+bool TrackPublisher::isOpen() {
+  return NULL != header;
+}
+
+bool TrackPublisher::publish(BlobTracker& tracker) {
+
+  if(!isOpen()) {
+    printf("Error: cannot publish, the publisher is not open.\n");
+    return false;
+  }
+
+  updateRecords(tracker);
+
+  int interval = std::max(1, std::min(keyframe_interval, (int)header->num_slots / 2));
+  bool is_keyframe = (TRACK_PUBLISH_FULL == mode) || 0 == (seq % interval);
+
+  if(is_keyframe) {
+    writeSlot(TRACK_SLOT_FULL, records, tracker.frame);
+    published = records;
+    return true;
+  }
+
+  updateDelta();
+  writeSlot(TRACK_SLOT_DELTA, changed, tracker.frame);
+  published.swap(records);
+
+  return true;
+}
+
+void TrackPublisher::updateRecords(BlobTracker& tracker) {
+
+  records.resize(tracker.blobs.size());
+
+  for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+    Blob& blob = tracker.blobs[i];
+    TrackRecord& rec = records[i];
+    rec.id = blob.id;
+    rec.age = blob.age;
+    rec.area = blob.area;
+    rec.x = blob.position.x;
+    rec.y = blob.position.y;
+    rec.direction_x = blob.direction.x;
+    rec.direction_y = blob.direction.y;
+    rec.reserved = 0;
+    rec.frame_id = blob.frame_id;
+  }
+
+  /* New blobs are appended with a new id, so this is sorted already unless the blobs were restored or reordered. */
+  std::sort(records.begin(), records.end(), TrackRecordIdSorter());
+
+  if(records.size() > header->max_tracks) {
+    num_overflows += records.size() - header->max_tracks;
+    records.resize(header->max_tracks);
+  }
+}
+
+void TrackPublisher::updateDelta() {
+
+  changed.clear();
+  removed.clear();
+
+  /* Both tables are sorted on id. */
+  size_t i = 0;
+  size_t j = 0;
+
+  while(i < records.size() || j < published.size()) {
+    if(j == published.size() || (i < records.size() && records[i].id < published[j].id)) {
+      changed.push_back(records[i]);
+      ++i;
+    }
+    else if(i == records.size() || published[j].id < records[i].id) {
+      removed.push_back(published[j].id);
+      ++j;
+    }
+    else {
+      if(track_publisher_is_changed(records[i], published[j])) {
+        changed.push_back(records[i]);
+      }
+      else {
+        /* The readers keep the age of the last change; so do we. */
+        records[i].age = published[j].age;
+      }
+      ++i;
+      ++j;
+    }
+  }
+}
+
+void TrackPublisher::writeSlot(uint32_t flags, const std::vector<TrackRecord>& tracks, const FrameInfo& frame) {
+
+  ++seq;
+
+  TrackShmSlot* slot = track_shm_get_slot(shm, seq);
+  uint32_t num_removed = (TRACK_SLOT_DELTA == flags) ? (uint32_t)removed.size() : 0;
+
+  /* Readers that see an odd sequence (or a different one after copying) know the slot is being written. */
+  slot->seq.store(2 * seq - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->frame_id = frame.id;
+  slot->capture_ns = frame.capture_ns;
+  slot->publish_ns = tracker_now_ns();
+  slot->flags = flags;
+  slot->num_tracks = (uint32_t)tracks.size();
+  slot->num_removed = num_removed;
+  slot->num_total = (uint32_t)records.size();
+
+  if(!tracks.empty()) {
+    memcpy(track_shm_get_records(slot), &tracks[0], tracks.size() * sizeof(TrackRecord));
+  }
+
+  if(0 != num_removed) {
+    memcpy(track_shm_get_removed(slot, header->max_tracks), &removed[0], num_removed * sizeof(int32_t));
+  }
+
+  slot->seq.store(2 * seq, std::memory_order_release);
+  header->write_seq.store(seq, std::memory_order_release);
+
+  num_bytes += sizeof(TrackShmSlot) + tracks.size() * sizeof(TrackRecord) + num_removed * sizeof(int32_t);
+}
@@ -0,0 +1,250 @@
+#include <tracker/TrackReader.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ---------------------------------------------------*/
+
+TrackReader::TrackReader()
+  :header(NULL)
+  ,frame_id(0)
+  ,capture_ns(0)
+  ,publish_ns(0)
+  ,last_seq(0)
+  ,num_skipped(0)
+  ,num_resyncs(0)
+  ,num_retries(0)
+{
+}
+
+TrackReader::~TrackReader() {
+  close();
+}
+
+bool TrackReader::open(std::string segmentName) {
+
+  if(isOpen()) {
+    printf("Error: the reader is already open.\n");
+    return false;
+  }
+
+  name = segmentName;
+
+  return mapSegment();
+}
+
+void TrackReader::close() {
+
+  if(isOpen()) {
+    track_shm_close(shm);
+  }
+
+  header = NULL;
+  last_seq = 0;
+}
+
+bool TrackReader::isOpen() {
+  return NULL != header;
+}
+
+bool TrackReader::update() {
+
+  if(name.empty()) {
+    printf("Error: cannot update the reader, call open() first.\n");
+    return false;
+  }
+
+  if(isOpen() && 0 != header->is_closed.load(std::memory_order_acquire)) {
+    close();
+  }
+
+  if(!isOpen() && !mapSegment()) {
+    return false;
+  }
+
+  uint64_t prev_seq = last_seq;
+  uint64_t num_slots = header->num_slots;
+
+  /* We only retry when the publisher overwrote the slots we were reading, i.e. when we are very slow. */
+  for(int attempt = 0; attempt < 4; ++attempt) {
+
+    uint64_t write_seq = header->write_seq.load(std::memory_order_acquire);
+    if(write_seq <= last_seq) {
+      break;
+    }
+
+    /* Start at the newest full slot after `last_seq`, or when there is none, right after `last_seq`. */
+    uint64_t oldest = (write_seq > num_slots) ? write_seq - num_slots + 1 : 1;
+    uint64_t start = 0;
+    for(uint64_t s = write_seq; s >= oldest && s > last_seq; --s) {
+      uint32_t flags = 0;
+      if(!peekFlags(s, flags)) {
+        break;
+      }
+      if(0 != (flags & TRACK_SLOT_FULL)) {
+        start = s;
+        break;
+      }
+    }
+
+    if(0 == start) {
+      if(0 == last_seq || last_seq + 1 < oldest) {
+        ++num_retries;
+        continue;
+      }
+      start = last_seq + 1;
+    }
+
+    if(0 != last_seq && start > last_seq + 1) {
+      num_skipped += start - last_seq - 1;
+      if(last_seq + 1 < oldest) {
+        ++num_resyncs;
+      }
+    }
+
+    bool is_complete = true;
+    for(uint64_t s = start; s <= write_seq; ++s) {
+      if(!readSlot(s, slot)) {
+        ++num_retries;
+        is_complete = false;
+        break;
+      }
+      applySlot(slot);
+      last_seq = s;
+    }
+
+    if(is_complete) {
+      break;
+    }
+  }
+
+  return last_seq != prev_seq;
+}
+
+bool TrackReader::mapSegment() {
+
+  if(!track_shm_open(shm, name)) {
+    return false;
+  }
+
+  TrackShmHeader* hdr = track_shm_get_header(shm);
+  uint32_t magic = hdr->magic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  /* Not initialized yet, or written by another version. */
+  if(TRACK_SHM_MAGIC != magic || TRACK_SHM_VERSION != hdr->version) {
+    track_shm_close(shm);
+    return false;
+  }
+
+  size_t header_bytes = (sizeof(TrackShmHeader) + 63) & ~(size_t)63;
+  if(0 == hdr->num_slots
+     || hdr->slot_bytes != track_shm_get_slot_bytes(hdr->max_tracks)
+     || shm.nbytes < header_bytes + hdr->num_slots * hdr->slot_bytes)
+    {
+      printf("Error: the shared memory %s has an invalid size.\n", name.c_str());
+      track_shm_close(shm);
+      return false;
+    }
+
+  header = hdr;
+  last_seq = 0;
+
+  return true;
+}
+
+bool TrackReader::peekFlags(uint64_t s, uint32_t& flags) {
+
+  TrackShmSlot* p = track_shm_get_slot(shm, s);
+  uint64_t expected = 2 * s;
+
+  if(p->seq.load(std::memory_order_acquire) != expected) {
+    return false;
+  }
+
+  flags = p->flags;
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return p->seq.load(std::memory_order_relaxed) == expected;
+}
+
+bool TrackReader::readSlot(uint64_t s, TrackReaderSlot& out) {
+
+  TrackShmSlot* p = track_shm_get_slot(shm, s);
+  uint64_t expected = 2 * s;
+
+  if(p->seq.load(std::memory_order_acquire) != expected) {
+    return false;
+  }
+
+  out.flags = p->flags;
+  out.frame_id = p->frame_id;
+  out.capture_ns = p->capture_ns;
+  out.publish_ns = p->publish_ns;
+  out.num_total = p->num_total;
+
+  /* The counts may be garbage when the slot is being overwritten; the sequence check below catches that. */
+  uint32_t num_tracks = p->num_tracks;
+  uint32_t num_removed = p->num_removed;
+  if(num_tracks > header->max_tracks || num_removed > header->max_tracks) {
+    return false;
+  }
+
+  out.tracks.resize(num_tracks);
+  out.removed.resize(num_removed);
+
+  if(0 != num_tracks) {
+    memcpy(&out.tracks[0], track_shm_get_records(p), num_tracks * sizeof(TrackRecord));
+  }
+
+  if(0 != num_removed) {
+    memcpy(&out.removed[0], track_shm_get_removed(p, header->max_tracks), num_removed * sizeof(int32_t));
+  }
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return p->seq.load(std::memory_order_relaxed) == expected;
+}
+
+void TrackReader::applySlot(TrackReaderSlot& s) {
+
+  frame_id = s.frame_id;
+  capture_ns = s.capture_ns;
+  publish_ns = s.publish_ns;
+
+  if(0 != (s.flags & TRACK_SLOT_FULL)) {
+    tracks.swap(s.tracks);
+    return;
+  }
+
+  /* All lists are sorted on id: merge the changed tracks into ours and leave out the removed ones. */
+  merged.clear();
+
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+
+  while(i < tracks.size() || j < s.tracks.size()) {
+
+    bool take_new = (i == tracks.size()) || (j < s.tracks.size() && s.tracks[j].id <= tracks[i].id);
+    if(take_new) {
+      if(i < tracks.size() && tracks[i].id == s.tracks[j].id) {
+        ++i;
+      }
+      merged.push_back(s.tracks[j]);
+      ++j;
+      continue;
+    }
+
+    while(k < s.removed.size() && s.removed[k] < tracks[i].id) {
+      ++k;
+    }
+
+    if(k == s.removed.size() || s.removed[k] != tracks[i].id) {
+      merged.push_back(tracks[i]);
+    }
+
+    ++i;
+  }
+
+  tracks.swap(merged);
+}
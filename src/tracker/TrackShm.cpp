@@ -0,0 +1,213 @@
+#include <tracker/TrackShm.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+/* ---------------------------------------------------*/
+
+TrackShm::TrackShm()
+  :data(NULL)
+  ,nbytes(0)
+  ,is_owner(false)
+#if defined(_WIN32)
+  ,handle(NULL)
+#endif
+{
+}
+
+/* ---------------------------------------------------*/
+
+size_t track_shm_get_slot_bytes(uint32_t maxTracks) {
+  size_t nbytes = sizeof(TrackShmSlot) + maxTracks * sizeof(TrackRecord) + maxTracks * sizeof(int32_t);
+  return (nbytes + 63) & ~(size_t)63;
+}
+
+#if defined(_WIN32)
+
+/* Windows has no shm_open(); a named mapping backed by the page file lives as long as one process has it open. */
+static std::string track_shm_get_windows_name(std::string name) {
+  if(!name.empty() && '/' == name[0]) {
+    name = name.substr(1);
+  }
+  return "Local\\" +name;
+}
+
+bool track_shm_create(TrackShm& shm, std::string name, size_t nbytes) {
+
+  if(NULL != shm.data) {
+    printf("Error: cannot create %s, we already mapped %s.\n", name.c_str(), shm.name.c_str());
+    return false;
+  }
+
+  uint64_t n = nbytes;
+  HANDLE h = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(n >> 32), (DWORD)(n & 0xFFFFFFFF), track_shm_get_windows_name(name).c_str());
+  if(NULL == h) {
+    printf("Error: cannot create the shared memory %s.\n", name.c_str());
+    return false;
+  }
+
+  void* ptr = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, nbytes);
+  if(NULL == ptr) {
+    printf("Error: cannot map the shared memory %s.\n", name.c_str());
+    CloseHandle(h);
+    return false;
+  }
+
+  memset(ptr, 0, nbytes);
+
+  shm.name = name;
+  shm.data = (unsigned char*)ptr;
+  shm.nbytes = nbytes;
+  shm.handle = h;
+  shm.is_owner = true;
+
+  return true;
+}
+
+bool track_shm_open(TrackShm& shm, std::string name) {
+
+  if(NULL != shm.data) {
+    printf("Error: cannot open %s, we already mapped %s.\n", name.c_str(), shm.name.c_str());
+    return false;
+  }
+
+  HANDLE h = OpenFileMappingA(FILE_MAP_READ, FALSE, track_shm_get_windows_name(name).c_str());
+  if(NULL == h) {
+    return false;
+  }
+
+  void* ptr = MapViewOfFile(h, FILE_MAP_READ, 0, 0, 0);
+  if(NULL == ptr) {
+    printf("Error: cannot map the shared memory %s.\n", name.c_str());
+    CloseHandle(h);
+    return false;
+  }
+
+  MEMORY_BASIC_INFORMATION info;
+  VirtualQuery(ptr, &info, sizeof(info));
+
+  shm.name = name;
+  shm.data = (unsigned char*)ptr;
+  shm.nbytes = info.RegionSize;
+  shm.handle = h;
+  shm.is_owner = false;
+
+  return true;
+}
+
+void track_shm_close(TrackShm& shm) {
+
+  if(NULL != shm.data) {
+    UnmapViewOfFile(shm.data);
+  }
+
+  if(NULL != shm.handle) {
+    CloseHandle(shm.handle);
+  }
+
+  shm.data = NULL;
+  shm.nbytes = 0;
+  shm.handle = NULL;
+  shm.is_owner = false;
+}
+
+#else
+
+bool track_shm_create(TrackShm& shm, std::string name, size_t nbytes) {
+
+  if(NULL != shm.data) {
+    printf("Error: cannot create %s, we already mapped %s.\n", name.c_str(), shm.name.c_str());
+    return false;
+  }
+
+  /* A segment of a crashed publisher may still exist; readers that have it mapped keep their copy. */
+  shm_unlink(name.c_str());
+
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if(-1 == fd) {
+    printf("Error: cannot create the shared memory %s.\n", name.c_str());
+    return false;
+  }
+
+  if(0 != ftruncate(fd, (off_t)nbytes)) {
+    printf("Error: cannot resize the shared memory %s to %zu bytes.\n", name.c_str(), nbytes);
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  void* ptr = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if(MAP_FAILED == ptr) {
+    printf("Error: cannot map the shared memory %s.\n", name.c_str());
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  shm.name = name;
+  shm.data = (unsigned char*)ptr;
+  shm.nbytes = nbytes;
+  shm.is_owner = true;
+
+  return true;
+}
+
+bool track_shm_open(TrackShm& shm, std::string name) {
+
+  if(NULL != shm.data) {
+    printf("Error: cannot open %s, we already mapped %s.\n", name.c_str(), shm.name.c_str());
+    return false;
+  }
+
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if(-1 == fd) {
+    return false;
+  }
+
+  struct stat st;
+  if(0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(TrackShmHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  void* ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if(MAP_FAILED == ptr) {
+    printf("Error: cannot map the shared memory %s.\n", name.c_str());
+    return false;
+  }
+
+  shm.name = name;
+  shm.data = (unsigned char*)ptr;
+  shm.nbytes = (size_t)st.st_size;
+  shm.is_owner = false;
+
+  return true;
+}
+
+void track_shm_close(TrackShm& shm) {
+
+  if(NULL != shm.data) {
+    munmap(shm.data, shm.nbytes);
+  }
+
+  if(shm.is_owner) {
+    shm_unlink(shm.name.c_str());
+  }
+
+  shm.data = NULL;
+  shm.nbytes = 0;
+  shm.is_owner = false;
+}
+
+#endif
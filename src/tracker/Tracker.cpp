@@ -1,18 +1,27 @@
 #include <tracker/Tracker.h>
 
-Tracker::Tracker(int w, int h, int bgBuffersize) 
+Tracker::Tracker(int w, int h, int bgBuffersize, int bgFormat) 
   :w(w)
   ,h(h)
-  ,bg_buffer(w, h, bgBuffersize)
+  ,bg_buffer(w, h, bgBuffersize, bgFormat)
   ,edt(w, h)
   ,erode_steps(2)
   ,dilate_steps(3)
   ,blur(w, h)
   ,blobs(w, h)
   ,pbo_toggle(0)
+  ,frame_count(0)
+  ,gpu_timer(timings)
+  ,heatmap(NULL)
+  ,appearance(NULL)
 {
 #if 1
   pbos[0] = pbos[1] = 0;
+  blobs.timings = &timings;
+  graph.pool = &targets;
+
+  // We only blur the one channel mask.
+  blur.target_format = GL_R8;
 
   if(!blur.setup(1.0, 10, 1)) {
     printf("Error: cannot setup the blur handler.\n");
@@ -30,7 +39,9 @@ Tracker::Tracker(int w, int h, int bgBuffersize)
 #endif
 }
 
-void Tracker::beginFrame() {
+void Tracker::beginFrame(uint64_t captureNs) {
+  frame.id = ++frame_count;
+  frame.capture_ns = (captureNs) ? captureNs : tracker_now_ns();
   bg_buffer.beginFrame();
 }
 
@@ -38,33 +49,90 @@ void Tracker::endFrame() {
   bg_buffer.endFrame();
 }
 
+void Tracker::uploadFrame(const GLvoid* pixels, uint64_t captureNs) {
+  frame.id = ++frame_count;
+  frame.capture_ns = (captureNs) ? captureNs : tracker_now_ns();
+  bg_buffer.uploadFrame(pixels);
+}
+
+bool Tracker::addTexture(GLuint tex, int flags, uint64_t captureNs) {
+
+  uint64_t capture_ns = (captureNs) ? captureNs : tracker_now_ns();
+
+  /* A texture we couldn't add is not a frame; we keep the id and time of the last one. */
+  if(!bg_buffer.addTexture(tex, flags)) {
+    return false;
+  }
+
+  frame.id = ++frame_count;
+  frame.capture_ns = capture_ns;
+
+  return true;
+}
+
 void Tracker::apply() {
 
-  // Perform background subtraction, erode, dilate, blur and thresholding.
-  GLuint bg_tex = bg_buffer.apply();
-  GLuint eroded_tex = edt.erode(bg_tex, erode_steps);
-  GLuint dilated_tex = edt.dilate(eroded_tex, dilate_steps);
-  GLuint blurred_tex = blur.blur(dilated_tex);
-  GLuint thresholded_tex = edt.threshold(blurred_tex);
+  timings.beginCpu(TRACKER_STAGE_APPLY);
+  gpu_timer.beginFrame();
+
+  // Build the graph with background subtraction, erode, dilate, blur and thresholding.
+  graph.clear();
+  targets.reset();
+  GLuint bg_tex = bg_buffer.apply(graph);
+  GLuint eroded_tex = edt.erode(graph, bg_tex, erode_steps);
+  GLuint dilated_tex = edt.dilate(graph, eroded_tex, dilate_steps);
+  GLuint blurred_tex = blur.blur(graph, dilated_tex);
+  edt.threshold(graph, blurred_tex);
+
+  if(heatmap) {
+    heatmap->apply(graph, edt.getThresholdedTex(), frame);
+  }
+
+  if(appearance) {
+    GLuint color_tex = 0;
+    bool flip_y = false;
+    if(bg_buffer.getColorTexture(color_tex, flip_y)) {
+      appearance->apply(graph, color_tex, edt.getThresholdedTex(), frame, flip_y);
+    }
+    else {
+      printf("Error: the appearance needs the colours of the frame, but the texture you added only has luma; we disable the appearance.\n");
+      appearance = NULL;
+      blobs.appearance = NULL;
+    }
+  }
 
   // Read back the input for blob tracking into PBO "A"
-  edt.setThresholdOutputAsReadBuffer();
-  {
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[pbo_toggle]);
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glPixelStorei(GL_PACK_ROW_LENGTH, blobs.getInputImageRowLength());
-    glReadPixels(0, 0, w, h, GL_RED, GL_UNSIGNED_BYTE, NULL);
+  graph.addReadPixelsPass(TRACKER_STAGE_READBACK, edt.threshold_fbo, pbos[pbo_toggle], w, h, GL_RED, blobs.getInputImageRowLength());
+  pbo_frames[pbo_toggle] = frame;
+
+  graph.execute(&gpu_timer);
+
+  if(heatmap) {
+    heatmap->update();
   }
-  edt.resetReadBuffer();
 
   // Copy the pixels from the previous glReadPixels call (above) (PBO "B")
+  timings.beginCpu(TRACKER_STAGE_MAP);
   glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[1 - pbo_toggle]);
   unsigned char* ptr = (unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
   if(ptr) {
     memcpy(blobs.getInputImagePtr(), ptr,  w * h);
   }
   glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
-  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, graph.state.saved_pack_buffer);
+
+  // The histograms of the same frame as the mask.
+  if(appearance) {
+    appearance->update();
+    blobs.appearance = &appearance->table;
+  }
+  timings.endCpu(TRACKER_STAGE_MAP);
+
+  // The mask we just copied belongs to the frame of the previous apply().
+  blobs.frame = pbo_frames[1 - pbo_toggle];
+  if(blobs.frame.id) {
+    latency_mask.add(tracker_now_ns() - blobs.frame.capture_ns);
+  }
 
   // Toggle the pbos
   pbo_toggle = 1 - pbo_toggle;
@@ -72,9 +140,68 @@ void Tracker::apply() {
   // Perform tracking.
   blobs.track();
 
-  /* Reset defaults. */
-  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
-  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  if(blobs.frame.id) {
+    latency_tracks.add(tracker_now_ns() - blobs.frame.capture_ns);
+  }
+
+  timings.endCpu(TRACKER_STAGE_APPLY);
+}
+
+size_t Tracker::getNumBytes() {
+
+  size_t nbytes = bg_buffer.getNumBytes();
+
+  nbytes += edt.getNumBytes();
+  nbytes += blur.getNumBytes();
+  nbytes += targets.getNumBytes();
+  nbytes += 2 * w * h;            /* read back pbos */
+
+  if(heatmap) {
+    nbytes += heatmap->getNumBytes();
+  }
+
+  if(appearance) {
+    nbytes += appearance->getNumBytes();
+  }
+
+  return nbytes;
+}
+
+bool Tracker::saveSnapshot(std::string filepath) {
+
+  TrackerSnapshot snap;
+  bg_buffer.getSnapshotInfo(snap.header);
+  snap.header.frame_id = frame_count;
+
+  if(!snap.create(filepath, blobs)) {
+    return false;
+  }
+
+  if(!bg_buffer.saveHistory(snap)) {
+    return false;
+  }
+
+  return snap.commit();
+}
+
+bool Tracker::loadSnapshot(std::string filepath) {
+
+  TrackerSnapshot snap;
+  if(!snap.open(filepath)) {
+    return false;
+  }
+
+  if(!bg_buffer.loadHistory(snap)) {
+    return false;
+  }
+
+  if(!snap.restoreBlobs(blobs)) {
+    return false;
+  }
+
+  frame_count = snap.header.frame_id;
+
+  return true;
 }
 
 void Tracker::draw() {
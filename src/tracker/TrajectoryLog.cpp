@@ -0,0 +1,509 @@
+#include <tracker/TrajectoryLog.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+
+#if defined(_WIN32)
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+/* ---------------------------------------------------*/
+
+static bool trajectory_file_exists(std::string path);
+static uint64_t trajectory_align(uint64_t offset);
+static bool trajectory_get_file_size(std::string path, uint64_t& size);
+static bool trajectory_truncate(std::string path, uint64_t size);
+
+/* ---------------------------------------------------*/
+
+size_t trajectory_get_column_size(int column) {
+
+  switch(column) {
+    case TRAJ_COLUMN_FRAME:        { return sizeof(uint64_t); }
+    case TRAJ_COLUMN_ID:           { return sizeof(int32_t);  }
+    case TRAJ_COLUMN_X:            { return sizeof(float);    }
+    case TRAJ_COLUMN_Y:            { return sizeof(float);    }
+    case TRAJ_COLUMN_AREA:         { return sizeof(int32_t);  }
+    case TRAJ_COLUMN_DIRECTION_X:  { return sizeof(float);    }
+    case TRAJ_COLUMN_DIRECTION_Y:  { return sizeof(float);    }
+    default:                       { return 0;                }
+  }
+}
+
+std::string trajectory_get_segment_path(std::string prefix, uint32_t segment) {
+  char num[16];
+  snprintf(num, sizeof(num), ".%06u", segment);
+  return prefix +num;
+}
+
+bool trajectory_read_index(std::string prefix, std::vector<TrajectoryIndexEntry>& entries) {
+
+  entries.clear();
+
+  std::string path = prefix +".index";
+  FILE* fp = fopen(path.c_str(), "rb");
+  if(NULL == fp) {
+    return false;
+  }
+
+  TrajectoryIndexHeader hdr;
+  if(1 != fread(&hdr, sizeof(hdr), 1, fp) || TRAJ_INDEX_MAGIC != hdr.magic || TRAJ_FILE_VERSION != hdr.version) {
+    printf("Error: %s is not a trajectory index.\n", path.c_str());
+    fclose(fp);
+    return false;
+  }
+
+  /* A partially written last entry (a crash while appending) is ignored. */
+  TrajectoryIndexEntry entry;
+  while(1 == fread(&entry, sizeof(entry), 1, fp)) {
+    entries.push_back(entry);
+  }
+
+  fclose(fp);
+
+  /* The segment that was open when the log was closed or crashed is not in the index yet. */
+  uint32_t next = (entries.empty()) ? 0 : entries.back().segment + 1;
+  while(trajectory_file_exists(trajectory_get_segment_path(prefix, next))) {
+
+    MappedFile file;
+    if(!file.open(trajectory_get_segment_path(prefix, next), false) || file.size < sizeof(TrajectorySegmentHeader)) {
+      break;
+    }
+
+    TrajectorySegmentHeader* seg = (TrajectorySegmentHeader*)file.data;
+    if(TRAJ_SEGMENT_MAGIC != seg->magic || TRAJ_FILE_VERSION != seg->version) {
+      break;
+    }
+
+    entry.segment = next;
+    entry.reason = TRAJ_ROLL_NONE;
+    entry.num_samples = seg->num_samples;
+    entry.first_frame = seg->first_frame;
+    entry.last_frame = seg->last_frame;
+    entry.first_ns = seg->first_ns;
+    entry.last_ns = seg->last_ns;
+    entries.push_back(entry);
+
+    ++next;
+  }
+
+  return true;
+}
+
+/* ---------------------------------------------------*/
+
+TrajectoryLog::TrajectoryLog()
+  :capacity(0)
+  ,segment_duration_ms(0)
+  ,next_segment(0)
+  ,index_fp(NULL)
+  ,header(NULL)
+  ,num_samples(0)
+  ,num_segments(0)
+{
+  memset(columns, 0, sizeof(columns));
+}
+
+TrajectoryLog::~TrajectoryLog() {
+  close();
+}
+
+bool TrajectoryLog::open(std::string filePrefix, uint32_t numSamples) {
+
+  if(isOpen()) {
+    printf("Error: the trajectory log is already open.\n");
+    return false;
+  }
+
+  if(0 == numSamples) {
+    printf("Error: the capacity of a trajectory segment must be > 0.\n");
+    return false;
+  }
+
+  std::string index_path = filePrefix +".index";
+  std::vector<TrajectoryIndexEntry> entries;
+  bool has_index = trajectory_file_exists(index_path);
+
+  size_t num_indexed = 0;
+
+  if(has_index) {
+
+    if(!trajectory_read_index(filePrefix, entries)) {
+      return false;
+    }
+
+    /* The entries after the ones in the file are the segments we found on disk. */
+    uint64_t index_size = 0;
+    if(!trajectory_get_file_size(index_path, index_size)) {
+      return false;
+    }
+
+    num_indexed = (index_size - sizeof(TrajectoryIndexHeader)) / sizeof(TrajectoryIndexEntry);
+
+    /* Cut off a partially written entry, otherwise every entry we append is misaligned. */
+    uint64_t valid_size = sizeof(TrajectoryIndexHeader) + num_indexed * sizeof(TrajectoryIndexEntry);
+    if(valid_size != index_size && !trajectory_truncate(index_path, valid_size)) {
+      return false;
+    }
+  }
+
+  index_fp = fopen(index_path.c_str(), (has_index) ? "ab" : "wb");
+  if(NULL == index_fp) {
+    printf("Error: cannot open %s.\n", index_path.c_str());
+    return false;
+  }
+
+  if(!has_index) {
+    TrajectoryIndexHeader hdr;
+    hdr.magic = TRAJ_INDEX_MAGIC;
+    hdr.version = TRAJ_FILE_VERSION;
+    if(1 != fwrite(&hdr, sizeof(hdr), 1, index_fp)) {
+      printf("Error: cannot write the header of %s.\n", index_path.c_str());
+      fclose(index_fp);
+      index_fp = NULL;
+      return false;
+    }
+  }
+
+  /* Index the segments of a previous run that crashed; the ones in the index already are indexed. */
+  for(size_t i = num_indexed; i < entries.size(); ++i) {
+    if(1 != fwrite(&entries[i], sizeof(entries[i]), 1, index_fp)) {
+      printf("Error: cannot index segment %u in %s.\n", entries[i].segment, index_path.c_str());
+      fclose(index_fp);
+      index_fp = NULL;
+      return false;
+    }
+  }
+  fflush(index_fp);
+
+  prefix = filePrefix;
+  capacity = numSamples;
+  next_segment = (entries.empty()) ? 0 : entries.back().segment + 1;
+  num_samples = 0;
+  num_segments = 0;
+
+  return true;
+}
+
+bool TrajectoryLog::append(BlobTracker& tracker) {
+
+  if(!isOpen()) {
+    printf("Error: cannot append, the trajectory log is not open.\n");
+    return false;
+  }
+
+  /* We log the blobs that were seen in this frame; the others only aged. */
+  FrameInfo& frame = tracker.frame;
+  uint32_t num = 0;
+  for(size_t i = 0; i < tracker.blobs.size(); ++i) {
+    num += (tracker.blobs[i].frame_id == frame.id);
+  }
+
+  if(0 == num) {
+    return true;
+  }
+
+  if(num > capacity) {
+    printf("Error: %u blobs don't fit in a trajectory segment of %u samples, we drop some.\n", num, capacity);
+    num = capacity;
+  }
+
+  if(NULL != header && header->num_samples + num > capacity) {
+    closeSegment(TRAJ_ROLL_SIZE);
+  }
+
+  if(NULL != header
+     && 0 != segment_duration_ms
+     && frame.capture_ns - header->first_ns >= segment_duration_ms * 1000000ull)
+    {
+      closeSegment(TRAJ_ROLL_TIME);
+    }
+
+  if(NULL == header && !createSegment()) {
+    return false;
+  }
+
+  uint64_t* frame_ids = (uint64_t*)columns[TRAJ_COLUMN_FRAME];
+  int32_t* ids = (int32_t*)columns[TRAJ_COLUMN_ID];
+  float* xs = (float*)columns[TRAJ_COLUMN_X];
+  float* ys = (float*)columns[TRAJ_COLUMN_Y];
+  int32_t* areas = (int32_t*)columns[TRAJ_COLUMN_AREA];
+  float* dxs = (float*)columns[TRAJ_COLUMN_DIRECTION_X];
+  float* dys = (float*)columns[TRAJ_COLUMN_DIRECTION_Y];
+
+  uint64_t dx = header->num_samples;
+  uint64_t end = dx + num;
+
+  for(size_t i = 0; i < tracker.blobs.size() && dx < end; ++i) {
+
+    Blob& blob = tracker.blobs[i];
+    if(blob.frame_id != frame.id) {
+      continue;
+    }
+
+    frame_ids[dx] = frame.id;
+    ids[dx] = blob.id;
+    xs[dx] = blob.position.x;
+    ys[dx] = blob.position.y;
+    areas[dx] = blob.area;
+    dxs[dx] = blob.direction.x;
+    dys[dx] = blob.direction.y;
+    ++dx;
+  }
+
+  if(0 == header->num_samples) {
+    header->first_frame = frame.id;
+    header->first_ns = frame.capture_ns;
+  }
+
+  header->last_frame = frame.id;
+  header->last_ns = frame.capture_ns;
+
+  /* A reader in another process only reads the samples of complete frames. */
+  std::atomic_thread_fence(std::memory_order_release);
+  header->num_samples = end;
+
+  num_samples += num;
+
+  return true;
+}
+
+bool TrajectoryLog::close() {
+
+  if(!isOpen()) {
+    return true;
+  }
+
+  bool r = closeSegment(TRAJ_ROLL_CLOSE);
+
+  fclose(index_fp);
+  index_fp = NULL;
+
+  return r;
+}
+
+bool TrajectoryLog::createSegment() {
+
+  TrajectorySegmentHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = TRAJ_SEGMENT_MAGIC;
+  hdr.version = TRAJ_FILE_VERSION;
+  hdr.segment = next_segment;
+  hdr.capacity = capacity;
+  hdr.created_unix = (uint64_t)time(NULL);
+
+  /* Every column starts on its own page, see the top of TrajectoryLog.h */
+  uint64_t offset = trajectory_align(sizeof(hdr));
+  for(int i = 0; i < TRAJ_NUM_COLUMNS; ++i) {
+    hdr.column_offsets[i] = offset;
+    offset = trajectory_align(offset + (uint64_t)capacity * trajectory_get_column_size(i));
+  }
+
+  if(!segment.create(trajectory_get_segment_path(prefix, next_segment), offset)) {
+    return false;
+  }
+
+  memcpy(segment.data, &hdr, sizeof(hdr));
+  header = (TrajectorySegmentHeader*)segment.data;
+
+  for(int i = 0; i < TRAJ_NUM_COLUMNS; ++i) {
+    columns[i] = segment.data + hdr.column_offsets[i];
+  }
+
+  ++next_segment;
+  ++num_segments;
+
+  return true;
+}
+
+bool TrajectoryLog::closeSegment(uint32_t reason) {
+
+  if(NULL == header) {
+    return true;
+  }
+
+  bool r = writeIndexEntry(header, reason);
+
+  /* We don't flush when we roll over: the kernel writes the pages back and they survive a crash of the application. */
+  if(TRAJ_ROLL_CLOSE == reason && !segment.flush()) {
+    r = false;
+  }
+
+  segment.close();
+  header = NULL;
+  memset(columns, 0, sizeof(columns));
+
+  return r;
+}
+
+bool TrajectoryLog::writeIndexEntry(TrajectorySegmentHeader* hdr, uint32_t reason) {
+
+  TrajectoryIndexEntry entry;
+  entry.segment = hdr->segment;
+  entry.reason = reason;
+  entry.num_samples = hdr->num_samples;
+  entry.first_frame = hdr->first_frame;
+  entry.last_frame = hdr->last_frame;
+  entry.first_ns = hdr->first_ns;
+  entry.last_ns = hdr->last_ns;
+
+  if(1 != fwrite(&entry, sizeof(entry), 1, index_fp) || 0 != fflush(index_fp)) {
+    printf("Error: cannot write the index entry of segment %u.\n", entry.segment);
+    return false;
+  }
+
+  return true;
+}
+
+/* ---------------------------------------------------*/
+
+TrajectoryReader::TrajectoryReader()
+  :header(NULL)
+  ,num_samples(0)
+{
+}
+
+TrajectoryReader::~TrajectoryReader() {
+  close();
+}
+
+bool TrajectoryReader::open(std::string filePrefix) {
+
+  close();
+
+  if(!trajectory_read_index(filePrefix, index)) {
+    printf("Error: cannot read the trajectory index of %s.\n", filePrefix.c_str());
+    return false;
+  }
+
+  prefix = filePrefix;
+
+  return true;
+}
+
+bool TrajectoryReader::mapSegment(uint32_t dx) {
+
+  if(dx >= index.size()) {
+    printf("Error: there is no segment with index %u.\n", dx);
+    return false;
+  }
+
+  segment.close();
+  header = NULL;
+  num_samples = 0;
+
+  std::string path = trajectory_get_segment_path(prefix, index[dx].segment);
+  if(!segment.open(path)) {
+    return false;
+  }
+
+  TrajectorySegmentHeader* hdr = (TrajectorySegmentHeader*)segment.data;
+  if(segment.size < sizeof(TrajectorySegmentHeader) || TRAJ_SEGMENT_MAGIC != hdr->magic || TRAJ_FILE_VERSION != hdr->version) {
+    printf("Error: %s is not a trajectory segment.\n", path.c_str());
+    segment.close();
+    return false;
+  }
+
+  for(int i = 0; i < TRAJ_NUM_COLUMNS; ++i) {
+    if(hdr->column_offsets[i] + (uint64_t)hdr->capacity * trajectory_get_column_size(i) > segment.size) {
+      printf("Error: %s is truncated.\n", path.c_str());
+      segment.close();
+      return false;
+    }
+  }
+
+  /* The log may still be appending to this segment; see TrajectoryLog::append(). */
+  uint64_t num = hdr->num_samples;
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  header = hdr;
+  num_samples = (num < hdr->capacity) ? num : hdr->capacity;
+
+  return true;
+}
+
+const void* TrajectoryReader::getColumn(int column) {
+
+  if(NULL == header) {
+    printf("Error: cannot get a column, no segment mapped.\n");
+    return NULL;
+  }
+
+  if(column < 0 || column >= TRAJ_NUM_COLUMNS) {
+    printf("Error: invalid trajectory column: %d.\n", column);
+    return NULL;
+  }
+
+  return segment.data + header->column_offsets[column];
+}
+
+void TrajectoryReader::close() {
+  segment.close();
+  header = NULL;
+  num_samples = 0;
+  index.clear();
+}
+
+/* ---------------------------------------------------*/
+
+static bool trajectory_file_exists(std::string path) {
+
+  FILE* fp = fopen(path.c_str(), "rb");
+  if(NULL == fp) {
+    return false;
+  }
+
+  fclose(fp);
+  return true;
+}
+
+static bool trajectory_get_file_size(std::string path, uint64_t& size) {
+
+  FILE* fp = fopen(path.c_str(), "rb");
+  if(NULL == fp) {
+    printf("Error: cannot open %s.\n", path.c_str());
+    return false;
+  }
+
+  fseek(fp, 0, SEEK_END);
+  long pos = ftell(fp);
+  fclose(fp);
+
+  if(pos < 0) {
+    printf("Error: cannot get the size of %s.\n", path.c_str());
+    return false;
+  }
+
+  size = (uint64_t)pos;
+  return true;
+}
+
+static bool trajectory_truncate(std::string path, uint64_t size) {
+
+  FILE* fp = fopen(path.c_str(), "r+b");
+  if(NULL == fp) {
+    printf("Error: cannot open %s to truncate it.\n", path.c_str());
+    return false;
+  }
+
+#if defined(_WIN32)
+  int r = _chsize_s(_fileno(fp), (__int64)size);
+#else
+  int r = ftruncate(fileno(fp), (off_t)size);
+#endif
+
+  fclose(fp);
+
+  if(0 != r) {
+    printf("Error: cannot truncate %s.\n", path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+static uint64_t trajectory_align(uint64_t offset) {
+  return (offset + TRAJ_PAGE_SIZE - 1) & ~(uint64_t)(TRAJ_PAGE_SIZE - 1);
+}
@@ -0,0 +1,335 @@
+#include <tracker/ZoneCounter.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+/* ---------------------------------------------------*/
+
+/* The z of (b - a) x (p - a); < 0 when p is on the side the normal (dy, -dx) of a -> b points to. */
+static float zone_cross(float ax, float ay, float bx, float by, float px, float py) {
+  return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+/* ---------------------------------------------------*/
+
+ZoneShape::ZoneShape()
+  :type(ZONE_SHAPE_LINE)
+  ,min_x(0.0f)
+  ,min_y(0.0f)
+  ,max_x(0.0f)
+  ,max_y(0.0f)
+  ,num_forward(0)
+  ,num_backward(0)
+  ,num_enters(0)
+  ,num_exits(0)
+  ,occupancy(0)
+{
+}
+
+/* ---------------------------------------------------*/
+
+ZoneCounter::ZoneCounter(int w, int h, int cellSize)
+  :w(w)
+  ,h(h)
+  ,cell_size(cellSize)
+  ,cols(0)
+  ,rows(0)
+  ,stamp(0)
+  ,is_grid_dirty(false)
+  ,callback(NULL)
+  ,user(NULL)
+  ,num_tests(0)
+{
+  if(w <= 0 || h <= 0 || cellSize <= 0) {
+    printf("Error: invalid size or cell size for the ZoneCounter.\n");
+    ::exit(EXIT_FAILURE);
+  }
+
+  cols = (w + cell_size - 1) / cell_size;
+  rows = (h + cell_size - 1) / cell_size;
+  cells.resize(cols * rows);
+}
+
+int ZoneCounter::addLine(float x0, float y0, float x1, float y1) {
+
+  ZoneShape shape;
+  shape.type = ZONE_SHAPE_LINE;
+
+  ZonePoint a = { x0, y0 };
+  ZonePoint b = { x1, y1 };
+  shape.points.push_back(a);
+  shape.points.push_back(b);
+  shape.min_x = std::min(x0, x1);
+  shape.max_x = std::max(x0, x1);
+  shape.min_y = std::min(y0, y1);
+  shape.max_y = std::max(y0, y1);
+
+  shapes.push_back(shape);
+  stamps.push_back(0);
+  is_grid_dirty = true;
+
+  return (int)shapes.size() - 1;
+}
+
+int ZoneCounter::addZone(const float* xy, int numPoints) {
+
+  if(NULL == xy || numPoints < 3) {
+    printf("Error: a zone needs at least 3 points.\n");
+    return -1;
+  }
+
+  ZoneShape shape;
+  shape.type = ZONE_SHAPE_POLYGON;
+  shape.min_x = shape.max_x = xy[0];
+  shape.min_y = shape.max_y = xy[1];
+
+  for(int i = 0; i < numPoints; ++i) {
+    ZonePoint p = { xy[i * 2 + 0], xy[i * 2 + 1] };
+    shape.points.push_back(p);
+    shape.min_x = std::min(shape.min_x, p.x);
+    shape.max_x = std::max(shape.max_x, p.x);
+    shape.min_y = std::min(shape.min_y, p.y);
+    shape.max_y = std::max(shape.max_y, p.y);
+  }
+
+  shapes.push_back(shape);
+  stamps.push_back(0);
+  is_grid_dirty = true;
+
+  return (int)shapes.size() - 1;
+}
+
+void ZoneCounter::clear() {
+
+  shapes.clear();
+  stamps.clear();
+  candidates.clear();
+  events.clear();
+
+  for(size_t i = 0; i < cells.size(); ++i) {
+    cells[i].clear();
+  }
+
+  is_grid_dirty = false;
+}
+
+void ZoneCounter::resetCounters() {
+  for(size_t i = 0; i < shapes.size(); ++i) {
+    ZoneShape& shape = shapes[i];
+    shape.num_forward = 0;
+    shape.num_backward = 0;
+    shape.num_enters = 0;
+    shape.num_exits = 0;
+  }
+}
+
+void ZoneCounter::beginFrame(const FrameInfo& currentFrame) {
+
+  frame = currentFrame;
+  events.clear();
+
+  if(is_grid_dirty) {
+    updateGrid();
+  }
+}
+
+void ZoneCounter::appear(int trackId, float x, float y) {
+
+  collect(x, y, x, y);
+  num_tests += candidates.size();
+
+  for(size_t i = 0; i < candidates.size(); ++i) {
+    int dx = candidates[i];
+    if(ZONE_SHAPE_POLYGON == shapes[dx].type && isInside(dx, x, y)) {
+      emit(ZONE_EVENT_ENTER, dx, trackId, x, y);
+    }
+  }
+}
+
+void ZoneCounter::move(int trackId, float x0, float y0, float x1, float y1) {
+
+  if(x0 == x1 && y0 == y1) {
+    return;
+  }
+
+  collect(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+  num_tests += candidates.size();
+
+  for(size_t i = 0; i < candidates.size(); ++i) {
+
+    int dx = candidates[i];
+    ZoneShape& shape = shapes[dx];
+
+    if(ZONE_SHAPE_POLYGON == shape.type) {
+      bool was_inside = isInside(dx, x0, y0);
+      bool is_inside = isInside(dx, x1, y1);
+      if(was_inside != is_inside) {
+        emit((is_inside) ? ZONE_EVENT_ENTER : ZONE_EVENT_EXIT, dx, trackId, x1, y1);
+      }
+      continue;
+    }
+
+    /* The movement must go from one side of the line to the other ... */
+    ZonePoint& a = shape.points[0];
+    ZonePoint& b = shape.points[1];
+    float s0 = zone_cross(a.x, a.y, b.x, b.y, x0, y0);
+    float s1 = zone_cross(a.x, a.y, b.x, b.y, x1, y1);
+    if((s0 >= 0.0f) == (s1 >= 0.0f)) {
+      continue;
+    }
+
+    /* ... and a and b must be on different sides of the movement. */
+    float ta = zone_cross(x0, y0, x1, y1, a.x, a.y);
+    float tb = zone_cross(x0, y0, x1, y1, b.x, b.y);
+    if(ta * tb > 0.0f) {
+      continue;
+    }
+
+    emit((s1 < 0.0f) ? ZONE_EVENT_FORWARD : ZONE_EVENT_BACKWARD, dx, trackId, x1, y1);
+  }
+}
+
+void ZoneCounter::disappear(int trackId, float x, float y) {
+
+  collect(x, y, x, y);
+  num_tests += candidates.size();
+
+  for(size_t i = 0; i < candidates.size(); ++i) {
+    int dx = candidates[i];
+    if(ZONE_SHAPE_POLYGON == shapes[dx].type && isInside(dx, x, y)) {
+      emit(ZONE_EVENT_EXIT, dx, trackId, x, y);
+    }
+  }
+}
+
+void ZoneCounter::restoreOccupancy(const float* xy, size_t num) {
+
+  for(size_t i = 0; i < shapes.size(); ++i) {
+    shapes[i].occupancy = 0;
+  }
+
+  for(size_t i = 0; i < num; ++i) {
+
+    float x = xy[i * 2 + 0];
+    float y = xy[i * 2 + 1];
+    collect(x, y, x, y);
+
+    for(size_t k = 0; k < candidates.size(); ++k) {
+      int dx = candidates[k];
+      if(ZONE_SHAPE_POLYGON == shapes[dx].type && isInside(dx, x, y)) {
+        shapes[dx].occupancy++;
+      }
+    }
+  }
+}
+
+/* Crossing number test; a point on the left or bottom edge is inside, on the right or top edge outside. */
+bool ZoneCounter::isInside(int shape, float x, float y) {
+
+  ZoneShape& s = shapes[shape];
+  if(x < s.min_x || x > s.max_x || y < s.min_y || y > s.max_y) {
+    return false;
+  }
+
+  bool inside = false;
+  size_t n = s.points.size();
+
+  for(size_t i = 0, j = n - 1; i < n; j = i++) {
+    const ZonePoint& a = s.points[i];
+    const ZonePoint& b = s.points[j];
+    if((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x) {
+      inside = !inside;
+    }
+  }
+
+  return inside;
+}
+
+void ZoneCounter::updateGrid() {
+
+  for(size_t i = 0; i < cells.size(); ++i) {
+    cells[i].clear();
+  }
+
+  for(size_t k = 0; k < shapes.size(); ++k) {
+
+    ZoneShape& s = shapes[k];
+    int c0 = std::max(0, std::min(cols - 1, (int)(s.min_x / cell_size)));
+    int c1 = std::max(0, std::min(cols - 1, (int)(s.max_x / cell_size)));
+    int r0 = std::max(0, std::min(rows - 1, (int)(s.min_y / cell_size)));
+    int r1 = std::max(0, std::min(rows - 1, (int)(s.max_y / cell_size)));
+
+    for(int r = r0; r <= r1; ++r) {
+      for(int c = c0; c <= c1; ++c) {
+        cells[r * cols + c].push_back((int)k);
+      }
+    }
+  }
+
+  /* A movement can't find more shapes than we have; so collect() doesn't allocate while tracking. */
+  candidates.reserve(shapes.size());
+
+  is_grid_dirty = false;
+}
+
+void ZoneCounter::collect(float x0, float y0, float x1, float y1) {
+
+  candidates.clear();
+
+  if(shapes.empty()) {
+    return;
+  }
+
+  if(is_grid_dirty) {
+    updateGrid();
+  }
+
+  /* The stamps wrap after 4 billion calls; start over so a stale stamp can't match. */
+  if(0 == ++stamp) {
+    std::fill(stamps.begin(), stamps.end(), 0);
+    stamp = 1;
+  }
+
+  int c0 = std::max(0, std::min(cols - 1, (int)(x0 / cell_size)));
+  int c1 = std::max(0, std::min(cols - 1, (int)(x1 / cell_size)));
+  int r0 = std::max(0, std::min(rows - 1, (int)(y0 / cell_size)));
+  int r1 = std::max(0, std::min(rows - 1, (int)(y1 / cell_size)));
+
+  for(int r = r0; r <= r1; ++r) {
+    for(int c = c0; c <= c1; ++c) {
+      std::vector<int>& cell = cells[r * cols + c];
+      for(size_t i = 0; i < cell.size(); ++i) {
+        int dx = cell[i];
+        if(stamps[dx] != stamp) {
+          stamps[dx] = stamp;
+          candidates.push_back(dx);
+        }
+      }
+    }
+  }
+}
+
+void ZoneCounter::emit(int type, int shape, int trackId, float x, float y) {
+
+  ZoneShape& s = shapes[shape];
+
+  switch(type) {
+    case ZONE_EVENT_FORWARD:   { s.num_forward++;                  break; }
+    case ZONE_EVENT_BACKWARD:  { s.num_backward++;                 break; }
+    case ZONE_EVENT_ENTER:     { s.num_enters++; s.occupancy++;    break; }
+    case ZONE_EVENT_EXIT:      { s.num_exits++; s.occupancy -= (s.occupancy > 0) ? 1 : 0; break; }
+  }
+
+  ZoneEvent ev;
+  ev.type = type;
+  ev.shape = shape;
+  ev.track_id = trackId;
+  ev.frame_id = frame.id;
+  ev.x = x;
+  ev.y = y;
+  events.push_back(ev);
+
+  if(callback) {
+    callback(this, ev, user);
+  }
+}